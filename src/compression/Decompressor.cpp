@@ -36,6 +36,22 @@ void DecompressorBase::removeFile(const PPSystemString& fileName)
 	XMFile::remove(fileName);
 }
 
+bool DecompressorBase::decompressToFile(const PPSystemString& outFileName, Hints hint)
+{
+	bool result = false;
+	
+	{
+		XMFile f(outFileName, true);
+		if (f.isOpenForWriting())
+			result = decompress(f, hint);
+	}
+	
+	if (!result)
+		removeFile(outFileName);
+	
+	return result;
+}
+
 bool DecompressorBase::identify()
 {
 	XMFile f(fileName);
@@ -59,7 +75,7 @@ Decompressor::Decompressor(const PPSystemString& fileName) :
 	adjustFilenames(fileName);
 }
 	
-bool Decompressor::identify(XMFile& f)
+bool Decompressor::identify(XMFileBase& f)
 {
 	for (pp_int32 i = 0; i < decompressors.size(); i++)
 	{
@@ -114,23 +130,37 @@ const PPSimpleVector<Descriptor>& Decompressor::getDescriptors(Hints hint) const
 	return descriptors;
 }
 	
-bool Decompressor::decompress(const PPSystemString& outFileName, Hints hint)
+bool Decompressor::decompress(XMFileBase& outFile, Hints hint)
 {
-	bool result = false;
+	const mp_uint32 start = outFile.pos();
+
 	for (pp_int32 i = 0; i < decompressors.size(); i++)
 	{
 		if (decompressors.get(i)->identify())
 		{
-			result = decompressors.get(i)->decompress(outFileName, hint);
-			if (result)
-				break;
+			if (decompressors.get(i)->decompress(outFile, hint))
+				return true;
+			
+			// a failing decompressor might leave partial data behind
+			if (outFile.pos() != start && !outFile.truncate(start))
+				return false;
 		}
 	}
 	
-	if (!result)
-		removeFile(outFileName);
+	return false;
+}
+
+bool Decompressor::decompressToFile(const PPSystemString& outFileName, Hints hint)
+{
+	// every attempt starts over with a new file
+	for (pp_int32 i = 0; i < decompressors.size(); i++)
+	{
+		if (decompressors.get(i)->identify() &&
+			decompressors.get(i)->decompressToFile(outFileName, hint))
+			return true;
+	}
 	
-	return result;
+	return false;
 }
 
 DecompressorBase* Decompressor::clone()
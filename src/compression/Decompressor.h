@@ -35,6 +35,7 @@
 #include "SimpleVector.h"
 
 class XMFile;
+class XMFileBase;
 
 class DecompressorBase
 {
@@ -58,7 +59,7 @@ public:
 	{
 	}
 	
-	virtual bool identify(XMFile& f) = 0;
+	virtual bool identify(XMFileBase& f) = 0;
 
 	virtual bool identify();
 	
@@ -66,7 +67,10 @@ public:
 	
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const = 0;
 	
-	virtual bool decompress(const PPSystemString& outFileName, Hints hint) = 0;
+	// Decompress into any kind of file, use an XMFileBuffer to stay in memory
+	virtual bool decompress(XMFileBase& outFile, Hints hint) = 0;
+	
+	virtual bool decompressToFile(const PPSystemString& outFileName, Hints hint);
 	
 	static void removeFile(const PPSystemString& fileName);
 	
@@ -88,13 +92,15 @@ class Decompressor : public DecompressorBase
 public:
 	Decompressor(const PPSystemString& fileName);
 
-	virtual bool identify(XMFile& f);
+	virtual bool identify(XMFileBase& f);
 	
 	virtual bool doesServeHint(Hints hint);
 	
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const;
 
-	virtual bool decompress(const PPSystemString& outFileName, Hints hint);
+	virtual bool decompress(XMFileBase& outFile, Hints hint);
+	
+	virtual bool decompressToFile(const PPSystemString& outFileName, Hints hint);
 	
 	virtual DecompressorBase* clone();
 
@@ -41,14 +41,14 @@ class DecompressorGZIP : public DecompressorBase
 public:
 	DecompressorGZIP(const PPSystemString& fileName);
 
-	virtual bool identify(XMFile& f);
+	virtual bool identify(XMFileBase& f);
 	
 	// this type of archive can contain any file type
 	virtual bool doesServeHint(Hints hint) { return true; }
 	
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const;
 	
-	virtual bool decompress(const PPSystemString& outFileName, Hints hint);
+	virtual bool decompress(XMFileBase& outFile, Hints hint);
 	
 	virtual DecompressorBase* clone();
 };
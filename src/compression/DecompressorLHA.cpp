@@ -40,7 +40,7 @@ namespace
 {
 	static int lha_read_callback(void *handle, void *buf, size_t buf_len)
 	{
-		return static_cast<XMFile*>(handle)->read(buf, 1, buf_len);
+		return static_cast<XMFileBase*>(handle)->read(buf, 1, buf_len);
 	}
 
 	static const LHAInputStreamType lha_callbacks =
@@ -54,7 +54,7 @@ namespace
 	class LHAReaderWrapper
 	{
 	public:
-		explicit LHAReaderWrapper(XMFile& file)
+		explicit LHAReaderWrapper(XMFileBase& file)
 		{
 			// Open input stream
 			input_stream = lha_input_stream_new(&lha_callbacks, &file);
@@ -102,7 +102,7 @@ DecompressorLHA::DecompressorLHA(const PPSystemString& filename) :
 {
 }
 
-bool DecompressorLHA::identify(XMFile& f)
+bool DecompressorLHA::identify(XMFileBase& f)
 {
 	f.seek(0);
 
@@ -121,7 +121,7 @@ const PPSimpleVector<Descriptor>& DecompressorLHA::getDescriptors(Hints hint) co
 	return descriptors;
 }		
 	
-bool DecompressorLHA::decompress(const PPSystemString& outFilename, Hints hint)
+bool DecompressorLHA::decompress(XMFileBase& outFile, Hints hint)
 {
 	XMFile f(fileName);
 	
@@ -151,11 +151,6 @@ bool DecompressorLHA::decompress(const PPSystemString& outFilename, Hints hint)
 
 		if (bytes_read > 0 && XModule::identifyModule(buf) != NULL)
 		{
-			// Write to output file
-			XMFile outFile(outFilename, true);
-			if (!outFile.isOpenForWriting())
-				return false;
-
 			// Decompress into outFile
 			do
 			{
@@ -43,8 +43,12 @@ DecompressorQT::DecompressorQT(const PPSystemString& filename) :
 {
 }
 
-bool DecompressorQT::identify(XMFile& f)
+bool DecompressorQT::identify(XMFileBase& f)
 {
+	// QuickTime reads from disk only
+	if (!f.isBackedByFile())
+		return false;
+
 	bool res = false;
 
 	// me misuse the generic sample loader of MilkyPlay to determine whether 
@@ -90,7 +94,7 @@ const PPSimpleVector<Descriptor>& DecompressorQT::getDescriptors(Hints hint) con
 	return descriptors;
 }	
 	
-bool DecompressorQT::decompress(const PPSystemString& outFilename, Hints hint)
+bool DecompressorQT::decompress(XMFileBase& outFile, Hints hint)
 {
 	// If client requests something else than a sample we can't deal we that
 	if (hint != HintAll &&
@@ -112,11 +116,26 @@ bool DecompressorQT::decompress(const PPSystemString& outFilename, Hints hint)
 	
 		if (TRUE == [[movie attributeForKey:QTMovieHasAudioAttribute] boolValue]) 
 		{
-			OSStatus err = [aiffWriter exportFromMovie:movie toFile:[NSString stringWithUTF8String:outFilename]];
+			// QuickTime can only export to disk, copy the result over
+			NSString* tempFile = [NSTemporaryDirectory() stringByAppendingPathComponent:
+								  [NSString stringWithFormat:@"milkytracker_qt_%@.aif", [[NSProcessInfo processInfo] globallyUniqueString]]];
+			
+			OSStatus err = [aiffWriter exportFromMovie:movie toFile:tempFile];
 			if (err != noErr)
 			{
 				res = false;
 			}
+			else
+			{
+				XMFile f([tempFile fileSystemRepresentation]);
+				
+				pp_uint8 buf[0x10000];
+				mp_sint32 len;
+				while ((len = f.read(buf, 1, sizeof(buf))) > 0)
+					outFile.write(buf, 1, len);
+			}
+			
+			removeFile([tempFile fileSystemRepresentation]);
 		} 
 		else 
 		{
@@ -38,8 +38,15 @@ DecompressorZIP::DecompressorZIP(const PPSystemString& filename) :
 {
 }
 
-bool DecompressorZIP::identify(XMFile& f)
+bool DecompressorZIP::identify(XMFileBase& f)
 {
+	// zziplib reads from disk only, look at the local file header
+	if (!f.isBackedByFile())
+	{
+		f.seek(0);
+		return f.readDword() == 0x04034B50;
+	}
+
 	const PPSystemString filename(f.getFileName());
 	PPSystemString ext = filename.getExtension();
 	
@@ -65,12 +72,12 @@ const PPSimpleVector<Descriptor>& DecompressorZIP::getDescriptors(Hints hint) co
 	return descriptors;
 }		
 	
-bool DecompressorZIP::decompress(const PPSystemString& outFilename, Hints hint)
+bool DecompressorZIP::decompress(XMFileBase& outFile, Hints hint)
 {
 	ZipExtractor extractor(fileName);
 	
 	pp_int32 error = 0;
-	bool res = extractor.parseZip(error, true, &outFilename);
+	bool res = extractor.parseZip(error, true, &outFile);
 	return (res && error == 0);
 }
 
@@ -610,21 +610,54 @@ void Unlzx::decrunch(struct UnLZX *unlzx)
 	unlzx->global_shift = shift;
 }
 
-XMFile* Unlzx::open_output(const PPSystemString& filename)
+XMFileBase* Unlzx::open_output(struct UnLZX *unlzx)
 {
-	XMFile *file = new XMFile(filename, true);
+	// extract right into the output if it can drop unwanted files again,
+	// otherwise keep files in memory until we know we want them
+	if (unlzx->outFile && unlzx->outFile->truncate(unlzx->outFileStart))
+		return unlzx->outFile;
 	
-	if (!file->isOpenForWriting())
-		return NULL;
+	return new XMFileBuffer(archiveFilename);
+}
+
+bool Unlzx::close_output(XMFileBase* out_file, struct UnLZX *unlzx, bool complete)
+{
+	const unsigned long start = out_file == unlzx->outFile ? unlzx->outFileStart : 0;
+	bool found = false;
+
+	if (complete && identificator)
+	{
+		out_file->seek(start);
+		found = identificator->identify(*out_file);
+	}
+	
+	if (out_file == unlzx->outFile)
+	{
+		if (found)
+			out_file->seek(0, XMFileBase::SeekOffsetTypeEnd);
+		else
+			out_file->truncate(start);
+		
+		return found;
+	}
+	
+	XMFileBuffer* buffer = static_cast<XMFileBuffer*>(out_file);
 	
-	return(file);
+	if (found && unlzx->outFile)
+	{
+		mp_sint32 size = (mp_sint32)buffer->size();
+		found = size == 0 || unlzx->outFile->write(buffer->getBuffer(), 1, size) == size;
+	}
+	
+	delete buffer;
+	return found;
 }
 
 signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& found)
 {
 	found = false;
 	struct filename_node *node;
-	XMFile *out_file = NULL;
+	XMFileBase *out_file = NULL;
 	unsigned char *pos, *temp;
 	unsigned long count;
 	signed long abort = 0;
@@ -638,7 +671,7 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 	for(count = 0; count < 768; count ++) unlzx->literal_len[count] = 0;
 	unlzx->source_end = (unlzx->source = unlzx->read_buffer + 16384) - 1024;
 	pos = unlzx->destination_end = unlzx->destination = unlzx->decrunch_buffer + 65794;
-	for (node = unlzx->filename_list; (!abort) && node; node = node->next)
+	for (node = unlzx->filename_list; (!abort) && (!found) && node; node = node->next)
 	{
 		unlzx->sum = 0;
 		if (unlzx->use_outdir)
@@ -656,7 +689,7 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 #ifdef UNLZX_DEBUG
 			printf("Extracting \"%s\"...", (char *)node->filename);
 #endif			
-			out_file = unlzx->temporaryFile ? open_output(*(unlzx->temporaryFile)) : open_output(PPSystemString((const char*)unlzx->work_buffer));
+			out_file = open_output(unlzx);
 		}
 		else
 		{
@@ -732,7 +765,7 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 #ifdef UNLZX_DEBUG
 					perror("FWrite");
 #endif
-					delete out_file;
+					close_output(out_file, unlzx, false);
 					out_file = 0;
 				}
 			}
@@ -741,16 +774,11 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 		}
 		if (out_file)
 		{
-			PPSystemString fileName = out_file->getFileName();
-			delete out_file;
-			if (!abort)
-			{
 #ifdef UNLZX_DEBUG
+			if (!abort)
 				printf(" crc %s\n", (char *)((node->crc == unlzx->sum) ? "good" : "bad"));
 #endif				
-				if (identificator)
-					found = identificator->identify(fileName);
-			}
+			found = close_output(out_file, unlzx, !abort);
 		}
 	}
 	return(abort);
@@ -759,11 +787,11 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& found)
 {
 	struct filename_node *node;
-	XMFile *out_file = NULL;
+	XMFileBase *out_file = NULL;
 	unsigned long count;
 	signed long abort = 0;
 	
-	for (node = unlzx->filename_list; (!abort) && (node); node = node->next)
+	for (node = unlzx->filename_list; (!abort) && (!found) && (node); node = node->next)
 	{
 		unlzx->sum = 0;
 		if (unlzx->use_outdir)
@@ -781,7 +809,7 @@ signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& fou
 #ifdef UNLZX_DEBUG
 			printf("Storing \"%s\"...", (char *)node->filename);
 #endif
-			out_file = unlzx->temporaryFile ? open_output(*(unlzx->temporaryFile)) : open_output(PPSystemString((const char*)unlzx->work_buffer));
+			out_file = open_output(unlzx);
 		}
 		else
 		{
@@ -817,7 +845,7 @@ signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& fou
 #ifdef UNLZX_DEBUG
 					perror("FWrite");
 #endif
-					delete out_file;
+					close_output(out_file, unlzx, false);
 					out_file = 0;
 				}
 			}
@@ -825,16 +853,11 @@ signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& fou
 		}
 		if (out_file)
 		{
-			PPSystemString fileName = out_file->getFileName();
-			delete out_file;
-			if (!abort)
-			{
 #ifdef UNLZX_DEBUG
+			if (!abort)
 				printf(" crc %s\n", (char *)((node->crc == unlzx->sum) ? "good" : "bad"));
 #endif				
-				if (identificator)
-					found = identificator->identify(fileName);
-			}
+			found = close_output(out_file, unlzx, !abort);
 		}
 	}
 	return(abort);
@@ -1323,7 +1346,7 @@ Unlzx::~Unlzx()
 		unlzx_free(unlzx);
 }
 
-bool Unlzx::extractFile(bool extract, const PPSystemString* outFilename)
+bool Unlzx::extractFile(bool extract, XMFileBase* outFile)
 {
 	int result = 0;
 	
@@ -1332,7 +1355,8 @@ bool Unlzx::extractFile(bool extract, const PPSystemString* outFilename)
 		if (extract)
 		{
 			unlzx->mode = 1;
-			unlzx->temporaryFile = outFilename;
+			unlzx->outFile = outFile;
+			unlzx->outFileStart = outFile ? outFile->pos() : 0;
 			bool found = false;
 			// TODO: make this all type safe
 			result = process_archive(archiveFilename, unlzx, found);
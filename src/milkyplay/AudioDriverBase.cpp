@@ -37,6 +37,7 @@
 
 #include "AudioDriverBase.h"
 #include "MasterMixer.h"
+#include "MixerStatistics.h"
 
 #if defined(__PSP__)
 #include <pspkernel.h>
@@ -61,6 +62,12 @@ void AudioDriverBase::msleep(mp_uint32 msecs)
 #endif
 }
 
+void AudioDriverBase::countXRun()
+{
+	if (mixer)
+		mixer->getStatistics().addXRun();
+}
+
 bool AudioDriverBase::isMixerActive()
 {
 	if (idle)
@@ -44,6 +44,8 @@
 #define MP_NUMCHANNELS 2
 #define MP_NUMBITS 16
 #define MP_NUMBYTES (NUMBITS>>3)
+// maximum number of buffers which can be rendered ahead of the device
+#define MP_MAXBUFFERSAHEAD 4
 
 class MasterMixer;
 
@@ -103,6 +105,12 @@ public:
 	virtual		void		msleep(mp_uint32 msecs) = 0;
 	virtual		bool		isMixerActive() = 0;
 	virtual		void		setIdle(bool idle) = 0;
+
+	// mix num buffers (at most MP_MAXBUFFERSAHEAD) ahead of the device
+	// on a thread of its own, the audio callback only copies them out,
+	// 0 mixes straight from the callback. Applied on the next start.
+	virtual		void		setNumBuffersAhead(mp_uint32 num) = 0;
+	virtual		mp_uint32	getNumBuffersAhead() const = 0;
 };
 
 // -------------------------------------------------------------------------
@@ -124,6 +132,9 @@ protected:
 	bool			idle;
 	bool			markedAsIdle;
 
+	// the device ran out of data, counted in the mixer statistics
+				void		countXRun();
+
 public:
 				AudioDriverBase() :
 					mixer(0),
@@ -166,6 +177,10 @@ public:
 	virtual		void		msleep(mp_uint32 msecs);
 	virtual		bool		isMixerActive();	
 	virtual		void		setIdle(bool idle);
+
+	// not supported unless the driver says otherwise
+	virtual		void		setNumBuffersAhead(mp_uint32 num) { }
+	virtual		mp_uint32	getNumBuffersAhead() const { return 0; }
 };
 
 #endif
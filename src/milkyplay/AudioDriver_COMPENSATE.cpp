@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  AudioDriver_COMPENSATE.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "AudioDriver_COMPENSATE.h"
+#include <chrono>
+
+AudioDriver_COMPENSATE::AudioDriver_COMPENSATE() :
+	deviceHasStarted(false),
+	sampleCounter(0),
+	numBuffersAhead(0),
+	renderThread(NULL),
+	renderTerminate(false),
+	renderFloat(false),
+	renderRing(NULL),
+	renderNumBuffers(0),
+	renderBufferFrames(0),
+	renderBufferSize(0),
+	renderSleepTime(0),
+	renderWritten(0),
+	renderRead(0)
+{
+}
+
+AudioDriver_COMPENSATE::~AudioDriver_COMPENSATE()
+{
+	stopRenderAhead();
+}
+
+void AudioDriver_COMPENSATE::setNumBuffersAhead(mp_uint32 num)
+{
+	numBuffersAhead = num > MP_MAXBUFFERSAHEAD ? MP_MAXBUFFERSAHEAD : num;
+}
+
+void AudioDriver_COMPENSATE::startRenderAhead(bool floatSamples/* = false*/)
+{
+	if (renderThread || numBuffersAhead == 0 || mixer == NULL)
+		return;
+	
+	renderFloat = floatSamples;
+	renderNumBuffers = numBuffersAhead;
+	renderBufferFrames = mixer->getBufferSize();
+	renderBufferSize = renderBufferFrames*MP_NUMCHANNELS*(floatSamples ? sizeof(float) : sizeof(mp_sword));
+	renderRing = new mp_ubyte[renderNumBuffers*renderBufferSize];
+	memset(renderRing, 0, renderNumBuffers*renderBufferSize);
+	
+	// poll a few times per buffer while the ring is full
+	renderSleepTime = (mp_uint32)(((mp_int64)renderBufferFrames * 1000000) / (mixFrequency * 4));
+	if (renderSleepTime < 500)
+		renderSleepTime = 500;
+	
+	renderWritten.store(0, std::memory_order_relaxed);
+	renderRead.store(0, std::memory_order_relaxed);
+	renderTerminate.store(false, std::memory_order_relaxed);
+	renderThread = new std::thread(&AudioDriver_COMPENSATE::renderLoop, this);
+}
+
+void AudioDriver_COMPENSATE::stopRenderAhead()
+{
+	if (renderThread == NULL)
+		return;
+	
+	renderTerminate.store(true, std::memory_order_release);
+	renderThread->join();
+	delete renderThread;
+	renderThread = NULL;
+	
+	delete[] renderRing;
+	renderRing = NULL;
+}
+
+void AudioDriver_COMPENSATE::renderLoop()
+{
+	while (!renderTerminate.load(std::memory_order_acquire))
+	{
+		const mp_uint32 written = renderWritten.load(std::memory_order_relaxed);
+		if (written - renderRead.load(std::memory_order_acquire) >= renderNumBuffers)
+		{
+			// nothing is mixed right now, answer a pending setIdle() 
+			// instead of letting it time out
+			isMixerActive();
+			std::this_thread::sleep_for(std::chrono::microseconds(renderSleepTime));
+			continue;
+		}
+		
+		mp_ubyte* buffer = renderRing + (written % renderNumBuffers)*renderBufferSize;
+		
+		if (!isMixerActive())
+			memset(buffer, 0, renderBufferSize);
+		else if (renderFloat)
+			mixer->mixerHandler((float*)buffer);
+		else
+			mixer->mixerHandler((mp_sword*)buffer);
+		
+		renderWritten.store(written + 1, std::memory_order_release);
+	}
+}
+
+void AudioDriver_COMPENSATE::copyRenderedBuffer(void* stream, mp_uint32 size)
+{
+	const mp_uint32 read = renderRead.load(std::memory_order_relaxed);
+	
+	// underrun, the render thread couldn't keep up
+	if (renderWritten.load(std::memory_order_acquire) == read)
+	{
+		// nothing has been rendered yet right after the start
+		if (read)
+			countXRun();
+		memset(stream, 0, size);
+		return;
+	}
+	
+	memcpy(stream, renderRing + (read % renderNumBuffers)*renderBufferSize, size < renderBufferSize ? size : renderBufferSize);
+	renderRead.store(read + 1, std::memory_order_release);
+}
+
+mp_uint32 AudioDriver_COMPENSATE::getBufferPos() const
+{
+	if (renderThread == NULL)
+		return 0;
+	
+	const mp_uint32 queued = renderWritten.load(std::memory_order_relaxed) - renderRead.load(std::memory_order_relaxed);
+	return (mp_uint32)(-(mp_sint32)(queued*renderBufferFrames));
+}
+
+void AudioDriver_COMPENSATE::fillAudioWithCompensation(char* stream, int length)
+{
+	// sanity check
+	if (!this->deviceHasStarted)
+		return;
+	
+	MasterMixer* mixer = this->mixer;
+
+	this->sampleCounter+=length>>2;
+	//mixer->updateSampleCounter(length>>2);
+
+	if (renderThread)
+		copyRenderedBuffer(stream, mixer->getBufferSize()*MP_NUMCHANNELS*sizeof(mp_sword));
+	else if (isMixerActive())
+		mixer->mixerHandler((mp_sword*)stream);
+	else
+		memset(stream, 0, length);
+}
+
+void AudioDriver_COMPENSATE::fillAudioWithCompensation(float* stream, int numFrames)
+{
+	// sanity check
+	if (!this->deviceHasStarted)
+		return;
+	
+	this->sampleCounter+=numFrames;
+
+	if (renderThread)
+		copyRenderedBuffer(stream, numFrames*MP_NUMCHANNELS*sizeof(float));
+	else if (isMixerActive())
+		mixer->mixerHandler(stream);
+	else
+		memset(stream, 0, numFrames*MP_NUMCHANNELS*sizeof(float));
+}
@@ -33,6 +33,12 @@
  *
  *  Created by Peter Barth on 22.04.06.
  *
+ *	Base of the callback driven drivers. The callback either mixes
+ *	straight into the device buffer or, when rendering ahead, copies
+ *	out a buffer a mixing thread has rendered in advance, so spikes in
+ *	the mixing time are absorbed by the queued buffers instead of 
+ *	causing dropouts.
+ *
  */
 #ifndef __AUDIODRIVER_COMPENSATE_H__
 #define __AUDIODRIVER_COMPENSATE_H__
@@ -40,6 +46,8 @@
 #include "AudioDriverBase.h"
 #include "MilkyPlayCommon.h"
 #include "MasterMixer.h"
+#include <atomic>
+#include <thread>
 
 class AudioDriver_COMPENSATE : public AudioDriverBase
 {
@@ -47,37 +55,50 @@ protected:
 	bool		deviceHasStarted;
 	mp_uint32	sampleCounter;
 	
-public:
-	AudioDriver_COMPENSATE() :
-		deviceHasStarted(false),
-		sampleCounter(0)
-	{
-	}
+private:
+	mp_uint32	numBuffersAhead;
+
+	// Render-ahead ring of renderNumBuffers mixed buffers. The render
+	// thread is the only writer and the audio callback the only reader,
+	// the buffer counters are the only thing they share.
+	std::thread* renderThread;
+	std::atomic<bool> renderTerminate;
+	bool		renderFloat;
+	mp_ubyte*	renderRing;
+	mp_uint32	renderNumBuffers;
+	mp_uint32	renderBufferFrames;
+	mp_uint32	renderBufferSize;			// in bytes
+	mp_uint32	renderSleepTime;			// in microseconds
+	std::atomic<mp_uint32> renderWritten;
+	std::atomic<mp_uint32> renderRead;
+
+	void		renderLoop();
+	void		copyRenderedBuffer(void* stream, mp_uint32 size);
+
+protected:
+	// start rendering ahead (if enabled), call this before the device 
+	// is started, floatSamples selects the float mixerHandler
+	void		startRenderAhead(bool floatSamples = false);
+	// call this after the device has been stopped
+	void		stopRenderAhead();
 
-	virtual		~AudioDriver_COMPENSATE()
-	{
-	}
+public:
+	AudioDriver_COMPENSATE();
+	virtual		~AudioDriver_COMPENSATE();
 
 	virtual		mp_uint32	getNumPlayedSamples() const { return sampleCounter; }
-	
-	void fillAudioWithCompensation(char* stream, int length)
-	{
-		// sanity check
-		if (!this->deviceHasStarted)
-			return;
-		
-		MasterMixer* mixer = this->mixer;
+	// negative while rendering ahead, the buffer of the last mix() 
+	// is played after the ones still queued
+	virtual		mp_uint32	getBufferPos() const;
 
-		// Attention: Sample buffer MUST be 16 bit stereo, otherwise this will not work
-		this->sampleCounter+=length>>2;
-		//mixer->updateSampleCounter(length>>2);
+	virtual		void		setNumBuffersAhead(mp_uint32 num);
+	virtual		mp_uint32	getNumBuffersAhead() const { return numBuffersAhead; }
+	
+	// Attention: Sample buffer MUST be 16 bit stereo, otherwise this will not work
+	void fillAudioWithCompensation(char* stream, int length);
 
-		if (isMixerActive())
-			mixer->mixerHandler((mp_sword*)stream);
-		else
-			memset(stream, 0, length);
-	}
+	// for drivers taking float samples, numFrames stereo frames are mixed
+	void fillAudioWithCompensation(float* stream, int numFrames);
 };
 
 #endif
-
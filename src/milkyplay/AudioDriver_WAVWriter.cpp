@@ -54,7 +54,7 @@ struct TWAVHeader
 	mp_dword dataLength;		// sample data size
 };
 
-static void writeWAVHeader(XMFile* f, const TWAVHeader& hdr)
+static void writeWAVHeader(XMFileBase* f, const TWAVHeader& hdr)
 {
 	f->write(hdr.RIFF, 1, 4);
 	
@@ -82,8 +82,6 @@ WAVWriter::WAVWriter(const SYSCHAR* fileName) :
 	f(NULL),
 	mixFreq(44100)
 {
-	TWAVHeader hdr;
-	
 	f = new XMFile(fileName, true);
 
 	if (!f->isOpenForWriting())
@@ -93,22 +91,7 @@ WAVWriter::WAVWriter(const SYSCHAR* fileName) :
 	}
 	else
 	{
-		// build wav header
-		memcpy(hdr.RIFF, "RIFF", 4);
-		hdr.length = 44 - 8;
-		memcpy(hdr.WAVE, "WAVE", 4);
-		memcpy(hdr.FMT, "fmt ", 4);
-		hdr.fmtDataLength = 16;
-		hdr.encodingTag = 1;
-		hdr.numChannels = 2;
-		hdr.sampleRate = mixFreq;
-		hdr.numBits = 16;
-		hdr.blockAlign = (hdr.numChannels*hdr.numBits) / 8;
-		hdr.bytesPerSecond = hdr.sampleRate*hdr.blockAlign;
-		memcpy(hdr.DATA, "data", 4);
-		hdr.dataLength = 0;	
-		
-		writeWAVHeader(f, hdr);
+		writeHeader(f, mixFreq, 0);
 	}
 }
 
@@ -133,28 +116,34 @@ mp_sint32 WAVWriter::closeDevice()
 	if (!f)
 		return MP_DEVICE_ERROR;
 		
+	f->seek(0);
+
+	writeHeader(f, mixFreq, numSamplesWritten);
+	
+	return MP_OK;
+}
+
+void WAVWriter::writeHeader(XMFileBase* f, mp_uint32 sampleRate, mp_uint32 numFrames, 
+							mp_uint32 numBits/* = 16*/, bool isFloat/* = false*/)
+{
 	TWAVHeader hdr;
 	
 	// build wav header
 	memcpy(hdr.RIFF, "RIFF", 4);
-	hdr.length = 44 + numSamplesWritten*4 - 8;
 	memcpy(hdr.WAVE, "WAVE", 4);
 	memcpy(hdr.FMT, "fmt ", 4);
 	hdr.fmtDataLength = 16;
-	hdr.encodingTag = 1;
+	hdr.encodingTag = isFloat ? 3 : 1;
 	hdr.numChannels = 2;
-	hdr.sampleRate = mixFreq;
-	hdr.numBits = 16;
+	hdr.sampleRate = sampleRate;
+	hdr.numBits = numBits;
 	hdr.blockAlign = (hdr.numChannels*hdr.numBits) / 8;
 	hdr.bytesPerSecond = hdr.sampleRate*hdr.blockAlign;
 	memcpy(hdr.DATA, "data", 4);
-	hdr.dataLength = (numSamplesWritten*2*hdr.numBits)/8;	
+	hdr.dataLength = numFrames*hdr.blockAlign;	
+	hdr.length = 44 + hdr.dataLength - 8;
 		
-	f->seek(0);
-
 	writeWAVHeader(f, hdr);
-	
-	return MP_OK;
 }
 
 void WAVWriter::advance()
@@ -167,3 +156,11 @@ void WAVWriter::advance()
 	f->writeWords((mp_uword*)compensateBuffer, bufferSize);
 }
 
+void WAVWriter::writeFrames(const mp_sword* buffer, mp_uint32 numFrames)
+{
+	if (!f)
+		return;
+	
+	numSamplesWritten+=numFrames;
+	f->writeWords((const mp_uword*)buffer, numFrames*MP_NUMCHANNELS);
+}
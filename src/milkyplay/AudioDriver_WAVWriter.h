@@ -60,6 +60,13 @@ public:
 	virtual		void		advance();
 
 	bool					isOpen() { return f != NULL; }
+	
+	// write 16 bit stereo frames which have been mixed elsewhere
+	void					writeFrames(const mp_sword* buffer, mp_uint32 numFrames);
+	
+	// write the header of a stereo WAV file containing numFrames frames
+	static void				writeHeader(XMFileBase* f, mp_uint32 sampleRate, mp_uint32 numFrames, 
+										mp_uint32 numBits = 16, bool isFloat = false);
 };
 
 #endif
@@ -39,10 +39,13 @@
  *  while mixing the audio stream in between.
  */
 #include "ChannelMixer.h"
+#include "MixerThreads.h"
+#include "ChannelScopes.h"
 #include "ResamplerFactory.h"
 #include "ResamplerMacros.h"
 #include "AudioDriverManager.h"
 #include <math.h>
+#include <chrono>
  
 // Ramp out will last (THEBEATLENGTH*RAMPDOWNFRACTION)>>8 samples
 #define RAMPDOWNFRACTION 256
@@ -76,18 +79,43 @@ void ChannelMixer::panToVol (ChannelMixer::TMixerChannel *chn, mp_sint32 &volL,
 		volL = volR = 0;
 }
 
-void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* mixBuffer32,mp_sint32 beatNum, mp_sint32 beatPacketLength)
 {
 	ChannelMixer::TMixerChannel* channel = mixer->channel;
 	ChannelMixer::TMixerChannel* newChannel = mixer->newChannel;
 	
-	for (mp_uint32 c=0;c<numChannels;c++) 
+	for (mp_uint32 c=fromChannel;c<toChannel;c++) 
 	{
 		ChannelMixer::TMixerChannel* chn = &channel[c];
 		chn->index = c;		// For Amiga resampler
+		mp_sint32* buffer32 = mixer->getChannelTarget(c, mixBuffer32);
+		mp_sint32 beatlength = beatPacketLength;
 
 		if (!(chn->flags & MP_SAMPLE_PLAY))
 			continue;
+		
+		// a live note starts later in this beat packet, until then the 
+		// sample played before goes on at the rate and volume it had in 
+		// the last beat packet
+		if (chn->startDelay)
+		{
+			const mp_sint32 delay = chn->startDelay < beatlength ? chn->startDelay : beatlength - 1;
+			chn->startDelay = 0;
+			
+			if (chn->flags & MP_SAMPLE_FADEOUT)
+			{
+				mp_sint32 tmpsmpadd = chn->smpadd;
+				mp_sint32 tmprsmpadd = chn->rsmpadd;
+				chn->smpadd = newChannel[c].smpadd;
+				chn->rsmpadd = newChannel[c].rsmpadd;
+				addChannel(chn, buffer32, delay, beatlength);
+				chn->smpadd = tmpsmpadd;
+				chn->rsmpadd = tmprsmpadd;
+			}
+			
+			buffer32+=delay*MP_NUMCHANNELS;
+			beatlength-=delay;
+		}
 	
 		switch (chn->flags&(MP_SAMPLE_FADEOUT|MP_SAMPLE_FADEIN|MP_SAMPLE_FADEOFF))
 		{
@@ -124,19 +152,44 @@ void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint
 	}
 }
 
-void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* mixBuffer32,mp_sint32 beatNum, mp_sint32 beatPacketLength)
 {
 	ChannelMixer::TMixerChannel* channel = mixer->channel;
 	ChannelMixer::TMixerChannel* newChannel = mixer->newChannel;
 	
-	for (mp_uint32 c=0;c<numChannels;c++) 
+	for (mp_uint32 c=fromChannel;c<toChannel;c++) 
 	{	
 		ChannelMixer::TMixerChannel* chn = &channel[c];
 		chn->index = c;		// For Amiga resampler
+		mp_sint32* buffer32 = mixer->getChannelTarget(c, mixBuffer32);
+		mp_sint32 beatlength = beatPacketLength;
 		
 		if (!(chn->flags & MP_SAMPLE_PLAY))
 			continue;
 		
+		// a live note starts later in this beat packet, until then the 
+		// sample played before goes on at its last rate and volume
+		if (chn->startDelay)
+		{
+			const mp_sint32 delay = chn->startDelay < beatlength ? chn->startDelay : beatlength - 1;
+			chn->startDelay = 0;
+			
+			if (chn->flags & MP_SAMPLE_FADEOUT)
+			{
+				mp_sint32 tmpsmpadd = chn->smpadd;
+				mp_sint32 tmprsmpadd = chn->rsmpadd;
+				chn->smpadd = newChannel[c].smpadd;
+				chn->rsmpadd = newChannel[c].rsmpadd;
+				chn->rampFromVolStepL = chn->rampFromVolStepR = 0;
+				addChannel(chn, buffer32, delay, beatlength);
+				chn->smpadd = tmpsmpadd;
+				chn->rsmpadd = tmprsmpadd;
+			}
+			
+			buffer32+=delay*MP_NUMCHANNELS;
+			beatlength-=delay;
+		}
+		
 		switch (chn->flags&(MP_SAMPLE_FADEOUT|MP_SAMPLE_FADEIN|MP_SAMPLE_FADEOFF))
 		{
 			case MP_SAMPLE_FADEOFF:
@@ -294,14 +347,25 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 }
 
 void ChannelMixer::ResamplerBase::addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+{
+	addChannelRange(mixer, 0, numChannels, buffer32, beatNum, beatlength);
+}
+
+void ChannelMixer::ResamplerBase::addChannelRange(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
 {
 	if (beatNum >= (signed)mixer->getNumBeatPackets())
 		beatNum = mixer->getNumBeatPackets();
 
+	if (mixer->channelScopes)
+		mixer->beginChannelScopes(fromChannel, toChannel, beatlength);
+
 	if (isRamping())
-		addChannelsRamping(mixer, numChannels, buffer32, beatNum, beatlength);
+		addChannelsRamping(mixer, fromChannel, toChannel, buffer32, beatNum, beatlength);
 	else
-		addChannelsNormal(mixer, numChannels, buffer32, beatNum, beatlength);
+		addChannelsNormal(mixer, fromChannel, toChannel, buffer32, beatNum, beatlength);
+
+	if (mixer->channelScopes)
+		mixer->endChannelScopes(fromChannel, toChannel, buffer32, beatlength);
 }
 
 void ChannelMixer::ResamplerBase::addChannel(TMixerChannel* chn, mp_sint32* buffer32, const mp_sint32 beatlength, const mp_sint32 beatSize)
@@ -500,6 +564,12 @@ void ChannelMixer::setFrequency(mp_sint32 frequency)
 	
 	mixbuffBeatPacket = new mp_sint32[beatPacketSize*MP_NUMCHANNELS];
 	
+	if (mixerThreads)
+		mixerThreads->setBeatPacketSize(beatPacketSize);
+	
+	reallocChannelBuses();
+	reallocChannelScopes();
+	
 	// channels contain information based on beatPacketSize so this might
 	// have been changed
 	reallocChannels();
@@ -519,12 +589,15 @@ void ChannelMixer::reallocChannels()
 		delete[] newChannel;
 		newChannel = new TMixerChannel[mixerNumAllocatedChannels];
 		
+		delete[] channelBusMap;
+		channelBusMap = new mp_uint32[mixerNumAllocatedChannels];
+		
 		clearChannels();
 	}
 	
 #if defined(MILKYTRACKER) || defined (__MPTIMETRACKING__)
 	for (mp_uint32 i = 0; i < mixerNumAllocatedChannels; i++)
-		channel[i].reallocTimeRecord(getNumBeatPackets()+1);
+		channel[i].reallocTimeRecord(getTimeRecordSize());
 #endif	
 	
 	mixerLastNumAllocatedChannels = mixerNumAllocatedChannels;
@@ -539,7 +612,10 @@ void ChannelMixer::clearChannels()
 	{
 		channel[i].clear();
 		newChannel[i].clear();
+		channelBusMap[i] = i;
 	}
+	
+	channelBusesShared = false;
 }
 
 ChannelMixer::ChannelMixer(mp_uint32 numChannels,
@@ -550,12 +626,35 @@ ChannelMixer::ChannelMixer(mp_uint32 numChannels,
 	mixFrequency(0),
 	mixbuffBeatPacket(NULL),
 	mixBufferSize(0),
+	numBuffersAhead(0),
+	numTimeRecordBuffers(1),
+	timeRecordBuffer(0),
+	timeRecordBase(0),
+	channelBuses(NULL),
+	channelBusBeatPackets(NULL),
+	channelBusTargets(NULL),
+	numChannelBuses(0),
+	channelBusMap(NULL),
+	channelBusesShared(false),
+	channelScopes(NULL),
+	numChannelScopes(0),
+	channelScopeDecimationShift(0),
+	pendingCommit(NULL),
+	numExecutedCommits(0),
+	syncSampleCounter(0),
+	syncPoint(0),
+	liveEventOffset(0),
+	startDelayPending(false),
 	channel(NULL),
 	newChannel(NULL),
 	resamplerType(MIXER_INVALID),
+	mixerThreads(NULL),
 	paused(false),
 	disableMixing(false),
 	allowFilters(false),
+	numActiveVoices(0),
+	tickTime(0),
+	tickNanos(0),
 	initialized(false),
 	sampleCounter(0)
 {	
@@ -590,9 +689,16 @@ ChannelMixer::~ChannelMixer()
 		closeDevice();
 	}
 
+	delete mixerThreads;
+	delete channelScopes;
+
 	if (mixbuffBeatPacket)
 		delete[] mixbuffBeatPacket;
 
+	delete[] channelBusBeatPackets;
+	delete[] channelBusTargets;
+	delete[] channelBusMap;
+
 	if (channel) 
 		delete[] channel;
 	
@@ -643,6 +749,44 @@ void ChannelMixer::setResamplerType(ResamplerTypes type)
 	}
 }
 
+void ChannelMixer::setNumMixerThreads(mp_uint32 num)
+{
+	if (num > MixerThreads::MAXTHREADS)
+		num = MixerThreads::MAXTHREADS;
+	
+	if (num == getNumMixerThreads())
+		return;
+		
+	delete mixerThreads;
+	mixerThreads = num ? new MixerThreads(num, beatPacketSize) : NULL;
+}
+
+mp_uint32 ChannelMixer::getNumMixerThreads() const
+{
+	return mixerThreads ? mixerThreads->getNumThreads() : 0;
+}
+
+void ChannelMixer::mixBeatPacket(mp_uint32 numChannels,
+								 mp_sint32* buffer32,
+								 mp_sint32 beatPacketIndex, 
+								 mp_sint32 beatPacketSize)
+{
+	// channels sharing a bus can't be mixed in parallel
+	if (mixerThreads && !channelBusesShared)
+		mixerThreads->mixBeatPacket(this, resamplerTable[resamplerType], numChannels, buffer32, beatPacketIndex, beatPacketSize);
+	else
+		resamplerTable[resamplerType]->addChannels(this, numChannels, buffer32, beatPacketIndex, beatPacketSize);
+
+	if (channelScopes)
+	{
+		// taps of channels which aren't mixed at all
+		for (mp_uint32 c = numChannels; c < numChannelScopes; c++)
+			channelScopes->storeBeatPacket(c, NULL, beatPacketSize);
+		
+		channelScopes->advance(beatPacketSize);
+	}
+}
+
 void ChannelMixer::setNumChannels(mp_uint32 num)
 {
 	if (num > mixerNumAllocatedChannels)
@@ -798,6 +942,12 @@ void ChannelMixer::playSample(mp_sint32 c, // channel
 		}
 	}
 	
+	// the sample played before can only go on until then when it's
+	// faded out, a sample which isn't ramped starts right away
+	channel[c].startDelay = ramp ? liveEventOffset : 0;
+	if (channel[c].startDelay)
+		startDelayPending = true;
+	
 	// play sample but don't ramp volume
 	if (!ramp)
 	{
@@ -889,6 +1039,14 @@ void ChannelMixer::playSample(mp_sint32 c, // channel
 		// "fade off" current sample
 		channel[c].flags = (channel[c].flags&~(MP_SAMPLE_FADEOUT|MP_SAMPLE_FADEIN|MP_SAMPLE_FADEOFF))|MP_SAMPLE_FADEOUT;
 		
+		// until a live note starts the current sample goes on at its 
+		// current rate, the new one is set on the channel after this
+		if (channel[c].startDelay)
+		{
+			newChannel[c].smpadd = channel[c].smpadd;
+			newChannel[c].rsmpadd = channel[c].rsmpadd;
+		}
+		
 		// one shot looping sample?
 		if (flags & 32)
 		{
@@ -945,15 +1103,289 @@ static inline void storeTimeRecordData(mp_sint32 nb, ChannelMixer::TMixerChannel
 	}
 }
 
+void ChannelMixer::setChannelBuses(mp_sint32** buses, mp_uint32 numBuses)
+{
+	channelBuses = buses;
+	numChannelBuses = buses ? numBuses : 0;
+	
+	reallocChannelBuses();
+}
+
+void ChannelMixer::setChannelBus(mp_uint32 c, mp_uint32 bus)
+{
+	if (c >= mixerNumAllocatedChannels)
+		return;
+	
+	channelBusMap[c] = bus;
+	if (bus != c)
+		channelBusesShared = true;
+}
+
+void ChannelMixer::reallocChannelBuses()
+{
+	delete[] channelBusBeatPackets;
+	channelBusBeatPackets = NULL;
+	delete[] channelBusTargets;
+	channelBusTargets = NULL;
+	
+	if (!numChannelBuses)
+		return;
+	
+	channelBusBeatPackets = new mp_sint32[numChannelBuses*beatPacketSize*MP_NUMCHANNELS];
+	memset(channelBusBeatPackets, 0, numChannelBuses*beatPacketSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+	channelBusTargets = new mp_sint32*[numChannelBuses];
+}
+
+// offset is the frame position in the buses, -1 selects the beat packet buffers
+void ChannelMixer::selectChannelBusTargets(mp_sint32 offset)
+{
+	for (mp_uint32 i = 0; i < numChannelBuses; i++)
+		channelBusTargets[i] = offset < 0 ? 
+			channelBusBeatPackets + i*beatPacketSize*MP_NUMCHANNELS : 
+			channelBuses[i] + offset*MP_NUMCHANNELS;
+}
+
+void ChannelMixer::setNumChannelScopes(mp_uint32 num, mp_uint32 decimationShift/* = 0*/)
+{
+	if (num > ChannelScopes::MAXCHANNELS)
+		num = ChannelScopes::MAXCHANNELS;
+	if (decimationShift > ChannelScopes::MAXDECIMATIONSHIFT)
+		decimationShift = ChannelScopes::MAXDECIMATIONSHIFT;
+
+	numChannelScopes = num;
+	channelScopeDecimationShift = decimationShift;
+	
+	reallocChannelScopes();
+}
+
+void ChannelMixer::reallocChannelScopes()
+{
+	delete channelScopes;
+	channelScopes = NULL;
+	
+	if (numChannelScopes && beatPacketSize)
+		channelScopes = new ChannelScopes(numChannelScopes, channelScopeDecimationShift, beatPacketSize, mixBufferSize);
+}
+
+bool ChannelMixer::readChannelScope(mp_uint32 c, mp_uint32 bufferPos, mp_sint32* dest, mp_uint32 count) const
+{
+	if (channelScopes == NULL)
+	{
+		memset(dest, 0, count*MP_NUMCHANNELS*sizeof(mp_sint32));
+		return false;
+	}
+	
+	return channelScopes->read(c, bufferPos, dest, count);
+}
+
+void ChannelMixer::beginChannelScopes(mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32 beatlength)
+{
+	if (toChannel > numChannelScopes)
+		toChannel = numChannelScopes;
+	
+	for (mp_uint32 c = fromChannel; c < toChannel; c++)
+		if (channel[c].flags & MP_SAMPLE_PLAY)
+			channelScopes->clearBeatPacket(c, beatlength);
+}
+
+void ChannelMixer::endChannelScopes(mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32, mp_sint32 beatlength)
+{
+	if (toChannel > numChannelScopes)
+		toChannel = numChannelScopes;
+	
+	for (mp_uint32 c = fromChannel; c < toChannel; c++)
+		channelScopes->storeBeatPacket(c, getChannelBusTarget(c, buffer32), beatlength);
+}
+
+mp_sint32* ChannelMixer::getChannelTarget(mp_uint32 c, mp_sint32* buffer32) const
+{
+	if (c < numChannelScopes)
+		return channelScopes->getBeatPacket(c);
+	
+	return getChannelBusTarget(c, buffer32);
+}
+
+mp_sint32* ChannelMixer::getChannelBusTarget(mp_uint32 c, mp_sint32* buffer32) const
+{
+	if (!numChannelBuses)
+		return buffer32;
+	
+	const mp_uint32 bus = channelBusMap[c];
+	return bus < numChannelBuses ? channelBusTargets[bus] : buffer32;
+}
+
+// same as adding the mixbuffBeatPacket remainder to the mixing buffer
+void ChannelMixer::addChannelBusRemainders(mp_uint32 pos, mp_uint32 offset, mp_uint32 count)
+{
+	for (mp_uint32 i = 0; i < numChannelBuses; i++)
+	{
+		const mp_sint32* src = channelBusBeatPackets + (i*beatPacketSize + pos)*MP_NUMCHANNELS;
+		mp_sint32* dst = channelBuses[i] + offset*MP_NUMCHANNELS;
+		for (mp_uint32 j = 0; j < count*MP_NUMCHANNELS; j++, src++, dst++)
+			*dst += *src;
+	}
+}
+
+bool ChannelMixer::postCommit(SyncedCommit* commit)
+{
+	SyncedCommit* expected = NULL;
+	return pendingCommit.compare_exchange_strong(expected, commit, std::memory_order_release);
+}
+
+bool ChannelMixer::revokeCommit(SyncedCommit* commit)
+{
+	SyncedCommit* expected = commit;
+	return pendingCommit.compare_exchange_strong(expected, NULL, std::memory_order_acquire);
+}
+
+static bool replaceChannelSample(ChannelMixer::TMixerChannel& chn, 
+								 const mp_sbyte* newSample, 
+								 mp_sint32 newSampleLength, 
+								 bool newSampleIs16Bit)
+{
+	if (newSample == NULL || 
+		((chn.flags & 4) != 0) != newSampleIs16Bit ||
+		chn.smppos >= newSampleLength)
+		return false;
+	
+	chn.sample = newSample;
+	if (chn.smplen > newSampleLength)
+		chn.smplen = newSampleLength;
+	if (chn.loopend > newSampleLength)
+		chn.loopend = newSampleLength;
+	if (chn.loopendcopy > newSampleLength)
+		chn.loopendcopy = newSampleLength;
+	
+	// loop got cut away
+	if (chn.loopstart >= chn.loopend)
+	{
+		chn.flags &= ~3;
+		chn.loopstart = 0;
+		chn.loopend = chn.smplen;
+	}
+	
+	return true;
+}
+
+static bool replaceTimeRecordSample(ChannelMixer::TTimeRecord& record, 
+									const mp_sbyte* newSample, 
+									mp_sint32 newSampleLength, 
+									bool newSampleIs16Bit)
+{
+	if (newSample == NULL || 
+		((record.flags & 4) != 0) != newSampleIs16Bit ||
+		record.smppos >= newSampleLength)
+		return false;
+	
+	record.sample = newSample;
+	if (record.smplen > newSampleLength)
+		record.smplen = newSampleLength;
+	if (record.loopend > newSampleLength)
+		record.loopend = newSampleLength;
+	
+	if (record.loopstart >= record.loopend)
+	{
+		record.flags &= ~3;
+		record.loopstart = 0;
+		record.loopend = record.smplen;
+	}
+	
+	return true;
+}
+
+void ChannelMixer::replaceSample(const mp_sbyte* oldSample, const mp_sbyte* newSample, 
+								 mp_sint32 newSampleLength, bool newSampleIs16Bit)
+{
+	if (oldSample == NULL || oldSample == newSample)
+		return;
+
+	const mp_uint32 stopFlags = MP_SAMPLE_PLAY | MP_SAMPLE_FADEIN | MP_SAMPLE_FADEOUT | MP_SAMPLE_FADEOFF;
+
+	for (mp_uint32 c = 0; c < mixerNumAllocatedChannels; c++)
+	{
+		// the sample which is about to be faded in
+		if (newChannel[c].sample == oldSample &&
+			!replaceChannelSample(newChannel[c], newSample, newSampleLength, newSampleIs16Bit))
+		{
+			newChannel[c].sample = NULL;
+			newChannel[c].flags &= ~stopFlags;
+			
+			if (channel[c].flags & MP_SAMPLE_FADEOUT)
+				channel[c].flags = (channel[c].flags & ~(MP_SAMPLE_FADEOUT | MP_SAMPLE_FADEIN)) | MP_SAMPLE_FADEOFF;
+		}
+
+		if (channel[c].sample == oldSample &&
+			!replaceChannelSample(channel[c], newSample, newSampleLength, newSampleIs16Bit))
+		{
+			channel[c].sample = NULL;
+			channel[c].flags &= ~stopFlags;
+		}
+		
+		// the GUI reads the sample data through the time records
+		for (mp_uint32 i = 0; i < channel[c].timeRecordSize; i++)
+		{
+			TTimeRecord& record = channel[c].timeRecord[i];
+			if (record.sample == oldSample &&
+				!replaceTimeRecordSample(record, newSample, newSampleLength, newSampleIs16Bit))
+			{
+				record.sample = NULL;
+				record.flags &= ~stopFlags;
+				record.smppos = -1;
+			}
+		}
+	}
+}
+
+void ChannelMixer::tick(mp_uint32 beatIndex)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	timer(beatIndex);
+	
+	tickNanos+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ChannelMixer::updateStatistics()
+{
+	mp_uint32 num = 0;
+	for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++)
+		if (channel[c].flags & MP_SAMPLE_PLAY)
+			num++;
+	
+	numActiveVoices = num;
+	tickTime = (mp_uint32)(tickNanos / 1000);
+}
+
 void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 {
 	updateSampleCounter(bufferSize);
 	
+	const mp_uint32 bufferStart = syncSampleCounter;
+	updateSyncPoint(bufferSize);
+	
+	executePendingCommit();
+
+	for (mp_uint32 i = 0; i < numChannelBuses; i++)
+		memset(channelBuses[i], 0, mixBufferSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+	
+	tickNanos = 0;
+	
 	if (!isPlaying())
+	{
+		numActiveVoices = tickTime = 0;
 		return;
+	}
 
 	if (!paused)
 	{
+		// record into the oldest buffer of the time records
+		const mp_uint32 recordBuffer = (timeRecordBuffer.load(std::memory_order_relaxed) + 1) % numTimeRecordBuffers;
+		timeRecordBase = recordBuffer*(getNumBeatPackets()+1);
+		
+		// where this buffer starts in the channel scopes, the beat packet
+		// remainder has been written there already
+		const mp_uint32 scopesBufferStart = channelScopes ? channelScopes->getWritePos() - lastBeatRemainder : 0;
+		
 		mp_sint32* buffer = mixbuff32;
 		
 		mp_sint32 beatLength = beatPacketSize;
@@ -973,6 +1405,7 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 				mp_sint32* dst = buffer;
 				for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
 					*dst += *src;
+				addChannelBusRemainders(pos, 0, todo);
 				done = mixBufferSize;
 				lastBeatRemainder-=done;
 			}
@@ -984,6 +1417,7 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 				mp_sint32* dst = buffer;
 				for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
 					*dst += *src;
+				addChannelBusRemainders(pos, 0, todo);
 				buffer+=lastBeatRemainder*MP_NUMCHANNELS;
 				mixSize-=lastBeatRemainder;
 				done = lastBeatRemainder;
@@ -1038,17 +1472,23 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 					}
 				}
 
-				timer(nb);
+				executePendingCommit();
+				tick(nb);
+				processLiveEvents(bufferStart + done - (numbeats-nb)*beatLength, beatLength);
 
 				if (!disableMixing)
 				{
 					// do some in between state recording 
 					// to be able to show smooth updates even if the buffer is large
 					for (mp_uint32 c=0;c<mixerNumActiveChannels;c++) 
-						storeTimeRecordData(nb, &channel[c]);
+						storeTimeRecordData(timeRecordBase + nb, &channel[c]);
 
+					selectChannelBusTargets(done - (numbeats-nb)*beatLength);
 					mixBeatPacket(mixerNumActiveChannels, buffer+nb*beatLength*MP_NUMCHANNELS, nb, beatLength);	
 				}
+
+				if (startDelayPending)
+					clearStartDelays();
 			}		
 
 			buffer+=numbeats*beatLength*MP_NUMCHANNELS;
@@ -1056,6 +1496,8 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 			if (done < (mp_sint32)mixBufferSize)
 			{
 				memset(mixbuffBeatPacket, 0, beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
+				if (numChannelBuses)
+					memset(channelBusBeatPackets, 0, numChannelBuses*beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
 
 				if (isRamping)
 				{
@@ -1092,18 +1534,24 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 					}
 				}
 
-				timer(numbeats);
+				executePendingCommit();
+				tick(numbeats);
+				processLiveEvents(bufferStart + done, beatLength);
 
 				if (!disableMixing)
 				{
 					// do some in between state recording 
 					// to be able to show smooth updates even if the buffer is large
 					for (mp_uint32 c=0;c<mixerNumActiveChannels;c++) 
-						storeTimeRecordData(nb, &channel[c]);
+						storeTimeRecordData(timeRecordBase + nb, &channel[c]);
 
+					selectChannelBusTargets(-1);
 					mixBeatPacket(mixerNumActiveChannels, mixbuffBeatPacket, numbeats, beatLength);	
 				}
 
+				if (startDelayPending)
+					clearStartDelays();
+
 				mp_sint32 todo = mixBufferSize - done;
 
 				if (todo)
@@ -1113,12 +1561,23 @@ void ChannelMixer::mix(mp_sint32* mixbuff32, mp_uint32 bufferSize)
 					mp_sint32* dst = buffer;
 					for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
 						*dst += *src;
+					addChannelBusRemainders(0, done, todo);
 					lastBeatRemainder = beatLength - todo;
 				}
 			}
 		}
+
+		// the workers aren't needed until the next buffer
+		if (mixerThreads)
+			mixerThreads->park();
+
+		if (channelScopes)
+			channelScopes->setBufferStart(scopesBufferStart);
+		
+		timeRecordBuffer.store(recordBuffer, std::memory_order_release);
 	}
 	
+	updateStatistics();
 }
 
 mp_sint32 ChannelMixer::initDevice()
@@ -1207,6 +1666,33 @@ mp_sint32 ChannelMixer::setBufferSize(mp_uint32 bufferSize)
 	
 	// channels contain information depending up the buffer size
 	// update those too
+	reallocChannels();
+	reallocChannelScopes();
+	
+	return MP_OK;
+}
+
+mp_sint32 ChannelMixer::setNumBuffersAhead(mp_uint32 num)
+{
+	if (num > MP_MAXBUFFERSAHEAD)
+		num = MP_MAXBUFFERSAHEAD;
+
+	if (numBuffersAhead == num)
+		return MP_OK;
+
+	if (initialized)
+	{
+		mp_sint32 err = closeDevice();
+		if (err != MP_OK)
+			return err;
+	}
+	
+	numBuffersAhead = num;
+	// one more buffer is being recorded into while the oldest is played
+	numTimeRecordBuffers = num ? num + 2 : 1;
+	timeRecordBuffer.store(0, std::memory_order_relaxed);
+	timeRecordBase = 0;
+	
 	reallocChannels();
 	
 	return MP_OK;
@@ -1225,6 +1711,19 @@ mp_sint32 ChannelMixer::getNumActiveChannels()
 
 mp_sint32 ChannelMixer::getBeatIndexFromSamplePos(mp_uint32 smpPos) const
 {
+	// go back to the buffer being played, the one after the oldest
+	// is the next to be recorded into
+	mp_uint32 buffersBack = 0;
+	if ((signed)smpPos < 0 && numTimeRecordBuffers > 2 && mixBufferSize)
+	{
+		buffersBack = ((mp_uint32)-(mp_sint32)smpPos + mixBufferSize - 1) / mixBufferSize;
+		if (buffersBack > numTimeRecordBuffers - 2)
+			buffersBack = numTimeRecordBuffers - 2;
+		smpPos+=buffersBack*mixBufferSize;
+	}
+	
+	const mp_uint32 recordBuffer = (timeRecordBuffer.load(std::memory_order_acquire) + numTimeRecordBuffers - buffersBack) % numTimeRecordBuffers;
+
 	mp_sint32 maxLen = (mixBufferSize/beatPacketSize)-1;
 	if (maxLen < 0)
 		maxLen = 0;
@@ -1239,7 +1738,7 @@ mp_sint32 ChannelMixer::getBeatIndexFromSamplePos(mp_uint32 smpPos) const
 	if (smpPos > (unsigned)maxSize)
 		smpPos = maxSize;
 
-	return smpPos / getBeatPacketSize();
+	return recordBuffer*(getNumBeatPackets()+1) + smpPos / getBeatPacketSize();
 }
 
 /*mp_sint32 ChannelMixer::getCurrentSample(mp_sint32 position,mp_sint32 channel)
@@ -1300,11 +1799,76 @@ mp_sint32 ChannelMixer::getCurrentSamplePeak(mp_sint32 position,mp_sint32 channe
 	}
 }*/
 
-mp_uint32 ChannelMixer::getSyncSampleCounter()
+static mp_uint32 getSyncMicros()
+{
+	return (mp_uint32)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ChannelMixer::updateSyncPoint(mp_uint32 bufferSize)
+{
+	syncPoint.store(((unsigned long long)syncSampleCounter << 32) | getSyncMicros(), std::memory_order_release);
+	syncSampleCounter+=bufferSize;
+}
+
+mp_uint32 ChannelMixer::getSyncSampleCounter(mp_sint32 bufferPos/* = 0*/) const
 {
-	/*return audioDriver->getNumPlayedSamples();*/
+	const unsigned long long point = syncPoint.load(std::memory_order_acquire);
+	
+	// the buffer played right now starts bufferPos samples after the one
+	// mixed last, when the driver renders ahead it's mixed as soon as the 
+	// device takes the next buffer, so how far are we into that one
+	mp_uint32 elapsed = (mp_uint32)(((mp_int64)(getSyncMicros() - (mp_uint32)point) * mixFrequency) / 1000000);
+	if (elapsed > mixBufferSize)
+		elapsed = mixBufferSize;
+	
+	return (mp_uint32)(point >> 32) + (mp_uint32)bufferPos + elapsed;
+}
+
+mp_sint32 ChannelMixer::getBeatIndexFromSyncSampleCounter(mp_uint32 sampleCounter) const
+{
+	const unsigned long long point = syncPoint.load(std::memory_order_acquire);
+	
+	return getBeatIndexFromSamplePos(sampleCounter - (mp_uint32)(point >> 32));
+}
+
+bool ChannelMixer::postLiveEvent(mp_ubyte chn, mp_sint32 note, mp_sint32 ins, mp_sint32 vol, mp_uint32 time)
+{
+	LiveEventQueue::TLiveEvent event;
+	event.time = time;
+	event.chn = chn;
+	event.note = note;
+	event.ins = ins;
+	event.vol = vol;
+	
+	return liveEvents.push(event);
+}
+
+void ChannelMixer::clearStartDelays()
+{
+	// channels which haven't been mixed in the last beat packet didn't 
+	// use their start delay, it would hold back the next sample played
+	for (mp_uint32 c = 0; c < mixerNumAllocatedChannels; c++)
+		channel[c].startDelay = 0;
+	
+	startDelayPending = false;
+}
+
+void ChannelMixer::processLiveEvents(mp_uint32 time, mp_sint32 beatLength)
+{
+	const LiveEventQueue::TLiveEvent* event;
+	while ((event = liveEvents.peek()) != NULL)
+	{
+		// one buffer after it has been triggered, late ones right away
+		const mp_sint32 offset = (mp_sint32)(event->time + mixBufferSize - time);
+		if (offset >= beatLength)
+			break;
+		
+		liveEventOffset = offset > 0 ? offset : 0;
+		handleLiveEvent(*event);
+		liveEvents.pop();
+	}
 	
-	return 0;
+	liveEventOffset = 0;
 }
 
 #ifdef __MPTIMETRACKING__
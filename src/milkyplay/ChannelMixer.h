@@ -43,6 +43,11 @@
 #include "MilkyPlayCommon.h"
 #include "AudioDriverBase.h"
 #include "Mixable.h"
+#include "LiveEventQueue.h"
+#include <atomic>
+
+class MixerThreads;
+class ChannelScopes;
 
 #define MP_FP_CEIL(x)			(((x)+65535)>>16)
 #define MP_FP_MUL(a, b)			((mp_sint32)(((mp_int64)(a)*(mp_int64)(b))>>16))
@@ -220,6 +225,7 @@ public:
 		mp_uint32			timeRecordSize;
 		TTimeRecord*		timeRecord;
 		mp_sint32			index;					// For Amiga resampler
+		mp_sint32			startDelay;				// a live note starts this many frames into the next beat packet
 
 		TMixerChannel() :
 			timeRecordSize(0),
@@ -272,6 +278,7 @@ public:
 			fixedtime			= 0;
 			fixedtimefrac		= 0;
 			index				= -1;		// is filled during runtime
+			startDelay			= 0;
 			
 			if (timeRecord)
 				memset(timeRecord, 0, sizeof(TTimeRecord) * timeRecordSize);
@@ -289,9 +296,9 @@ public:
 	{
 	private:
 		// add channels without volume ramping
-		void addChannelsNormal(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);		
+		void addChannelsNormal(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);		
 		// add channels with volume ramping
-		void addChannelsRamping(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);		
+		void addChannelsRamping(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);		
 
 	public:
 		virtual ~ResamplerBase()
@@ -299,6 +306,9 @@ public:
 		}
 		
 		void addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);
+		// add channels fromChannel to toChannel-1 only, disjoint ranges
+		// can be added from different threads at the same time
+		void addChannelRange(ChannelMixer* mixer, mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);
 		void addChannel(TMixerChannel* chn, mp_sint32* buffer32, const mp_sint32 beatlength, const mp_sint32 beatSize);		
 		
 		// walk along the sample
@@ -342,6 +352,23 @@ public:
 	};
 
 	friend class ChannelMixer::ResamplerBase;
+	friend class MixerThreads;
+
+	// Changes to data the mixer is reading from (sample memory, patterns...)
+	// can be handed over to the mixer thread instead of stopping playback.
+	// The mixer executes a posted commit before it processes the next 
+	// beat packet, so it never sees a half finished edit.
+	class SyncedCommit
+	{
+	public:
+		virtual ~SyncedCommit()
+		{
+		}
+		
+		// called from the mixer thread, mixer is NULL when
+		// the commit is executed without a running mixer
+		virtual void commit(ChannelMixer* mixer) = 0;
+	};
 
 private:	
 	mp_uint32	mixerNumAllocatedChannels;	// Number of channels to be allocated by mixer
@@ -357,6 +384,31 @@ private:
 	mp_uint32	beatPacketSize;				// size of 1/250 of a second in samples
 	mp_uint32	numBeatPackets;				// how many of these fit in our buffer size
 	mp_uint32	lastBeatRemainder;			// used while filling the buffer, if the buffer is not an exact multiple of beatPacketSize
+
+	mp_uint32	numBuffersAhead;			// see setNumBuffersAhead()
+	mp_uint32	numTimeRecordBuffers;		// the time records are kept for this many buffers
+	std::atomic<mp_uint32> timeRecordBuffer;	// the one of those the last mix() has recorded into
+	mp_uint32	timeRecordBase;				// first time record of the buffer being mixed
+
+	mp_sint32**	channelBuses;				// optional separate output buffer for each of the first numChannelBuses channels
+	mp_sint32*	channelBusBeatPackets;		// beat packet remainder buffer for each channel bus
+	mp_sint32**	channelBusTargets;			// where the current beat packet of each channel bus is mixed into
+	mp_uint32	numChannelBuses;
+	mp_uint32*	channelBusMap;				// bus each mixer channel is mixed into, its own index by default
+	bool		channelBusesShared;			// some buses are fed by more than one channel
+
+	ChannelScopes* channelScopes;			// optional taps of the first numChannelScopes channels
+	mp_uint32	numChannelScopes;
+	mp_uint32	channelScopeDecimationShift;
+
+	std::atomic<SyncedCommit*> pendingCommit;	// posted commit, executed at the next beat packet
+	std::atomic<mp_uint32> numExecutedCommits;
+	
+	LiveEventQueue	liveEvents;				// posted live notes, started in the beat packet they're due
+	mp_uint32		syncSampleCounter;		// number of samples mixed, never reset
+	std::atomic<unsigned long long> syncPoint;	// syncSampleCounter (high part) and microseconds (low part) at the last mix()
+	mp_sint32		liveEventOffset;		// where in the current beat packet a live note is started
+	bool			startDelayPending;		// a channel's start delay is set, see clearStartDelays()
 		
 	TMixerChannel*	channel;
 	TMixerChannel*  newChannel;
@@ -368,25 +420,63 @@ private:
 	TSetFreq		setFreqFuncTable[NUMRESAMPLERTYPES];			// If different precisions are used, use other frequency calculation procedures	
 	ResamplerBase*  resamplerTable[NUMRESAMPLERTYPES];
 	
+	MixerThreads*	mixerThreads;			// optional threads mixing groups of channels in parallel
+	
 	bool			paused;
 	bool			disableMixing;
 	bool			allowFilters;
 
 	void			setFrequency(mp_sint32 frequency);
 	
+	void			executePendingCommit()
+	{
+		if (pendingCommit.load(std::memory_order_relaxed) == NULL)
+			return;
+		
+		SyncedCommit* commit = pendingCommit.exchange(NULL, std::memory_order_acquire);
+		if (commit)
+		{
+			commit->commit(this);
+			numExecutedCommits.fetch_add(1, std::memory_order_release);
+		}
+	}
+
+	void			updateSyncPoint(mp_uint32 bufferSize);
+	void			processLiveEvents(mp_uint32 time, mp_sint32 beatLength);
+	void			clearStartDelays();
+
+	void			reallocChannelBuses();
+	void			selectChannelBusTargets(mp_sint32 offset);
+	void			addChannelBusRemainders(mp_uint32 pos, mp_uint32 offset, mp_uint32 count);
+	mp_sint32*		getChannelBusTarget(mp_uint32 c, mp_sint32* buffer32) const;
+
+	void			reallocChannelScopes();
+	void			beginChannelScopes(mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32 beatlength);
+	void			endChannelScopes(mp_uint32 fromChannel, mp_uint32 toChannel, mp_sint32* buffer32, mp_sint32 beatlength);
+
+	// channel c is mixed into its bus if there is one, otherwise into buffer32,
+	// a tapped channel goes through its beat packet in the channel scopes first
+	mp_sint32*		getChannelTarget(mp_uint32 c, mp_sint32* buffer32) const;
+
 	void			mixBeatPacket(mp_uint32 numChannels,
 								  mp_sint32* buffer32,
 								  mp_sint32 beatPacketIndex, 
-								  mp_sint32 beatPacketSize) 
-	{ 
-		resamplerTable[resamplerType]->addChannels(this, numChannels, buffer32, beatPacketIndex, beatPacketSize);
-	}
+								  mp_sint32 beatPacketSize);
 	
 	inline void		timer(mp_uint32 beatIndex)
 	{
-		timerHandler(beatIndex <= getNumBeatPackets() ? beatIndex : getNumBeatPackets());
+		timerHandler(timeRecordBase + (beatIndex <= getNumBeatPackets() ? beatIndex : getNumBeatPackets()));
 	}
 	
+	// what the last call to mix() did, see Mixable
+	mp_uint32		numActiveVoices;
+	mp_uint32		tickTime;
+	mp_int64		tickNanos;
+	
+	// timer() with its duration added to tickNanos
+	void			tick(mp_uint32 beatIndex);
+	void			updateStatistics();
+	
 	void			reallocChannels();
 	void			clearChannels();
 
@@ -398,6 +488,8 @@ public:
 	
 	mp_uint32		getMixBufferSize() const { return mixBufferSize; }	
 	void			mix(mp_sint32* buffer, mp_uint32 numSamples);	
+	virtual mp_uint32 getNumActiveVoices() const { return numActiveVoices; }
+	virtual mp_uint32 getTickTime() const { return tickTime; }
 	void			updateSampleCounter(mp_sint32 numSamples) { sampleCounter+=numSamples; }
 	void			resetSampleCounter() { sampleCounter=0; }
 	
@@ -419,14 +511,54 @@ public:
 	ResamplerTypes	getResamplerType() const { return resamplerType; }
 	bool			isRamping()  const { return resamplerTable[resamplerType]->isRamping(); }
 	
+	// Mix the channels with the help of num additional threads, 0 mixes
+	// everything on the calling thread (default). The output is the same
+	// either way, the threads spin on a core each during mix() though.
+	// Don't call this while the mixer is playing.
+	void			setNumMixerThreads(mp_uint32 num);
+	mp_uint32		getNumMixerThreads() const;
+	
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
 	mp_sint32		getMixFrequency() { return mixFrequency; }
 	
 	static mp_sint32 beatPacketsToBufferSize(mp_uint32 mixFrequency, mp_uint32 numBeats);	
 	virtual mp_sint32 setBufferSize(mp_uint32 bufferSize);
 	
+	// A driver rendering ahead plays a buffer up to num buffers after it
+	// has been mixed, the time records of these buffers are kept so the
+	// beat index of the buffer being played can still be looked up
+	// (see getBeatIndexFromSamplePos()). Don't call this while playing.
+	virtual mp_sint32 setNumBuffersAhead(mp_uint32 num);
+	mp_uint32		getNumBuffersAhead() const { return numBuffersAhead; }
+	
+	// Mix each of the first numBuses channels into its own stereo buffer
+	// instead of the buffer passed to mix(), this is used for rendering
+	// all channels of a song separately in a single pass.
+	// Every bus must hold getMixBufferSize() frames, it's cleared on each
+	// call to mix(). Pass NULL/0 to go back to normal mixing.
+	void			setChannelBuses(mp_sint32** buses, mp_uint32 numBuses);
+	// Players with virtual channels route each mixer channel into the bus
+	// of the module channel it's playing for
+	void			setChannelBus(mp_uint32 c, mp_uint32 bus);
+	
+	// Keep what the first num channels actually sound like (after volume
+	// and panning) in ring buffers, every (1<<decimationShift)th frame.
+	// Scopes and meters on other threads get those from readChannelScope()
+	// instead of simulating the channels themselves. 0 turns the taps off.
+	// Don't call this while the mixer is playing.
+	void			setNumChannelScopes(mp_uint32 num, mp_uint32 decimationShift = 0);
+	mp_uint32		getNumChannelScopes() const { return numChannelScopes; }
+	mp_uint32		getChannelScopeDecimationShift() const { return channelScopeDecimationShift; }
+	// count decimated stereo frames of channel c ending at frame bufferPos
+	// of the last mixed buffer (see AudioDriverBase::getBufferPos()), dest
+	// is silent and false is returned if they aren't available
+	bool			readChannelScope(mp_uint32 c, mp_uint32 bufferPos, mp_sint32* dest, mp_uint32 count) const;
+	
 	mp_uint32		getBeatPacketSize() const { return beatPacketSize; }
 	mp_uint32		getNumBeatPackets() const { return mixBufferSize / beatPacketSize; } 
+	// number of time records kept per channel, (getNumBeatPackets()+1) for
+	// each buffer which can be played after the last mixed one
+	mp_uint32		getTimeRecordSize() const { return (getNumBeatPackets()+1)*numTimeRecordBuffers; }
 
 	// volume control
 	void			setMasterVolume(mp_sint32 vol) { masterVolume = vol; }
@@ -443,6 +575,8 @@ public:
 
 	mp_int64		getSampleCounter() const { return sampleCounter; }
 	
+	// smpPos is relative to the start of the last mixed buffer, it's 
+	// negative for the buffers a driver rendering ahead still has queued
 	mp_sint32		getBeatIndexFromSamplePos(mp_uint32 smpPos) const;
 	
 	ResamplerBase*  getCurrentResampler() const { return resamplerTable[resamplerType]; }
@@ -525,15 +659,47 @@ public:
 		}
 	}
 	
+	// Hand a commit over to the mixer thread, only one commit can be
+	// pending at a time. Returns false if there is already one.
+	bool			postCommit(SyncedCommit* commit);
+	// Take back a posted commit, returns false if the mixer has already 
+	// picked it up (wait until getNumExecutedCommits() changes in that case)
+	bool			revokeCommit(SyncedCommit* commit);
+	mp_uint32		getNumExecutedCommits() const { return numExecutedCommits.load(std::memory_order_acquire); }
+
+	// Let channels which are playing from oldSample continue on newSample 
+	// (only call this from a SyncedCommit). Channels are stopped if the
+	// new sample is too short or of a different bit depth.
+	void			replaceSample(const mp_sbyte* oldSample, const mp_sbyte* newSample, 
+								  mp_sint32 newSampleLength, bool newSampleIs16Bit);
+
 	void			muteChannel(mp_sint32 c, bool m);
 
 	bool			isChannelMuted(mp_sint32 c);
 	
-	mp_uint32		getSyncSampleCounter();
+	// Sample of the mixer's timeline being played right now, i.e. the 
+	// samples mixed so far plus the time since the last mix() call.
+	// bufferPos is the driver's position of the buffer being played
+	// relative to the one mixed last (see getBeatIndexFromSamplePos()),
+	// it's negative when the driver renders ahead.
+	// Can be called from any thread.
+	mp_uint32		getSyncSampleCounter(mp_sint32 bufferPos = 0) const;
+	// beat packet of the mixed buffers a sync sample counter falls into
+	mp_sint32		getBeatIndexFromSyncSampleCounter(mp_uint32 sampleCounter) const;
+	
+	// Queue a note played live from another thread (one at a time), 
+	// time is the sync sample counter without the driver's buffer
+	// position (the mixer's timeline) when it was triggered. The note
+	// is handed to handleLiveEvent() one buffer later so the notes 
+	// keep their exact spacing, its sample starts at the right frame
+	// within the beat packet. Returns false if the queue is full.
+	bool			postLiveEvent(mp_ubyte chn, mp_sint32 note, mp_sint32 ins, mp_sint32 vol, mp_uint32 time);
 
 protected:
 	// timer procedure for mixing
 	virtual void	timerHandler(mp_sint32 currentBeatPacket) = 0;
+	// play a live note, called from the mixer right after the timer
+	virtual void	handleLiveEvent(const LiveEventQueue::TLiveEvent& event) { }
 	void		   	panToVol(ChannelMixer::TMixerChannel *chn, mp_sint32 &left, mp_sint32 &right);
 	static mp_sint32 panLUT[257];
 
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ChannelScopes.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "ChannelScopes.h"
+#include <string.h>
+
+ChannelScopes::ChannelScopes(mp_uint32 numChannels, mp_uint32 decimationShift, mp_uint32 beatPacketSize, mp_uint32 bufferSize) :
+	numChannels(numChannels > MAXCHANNELS ? (mp_uint32)MAXCHANNELS : numChannels),
+	decimationShift(decimationShift > MAXDECIMATIONSHIFT ? (mp_uint32)MAXDECIMATIONSHIFT : decimationShift),
+	beatPacketSize(beatPacketSize),
+	writePos(0),
+	bufferStart(0)
+{
+	// the writer is ahead of bufferStart by at most one buffer and a beat
+	// packet, plus the beat packet which is being written while reading,
+	// a driver rendering ahead plays up to MP_MAXBUFFERSAHEAD buffers behind
+	const mp_uint32 minSize = ((bufferSize*(MP_MAXBUFFERSAHEAD+1) + beatPacketSize*2) >> this->decimationShift) + 2 + MAXREADSIZE;
+	ringSize = 1;
+	while (ringSize < minSize)
+		ringSize<<=1;
+
+	beatPackets = new mp_sint32[this->numChannels*beatPacketSize*MP_NUMCHANNELS];
+	rings = new mp_sint32[this->numChannels*ringSize*MP_NUMCHANNELS];
+	memset(rings, 0, this->numChannels*ringSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+
+	for (mp_uint32 c = 0; c < MAXCHANNELS; c++)
+	{
+		packetUsed[c] = false;
+		numSilentFrames[c] = ringSize << this->decimationShift;
+	}
+}
+
+ChannelScopes::~ChannelScopes()
+{
+	delete[] rings;
+	delete[] beatPackets;
+}
+
+void ChannelScopes::clearBeatPacket(mp_uint32 c, mp_uint32 count)
+{
+	memset(getBeatPacket(c), 0, count*MP_NUMCHANNELS*sizeof(mp_sint32));
+	packetUsed[c] = true;
+}
+
+void ChannelScopes::storeBeatPacket(mp_uint32 c, mp_sint32* target, mp_uint32 count)
+{
+	const mp_uint32 step = 1 << decimationShift;
+	const mp_uint32 mask = ringSize - 1;
+	const mp_uint32 pos = writePos.load(std::memory_order_relaxed);
+	mp_sint32* ring = rings + c*ringSize*MP_NUMCHANNELS;
+
+	// first frame of the packet which is on the decimation grid
+	mp_uint32 i = (step - (pos & (step - 1))) & (step - 1);
+
+	if (!packetUsed[c])
+	{
+		// nothing to do once the whole ring is silent
+		if (numSilentFrames[c] >= (ringSize << decimationShift))
+			return;
+
+		numSilentFrames[c]+=count;
+		for (; i < count; i+=step)
+		{
+			const mp_uint32 index = ((pos + i) >> decimationShift) & mask;
+			ring[index*2] = ring[index*2+1] = 0;
+		}
+		return;
+	}
+
+	packetUsed[c] = false;
+	numSilentFrames[c] = 0;
+
+	const mp_sint32* src = getBeatPacket(c);
+	for (mp_uint32 j = 0; j < count*MP_NUMCHANNELS; j++)
+		target[j]+=src[j];
+
+	for (; i < count; i+=step)
+	{
+		const mp_uint32 index = ((pos + i) >> decimationShift) & mask;
+		ring[index*2] = src[i*2];
+		ring[index*2+1] = src[i*2+1];
+	}
+}
+
+bool ChannelScopes::read(mp_uint32 c, mp_uint32 bufferPos, mp_sint32* dest, mp_uint32 count) const
+{
+	const mp_uint32 step = 1 << decimationShift;
+	const mp_uint32 mask = ringSize - 1;
+	// frames of the beat packet the mixer might be writing right now
+	const mp_uint32 margin = (beatPacketSize >> decimationShift) + 1;
+
+	if (c >= numChannels || count > MAXREADSIZE)
+	{
+		memset(dest, 0, count*MP_NUMCHANNELS*sizeof(mp_sint32));
+		return false;
+	}
+
+	const mp_uint32 end = (bufferStart.load(std::memory_order_acquire) + bufferPos) >> decimationShift;
+	const mp_uint32 start = end - count;
+
+	mp_uint32 pos = writePos.load(std::memory_order_acquire);
+	mp_uint32 written = (pos >> decimationShift) + ((pos & (step - 1)) ? 1 : 0);
+
+	// not mixed yet or already overwritten
+	if ((mp_sint32)(written - end) < 0 || written - start + margin > ringSize)
+	{
+		memset(dest, 0, count*MP_NUMCHANNELS*sizeof(mp_sint32));
+		return false;
+	}
+
+	const mp_sint32* ring = rings + c*ringSize*MP_NUMCHANNELS;
+	for (mp_uint32 i = 0; i < count; i++)
+	{
+		const mp_uint32 index = (start + i) & mask;
+		dest[i*2] = ring[index*2];
+		dest[i*2+1] = ring[index*2+1];
+	}
+
+	// the mixer might have overwritten the oldest frames meanwhile
+	std::atomic_thread_fence(std::memory_order_acquire);
+	pos = writePos.load(std::memory_order_relaxed);
+	written = (pos >> decimationShift) + ((pos & (step - 1)) ? 1 : 0);
+	if (written - start + margin > ringSize)
+	{
+		memset(dest, 0, count*MP_NUMCHANNELS*sizeof(mp_sint32));
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ChannelScopes.h
+ *  MilkyPlay
+ *
+ *	Taps of the ChannelMixer output of single channels, after volume 
+ *	and panning. Every tapped channel is mixed into its own beat packet
+ *	first, which is then added to the real mixing buffer and written
+ *	(decimated) into a ring buffer of stereo frames. The mixer is the
+ *	only writer, any other thread may read the rings without locking, 
+ *	a read which has been overtaken by the writer is detected and 
+ *	reported as failed.
+ *
+ */
+
+#ifndef __CHANNELSCOPES_H__
+#define __CHANNELSCOPES_H__
+
+#include "AudioDriverBase.h"
+#include <atomic>
+
+class ChannelScopes
+{
+public:
+	enum
+	{
+		MAXCHANNELS = 256,
+		MAXDECIMATIONSHIFT = 4,
+		MAXREADSIZE = 1024			// decimated frames a single read may ask for
+	};
+
+private:
+	mp_uint32			numChannels;
+	mp_uint32			decimationShift;
+	mp_uint32			beatPacketSize;
+
+	mp_sint32*			beatPackets;		// stereo beat packet of every channel
+	bool				packetUsed[MAXCHANNELS];
+	
+	mp_sint32*			rings;				// stereo ring of every channel
+	mp_uint32			ringSize;			// in decimated frames, power of 2
+	mp_uint32			numSilentFrames[MAXCHANNELS];
+
+	// frames (not decimated) written into the rings so far
+	std::atomic<mp_uint32> writePos;
+	// frame in the rings at which the buffer of the last ChannelMixer::mix() starts
+	std::atomic<mp_uint32> bufferStart;
+
+public:
+	// the rings hold a mix buffer of bufferSize frames, the buffers a 
+	// driver may render ahead and MAXREADSIZE decimated frames of history
+	ChannelScopes(mp_uint32 numChannels, mp_uint32 decimationShift, mp_uint32 beatPacketSize, mp_uint32 bufferSize);
+	~ChannelScopes();
+
+	mp_uint32			getNumChannels() const { return numChannels; }
+	mp_uint32			getDecimationShift() const { return decimationShift; }
+
+	// mixer side
+	mp_sint32*			getBeatPacket(mp_uint32 c) { return beatPackets + c*beatPacketSize*MP_NUMCHANNELS; }
+
+	// channel c is going to be mixed into its beat packet
+	void				clearBeatPacket(mp_uint32 c, mp_uint32 count);
+	// add the beat packet of channel c to target and write it into the
+	// ring, a channel whose packet hasn't been cleared records silence
+	void				storeBeatPacket(mp_uint32 c, mp_sint32* target, mp_uint32 count);
+	// publish the frames of the beat packet, called once all 
+	// channels have been written
+	void				advance(mp_uint32 count) { writePos.store(writePos.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+	mp_uint32			getWritePos() const { return writePos.load(std::memory_order_relaxed); }
+	void				setBufferStart(mp_uint32 pos) { bufferStart.store(pos, std::memory_order_release); }
+
+	// reader side, any thread
+	// copy the count decimated stereo frames of channel c which end at 
+	// frame bufferPos of the last mixed buffer into dest, on failure dest 
+	// is filled with silence and false is returned
+	bool				read(mp_uint32 c, mp_uint32 bufferPos, mp_sint32* dest, mp_uint32 count) const;
+};
+
+#endif
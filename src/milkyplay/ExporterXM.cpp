@@ -1342,6 +1342,16 @@ static void sort(mp_sword* array,mp_sint32 l, mp_sint32 r)
 }
 
 mp_sint32 XModule::saveExtendedModule(const SYSCHAR* fileName)
+{
+	XMFile f(fileName, true);
+	
+	if (!f.isOpenForWriting())
+		return MP_DEVICE_ERROR;
+	
+	return saveExtendedModule(f);
+}
+
+mp_sint32 XModule::saveExtendedModule(XMFileBase& f)
 {
 	mp_sint32 i,j,k,l;
 	
@@ -1362,8 +1372,6 @@ mp_sint32 XModule::saveExtendedModule(const SYSCHAR* fileName)
 		insNum++;
 	
 	// ------ start ---------------------------------
-	XMFile f(fileName, true);
-	
 	if (!f.isOpenForWriting())
 		return MP_DEVICE_ERROR;
 
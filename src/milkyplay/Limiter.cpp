@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  Limiter.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "Limiter.h"
+#include "MilkyPlayCommon.h"
+#include "AudioDriverBase.h"
+#include <math.h>
+
+#define LOOKAHEAD_MILLIS	1.5
+#define RELEASE_MILLIS		50.0
+
+Limiter::Limiter() :
+	lookAhead(0),
+	maxFrames(0),
+	ceiling(1.0f),
+	releaseCoeff(1.0f),
+	delayLine(NULL),
+	gain(NULL),
+	minValue(NULL),
+	minPos(NULL),
+	average(NULL)
+{
+}
+
+Limiter::~Limiter()
+{
+	cleanUp();
+}
+
+void Limiter::cleanUp()
+{
+	delete[] delayLine;
+	delete[] gain;
+	delete[] minValue;
+	delete[] minPos;
+	delete[] average;
+	
+	delayLine = gain = minValue = average = NULL;
+	minPos = NULL;
+}
+
+void Limiter::setup(mp_uint32 sampleRate, mp_uint32 maxFrames)
+{
+	cleanUp();
+	
+	lookAhead = (mp_uint32)(sampleRate * (LOOKAHEAD_MILLIS / 1000.0));
+	if (lookAhead < 1)
+		lookAhead = 1;
+	
+	releaseCoeff = (float)(1.0 - exp(-1.0 / (sampleRate * (RELEASE_MILLIS / 1000.0))));
+	
+	this->maxFrames = maxFrames;
+	
+	delayLine = new float[(lookAhead + maxFrames)*MP_NUMCHANNELS];
+	gain = new float[maxFrames];
+	minValue = new float[lookAhead + 1];
+	minPos = new mp_uint32[lookAhead + 1];
+	average = new float[lookAhead];
+	
+	reset();
+}
+
+void Limiter::reset()
+{
+	if (delayLine == NULL)
+		return;
+
+	memset(delayLine, 0, lookAhead*MP_NUMCHANNELS*sizeof(float));
+	
+	minFirst = minCount = 0;
+	position = 0;
+	
+	envelope = 1.0f;
+	
+	for (mp_uint32 i = 0; i < lookAhead; i++)
+		average[i] = 1.0f;
+	averagePos = 0;
+	averageSum = lookAhead;
+}
+
+void Limiter::process(float* buffer, mp_uint32 numFrames)
+{
+	if (numFrames > maxFrames)
+		numFrames = maxFrames;
+
+	const float ceiling = this->ceiling;
+	const mp_uint32 windowSize = lookAhead + 1;
+	
+	// the new frames go behind the ones still waiting in the look-ahead
+	float* delayed = delayLine;
+	memcpy(delayed + lookAhead*MP_NUMCHANNELS, buffer, numFrames*MP_NUMCHANNELS*sizeof(float));
+	
+	// gain required by each frame (this and the loop applying 
+	// the gain are kept simple enough for the compiler to vectorize)
+	for (mp_uint32 i = 0; i < numFrames; i++)
+	{
+		const float l = fabsf(buffer[i*2]);
+		const float r = fabsf(buffer[i*2+1]);
+		const float peak = l > r ? l : r;
+		gain[i] = peak > ceiling ? ceiling / peak : 1.0f;
+	}
+	
+	for (mp_uint32 i = 0; i < numFrames; i++, position++)
+	{
+		const float g = gain[i];
+		
+		// minimum over the last lookAhead+1 frames (monotonic queue)
+		if (minCount && position - minPos[minFirst] >= windowSize)
+		{
+			minFirst = (minFirst + 1) % windowSize;
+			minCount--;
+		}
+		
+		while (minCount && minValue[(minFirst + minCount - 1) % windowSize] >= g)
+			minCount--;
+		
+		const mp_uint32 slot = (minFirst + minCount) % windowSize;
+		minValue[slot] = g;
+		minPos[slot] = position;
+		minCount++;
+		
+		const float target = minValue[minFirst];
+		
+		// instant attack (the averaging below smoothes it), exponential release
+		if (target < envelope)
+			envelope = target;
+		else
+			envelope += (target - envelope) * releaseCoeff;
+		
+		averageSum += envelope - average[averagePos];
+		average[averagePos] = envelope;
+		if (++averagePos == lookAhead)
+			averagePos = 0;
+		
+		gain[i] = (float)(averageSum / lookAhead);
+	}
+	
+	for (mp_uint32 i = 0; i < numFrames; i++)
+	{
+		float l = delayed[i*2] * gain[i];
+		float r = delayed[i*2+1] * gain[i];
+		// guard against rounding errors of the running average
+		l = l > ceiling ? ceiling : (l < -ceiling ? -ceiling : l);
+		r = r > ceiling ? ceiling : (r < -ceiling ? -ceiling : r);
+		buffer[i*2] = l;
+		buffer[i*2+1] = r;
+	}
+	
+	memmove(delayLine, delayLine + numFrames*MP_NUMCHANNELS, lookAhead*MP_NUMCHANNELS*sizeof(float));
+}
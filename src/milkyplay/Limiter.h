@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  Limiter.h
+ *  MilkyPlay
+ *
+ *	Look-ahead peak limiter for the float master bus.
+ *	The gain is the minimum of the required gain over the look-ahead 
+ *	window, smoothed by a moving average of the same length, so it has
+ *	reached its target when a peak leaves the delay line.
+ *
+ */
+
+#ifndef __LIMITER_H__
+#define __LIMITER_H__
+
+#include "MilkyPlayTypes.h"
+
+class Limiter
+{
+private:
+	mp_uint32	lookAhead;			// in frames
+	mp_uint32	maxFrames;
+	float		ceiling;
+	float		releaseCoeff;
+	
+	float*		delayLine;			// (lookAhead + maxFrames) stereo frames
+	float*		gain;				// per frame gain of the current block
+	
+	// sliding window minimum of the required gain
+	float*		minValue;
+	mp_uint32*	minPos;
+	mp_uint32	minFirst;
+	mp_uint32	minCount;
+	mp_uint32	position;
+	
+	float		envelope;
+	
+	// moving average of the envelope
+	float*		average;
+	mp_uint32	averagePos;
+	double		averageSum;
+	
+	void		cleanUp();
+
+public:
+	Limiter();
+	~Limiter();
+	
+	// allocate for blocks of up to maxFrames frames, this also resets the state
+	void		setup(mp_uint32 sampleRate, mp_uint32 maxFrames);
+	void		reset();
+	
+	// highest absolute output value, 1.0 is full scale
+	void		setCeiling(float ceiling) { this->ceiling = ceiling; }
+	float		getCeiling() const { return ceiling; }
+
+	// the output is delayed by this number of frames
+	mp_uint32	getLatency() const { return lookAhead; }
+	
+	// limit numFrames interleaved stereo frames in place
+	void		process(float* buffer, mp_uint32 numFrames);
+};
+
+#endif
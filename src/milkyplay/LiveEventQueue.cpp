@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  LiveEventQueue.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "LiveEventQueue.h"
+
+LiveEventQueue::LiveEventQueue() :
+	readIndex(0),
+	writeIndex(0)
+{
+}
+
+bool LiveEventQueue::push(const TLiveEvent& event)
+{
+	const mp_uint32 index = writeIndex.load(std::memory_order_relaxed);
+	if (index - readIndex.load(std::memory_order_acquire) >= SIZE)
+		return false;
+	
+	events[index & (SIZE-1)] = event;
+	writeIndex.store(index + 1, std::memory_order_release);
+	return true;
+}
+
+const LiveEventQueue::TLiveEvent* LiveEventQueue::peek() const
+{
+	const mp_uint32 index = readIndex.load(std::memory_order_relaxed);
+	if (index == writeIndex.load(std::memory_order_acquire))
+		return NULL;
+	
+	return &events[index & (SIZE-1)];
+}
+
+void LiveEventQueue::pop()
+{
+	readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  LiveEventQueue.h
+ *  MilkyPlay
+ *
+ *	Notes played live (keyboard, MIDI) on their way from the UI thread
+ *	into the mixer. Every event carries the moment it was triggered on
+ *	the mixer's timeline (see ChannelMixer::postLiveEvent()),
+ *	so the mixer can start it at the right sample instead of the next
+ *	tick. One thread writes, the mixer reads, no locking involved.
+ *
+ */
+
+#ifndef __LIVEEVENTQUEUE_H__
+#define __LIVEEVENTQUEUE_H__
+
+#include "MilkyPlayCommon.h"
+#include <atomic>
+
+class LiveEventQueue
+{
+public:
+	enum
+	{
+		// must be 2^n
+		SIZE = 256
+	};
+
+	struct TLiveEvent
+	{
+		mp_uint32 time;
+		mp_ubyte chn;
+		mp_sint32 note;
+		mp_sint32 ins;
+		mp_sint32 vol;
+	};
+
+private:
+	TLiveEvent events[SIZE];
+	std::atomic<mp_uint32> readIndex;
+	std::atomic<mp_uint32> writeIndex;
+
+public:
+	LiveEventQueue();
+
+	// writer side, false if the queue is full
+	bool push(const TLiveEvent& event);
+
+	// reader side, oldest event or NULL if there is none, it stays
+	// valid until it's popped
+	const TLiveEvent* peek() const;
+	void pop();
+};
+
+#endif
@@ -39,12 +39,48 @@
 #include "MilkyPlayCommon.h"
 #include "AudioDriverBase.h"
 #include "AudioDriverManager.h"
+#include "Limiter.h"
+#include "MixerThreads.h"
+#include "MixerStatistics.h"
+#include <chrono>
 
 enum
 {
 	BlockTimeOut = 5000
 };
 
+// the devices to mix in one buffer, job index -> device index
+struct MasterMixer::DeviceBatch : public MixerThreads::Batch
+{
+	MasterMixer& mixer;
+	mp_uint32* jobs;
+	
+	DeviceBatch(MasterMixer& mixer) :
+		mixer(mixer),
+		jobs(new mp_uint32[mixer.numDevices])
+	{
+	}
+	
+	virtual ~DeviceBatch()
+	{
+		delete[] jobs;
+	}
+	
+	virtual void process(mp_uint32 index)
+	{
+		const mp_uint32 i = jobs[index];
+		mp_sint32* buffer = mixer.buffer;
+		
+		if (index)
+		{
+			buffer = mixer.deviceBuffers + i*mixer.bufferSize*MP_NUMCHANNELS;
+			memset(buffer, 0, mixer.bufferSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+		}
+		
+		mixer.mixDevice(mixer.devices[i], buffer);
+	}
+};
+
 MasterMixer::MasterMixer(mp_uint32 sampleRate, 
 						 mp_uint32 bufferSize/* = 0*/, 
 						 mp_uint32 numDevices/* = 1*/,
@@ -57,21 +93,37 @@ MasterMixer::MasterMixer(mp_uint32 sampleRate,
 	disableMixing(false),
 	numDevices(numDevices),
 	filterHook(0),
+	floatBus(false),
+	limiterActive(false),
+	floatBuffer(0),
+	floatFilterHook(0),
+	limiter(new Limiter()),
+	statistics(new MixerStatistics()),
 	devices(new DeviceDescriptor[numDevices]),
+	mixerThreads(0),
+	deviceBatch(0),
+	deviceBuffers(0),
+	numBuffersAhead(0),
+	peakBuffer(0),
 	audioDriverManager(0),
 	audioDriver(audioDriver),
 	initialized(false),
 	started(false),
 	paused(false)
 {
+	memset(peakHistory, 0, sizeof(peakHistory));
 }
 
 MasterMixer::~MasterMixer()
 {
 	cleanup();
 
+	delete mixerThreads;
+	delete deviceBatch;
 	delete audioDriverManager;
 	delete[] devices;
+	delete limiter;
+	delete statistics;
 }
 
 void MasterMixer::setMasterMixerNotificationListener(MasterMixerNotificationListener* listener) 
@@ -100,6 +152,8 @@ mp_sint32 MasterMixer::openAudioDevice()
 		
 	cleanup();
 	
+	audioDriver->setNumBuffersAhead(numBuffersAhead);
+	
 	mp_sint32 res = audioDriver->initDevice(bufferSize*MP_NUMCHANNELS, sampleRate, this);
 	if (res < 0)
 		return res;
@@ -119,6 +173,10 @@ mp_sint32 MasterMixer::openAudioDevice()
 	}
 	
 	buffer = new mp_sint32[bufferSize*MP_NUMCHANNELS];	
+	floatBuffer = new float[bufferSize*MP_NUMCHANNELS];
+	if (mixerThreads)
+		deviceBuffers = new mp_sint32[numDevices*bufferSize*MP_NUMCHANNELS];
+	limiter->setup(sampleRate, bufferSize);
 	
 	initialized = true;	
 	return 0;
@@ -205,6 +263,10 @@ mp_sint32 MasterMixer::setBufferSize(mp_uint32 bufferSize)
 		this->bufferSize = bufferSize;
 		delete[] buffer;
 		buffer = NULL;
+		delete[] floatBuffer;
+		floatBuffer = NULL;
+		delete[] deviceBuffers;
+		deviceBuffers = NULL;
 		
 		notifyListener(MasterMixerNotificationBufferSizeChanged);
 	}
@@ -377,15 +439,84 @@ bool MasterMixer::isDevicePaused(Mixable* device)
 	return false;
 }
 
-void MasterMixer::mixerHandler(mp_sword* buffer)
+mp_uint32 MasterMixer::getDeviceMixTime(Mixable* device) const
 {
-	if (!disableMixing)
-		prepareBuffer();
+	for (mp_uint32 i = 0; i < numDevices; i++)
+	{
+		if (devices[i].mixable == device)
+		{
+			return devices[i].mixTime;
+		}
+	}
+
+	return 0;
+}
+
+mp_sint32 MasterMixer::setNumMixerThreads(mp_uint32 num)
+{
+	if (num > MixerThreads::MAXTHREADS)
+		num = MixerThreads::MAXTHREADS;
+	
+	if (num == getNumMixerThreads())
+		return 0;
+	
+	// the workers must not be touched while mixing
+	mp_sint32 res = closeAudioDevice();
+	if (res != 0)
+		return res;
+	
+	delete mixerThreads;
+	mixerThreads = num ? new MixerThreads(num) : NULL;
+	
+	if (deviceBatch == NULL && mixerThreads)
+		deviceBatch = new DeviceBatch(*this);
+	
+	// allocated on the next openAudioDevice
+	delete[] deviceBuffers;
+	deviceBuffers = NULL;
+	
+	return 0;
+}
+
+mp_uint32 MasterMixer::getNumMixerThreads() const
+{
+	return mixerThreads ? mixerThreads->getNumThreads() : 0;
+}
+
+mp_sint32 MasterMixer::setNumBuffersAhead(mp_uint32 num)
+{
+	if (num > MP_MAXBUFFERSAHEAD)
+		num = MP_MAXBUFFERSAHEAD;
+	
+	if (num == numBuffersAhead)
+		return 0;
+	
+	mp_sint32 res = closeAudioDevice();
+	if (res != 0)
+		return res;
+	
+	numBuffersAhead = num;
+	return 0;
+}
+
+void MasterMixer::mixDevice(DeviceDescriptor& device, mp_sint32* buffer)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	device.mixable->mix(buffer, bufferSize);
 	
+	device.mixTime = (mp_uint32)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void MasterMixer::mixDevices()
+{
 	const register mp_sint32 numDevices = this->numDevices;
-	const register mp_uint32 bufferSize = this->bufferSize;
 	mp_sint32* mixBuffer = this->buffer;
 	
+	// devices are only collected when they can be mixed in parallel
+	mp_uint32* jobs = (mixerThreads && deviceBuffers && numDevices <= MixerThreads::MAXJOBS) ? deviceBatch->jobs : NULL;
+	mp_uint32 numJobs = 0;
+	
 	DeviceDescriptor* device = this->devices;	
 	for (mp_sint32 i = 0; i < numDevices; i++, device++)
 	{
@@ -393,20 +524,99 @@ void MasterMixer::mixerHandler(mp_sword* buffer)
 		{
 			device->markedForRemoval = false;
 			device->mixable = 0;
+			device->mixTime = 0;
 		}  
 		else if (device->mixable && device->markedForPause)
 		{
 			device->markedForPause = false;
 			device->paused = true;
+			device->mixTime = 0;
 		}
 		else if (device->mixable && !device->paused)
 		{
-			device->mixable->mix(mixBuffer, bufferSize);
+			if (jobs)
+				jobs[numJobs++] = i;
+			else
+				mixDevice(*device, mixBuffer);
+		}
+	}
+	
+	if (numJobs == 0)
+		return;
+	
+	if (numJobs == 1)
+	{
+		mixDevice(devices[jobs[0]], mixBuffer);
+		return;
+	}
+	
+	mixerThreads->run(deviceBatch, numJobs);
+	mixerThreads->park();
+	
+	// add up the devices in a fixed order, the first one 
+	// has been mixed in place
+	const mp_sint32 bufferSize = this->bufferSize*MP_NUMCHANNELS;
+	for (mp_uint32 j = 1; j < numJobs; j++)
+	{
+		const mp_sint32* src = deviceBuffers + jobs[j]*bufferSize;
+		for (mp_sint32 i = 0; i < bufferSize; i++)
+			mixBuffer[i] += src[i];
+	}
+}
+
+void MasterMixer::updateStatistics()
+{
+	mp_uint32 numVoices = 0;
+	mp_uint32 tickTime = 0;
+	for (mp_uint32 i = 0; i < numDevices; i++)
+	{
+		const DeviceDescriptor& device = devices[i];
+		if (device.mixable && !device.paused)
+		{
+			numVoices+=device.mixable->getNumActiveVoices();
+			tickTime+=device.mixable->getTickTime();
 		}
 	}
 	
+	statistics->endBuffer(bufferSize, sampleRate, numVoices, tickTime);
+}
+
+void MasterMixer::mixerHandler(mp_sword* buffer)
+{
+	statistics->beginBuffer();
+	
+	if (!disableMixing)
+		prepareBuffer();
+	
+	mixDevices();
+	
 	if (!disableMixing)
+	{
 		swapOutBuffer(buffer);
+		if (numBuffersAhead)
+			storePeaks();
+	}
+	
+	updateStatistics();
+}
+
+void MasterMixer::mixerHandler(float* buffer)
+{
+	statistics->beginBuffer();
+	
+	if (!disableMixing)
+		prepareBuffer();
+	
+	mixDevices();
+	
+	if (!disableMixing)
+	{
+		processFloatBus(buffer);
+		if (numBuffersAhead)
+			storePeaks();
+	}
+	
+	updateStatistics();
 }
 
 void MasterMixer::notifyListener(MasterMixerNotifications notification)
@@ -428,6 +638,12 @@ void MasterMixer::cleanup()
 		delete[] buffer;	
 		buffer = 0;
 	}
+	
+	delete[] floatBuffer;
+	floatBuffer = 0;
+	
+	delete[] deviceBuffers;
+	deviceBuffers = 0;
 }
 
 inline void MasterMixer::prepareBuffer()
@@ -435,12 +651,11 @@ inline void MasterMixer::prepareBuffer()
 	memset(buffer, 0, bufferSize*MP_NUMCHANNELS*sizeof(mp_sint32)); 
 }
 
-inline void MasterMixer::swapOutBuffer(mp_sword* bufferOut)
+void MasterMixer::convertBuffer(mp_sint32* bufferIn, mp_sword* bufferOut)
 {
 	if (filterHook)
-		filterHook->mix(buffer, bufferSize);
+		filterHook->mix(bufferIn, bufferSize);
 
-	register mp_sint32* bufferIn = buffer;
 	const register mp_sint32 sampleShift = this->sampleShift; 
 	const register mp_sint32 lowerBound = -((128<<sampleShift)*256); 
 	const register mp_sint32 upperBound = ((128<<sampleShift)*256)-1;
@@ -453,6 +668,99 @@ inline void MasterMixer::swapOutBuffer(mp_sword* bufferOut)
 		else if (b<lowerBound) b = lowerBound; 
 		*bufferOut++ = b>>sampleShift;
 	}
+}
+
+void MasterMixer::processFloatBus(float* bufferOut)
+{
+	if (filterHook)
+		filterHook->mix(buffer, bufferSize);
+
+	// full scale of the 32 bit buffer is 16 bit shifted left by sampleShift
+	const float scale = 1.0f / (float)(32768 << sampleShift);
+	const mp_sint32* bufferIn = this->buffer;
+	const mp_sint32 bufferSize = this->bufferSize*MP_NUMCHANNELS;
+	
+	if (!floatBus)
+	{
+		limiterActive = false;
+		
+		// clip like the 16 bit output does
+		const mp_sint32 lowerBound = -(32768 << sampleShift);
+		const mp_sint32 upperBound = (32768 << sampleShift) - 1;
+		
+		for (mp_sint32 i = 0; i < bufferSize; i++)
+		{
+			mp_sint32 b = bufferIn[i];
+			if (b>upperBound) b = upperBound; 
+			else if (b<lowerBound) b = lowerBound; 
+			bufferOut[i] = (float)b * scale;
+		}
+		return;
+	}
+	
+	for (mp_sint32 i = 0; i < bufferSize; i++)
+		bufferOut[i] = (float)bufferIn[i] * scale;
+	
+	if (floatFilterHook)
+		floatFilterHook->mix(bufferOut, this->bufferSize);
+	
+	// don't play out what was left in the look-ahead 
+	// when the limiter has been turned off
+	if (!limiterActive)
+	{
+		limiter->reset();
+		limiterActive = true;
+	}
+	
+	limiter->process(bufferOut, this->bufferSize);
+}
+
+void MasterMixer::storePeaks()
+{
+	const mp_uint32 index = (peakBuffer.load(std::memory_order_relaxed) + 1) % NumPeakBuffers;
+	mp_sint32* peaks = peakHistory[index];
+	
+	for (mp_sint32 c = 0; c < MP_NUMCHANNELS; c++)
+	{
+		mp_sint32 peak = 0;
+		for (mp_uint32 pos = 0; pos < bufferSize; pos++)
+		{
+			mp_sint32 s = buffer[pos*MP_NUMCHANNELS+c];
+			if (s < -32768)
+				s = -32768;
+			if (s > 32767)
+				s = 32767;
+			if (s > peak)
+				peak = s;
+			if (-s > peak)
+				peak = -s;
+		}
+		peaks[c] = peak;
+	}
+	
+	peakBuffer.store(index, std::memory_order_release);
+}
+
+inline void MasterMixer::swapOutBuffer(mp_sword* bufferOut)
+{
+	if (floatBus)
+	{
+		processFloatBus(floatBuffer);
+		
+		const mp_sint32 bufferSize = this->bufferSize*MP_NUMCHANNELS;
+		for (mp_sint32 i = 0; i < bufferSize; i++)
+		{
+			// the limiter keeps the signal within full scale, 
+			// only +1.0 needs to be clipped
+			mp_sint32 b = (mp_sint32)lrintf(floatBuffer[i] * 32768.0f);
+			if (b > 32767) b = 32767;
+			bufferOut[i] = (mp_sword)b;
+		}
+		return;
+	}
+
+	limiterActive = false;
+	convertBuffer(buffer, bufferOut);
 	
 	/*
 	mp_sint32* buffer32 = mixbuff32;
@@ -603,6 +911,21 @@ mp_sint32 MasterMixer::getCurrentSamplePeak(mp_sint32 position, mp_sint32 channe
 		}
 		return peak;
 	}	
+	else if (numBuffersAhead)
+	{
+		// the driver plays the buffers mixed before the last one first,
+		// the one after the oldest peak is the next to be written
+		mp_uint32 buffersBack = 0;
+		if (position < 0 && mixBufferSize)
+		{
+			buffersBack = ((mp_uint32)-position + mixBufferSize - 1) / mixBufferSize;
+			if (buffersBack > NumPeakBuffers - 2)
+				buffersBack = NumPeakBuffers - 2;
+		}
+		
+		const mp_uint32 index = (peakBuffer.load(std::memory_order_acquire) + NumPeakBuffers - buffersBack) % NumPeakBuffers;
+		return peakHistory[index][channel];
+	}
 	else
 	{
 		mp_sword peak = 0;
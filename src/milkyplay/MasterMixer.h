@@ -39,6 +39,8 @@
 #define __MASTERMIXER_H__
 
 #include "Mixable.h"
+#include "AudioDriverBase.h"
+#include <atomic>
 
 class MasterMixer
 {
@@ -94,8 +96,35 @@ public:
 	bool pauseDevice(Mixable* device, bool blocking = true);
 	bool resumeDevice(Mixable* device);
 	bool isDevicePaused(Mixable* device);
+
+	// microseconds the device took to mix the last buffer
+	mp_uint32 getDeviceMixTime(Mixable* device) const;
+	
+	// timing of the buffers mixed so far, xruns counted by the driver
+	class MixerStatistics& getStatistics() const { return *statistics; }
+	
+	// Mix the devices on num worker threads in addition to the audio
+	// thread, every device into a buffer of its own which are added up
+	// in device order, so the output doesn't change. 0 mixes everything
+	// on the audio thread. The workers busy wait while the devices are
+	// mixed, which costs up to num cores of CPU time during that part
+	// of each buffer. Changing this closes the audio device.
+	mp_sint32 setNumMixerThreads(mp_uint32 num);
+	mp_uint32 getNumMixerThreads() const;
+
+	// Let the audio driver mix num buffers ahead of the device on a
+	// thread of its own (if it supports that), 0 mixes from the audio
+	// callback. Changing this closes the audio device.
+	mp_sint32 setNumBuffersAhead(mp_uint32 num);
+	mp_uint32 getNumBuffersAhead() const { return numBuffersAhead; }
 		
 	void mixerHandler(mp_sword* buffer);
+	// same for drivers taking float samples, always uses the float bus
+	void mixerHandler(float* buffer);
+	
+	// run the filter hook on one buffer of 32 bit mixing output, then clip
+	// and shift it to 16 bit, exactly like the mixer's own 16 bit output
+	void convertBuffer(mp_sint32* bufferIn, mp_sword* bufferOut);
 	
 	// allows to control the loudness of the resulting output stream
 	// by bit-shifting the output *right* (dividing by 2^shift)
@@ -108,6 +137,18 @@ public:
 	void setFilterHook(Mixable* filterHook) { this->filterHook = filterHook; }
 	Mixable* getFilterHook(Mixable* filterHook) const { return filterHook; }
 	
+	// Convert the 32 bit mixing output to float and run it through the
+	// float filter hook and a look-ahead limiter instead of clipping it,
+	// 16 bit output is converted from the limited signal.
+	// The filter hook above is still applied before the conversion.
+	// When this is off, float drivers get the clipped 32 bit output scaled
+	// to float, just like the 16 bit output.
+	void setFloatBus(bool floatBus) { this->floatBus = floatBus; }
+	bool getFloatBus() const { return floatBus; }
+
+	void setFloatFilterHook(FloatMixable* floatFilterHook) { this->floatFilterHook = floatFilterHook; }
+	FloatMixable* getFloatFilterHook() const { return floatFilterHook; }
+	
 	// some legacy functions used by milkytracker
 	const class AudioDriverInterface* getAudioDriver() const { return audioDriver; }
 	
@@ -128,6 +169,14 @@ private:
 	bool disableMixing;
 	mp_uint32 numDevices;
 	Mixable* filterHook;
+	
+	bool floatBus;
+	// the limiter has processed the previous buffer (audio thread only)
+	bool limiterActive;
+	float* floatBuffer;
+	FloatMixable* floatFilterHook;
+	class Limiter* limiter;
+	class MixerStatistics* statistics;
 
 	struct DeviceDescriptor
 	{
@@ -135,17 +184,32 @@ private:
 		bool markedForRemoval;
 		bool markedForPause;
 		bool paused;
+		mp_uint32 mixTime;
 	
 		DeviceDescriptor() :
 			mixable(0),
 			markedForRemoval(false),
 			markedForPause(false),
-			paused(false)
+			paused(false),
+			mixTime(0)
 		{
 		}
 	};
 	
 	DeviceDescriptor* devices;
+
+	class MixerThreads* mixerThreads;
+	struct DeviceBatch;
+	DeviceBatch* deviceBatch;
+	// one buffer per device, the first device to mix goes straight into buffer
+	mp_sint32* deviceBuffers;
+	
+	mp_uint32 numBuffersAhead;
+	// peaks of the buffers mixed last when rendering ahead, the driver
+	// plays them after the last one has been mixed
+	enum { NumPeakBuffers = MP_MAXBUFFERSAHEAD+2 };
+	mp_sint32 peakHistory[NumPeakBuffers][MP_NUMCHANNELS];
+	std::atomic<mp_uint32> peakBuffer;
 	
 	mutable class AudioDriverManager* audioDriverManager;
 	AudioDriverInterface* audioDriver;
@@ -159,7 +223,12 @@ private:
 	void cleanup();
 	
 	inline void prepareBuffer();
+	inline void mixDevices();
+	void mixDevice(DeviceDescriptor& device, mp_sint32* buffer);
 	inline void swapOutBuffer(mp_sword* bufferOut);
+	void processFloatBus(float* bufferOut);
+	void storePeaks();
+	void updateStatistics();
 };
 
 #endif
@@ -41,6 +41,8 @@
 #include "MasterMixer.h"
 #include "PlayerSTD.h"
 #include "PlayerGeneric.h"
+#include "OfflineRenderer.h"
+#include "SongAnalyzer.h"
 #include "XModule.h"
 
 #ifdef MILKYTRACKER
@@ -47,6 +47,21 @@ struct Mixable
 	}
 
 	virtual void mix(mp_sint32* buffer, mp_uint32 numSamples) = 0;			
+	
+	// what the last call to mix() did, for the mixer statistics
+	virtual mp_uint32 getNumActiveVoices() const { return 0; }
+	// microseconds spent on anything but mixing (e.g. player ticks)
+	virtual mp_uint32 getTickTime() const { return 0; }
+};
+
+// same for the float master bus, full scale is -1.0 to 1.0
+struct FloatMixable
+{
+	virtual ~FloatMixable()
+	{
+	}
+
+	virtual void mix(float* buffer, mp_uint32 numSamples) = 0;			
 };
 
 #endif
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerStatistics.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "MixerStatistics.h"
+#include "XMFile.h"
+#include <stdio.h>
+#include <string.h>
+
+MixerStatistics::MixerStatistics() :
+	numBuffers(0),
+	numXRuns(0),
+	load(0),
+	averageLoad(0),
+	peakLoad(0),
+	maxInterval(0),
+	numVoices(0),
+	tickTime(0),
+	mixTime(0),
+	resetPending(false),
+	trace(NULL),
+	traceEnabled(false),
+	traceWritten(0),
+	traceRead(0),
+	numDroppedRecords(0)
+{
+	clear();
+}
+
+MixerStatistics::~MixerStatistics()
+{
+	delete[] trace;
+}
+
+void MixerStatistics::clear()
+{
+	startTime = lastBufferStartTime = Clock::now();
+
+	numBuffers.store(0, std::memory_order_relaxed);
+	numXRuns.store(0, std::memory_order_relaxed);
+	load.store(0, std::memory_order_relaxed);
+	averageLoad.store(0, std::memory_order_relaxed);
+	peakLoad.store(0, std::memory_order_relaxed);
+	maxInterval.store(0, std::memory_order_relaxed);
+	
+	for (mp_uint32 i = 0; i < NUMLOADBUCKETS; i++)
+		loadHistogram[i].store(0, std::memory_order_relaxed);
+}
+
+void MixerStatistics::beginBuffer()
+{
+	if (resetPending.load(std::memory_order_relaxed) && resetPending.exchange(false, std::memory_order_acquire))
+		clear();
+
+	bufferStartTime = Clock::now();
+}
+
+void MixerStatistics::endBuffer(mp_uint32 bufferSize, mp_uint32 sampleRate, mp_uint32 numVoices, mp_uint32 tickTime)
+{
+	const Clock::time_point now = Clock::now();
+	
+	const mp_uint32 mixTime = (mp_uint32)std::chrono::duration_cast<std::chrono::microseconds>(now - bufferStartTime).count();
+	const mp_uint32 bufferTime = sampleRate ? (mp_uint32)(((mp_int64)bufferSize * 1000000) / sampleRate) : 0;
+	
+	// the first buffer after a reset has no predecessor
+	const mp_uint32 numBuffers = this->numBuffers.load(std::memory_order_relaxed);
+	const mp_uint32 interval = numBuffers ? (mp_uint32)std::chrono::duration_cast<std::chrono::microseconds>(bufferStartTime - lastBufferStartTime).count() : bufferTime;
+	lastBufferStartTime = bufferStartTime;
+	
+	const mp_uint32 load = bufferTime ? (mp_uint32)(((mp_int64)mixTime * LOADSCALE) / bufferTime) : 0;
+	
+	this->load.store(load, std::memory_order_relaxed);
+	// average over roughly the last 16 buffers
+	const mp_uint32 averageLoad = this->averageLoad.load(std::memory_order_relaxed);
+	this->averageLoad.store(numBuffers ? averageLoad + (((mp_sint32)load - (mp_sint32)averageLoad) >> 4) : load, std::memory_order_relaxed);
+	if (load > peakLoad.load(std::memory_order_relaxed))
+		peakLoad.store(load, std::memory_order_relaxed);
+	if (interval > maxInterval.load(std::memory_order_relaxed))
+		maxInterval.store(interval, std::memory_order_relaxed);
+	
+	mp_uint32 bucket = load * (NUMLOADBUCKETS-1) / LOADSCALE;
+	if (bucket >= NUMLOADBUCKETS)
+		bucket = NUMLOADBUCKETS-1;
+	loadHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+	
+	this->numVoices.store(numVoices, std::memory_order_relaxed);
+	this->tickTime.store(tickTime, std::memory_order_relaxed);
+	this->mixTime.store(mixTime, std::memory_order_relaxed);
+	this->numBuffers.store(numBuffers + 1, std::memory_order_relaxed);
+	
+	if (!traceEnabled.load(std::memory_order_acquire))
+		return;
+	
+	const mp_uint32 written = traceWritten.load(std::memory_order_relaxed);
+	if (written - traceRead.load(std::memory_order_acquire) >= TRACESIZE)
+	{
+		numDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	
+	Record& record = trace[written & (TRACESIZE-1)];
+	record.time = std::chrono::duration_cast<std::chrono::microseconds>(bufferStartTime - startTime).count();
+	record.interval = interval;
+	record.bufferTime = bufferTime;
+	record.mixTime = mixTime;
+	record.tickTime = tickTime;
+	record.numVoices = numVoices;
+	record.numXRuns = numXRuns.load(std::memory_order_relaxed);
+	
+	traceWritten.store(written + 1, std::memory_order_release);
+}
+
+mp_uint32 MixerStatistics::getPeakLoad(bool reset/* = false*/)
+{
+	return reset ? peakLoad.exchange(0, std::memory_order_relaxed) : peakLoad.load(std::memory_order_relaxed);
+}
+
+mp_uint32 MixerStatistics::getMaxInterval(bool reset/* = false*/)
+{
+	return reset ? maxInterval.exchange(0, std::memory_order_relaxed) : maxInterval.load(std::memory_order_relaxed);
+}
+
+mp_uint32 MixerStatistics::getLoadHistogram(mp_uint32 bucket) const
+{
+	return bucket < NUMLOADBUCKETS ? loadHistogram[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+void MixerStatistics::setTraceEnabled(bool enabled)
+{
+	// the ring stays around once it's there, the audio thread 
+	// might still be writing a record
+	if (enabled && trace == NULL)
+		trace = new Record[TRACESIZE];
+	
+	traceEnabled.store(enabled, std::memory_order_release);
+}
+
+mp_uint32 MixerStatistics::readTrace(Record* dest, mp_uint32 count)
+{
+	const mp_uint32 read = traceRead.load(std::memory_order_relaxed);
+	mp_uint32 available = traceWritten.load(std::memory_order_acquire) - read;
+	if (count > available)
+		count = available;
+	
+	for (mp_uint32 i = 0; i < count; i++)
+		dest[i] = trace[(read + i) & (TRACESIZE-1)];
+	
+	traceRead.store(read + count, std::memory_order_release);
+	return count;
+}
+
+mp_uint32 MixerStatistics::writeTrace(XMFileBase& f, bool writeHeader/* = false*/)
+{
+	if (writeHeader)
+	{
+		static const char header[] = "time_us,interval_us,buffer_us,mix_us,tick_us,load_percent,voices,xruns\n";
+		f.write(header, 1, sizeof(header)-1);
+	}
+	
+	if (trace == NULL)
+		return 0;
+	
+	Record records[64];
+	char line[128];
+	mp_uint32 total = 0;
+	mp_uint32 num;
+	while ((num = readTrace(records, sizeof(records)/sizeof(Record))) != 0)
+	{
+		for (mp_uint32 i = 0; i < num; i++)
+		{
+			const Record& r = records[i];
+			const mp_uint32 load = r.bufferTime ? (mp_uint32)(((mp_int64)r.mixTime * LOADSCALE) / r.bufferTime) : 0;
+			sprintf(line, "%lld,%u,%u,%u,%u,%u.%u,%u,%u\n", 
+					(long long)r.time, r.interval, r.bufferTime, r.mixTime, r.tickTime, 
+					load / 10, load % 10, r.numVoices, r.numXRuns);
+			f.write(line, 1, (mp_sint32)strlen(line));
+		}
+		total+=num;
+	}
+	
+	return total;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerStatistics.h
+ *  MilkyPlay
+ *
+ *	How close the audio thread is to its deadline. The MasterMixer
+ *	times every buffer it mixes against the duration of that buffer,
+ *	the audio drivers count the buffers the device didn't get in time
+ *	(xruns). Everything is written from the audio thread (xruns also from 
+ *	driver threads) and can be read from any other thread without locking.
+ *	A trace of the single buffers can be recorded on top, it's kept in a
+ *	ring buffer which has to be drained regularly by one reader thread,
+ *	records which don't fit are dropped.
+ *
+ */
+
+#ifndef __MIXERSTATISTICS_H__
+#define __MIXERSTATISTICS_H__
+
+#include "MilkyPlayCommon.h"
+#include <atomic>
+#include <chrono>
+
+class XMFileBase;
+
+class MixerStatistics
+{
+public:
+	enum
+	{
+		// load is given in 1/10 percent of the buffer duration
+		LOADSCALE = 1000,
+		// 10% per bucket, the last one takes everything from 100%
+		NUMLOADBUCKETS = 11,
+		TRACESIZE = 4096
+	};
+
+	struct Record
+	{
+		mp_int64 time;			// microseconds since the statistics were reset
+		mp_uint32 interval;		// microseconds since the previous buffer
+		mp_uint32 bufferTime;	// duration of the buffer in microseconds
+		mp_uint32 mixTime;		// microseconds it took to mix the buffer
+		mp_uint32 tickTime;		// part of mixTime spent in the player ticks
+		mp_uint32 numVoices;
+		mp_uint32 numXRuns;		// xruns counted so far
+	};
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point startTime;
+	Clock::time_point bufferStartTime;
+	Clock::time_point lastBufferStartTime;
+	
+	std::atomic<mp_uint32> numBuffers;
+	std::atomic<mp_uint32> numXRuns;
+	std::atomic<mp_uint32> load;
+	std::atomic<mp_uint32> averageLoad;
+	std::atomic<mp_uint32> peakLoad;
+	std::atomic<mp_uint32> maxInterval;
+	std::atomic<mp_uint32> numVoices;
+	std::atomic<mp_uint32> tickTime;
+	std::atomic<mp_uint32> mixTime;
+	std::atomic<mp_uint32> loadHistogram[NUMLOADBUCKETS];
+	std::atomic<bool> resetPending;
+	
+	// single producer/single consumer ring
+	Record* trace;
+	std::atomic<bool> traceEnabled;
+	std::atomic<mp_uint32> traceWritten;
+	std::atomic<mp_uint32> traceRead;
+	std::atomic<mp_uint32> numDroppedRecords;
+
+	void clear();
+
+public:
+	MixerStatistics();
+	~MixerStatistics();
+
+	// called by the MasterMixer around every buffer it mixes
+	void beginBuffer();
+	void endBuffer(mp_uint32 bufferSize, mp_uint32 sampleRate, mp_uint32 numVoices, mp_uint32 tickTime);
+	
+	// called by the audio drivers when the device ran out of data
+	void addXRun() { numXRuns.fetch_add(1, std::memory_order_relaxed); }
+	
+	// start over, takes effect with the next buffer
+	void reset() { resetPending.store(true, std::memory_order_release); }
+	
+	mp_uint32 getNumBuffers() const { return numBuffers.load(std::memory_order_relaxed); }
+	mp_uint32 getNumXRuns() const { return numXRuns.load(std::memory_order_relaxed); }
+	
+	// load of the last buffer and a running average, see LOADSCALE
+	mp_uint32 getLoad() const { return load.load(std::memory_order_relaxed); }
+	mp_uint32 getAverageLoad() const { return averageLoad.load(std::memory_order_relaxed); }
+	// highest load since the last call with reset set (or reset())
+	mp_uint32 getPeakLoad(bool reset = false);
+	// longest time between two buffers in microseconds, 
+	// should stay around the buffer duration
+	mp_uint32 getMaxInterval(bool reset = false);
+	
+	// how many buffers were mixed with a load of bucket*10% to (bucket+1)*10%
+	mp_uint32 getLoadHistogram(mp_uint32 bucket) const;
+	
+	mp_uint32 getNumVoices() const { return numVoices.load(std::memory_order_relaxed); }
+	// microseconds spent in the player ticks/mixing the last buffer
+	mp_uint32 getTickTime() const { return tickTime.load(std::memory_order_relaxed); }
+	mp_uint32 getMixTime() const { return mixTime.load(std::memory_order_relaxed); }
+	
+	// Allocates the trace buffer on first use, call this from 
+	// the thread which reads the trace.
+	void setTraceEnabled(bool enabled);
+	bool isTraceEnabled() const { return traceEnabled.load(std::memory_order_relaxed); }
+	// take at most count records off the trace, returns how many
+	mp_uint32 readTrace(Record* dest, mp_uint32 count);
+	mp_uint32 getNumDroppedRecords() const { return numDroppedRecords.load(std::memory_order_relaxed); }
+	
+	// drain the trace to a CSV file, the header is written if requested
+	mp_uint32 writeTrace(XMFileBase& f, bool writeHeader = false);
+};
+
+#endif
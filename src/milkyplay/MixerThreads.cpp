@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerThreads.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "MixerThreads.h"
+
+#if defined(WIN32) || defined(_WIN32_WCE)
+	// windows.h comes with MilkyPlayCommon.h
+#elif defined(__APPLE__)
+	#include <dispatch/dispatch.h>
+#else
+	#include <semaphore.h>
+#endif
+
+// Posting doesn't block, it only enters the kernel if a thread is waiting
+class MixerThreads::Semaphore
+{
+private:
+#if defined(WIN32) || defined(_WIN32_WCE)
+	HANDLE handle;
+#elif defined(__APPLE__)
+	dispatch_semaphore_t handle;
+#else
+	sem_t handle;
+#endif
+
+public:
+	Semaphore()
+	{
+#if defined(WIN32) || defined(_WIN32_WCE)
+		handle = CreateSemaphore(NULL, 0, MAXTHREADS, NULL);
+#elif defined(__APPLE__)
+		handle = dispatch_semaphore_create(0);
+#else
+		sem_init(&handle, 0, 0);
+#endif
+	}
+	
+	~Semaphore()
+	{
+#if defined(WIN32) || defined(_WIN32_WCE)
+		CloseHandle(handle);
+#elif defined(__APPLE__)
+		dispatch_release(handle);
+#else
+		sem_destroy(&handle);
+#endif
+	}
+
+	void wait()
+	{
+#if defined(WIN32) || defined(_WIN32_WCE)
+		WaitForSingleObject(handle, INFINITE);
+#elif defined(__APPLE__)
+		dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER);
+#else
+		while (sem_wait(&handle) != 0)
+			;
+#endif
+	}
+	
+	void post(mp_uint32 count)
+	{
+#if defined(WIN32) || defined(_WIN32_WCE)
+		ReleaseSemaphore(handle, count, NULL);
+#else
+		for (mp_uint32 i = 0; i < count; i++)
+		{
+#if defined(__APPLE__)
+			dispatch_semaphore_signal(handle);
+#else
+			sem_post(&handle);
+#endif
+		}
+#endif
+	}
+};
+
+MixerThreads::MixerThreads(mp_uint32 numThreads, mp_uint32 beatPacketSize) :
+	threads(NULL),
+	numThreads(numThreads > MAXTHREADS ? (mp_uint32)MAXTHREADS : numThreads),
+	groupBuffers(NULL),
+	beatPacketSize(0),
+	batch(NULL),
+	generation(0),
+	ticket(0),
+	jobsDone(0),
+	terminate(false),
+	spinning(false),
+	numSleeping(0),
+	wakeup(new Semaphore())
+{
+	maxGroups = (this->numThreads+1)*GROUPSPERTHREAD;
+	if (maxGroups > MAXGROUPS)
+		maxGroups = MAXGROUPS;
+
+	memset(groupUsed, 0, sizeof(groupUsed));
+	job.owner = this;
+	job.mixer = NULL;
+	job.resampler = NULL;
+	job.buffer32 = NULL;
+	job.beatNum = job.beatLength = 0;
+	job.numChannels = job.numGroups = 0;
+	
+	setBeatPacketSize(beatPacketSize);
+
+	threads = new std::thread[this->numThreads];
+	for (mp_uint32 i = 0; i < this->numThreads; i++)
+		threads[i] = std::thread(&MixerThreads::workerLoop, this);
+}
+
+MixerThreads::~MixerThreads()
+{
+	terminate.store(true);
+	wakeSleepers();
+
+	for (mp_uint32 i = 0; i < numThreads; i++)
+		threads[i].join();
+
+	delete[] threads;
+	delete[] groupBuffers;
+	delete wakeup;
+}
+
+void MixerThreads::setBeatPacketSize(mp_uint32 beatPacketSize)
+{
+	if (beatPacketSize == this->beatPacketSize)
+		return;
+		
+	delete[] groupBuffers;
+	groupBuffers = beatPacketSize ? new mp_sint32[(maxGroups-1)*beatPacketSize*MP_NUMCHANNELS] : NULL;
+	this->beatPacketSize = beatPacketSize;
+}
+
+void MixerThreads::processGroup(mp_uint32 group)
+{
+	const mp_uint32 from = group*job.numChannels/job.numGroups;
+	const mp_uint32 to = (group+1)*job.numChannels/job.numGroups;
+	
+	mp_sint32* buffer32 = job.buffer32;
+	
+	if (group)
+	{
+		buffer32 = groupBuffers + (group-1)*beatPacketSize*MP_NUMCHANNELS;
+		
+		// only clear (and later add) the private buffer if any channel 
+		// of this group is going to be mixed into it
+		bool used = false;
+		for (mp_uint32 c = from; c < to && !used; c++)
+			used = (job.mixer->channel[c].flags & ChannelMixer::MP_SAMPLE_PLAY) && c >= job.mixer->numChannelBuses;
+		
+		if (used)
+			memset(buffer32, 0, job.beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
+		groupUsed[group] = used;
+	}
+	
+	job.resampler->addChannelRange(job.mixer, from, to, buffer32, job.beatNum, job.beatLength);
+}
+
+bool MixerThreads::processJobs()
+{
+	bool processed = false;
+	mp_uint32 t = ticket.load(std::memory_order_relaxed);
+	
+	while ((t & 0xFF) < ((t >> 8) & 0xFF))
+	{
+		// the acquire pairs with the release in run, after claiming a job
+		// the batch can't change until the job has been finished
+		if (ticket.compare_exchange_weak(t, t+1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			batch->process(t & 0xFF);
+			jobsDone.fetch_add(1, std::memory_order_release);
+			processed = true;
+			t = ticket.load(std::memory_order_relaxed);
+		}
+	}
+	
+	return processed;
+}
+
+void MixerThreads::sleep()
+{
+	// The worker counts itself in before looking for work a last time,
+	// run() publishes the work before looking for sleepers. Both are
+	// sequentially consistent, so either the work is seen here or the
+	// sleeper is seen by run() and gets a post.
+	numSleeping.fetch_add(1);
+	if (!hasWork() && !terminate.load())
+	{
+		wakeup->wait();
+		return;
+	}
+	
+	// count ourselves out again, unless we've been posted already
+	mp_uint32 n = numSleeping.load(std::memory_order_relaxed);
+	while (n)
+	{
+		if (numSleeping.compare_exchange_weak(n, n-1, std::memory_order_relaxed))
+			return;
+	}
+	
+	wakeup->wait();
+}
+
+void MixerThreads::wakeSleepers()
+{
+	if (numSleeping.load() == 0)
+		return;
+	
+	const mp_uint32 n = numSleeping.exchange(0);
+	if (n)
+		wakeup->post(n);
+}
+
+void MixerThreads::workerLoop()
+{
+	mp_uint32 spins = 0;
+	
+	while (!terminate.load(std::memory_order_acquire))
+	{
+		if (processJobs())
+		{
+			spins = 0;
+			continue;
+		}
+		
+		// the next batch of the buffer is about to come
+		if (spinning.load(std::memory_order_relaxed) && ++spins < MAXSPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		
+		sleep();
+		spins = 0;
+	}
+}
+
+void MixerThreads::run(Batch* batch, mp_uint32 numJobs)
+{
+	if (numJobs > MAXJOBS)
+		numJobs = MAXJOBS;
+
+	this->batch = batch;
+	jobsDone.store(0, std::memory_order_relaxed);
+	generation = (generation + 1) & 0xFFFF;
+	spinning.store(true, std::memory_order_relaxed);
+	ticket.store((generation << 16) | (numJobs << 8));
+
+	// usually only the first batch of a buffer finds the workers asleep
+	wakeSleepers();
+	
+	// work on the jobs ourselves, so we only ever wait for
+	// jobs which are already being processed by another thread
+	processJobs();
+	
+	while (jobsDone.load(std::memory_order_acquire) < numJobs)
+		std::this_thread::yield();
+}
+
+void MixerThreads::mixBeatPacket(ChannelMixer* mixer,
+								 ChannelMixer::ResamplerBase* resampler,
+								 mp_uint32 numChannels,
+								 mp_sint32* buffer32,
+								 mp_sint32 beatNum, 
+								 mp_sint32 beatLength)
+{
+	mp_uint32 numGroups = numChannels / MINCHANNELSPERGROUP;
+	if (numGroups > maxGroups)
+		numGroups = maxGroups;
+
+	if (numGroups < 2 || (mp_uint32)beatLength > beatPacketSize)
+	{
+		resampler->addChannels(mixer, numChannels, buffer32, beatNum, beatLength);
+		return;
+	}
+	
+	job.mixer = mixer;
+	job.resampler = resampler;
+	job.buffer32 = buffer32;
+	job.beatNum = beatNum;
+	job.beatLength = beatLength;
+	job.numChannels = numChannels;
+	job.numGroups = numGroups;
+	
+	run(&job, numGroups);
+	
+	// add up the groups in a fixed order
+	for (mp_uint32 g = 1; g < numGroups; g++)
+	{
+		if (!groupUsed[g])
+			continue;
+			
+		const mp_sint32* src = groupBuffers + (g-1)*beatPacketSize*MP_NUMCHANNELS;
+		mp_sint32* dst = buffer32;
+		for (mp_sint32 i = 0; i < beatLength*MP_NUMCHANNELS; i++)
+			dst[i] += src[i];
+	}
+}
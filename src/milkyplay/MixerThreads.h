@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerThreads.h
+ *  MilkyPlay
+ *
+ *	Worker threads which help the ChannelMixer mixing a beat packet.
+ *	The channels are split into groups, each group is mixed into a
+ *	private buffer by whichever thread claims it first (the mixer thread
+ *	takes part as well), the group buffers are then added up in a fixed 
+ *	order, so the result is exactly the same as mixing on one thread.
+ *	Nothing is allocated or locked while mixing.
+ *	Any other batch of independent jobs can be run the same way, the
+ *	MasterMixer uses this to mix its devices in parallel.
+ *	While a buffer is being mixed idle workers poll for the next batch,
+ *	after park() they sleep on a semaphore, which the mixer thread only
+ *	posts when a batch finds workers asleep.
+ *
+ */
+
+#ifndef __MIXERTHREADS_H__
+#define __MIXERTHREADS_H__
+
+#include "ChannelMixer.h"
+#include <atomic>
+#include <thread>
+
+class MixerThreads
+{
+public:
+	enum
+	{
+		MAXTHREADS = 16,
+		MAXGROUPS = 64,
+		MAXJOBS = 255,
+		GROUPSPERTHREAD = 4,		// more groups than threads to even out the load
+		MINCHANNELSPERGROUP = 2,
+		MAXSPINS = 4096				// idle polls before a worker goes to sleep without park()
+	};
+
+	// a batch of independent jobs, process() is called exactly once 
+	// for every job index by whichever thread claims it first
+	class Batch
+	{
+	public:
+		virtual ~Batch()
+		{
+		}
+		
+		virtual void process(mp_uint32 index) = 0;
+	};
+
+private:
+	struct Job : public Batch
+	{
+		MixerThreads* owner;
+		ChannelMixer* mixer;
+		ChannelMixer::ResamplerBase* resampler;
+		mp_sint32* buffer32;
+		mp_sint32 beatNum;
+		mp_sint32 beatLength;
+		mp_uint32 numChannels;
+		mp_uint32 numGroups;
+
+		virtual void process(mp_uint32 group) { owner->processGroup(group); }
+	};
+
+	std::thread*		threads;
+	mp_uint32			numThreads;
+	mp_uint32			maxGroups;
+
+	mp_sint32*			groupBuffers;		// private beat packet of group 1 to maxGroups-1, group 0 is mixed in place
+	mp_uint32			beatPacketSize;
+	bool				groupUsed[MAXGROUPS];
+	
+	Job					job;
+	Batch*				batch;
+	mp_uint32			generation;
+	// generation << 16 | number of jobs << 8 | next job to claim
+	std::atomic<mp_uint32> ticket;
+	std::atomic<mp_uint32> jobsDone;
+
+	std::atomic<bool>	terminate;
+	std::atomic<bool>	spinning;
+	std::atomic<mp_uint32> numSleeping;
+	
+	class Semaphore;
+	Semaphore*			wakeup;
+
+	bool				hasWork() const
+	{
+		const mp_uint32 t = ticket.load();
+		return (t & 0xFF) < ((t >> 8) & 0xFF);
+	}
+
+	bool				processJobs();
+	void				processGroup(mp_uint32 group);
+	void				sleep();
+	void				wakeSleepers();
+	void				workerLoop();
+
+public:
+	// numThreads worker threads are started in addition to the mixer thread
+	MixerThreads(mp_uint32 numThreads, mp_uint32 beatPacketSize = 0);
+	~MixerThreads();
+
+	mp_uint32			getNumThreads() const { return numThreads; }
+
+	// reallocate the group buffers, don't call this while mixing
+	void				setBeatPacketSize(mp_uint32 beatPacketSize);
+
+	// process jobs 0 to numJobs-1 (at most MAXJOBS) of batch, returns 
+	// when all of them are done, only one thread may run a batch at a time
+	void				run(Batch* batch, mp_uint32 numJobs);
+
+	// no more batches until the next buffer, let the workers sleep
+	void				park() { spinning.store(false, std::memory_order_relaxed); }
+
+	// same as ResamplerBase::addChannels, called from the mixer thread
+	void				mixBeatPacket(ChannelMixer* mixer,
+									  ChannelMixer::ResamplerBase* resampler,
+									  mp_uint32 numChannels,
+									  mp_sint32* buffer32,
+									  mp_sint32 beatNum, 
+									  mp_sint32 beatLength);
+};
+
+#endif
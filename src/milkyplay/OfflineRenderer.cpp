@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  OfflineRenderer.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "OfflineRenderer.h"
+#include "PlayerGeneric.h"
+#include "PlayerBase.h"
+#include "PlayerIT.h"
+#include "XModule.h"
+#include "AudioDriver_WAVWriter.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Writes data to a file from a separate thread. While one buffer is 
+// being written to disk the renderer fills up the other one.
+class AsyncWriter
+{
+private:
+	enum
+	{
+		BufferSize = 1024*1024
+	};
+
+	XMFileBase& f;
+	mp_ubyte* buffers[2];
+	mp_uint32 current;
+	mp_uint32 fill;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	const mp_ubyte* pending;
+	mp_uint32 pendingSize;
+	bool finished;
+	std::thread thread;
+	
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			while (!pending && !finished)
+				condition.wait(lock);
+			
+			if (!pending)
+				break;
+			
+			const mp_ubyte* data = pending;
+			mp_uint32 size = pendingSize;
+			
+			lock.unlock();
+			f.write(data, 1, size);
+			lock.lock();
+			
+			pending = NULL;
+			condition.notify_all();
+		}
+	}
+	
+	void submit()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (pending)
+			condition.wait(lock);
+		
+		pending = buffers[current];
+		pendingSize = fill;
+		condition.notify_all();
+		
+		current^=1;
+		fill = 0;
+	}
+	
+public:
+	AsyncWriter(XMFileBase& f) :
+		f(f),
+		current(0),
+		fill(0),
+		pending(NULL),
+		pendingSize(0),
+		finished(false)
+	{
+		buffers[0] = new mp_ubyte[BufferSize];
+		buffers[1] = new mp_ubyte[BufferSize];
+		thread = std::thread(&AsyncWriter::run, this);
+	}
+	
+	~AsyncWriter()
+	{
+		finish();
+		delete[] buffers[0];
+		delete[] buffers[1];
+	}
+	
+	void write(const mp_ubyte* data, mp_uint32 size)
+	{
+		while (size)
+		{
+			mp_uint32 todo = BufferSize - fill;
+			if (todo > size)
+				todo = size;
+			
+			memcpy(buffers[current] + fill, data, todo);
+			fill+=todo;
+			data+=todo;
+			size-=todo;
+
+			if (fill == BufferSize)
+				submit();
+		}
+	}
+
+	// write out what's left and wait until the file is written
+	void finish()
+	{
+		if (!thread.joinable())
+			return;
+		
+		if (fill)
+			submit();
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished = true;
+			condition.notify_all();
+		}
+		
+		thread.join();
+	}
+};
+
+OfflineRenderer::OfflineRenderer(PlayerGeneric& settings, mp_uint32 blockSize/* = DefaultBlockSize*/) :
+	settings(settings),
+	player(NULL),
+	module(NULL),
+	endOrder(-1),
+	blockSize(blockSize ? blockSize : (mp_uint32)DefaultBlockSize),
+	blockPos(0),
+	blockFill(0),
+	numRenderedFrames(0),
+	renderTime(0.0)
+{
+	blockBuffer = new mp_sint32[this->blockSize*MP_NUMCHANNELS];
+	conversionBuffer = new mp_sint32[this->blockSize*MP_NUMCHANNELS];
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+	stopPlaying();
+	delete[] blockBuffer;
+	delete[] conversionBuffer;
+}
+
+mp_sint32 OfflineRenderer::startPlaying(XModule* module, 
+										mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/, 
+										const mp_ubyte* mutingArray/* = NULL*/, mp_uint32 mutingNumChannels/* = 0*/,
+										const mp_ubyte* customPanningTable/* = NULL*/)
+{
+	stopPlaying();
+
+	player = settings.getPreferredPlayer(module);
+	if (player == NULL)
+		return MP_UNSUPPORTED;
+
+	player->adjustFrequency(settings.frequency);
+	player->resetOnStop(settings.resetOnStopFlag);
+	player->setBufferSize(blockSize);
+	player->setResamplerType(settings.resamplerType);
+	player->setMasterVolume(settings.masterVolume);
+	player->setPanningSeparation(settings.panningSeparation);
+	player->setPlayMode(settings.playMode);
+
+	for (mp_sint32 i = PlayModeSettings::PlayModeOptionFirst; i < PlayModeSettings::PlayModeOptionLast; i++)
+		player->enable((PlayModeSettings::PlayModeOptions)i, settings.isEnabled((PlayModeSettings::PlayModeOptions)i));
+
+	player->setDisableMixing(settings.disableMixing);
+	player->setAllowFilters(settings.allowFilters);
+	player->setNumMixerThreads(settings.numMixerThreads);
+#ifndef MILKYTRACKER
+	if (player->getType() == PlayerBase::PlayerType_IT)
+	{
+		static_cast<PlayerIT*>(player)->setNumMaxVirChannels(settings.numMaxVirChannels);
+	}
+#endif
+
+	if (mutingArray && mutingNumChannels > 0 && mutingNumChannels <= module->header.channum)
+	{
+		for (mp_uint32 i = 0; i < mutingNumChannels; i++)
+			player->muteChannel(i, mutingArray[i] == 1);
+	}
+
+	mp_sint32 res = player->startPlaying(module, false, startOrder, 0, -1, customPanningTable, false, -1);
+	if (res != MP_OK)
+	{
+		delete player;
+		player = NULL;
+		return res;
+	}
+	
+	if (endOrder == -1 || endOrder < startOrder || endOrder > module->header.ordnum - 1)
+		endOrder = module->header.ordnum - 1;		
+
+	this->module = module;
+	this->endOrder = endOrder;
+	blockPos = blockFill = 0;
+	
+	return MP_OK;
+}
+
+mp_sint32 OfflineRenderer::stopPlaying()
+{
+	if (player)
+	{
+		player->stopPlaying();
+		delete player;
+		player = NULL;
+	}
+	
+	module = NULL;
+	blockPos = blockFill = 0;
+	
+	return MP_OK;
+}
+
+bool OfflineRenderer::hasSongHalted() const
+{
+	if (blockPos < blockFill)
+		return false;
+	
+	return player == NULL || player->hasSongHalted() || player->getOrder(0) > endOrder;
+}
+
+bool OfflineRenderer::mixBlock(mp_sint32* buffer)
+{
+	if (hasSongHalted())
+		return false;
+
+	memset(buffer, 0, blockSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+	player->mix(buffer, blockSize);
+	numRenderedFrames+=blockSize;
+	
+	return true;
+}
+
+mp_sint32 OfflineRenderer::renderBlocks(mp_sint32* buffer, mp_uint32 numFrames)
+{
+	mp_uint32 done = 0;
+	
+	while (done < numFrames)
+	{
+		if (blockPos == blockFill)
+		{
+			// whole blocks are mixed straight into the destination
+			if (numFrames - done >= blockSize)
+			{
+				if (!mixBlock(buffer + done*MP_NUMCHANNELS))
+					break;
+				done+=blockSize;
+				continue;
+			}
+		
+			if (!mixBlock(blockBuffer))
+				break;
+			blockPos = 0;
+			blockFill = blockSize;
+		}
+		
+		mp_uint32 todo = blockFill - blockPos;
+		if (todo > numFrames - done)
+			todo = numFrames - done;
+		
+		memcpy(buffer + done*MP_NUMCHANNELS, blockBuffer + blockPos*MP_NUMCHANNELS, todo*MP_NUMCHANNELS*sizeof(mp_sint32));
+		blockPos+=todo;
+		done+=todo;
+	}
+	
+	return done;
+}
+
+mp_sint32 OfflineRenderer::render(mp_sint32* buffer, mp_uint32 numFrames)
+{
+	if (player == NULL)
+		return MP_DEVICE_ERROR;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	mp_sint32 res = renderBlocks(buffer, numFrames);
+	
+	renderTime+=std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	
+	return res;
+}
+
+mp_sint32 OfflineRenderer::render(float* buffer, mp_uint32 numFrames)
+{
+	if (player == NULL)
+		return MP_DEVICE_ERROR;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	const float scale = 1.0f / (float)getFullScale();
+	mp_sint32 res = 0;
+	
+	while ((mp_uint32)res < numFrames)
+	{
+		mp_uint32 todo = numFrames - res;
+		if (todo > blockSize)
+			todo = blockSize;
+		
+		mp_sint32 n = renderBlocks(conversionBuffer, todo);
+		
+		float* dst = buffer + res*MP_NUMCHANNELS;
+		for (mp_sint32 i = 0; i < n*MP_NUMCHANNELS; i++)
+			dst[i] = (float)conversionBuffer[i] * scale;
+		
+		res+=n;
+		if ((mp_uint32)n < todo)
+			break;
+	}
+	
+	renderTime+=std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	
+	return res;
+}
+
+mp_sint32 OfflineRenderer::getFullScale() const
+{
+	return 32768 << settings.sampleShift;
+}
+
+double OfflineRenderer::getRealtimeMultiple() const
+{
+	if (renderTime <= 0.0)
+		return 0.0;
+	
+	return ((double)numRenderedFrames / (double)settings.frequency) / renderTime;
+}
+
+mp_sint32 OfflineRenderer::exportToWAV(const SYSCHAR* fileName, 
+									   XModule* module, 
+									   mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/, 
+									   const mp_ubyte* mutingArray/* = NULL*/, mp_uint32 mutingNumChannels/* = 0*/,
+									   const mp_ubyte* customPanningTable/* = NULL*/,
+									   bool floatFormat/* = false*/)
+{
+	mp_sint32 res = startPlaying(module, startOrder, endOrder, mutingArray, mutingNumChannels, customPanningTable);
+	if (res != MP_OK)
+		return res;
+
+	// don't leave an empty file behind if the song can't be played
+	XMFile f(fileName, true);
+	if (!f.isOpenForWriting())
+	{
+		stopPlaying();
+		return MP_DEVICE_ERROR;
+	}
+
+	const mp_uint32 numBits = floatFormat ? 32 : 16;
+	WAVWriter::writeHeader(&f, settings.frequency, 0, numBits, floatFormat);
+
+	mp_sint32* buffer32 = new mp_sint32[blockSize*MP_NUMCHANNELS];
+	mp_ubyte* bytes = new mp_ubyte[blockSize*MP_NUMCHANNELS*4];
+	mp_uint32 numFrames = 0;
+	
+	{
+		AsyncWriter writer(f);
+		
+		const mp_sint32 sampleShift = settings.sampleShift;
+		const mp_sint32 lowerBound = -((128<<sampleShift)*256); 
+		const mp_sint32 upperBound = ((128<<sampleShift)*256)-1;
+		const float scale = 1.0f / (float)getFullScale();
+		
+		for (;;)
+		{
+			mp_sint32 n = render(buffer32, blockSize);
+			if (n <= 0)
+				break;
+				
+			mp_ubyte* dst = bytes;
+			if (floatFormat)
+			{
+				for (mp_sint32 i = 0; i < n*MP_NUMCHANNELS; i++)
+				{
+					float v = (float)buffer32[i] * scale;
+					mp_uint32 b;
+					memcpy(&b, &v, 4);
+					*dst++ = (mp_ubyte)b;
+					*dst++ = (mp_ubyte)(b>>8);
+					*dst++ = (mp_ubyte)(b>>16);
+					*dst++ = (mp_ubyte)(b>>24);
+				}
+			}
+			else
+			{
+				// same as MasterMixer::convertBuffer
+				for (mp_sint32 i = 0; i < n*MP_NUMCHANNELS; i++)
+				{
+					mp_sint32 b = buffer32[i];
+					if (b>upperBound) b = upperBound; 
+					else if (b<lowerBound) b = lowerBound; 
+					b>>=sampleShift;
+					*dst++ = (mp_ubyte)b;
+					*dst++ = (mp_ubyte)(b>>8);
+				}
+			}
+			
+			writer.write(bytes, (mp_uint32)(dst - bytes));
+			numFrames+=n;
+		}
+		
+		writer.finish();
+	}
+	
+	delete[] bytes;
+	delete[] buffer32;
+	
+	stopPlaying();
+	
+	f.seek(0);
+	WAVWriter::writeHeader(&f, settings.frequency, numFrames, numBits, floatFormat);
+	
+	return numFrames;
+}
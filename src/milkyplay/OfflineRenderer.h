@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  OfflineRenderer.h
+ *  MilkyPlay
+ *
+ *	Renders a module straight into memory as fast as possible, 
+ *	there is no MasterMixer and no audio driver involved.
+ *
+ */
+
+#ifndef __OFFLINERENDERER_H__
+#define __OFFLINERENDERER_H__
+
+#include "MilkyPlayCommon.h"
+
+class PlayerGeneric;
+class PlayerBase;
+class XModule;
+
+class OfflineRenderer
+{
+public:
+	enum
+	{
+		DefaultBlockSize = 8192
+	};
+
+private:
+	PlayerGeneric&		settings;
+	PlayerBase*			player;
+	XModule*			module;
+	mp_sint32			endOrder;
+	
+	mp_uint32			blockSize;
+	mp_sint32*			blockBuffer;
+	mp_uint32			blockPos;
+	mp_uint32			blockFill;
+	// float output is converted from this one, blockSize frames
+	mp_sint32*			conversionBuffer;
+	
+	mp_int64			numRenderedFrames;
+	double				renderTime;
+
+	bool				mixBlock(mp_sint32* buffer);
+	mp_sint32			renderBlocks(mp_sint32* buffer, mp_uint32 numFrames);
+	
+public:
+	/**
+	 * Construct an offline renderer
+	 * @param  settings		mixer and play mode settings are taken from this player
+	 *						when startPlaying() is called (frequency, resampler, master 
+	 *						volume, sample shift, play mode, filters, disabled mixing...)
+	 * @param  blockSize	number of stereo frames which are mixed in one go
+	 */
+						OfflineRenderer(PlayerGeneric& settings, mp_uint32 blockSize = DefaultBlockSize);
+						~OfflineRenderer();
+	
+	/**
+	 * Start rendering a module
+	 * @param  module				the module to render
+	 * @param  startOrder			the start position within the order list of the song
+	 * @param  endOrder				the last order to be played
+	 * @param  mutingArray			optional: an array telling which channels to mute
+	 * @param  mutingNumChannels	optional: many channels does the muting array contain?
+	 * @param  customPanningTable	When specifying a custom panning table the panning default from the module is ignored
+	 * @return						MP_OK on success
+	 */
+	mp_sint32			startPlaying(XModule* module, 
+									 mp_sint32 startOrder = 0, mp_sint32 endOrder = -1, 
+									 const mp_ubyte* mutingArray = NULL, mp_uint32 mutingNumChannels = 0,
+									 const mp_ubyte* customPanningTable = NULL);
+	
+	/**
+	 * Stop rendering and release the player
+	 */
+	mp_sint32			stopPlaying();
+	
+	/**
+	 * Check if the end of the song (or the end order) has been reached
+	 */
+	bool				hasSongHalted() const;
+
+	/**
+	 * Render interleaved stereo frames as they come out of the mixer, without
+	 * any clipping. Full scale is getFullScale(), the sample shift is not applied.
+	 * @param  buffer		destination buffer, holds numFrames*2 values
+	 * @param  numFrames	number of stereo frames to render
+	 * @return				number of frames rendered, less than numFrames when
+	 *						the song has ended, negative on error
+	 */
+	mp_sint32			render(mp_sint32* buffer, mp_uint32 numFrames);
+
+	/**
+	 * Render interleaved stereo frames normalized to [-1.0, 1.0], 
+	 * peaks above full scale are not clipped
+	 * @param  buffer		destination buffer, holds numFrames*2 values
+	 * @param  numFrames	number of stereo frames to render
+	 * @return				number of frames rendered, less than numFrames when
+	 *						the song has ended, negative on error
+	 */
+	mp_sint32			render(float* buffer, mp_uint32 numFrames);
+	
+	/**
+	 * Return the value of a full scale sample in the mixer output
+	 */
+	mp_sint32			getFullScale() const;
+
+	/**
+	 * Render a whole song into a stereo WAV file, the file is written 
+	 * asynchronously while the next blocks are rendered
+	 * @param  fileName				the path and the filename to export to
+	 * @param  module				the module to export
+	 * @param  startOrder			the start position within the order list of the song
+	 * @param  endOrder				the last order to be played
+	 * @param  mutingArray			optional: an array telling which channels to mute
+	 * @param  mutingNumChannels	optional: many channels does the muting array contain?
+	 * @param  customPanningTable	When specifying a custom panning table the panning default from the module is ignored
+	 * @param  floatFormat			write 32 bit float samples instead of 16 bit integers
+	 * @return						number of frames written, negative on error
+	 */
+	mp_sint32			exportToWAV(const SYSCHAR* fileName, 
+									XModule* module, 
+									mp_sint32 startOrder = 0, mp_sint32 endOrder = -1, 
+									const mp_ubyte* mutingArray = NULL, mp_uint32 mutingNumChannels = 0,
+									const mp_ubyte* customPanningTable = NULL,
+									bool floatFormat = false);
+	
+	// --- statistics, accumulated over all songs rendered by this instance ---
+	mp_int64			getNumRenderedFrames() const { return numRenderedFrames; }
+	// time spent rendering in seconds
+	double				getRenderTime() const { return renderTime; }
+	// seconds of audio rendered per second of rendering time
+	double				getRealtimeMultiple() const;
+};
+
+#endif
@@ -55,6 +55,7 @@ mp_sint32 PlayerBase::kick()
 	paused = false;
 	// playing => song has not stopped yet
 	halted = false;
+	haltedAtLoop = false;
 	// set idle mode
 	setIdle(idle);
 	
@@ -91,6 +92,7 @@ PlayerBase::PlayerBase(mp_uint32 frequency) :
 	startPlay						= false;
 	paused							= false;
 	halted							= false;
+	haltedAtLoop					= false;
 	idle							= false;
 	resetOnStopFlag					= false;
 	resetMainVolumeOnStartPlayFlag	= true;
@@ -150,6 +152,24 @@ mp_sint32 PlayerBase::setBufferSize(mp_uint32 bufferSize)
 	return MP_OK;
 }
 
+mp_sint32 PlayerBase::setNumBuffersAhead(mp_uint32 num)
+{
+	mp_uint32 lastTimeRecordSize = getTimeRecordSize();
+
+	mp_sint32 res = ChannelMixer::setNumBuffersAhead(num);
+	
+	if (res < 0)
+		return res;
+		
+	// nothing has changed
+	if (lastTimeRecordSize == getTimeRecordSize())
+		return MP_OK;
+
+	reallocTimeRecord();
+	
+	return MP_OK;
+}
+
 void PlayerBase::restart(mp_uint32 startPosition/* = 0*/, mp_uint32 startRow/* = 0*/, bool resetMixer/* = true*/, const mp_ubyte* customPanningTable/* = NULL*/, bool playOneRowOnly /* = false*/)
 {
 	if (module == NULL) 
@@ -162,6 +182,7 @@ void PlayerBase::restart(mp_uint32 startPosition/* = 0*/, mp_uint32 startRow/* =
 	baseBpm = 125;
 	
 	halted = false;
+	haltedAtLoop = false;
 	
 	synccnt = 0;
 	rowcnt = startRow;
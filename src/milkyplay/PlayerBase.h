@@ -126,14 +126,14 @@ private:
 	void reallocTimeRecord()
 	{
 		delete[] timeRecord;
-		timeRecord = new TimeRecord[getNumBeatPackets()+1];
+		timeRecord = new TimeRecord[getTimeRecordSize()];
 		
 		updateTimeRecord();
 	}
 
 	void updateTimeRecord()
 	{
-		for (mp_uint32 i = 0; i < getNumBeatPackets()+1; i++)
+		for (mp_uint32 i = 0; i < getTimeRecordSize(); i++)
 		{
 			timeRecord[i] = TimeRecord(poscnt, 
 									   rowcnt, 
@@ -158,6 +158,7 @@ protected:
 
 	bool			paused;					// Player is paused
 	bool			halted;					// Playing has been stopped (song is over)
+	bool			haltedAtLoop;			// ...because it came back to a row which has been played already
 	bool			repeat;					// Player will repeat song
 	bool			idle;					// Player is mixing, but not processing song
 	bool			playOneRowOnly;			// Player will only play one row and not advance to the next row (used for milkytracker)
@@ -196,6 +197,7 @@ public:
 	
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
 	virtual mp_sint32 setBufferSize(mp_uint32 bufferSize);	
+	virtual mp_sint32 setNumBuffersAhead(mp_uint32 num);
 	
 	void setPlayMode(PlayModes mode) { playMode = mode; }
 
@@ -219,6 +221,12 @@ public:
 	// virtual from mixer class, perform playing here
 	virtual void timerHandler(mp_sint32 currentBeatPacket);
 
+	// virtual from mixer class, live notes are played like key jazz
+	virtual void handleLiveEvent(const LiveEventQueue::TLiveEvent& event)
+	{
+		playNote(event.chn, event.note, event.ins, event.vol);
+	}
+
 	virtual void restart(mp_uint32 startPosition = 0, 
 						 mp_uint32 startRow = 0, 
 						 bool resetMixer = true, 
@@ -245,6 +253,10 @@ public:
 	mp_sint32		stopPlaying();
 	
 	bool			hasSongHalted() const { return halted; }
+	// the song has halted because it would play a row again (only when not
+	// repeating), getLoopPosition() tells where it would have continued
+	bool			hasSongLooped() const { return halted && haltedAtLoop; }
+	void			getLoopPosition(mp_sint32& order, mp_sint32& row) const { order = poscnt; row = rowcnt; }
 
 	void			setIdle(bool idle) { this->idle = idle; }
 	bool			isIdle() const { return idle; }
@@ -177,6 +177,7 @@ PlayerGeneric::PlayerGeneric(mp_sint32 frequency, AudioDriverInterface* audioDri
 	autoAdjustPeak = false;
 	disableMixing = false;
 	allowFilters = false;
+	numMixerThreads = 0;
 #ifdef __FORCEPOWEROFTWOBUFFERSIZE__
 	compensateBufferFlag = true;
 #else
@@ -577,6 +578,7 @@ mp_sint32 PlayerGeneric::startPlaying(XModule* module,
 			
 			player->setDisableMixing(disableMixing);
 			player->setAllowFilters(allowFilters);
+			player->setNumMixerThreads(numMixerThreads);
 			//if (paused)
 			//	player->pausePlaying();
 
@@ -711,6 +713,15 @@ bool PlayerGeneric::getAllowFilters() const
 	return allowFilters;
 }
 
+void PlayerGeneric::setNumMixerThreads(mp_uint32 num)
+{
+	numMixerThreads = num;
+
+	// the mixer threads can't be replaced while mixing
+	if (player && !player->isPlaying())
+		player->setNumMixerThreads(numMixerThreads);
+}
+
 // volume control
 void PlayerGeneric::setMasterVolume(mp_sint32 vol)
 {
@@ -819,7 +830,7 @@ mp_int64 PlayerGeneric::getSyncCount() const
 mp_uint32 PlayerGeneric::getSyncSampleCounter() const
 {
 	if (player)
-		return player->getSyncSampleCounter();
+		return player->getSyncSampleCounter(getCurrentSamplePosition());
 		
 	return 0;
 }
@@ -961,6 +972,7 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 		player->setPlayMode(playMode);
 		player->setDisableMixing(disableMixing);
 		player->setAllowFilters(allowFilters);		
+		player->setNumMixerThreads(numMixerThreads);
 #ifndef MILKYTRACKER
 		if (player->getType() == PlayerBase::PlayerType_IT)
 		{
@@ -1033,6 +1045,173 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 	return numWrittenSamples;
 }
 
+// writes the channel buses of the player into separate WAV files
+class ChannelWAVWriter : public AudioDriver_NULL
+{
+private:
+	WAVWriter**	writers;
+	mp_sint32**	buses;
+	mp_uint32	numBuses;
+	
+public:
+	ChannelWAVWriter(WAVWriter** writers, mp_sint32** buses, mp_uint32 numBuses) :
+		writers(writers),
+		buses(buses),
+		numBuses(numBuses)
+	{
+	}
+	
+	virtual mp_sint32 initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer)
+	{
+		mp_sint32 res = AudioDriver_NULL::initDevice(bufferSizeInWords, mixFrequency, mixer);
+		if (res < 0)
+			return res;
+		
+		for (mp_uint32 i = 0; i < numBuses; i++)
+		{
+			if (writers[i])
+				writers[i]->initDevice(bufferSizeInWords, mixFrequency, mixer);
+		}
+		
+		return MP_OK;
+	}
+	
+	virtual mp_sint32 closeDevice()
+	{
+		for (mp_uint32 i = 0; i < numBuses; i++)
+		{
+			if (writers[i])
+				writers[i]->closeDevice();
+		}
+		
+		return AudioDriver_NULL::closeDevice();
+	}
+	
+	virtual	const char* getDriverID() { return "ChannelWAVWriter"; }
+	
+	virtual void advance()
+	{
+		AudioDriver_NULL::advance();
+		
+		for (mp_uint32 i = 0; i < numBuses; i++)
+		{
+			if (!writers[i])
+				continue;
+			
+			mixer->convertBuffer(buses[i], compensateBuffer);
+			writers[i]->writeFrames(compensateBuffer, bufferSize / MP_NUMCHANNELS);
+		}
+	}
+};
+
+// export each channel to a separate 16bit stereo WAV file in one go
+mp_sint32 PlayerGeneric::exportChannelsToWAV(const SYSCHAR* const* fileNames, mp_uint32 numFileNames,
+											 XModule* module, 
+											 mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/,
+											 const mp_ubyte* customPanningTable/* = NULL*/)
+{
+	const mp_uint32 numChannels = numFileNames < module->header.channum ? numFileNames : module->header.channum;
+	
+	WAVWriter** writers = new WAVWriter*[numChannels];
+	mp_uint32 i;
+	for (i = 0; i < numChannels; i++)
+		writers[i] = fileNames[i] ? new WAVWriter(fileNames[i]) : NULL;
+
+	for (i = 0; i < numChannels; i++)
+	{
+		if (writers[i] && !writers[i]->isOpen())
+		{
+			for (mp_uint32 j = 0; j < numChannels; j++)
+				delete writers[j];
+			delete[] writers;
+			return MP_DEVICE_ERROR;
+		}
+	}
+	
+	mp_sint32* busMemory = new mp_sint32[numChannels*bufferSize*MP_NUMCHANNELS];
+	mp_sint32** buses = new mp_sint32*[numChannels];
+	for (i = 0; i < numChannels; i++)
+		buses[i] = busMemory + i*bufferSize*MP_NUMCHANNELS;
+	
+	ChannelWAVWriter* channelWriter = new ChannelWAVWriter(writers, buses, numChannels);
+	
+	mp_sint32 numWrittenSamples = 0;
+	
+	{
+		MasterMixer mixer(frequency, bufferSize, 1, channelWriter);
+		mixer.setSampleShift(sampleShift);
+		mixer.setDisableMixing(disableMixing);
+		
+		PlayerBase* player = getPreferredPlayer(module);
+		
+		// the peak is taken over all channels
+		PeakAutoAdjustFilter filter;
+		if (autoAdjustPeak)
+			mixer.setFilterHook(&filter);
+		
+		if (player)
+		{
+			player->adjustFrequency(frequency);
+			player->resetOnStop(resetOnStopFlag);
+			player->setBufferSize(bufferSize);
+			player->setResamplerType(resamplerType);
+			player->setMasterVolume(masterVolume);
+			player->setPlayMode(playMode);
+			player->setDisableMixing(disableMixing);
+			player->setAllowFilters(allowFilters);		
+			player->setNumMixerThreads(numMixerThreads);
+#ifndef MILKYTRACKER
+			if (player->getType() == PlayerBase::PlayerType_IT)
+			{
+				static_cast<PlayerIT*>(player)->setNumMaxVirChannels(numMaxVirChannels);
+			}
+#endif
+			mixer.addDevice(player);
+			
+			// channels which are not exported are muted
+			for (i = 0; i < numChannels; i++)
+				player->muteChannel(i, writers[i] == NULL);
+			player->setChannelBuses(buses, numChannels);
+			player->startPlaying(module, false, startOrder, 0, -1, customPanningTable, false, -1);
+			
+			mixer.start();
+			
+			if (endOrder == -1 || endOrder < startOrder || endOrder > module->header.ordnum - 1)
+				endOrder = module->header.ordnum - 1;		
+			
+			while (!player->hasSongHalted() && player->getOrder(0) <= endOrder)
+				channelWriter->advance();
+			
+			player->stopPlaying();
+			
+			mixer.stop();
+			mixer.closeAudioDevice();
+			
+			delete player;
+		}
+		
+		if (autoAdjustPeak)
+		{
+			sampleShift = mixer.getSampleShift();
+			filter.mixerShift = sampleShift;
+			filter.calculateMasterVolume();
+			masterVolume = filter.masterVolume;
+		}
+		
+		numWrittenSamples = channelWriter->getNumPlayedSamples();
+	}
+	
+	delete channelWriter;
+	
+	for (i = 0; i < numChannels; i++)
+		delete writers[i];
+	delete[] writers;
+	delete[] buses;
+	delete[] busMemory;
+	
+	return numWrittenSamples;
+}
+
 bool PlayerGeneric::grabChannelInfo(mp_sint32 chn, TPlayerChannelInfo& channelInfo) const
 {
 	if (player)
@@ -85,6 +85,8 @@ private:
 	bool				disableMixing;
 	// remember if filters are allowed
 	bool				allowFilters;
+	// remember number of additional mixer threads
+	mp_uint32			numMixerThreads;
 	// remember idle state
 	bool				idle;
 	// remember to play only one row
@@ -493,6 +495,23 @@ public:
 	 * @see				setAllowFilters
 	 */
 	bool				getAllowFilters() const;
+
+	/**
+	 * Mix the channels with the help of additional threads.
+	 * The output is exactly the same as with single threaded mixing.
+	 * While a buffer is being mixed the threads poll for work and keep
+	 * a CPU core each busy, between buffers they sleep.
+	 * Takes effect with the next song if a song is already playing.
+	 * @param  num		Number of additional threads, 0 is the default
+	 */
+	void				setNumMixerThreads(mp_uint32 num);
+
+	/**
+	 * Get the number of additional mixer threads
+	 * @return			Number of additional threads
+	 * @see				setNumMixerThreads
+	 */
+	mp_uint32			getNumMixerThreads() const { return numMixerThreads; }
 	
 	/**
 	 * Set master volume for the mixer
@@ -569,11 +588,12 @@ public:
 	mp_int64			getSyncCount() const;
 
 	/**
-	 * Return number of samples played but this time the
-	 * audio driver will return this value.
-	 * This is also used for VERY accurate synching especially
-	 * using MMSYSTEM. The value will be resettet on calling stopPlaying()
-	 * @return			number of samples the audiodriver has played since start
+	 * Return the sample of the mixer's timeline being played right now,
+	 * that's the number of samples mixed so far plus the time since the
+	 * last buffer has been mixed, minus the buffers the audio driver
+	 * has mixed ahead. It's never reset and wraps around.
+	 * This is also used for VERY accurate synching of live input.
+	 * @return			sync sample counter
 	 */
 	mp_uint32			getSyncSampleCounter() const;
 	
@@ -646,6 +666,23 @@ public:
 									AudioDriverBase* preferredDriver = NULL,
 									mp_sint32* timingLUT = NULL);
 	
+	/**
+	 * Export every channel of the song into its own WAV file. All channels are
+	 * rendered in a single pass, the result is the same as exporting the song
+	 * once per channel with all other channels muted. Virtual channels (NNA)
+	 * go into the file of the module channel they were triggered on.
+	 * @param  fileNames			one filename per channel, channels with a NULL filename are skipped
+	 * @param  numFileNames			number of entries in fileNames
+	 * @param  module				the module to export
+	 * @param  startOrder			the start position within the order list of the song
+	 * @param  endOrder				the last order to be played
+	 * @param  customPanningTable	When specifying a custom panning table the panning default from the module is ignored
+	 */	
+	mp_sint32			exportChannelsToWAV(const SYSCHAR* const* fileNames, mp_uint32 numFileNames,
+											XModule* module, 
+											mp_sint32 startOrder = 0, mp_sint32 endOrder = -1, 
+											const mp_ubyte* customPanningTable = NULL);
+	
 	/**
 	 * Grab current channel data from a module channel
 	 * @param  chn					the channel index to grab the data from
@@ -686,6 +723,8 @@ public:
 	PlayerBase*			getPlayerInstance() { return player; }	
 	
 	friend class MixerNotificationListener;
+	friend class OfflineRenderer;
+	friend class SongAnalyzer;
 };
 
 #endif
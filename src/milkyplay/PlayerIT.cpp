@@ -36,6 +36,7 @@
  *
  */
 #include "PlayerIT.h"
+#include "VirtualChannelPool.h"
 
 // if we're in background we work on our own state
 // if not, we're just going to work on the host state
@@ -285,6 +286,7 @@ PlayerIT::PlayerIT(mp_uint32 frequency) :
 {
 	chninfo		= NULL;
 	vchninfo	= NULL;
+	virtualChannelPool = NULL;
 	attick		= NULL;	
 	// fill in some default values, don't know if this is necessary
 
@@ -425,6 +427,7 @@ void PlayerIT::reset()
 	curMaxVirChannels = 0;
 	memset(chninfo, 0, sizeof(TModuleChannel)*numModuleChannels);
 	memset(vchninfo, 0, sizeof(TVirtualChannel)*numVirtualChannels);
+	virtualChannelPool->reset();
 	RESET_ALL_LOOPING
 }
 
@@ -443,6 +446,7 @@ mp_sint32 PlayerIT::allocateStructures()
 
 	chninfo			= new TModuleChannel[numModuleChannels];
 	vchninfo		= new TVirtualChannel[numVirtualChannels];
+	virtualChannelPool = new VirtualChannelPool(numVirtualChannels, numModuleChannels);
 	attick			= new mp_ubyte[numModuleChannels];
 	return MP_OK;
 }
@@ -459,6 +463,11 @@ void PlayerIT::freeMemory()
 		delete[] vchninfo; 
 		vchninfo = NULL; 
 	} 
+	if (virtualChannelPool)
+	{
+		delete virtualChannelPool;
+		virtualChannelPool = NULL;
+	}
 	if (attick) 
 	{ 
 		delete[] attick; 
@@ -502,49 +511,61 @@ void PlayerIT::clearEffectMemory()
 
 PlayerIT::TVirtualChannel* PlayerIT::allocateVirtualChannel()
 {
-	const mp_sint32 numVirtualChannels = this->numVirtualChannels;
-	
-	mp_sint32 i;
-
-	TVirtualChannel* vchn = vchninfo;	
-	for (i = 0; i < numVirtualChannels; i++, vchn++)
+	// lowest free channel first, otherwise steal the quietest background channel
+	mp_sint32 i = virtualChannelPool->getFree();
+	if (i >= 0)
 	{
-		if (vchn->getBackground())
-		{
-			if (!vchn->getActive())
-			{
-				if (i+1 > curMaxVirChannels)
-					curMaxVirChannels = i+1;
-				vchn->setChannelIndex(i);
-				return vchn;
-			}
-		}
+		if (i+1 > curMaxVirChannels)
+			curMaxVirChannels = i+1;
 	}
-	
-	mp_sint32 chnIndex = -1;
-	mp_sint32 vol = 0x7FFFFFFF;
-	vchn = vchninfo;	
-	for (i = 0; i < curMaxVirChannels; i++, vchn++)
+	else
 	{
-		if (vchn->getBackground())
-		{
-			mp_sint32 newVol = vchn->getResultingVolume();
-			if (newVol < vol)
-			{
-				vol = newVol;
-				chnIndex = i;
-			}
-		}
+		i = virtualChannelPool->getQuietest();
+		if (i < 0)
+			return NULL;
 	}
 	
-	if (chnIndex != -1)
-	{
-		vchn = vchninfo + chnIndex;
-		vchn->setChannelIndex(chnIndex);
-		return vchn;
-	}
+	TVirtualChannel* vchn = vchninfo + i;
+	vchn->setChannelIndex(i);
+	return vchn;
+}
+
+void PlayerIT::releaseVirtualChannel(TVirtualChannel* vchn)
+{
+	vchn->setActive(false);
+	if (vchn->getChannelIndex() == curMaxVirChannels-1)
+		curMaxVirChannels--;
 	
-	return NULL;
+	const mp_sint32 i = (mp_sint32)(vchn - vchninfo);
+	virtualChannelPool->removeBackground(i);
+	// still linked to a module channel, free when it's unlinked
+	if (vchn->getBackground())
+		virtualChannelPool->setFree(i, true);
+}
+
+void PlayerIT::linkVirtualChannel(TModuleChannel* chnInf, TVirtualChannel* vchn)
+{
+	const mp_sint32 i = (mp_sint32)(vchn - vchninfo);
+	virtualChannelPool->removeBackground(i);
+	virtualChannelPool->setFree(i, false);
+	
+	chnInf->linkVchn(vchn);
+	
+	// stays with this channel's bus in the background as well
+	setChannelBus(vchn->getChannelIndex(), (mp_uint32)(chnInf - chninfo));
+}
+
+PlayerIT::TVirtualChannel* PlayerIT::unlinkVirtualChannel(TModuleChannel* chnInf)
+{
+	TVirtualChannel* vchn = chnInf->unlinkVchn();
+	
+	const mp_sint32 i = (mp_sint32)(vchn - vchninfo);
+	if (vchn->getActive())
+		virtualChannelPool->addBackground(i, (mp_sint32)(chnInf - chninfo), vchn->getResultingVolume());
+	else
+		virtualChannelPool->setFree(i, true);
+	
+	return vchn;
 }
 
 void PlayerIT::handleNoteOFF(TChnState& state)
@@ -581,113 +602,108 @@ void PlayerIT::handleNoteOFF(TChnState& state)
 	state.setKeyon(false);
 }
 
+void PlayerIT::handleBackgroundNoteOFF(TVirtualChannel* vchn)
+{
+	handleNoteOFF(vchn->getRealState());
+	virtualChannelPool->setVolume((mp_sint32)(vchn - vchninfo), vchn->getResultingVolume());
+}
+
 void PlayerIT::handlePastNoteAction(TModuleChannel* chnInf, mp_ubyte pastNoteActionType)
 {
-	TVirtualChannel* vchn = vchninfo;	
-	const mp_sint32 curMaxVirChannels = this->curMaxVirChannels;
-	
-	switch (pastNoteActionType)
+	// only the background channels played on this channel
+	mp_sint32 next;
+	for (mp_sint32 i = virtualChannelPool->getFirstBackground((mp_sint32)(chnInf - chninfo)); i >= 0; i = next)
 	{
-		case 0:
-		{
-			for (mp_sint32 i = 0; i < curMaxVirChannels; i++, vchn++)
-				if (vchn->getActive() && (vchn->getOldHost() == chnInf))
-				{
-					mp_sint32 index = vchn->getChannelIndex();
-					stopSample(index);
-					releaseVirtualChannel(vchn);
-				}
-			break;
-		}
+		next = virtualChannelPool->getNextBackground(i);
 		
-		case 1:
+		TVirtualChannel* vchn = vchninfo + i;
+		switch (pastNoteActionType)
 		{
-			for (mp_sint32 i = 0; i < curMaxVirChannels; i++, vchn++)
-				if (vchn->getActive() && (vchn->getOldHost() == chnInf))
-					handleNoteOFF(vchn->getRealState());
-			break;
+			case 0:
+				stopSample(vchn->getChannelIndex());
+				releaseVirtualChannel(vchn);
+				break;
+			case 1:
+				handleBackgroundNoteOFF(vchn);
+				break;
+			case 2:
+				vchn->getRealState().setFadeout(true);
+				break;
 		}
+	}
+}
 
-		case 2:
-		{
-			for (mp_sint32 i = 0; i < curMaxVirChannels; i++, vchn++)
-				if (vchn->getActive() && (vchn->getOldHost() == chnInf))
-					vchn->getRealState().setFadeout(true);
-			break;
-		}
+bool PlayerIT::matchDCT(TVirtualChannel* vchn, const TNNATriggerInfo& triggerInfo, mp_ubyte DCT)
+{
+	// normal case (instrument supplied with note)
+	if (triggerInfo.ins)
+	{
+		// must always be the same instrument
+		bool match = (vchn->getIns() == triggerInfo.ins);
+		// check for note
+		if (DCT == 1)
+			match &= (vchn->getNote() == triggerInfo.note);
+		// check for sample
+		else if (DCT == 2)
+			match &= (vchn->getSmp() == triggerInfo.smp);
+		return match;
 	}
+
+	// no instrument supplied with note
+	// note check doesn't do anything if instrument is 0
+	return DCT != 1;
 }
 
 bool PlayerIT::handleDCT(TModuleChannel* chnInf, const TNNATriggerInfo& triggerInfo, mp_ubyte DCT, mp_ubyte DCA)
 {
-	TVirtualChannel* vchn = vchninfo;	
-	const mp_sint32 curMaxVirChannels = this->curMaxVirChannels;
-	for (mp_sint32 i = 0; i < curMaxVirChannels; i++, vchn++)
+	// background channels which have been played on this channel
+	mp_sint32 next;
+	for (mp_sint32 i = virtualChannelPool->getFirstBackground((mp_sint32)(chnInf - chninfo)); i >= 0; i = next)
 	{
-		if (vchn->getActive() && (vchn->getOldHost() == chnInf || vchn->getHost() == chnInf))
-		{
-			bool matchDCT;
+		next = virtualChannelPool->getNextBackground(i);
 		
-			// normal case (instrument supplied with note)
-			if (triggerInfo.ins)
-			{
-				// must always be the same instrument
-				matchDCT = (vchn->getIns() == triggerInfo.ins);
-				// check for note
-				if (DCT == 1)
-					matchDCT &= (vchn->getNote() == triggerInfo.note);
-				// check for sample
-				else if (DCT == 2)
-					matchDCT &= (vchn->getSmp() == triggerInfo.smp);
-			}
-			// no instrument supplied with note
-			else 
-			{
-				matchDCT = true;
-				// note check doesn't do anything if instrument is 0
-				if (DCT == 1)
-					continue;
-			}
-			
-			if (!matchDCT)
-				continue;
+		TVirtualChannel* vchn = vchninfo + i;
+		if (!matchDCT(vchn, triggerInfo, DCT))
+			continue;
 			
-			// cut = keep channel
-			if (DCA == 0)
-			{
-				mp_sint32 index = vchn->getChannelIndex();
-				stopSample(index);
-				releaseVirtualChannel(vchn);
-			}
-			// note off
-			else if (DCA == 1)
-			{
-				// virtual channel is no longer linked to host
-				if (vchn->getOldHost() == chnInf)
-					handleNoteOFF(vchn->getRealState());
-				// virtual channel is linked to host, unlink and handle note off
-				else
-				{
-					// important: first set host to NULL
-					// THEN set key on flag
-					TVirtualChannel* oldvchn = chnInf->unlinkVchn();
-					handleNoteOFF(oldvchn->getRealState());
-				}
-			}
-			// note fade
-			else if (DCA == 2)
-			{
-				// virtual channel is no longer linked to host
-				if (vchn->getOldHost() == chnInf)
-					vchn->getRealState().setFadeout(true);
-				// virtual channel is linked to host, unlink and handle fade out
-				else
-				{
-					// important: first set host to NULL
-					// THEN set fade out
-					chnInf->unlinkVchn()->setFadeout(true);
-				}
-			}
+		// cut = keep channel
+		if (DCA == 0)
+		{
+			stopSample(vchn->getChannelIndex());
+			releaseVirtualChannel(vchn);
+		}
+		// note off
+		else if (DCA == 1)
+			handleBackgroundNoteOFF(vchn);
+		// note fade
+		else if (DCA == 2)
+			vchn->getRealState().setFadeout(true);
+	}
+	
+	// the channel it's currently playing on
+	TVirtualChannel* vchn = chnInf->getVchn();
+	if (vchn && vchn->getActive() && matchDCT(vchn, triggerInfo, DCT))
+	{
+		// cut = keep channel
+		if (DCA == 0)
+		{
+			stopSample(vchn->getChannelIndex());
+			releaseVirtualChannel(vchn);
+		}
+		// note off, the virtual channel is linked to host, unlink and handle note off
+		else if (DCA == 1)
+		{
+			// important: first set host to NULL
+			// THEN set key on flag
+			TVirtualChannel* oldvchn = unlinkVirtualChannel(chnInf);
+			handleBackgroundNoteOFF(oldvchn);
+		}
+		// note fade, unlink and handle fade out
+		else if (DCA == 2)
+		{
+			// important: first set host to NULL
+			// THEN set fade out
+			unlinkVirtualChannel(chnInf)->setFadeout(true);
 		}
 	}
 	
@@ -744,8 +760,8 @@ bool PlayerIT::handleNNAs(TModuleChannel* chnInf, const TNNATriggerInfo& trigger
 		// NNA = continue
 		else if (NNA == 1)
 		{
-			chnInf->unlinkVchn();			
-			chnInf->linkVchn(newVchn);
+			unlinkVirtualChannel(chnInf);
+			linkVirtualChannel(chnInf, newVchn);
 			return true;
 		}
 		// NNA = note off
@@ -753,9 +769,9 @@ bool PlayerIT::handleNNAs(TModuleChannel* chnInf, const TNNATriggerInfo& trigger
 		{
 			// important: first set host to NULL
 			// THEN set key on flag
-			TVirtualChannel* oldvchn = chnInf->unlinkVchn();
-			handleNoteOFF(oldvchn->getRealState());
-			chnInf->linkVchn(newVchn);
+			TVirtualChannel* oldvchn = unlinkVirtualChannel(chnInf);
+			handleBackgroundNoteOFF(oldvchn);
+			linkVirtualChannel(chnInf, newVchn);
 			return true;
 		}
 		// NNA = note fade
@@ -763,14 +779,14 @@ bool PlayerIT::handleNNAs(TModuleChannel* chnInf, const TNNATriggerInfo& trigger
 		{
 			// important: first set host to NULL
 			// THEN set fade out
-			chnInf->unlinkVchn()->setFadeout(true);
-			chnInf->linkVchn(newVchn);
+			unlinkVirtualChannel(chnInf)->setFadeout(true);
+			linkVirtualChannel(chnInf, newVchn);
 			return true;
 		}
 	}
 	else
 	{
-		chnInf->linkVchn(newVchn);
+		linkVirtualChannel(chnInf, newVchn);
 	}	
 	
 	return true;
@@ -800,6 +816,9 @@ void PlayerIT::adjustVirtualChannels()
 				releaseVirtualChannel(vchn);
 				continue;
 			}
+			
+			// fading out changes the volume every tick
+			virtualChannelPool->setVolume(i, vchn->getResultingVolume());
 		}
 		/*else
 		{
@@ -3622,6 +3641,7 @@ void PlayerIT::tickhandler()
 
 				if (!b)
 				{
+					haltedAtLoop = true;
 					halt();
 					return;
 				}
@@ -464,6 +464,7 @@ private:
 	
 	TModuleChannel	*chninfo;				// our channel information
 	TVirtualChannel *vchninfo;				// our virtual channels
+	class VirtualChannelPool* virtualChannelPool;	// free and background virtual channels
 	
 	mp_ubyte		*attick;
 	
@@ -513,12 +514,10 @@ private:
 	}	
 
 	TVirtualChannel*	allocateVirtualChannel();
-	void				releaseVirtualChannel(TVirtualChannel* vchn)
-	{
-		vchn->setActive(false);
-		if (vchn->getChannelIndex() == curMaxVirChannels-1)
-			curMaxVirChannels--;
-	}
+	void				releaseVirtualChannel(TVirtualChannel* vchn);
+	// linking and unlinking goes through these to keep the pool up to date
+	void				linkVirtualChannel(TModuleChannel* chnInf, TVirtualChannel* vchn);
+	TVirtualChannel*	unlinkVirtualChannel(TModuleChannel* chnInf);
 		
 	struct TNNATriggerInfo
 	{
@@ -528,7 +527,9 @@ private:
 	};
 	
 	void				handleNoteOFF(TChnState& state);
+	void				handleBackgroundNoteOFF(TVirtualChannel* vchn);
 	void				handlePastNoteAction(TModuleChannel* chnInf, mp_ubyte pastNoteActionType);
+	bool				matchDCT(TVirtualChannel* vchn, const TNNATriggerInfo& triggerInfo, mp_ubyte DCT);
 	bool				handleDCT(TModuleChannel* chnInf, const TNNATriggerInfo& triggerInfo, mp_ubyte DCT, mp_ubyte DCA);
 	bool				handleNNAs(TModuleChannel* chnInf, const TNNATriggerInfo& triggerInfo);
 	void				adjustVirtualChannels();
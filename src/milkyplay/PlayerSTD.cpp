@@ -278,6 +278,24 @@ mp_sint32 PlayerSTD::setBufferSize(mp_uint32 bufferSize)
 	return res;
 }
 
+mp_sint32 PlayerSTD::setNumBuffersAhead(mp_uint32 num)
+{
+	mp_uint32 lastTimeRecordSize = getTimeRecordSize();
+
+	mp_sint32 res = PlayerBase::setNumBuffersAhead(num);
+	
+	if (res < 0)
+		return res;
+		
+	// nothing has changed
+	if (lastTimeRecordSize == getTimeRecordSize())
+		return MP_OK;
+
+	res = allocateStructures();
+	
+	return res;
+}
+
 void PlayerSTD::timerHandler(mp_sint32 currentBeatPacket)
 {
 	PlayerBase::timerHandler(currentBeatPacket);
@@ -430,7 +448,7 @@ mp_sint32 PlayerSTD::allocateStructures()
 	
 #ifdef MILKYTRACKER
 	for (mp_sint32 i = 0; i < initialNumChannels; i++)
-		chninfo[i].reallocTimeRecord(getNumBeatPackets()+1);
+		chninfo[i].reallocTimeRecord(getTimeRecordSize());
 #endif	
 	
 	return MP_OK;
@@ -2614,6 +2632,19 @@ void PlayerSTD::progressRow()
  
 }
 
+void PlayerSTD::updateChannel(mp_sint32 c, TModuleChannel* chnInf)
+{
+	mp_sint32 dfs = chnInf->flags & CHANNEL_FLAGS_DFS, dvs = chnInf->flags & CHANNEL_FLAGS_DVS;
+
+	if ((chnInf->per)&&(!dfs)) 
+		setFreq(c,getfreq(c,getfinalperiod(c,chnInf->hasVibrato ? chnInf->finalVibratoPer : chnInf->per),chnInf->freqadjust));
+	
+	if (!dvs) 
+		setVol(c,getvolume(c,chnInf-> hasTremolo ? chnInf->finalTremoloVol : chnInf->vol));
+
+	setPan(c,getpanning(c,chnInf->pan));
+}
+
 void PlayerSTD::update()
 {
 	mp_sint32 c;
@@ -2629,15 +2660,7 @@ void PlayerSTD::update()
 		if (chnInf->flags & CHANNEL_FLAGS_UPDATE_IGNORE)
 			continue;
 
-		mp_sint32 dfs = chnInf->flags & CHANNEL_FLAGS_DFS, dvs = chnInf->flags & CHANNEL_FLAGS_DVS;
-
-		if ((chnInf->per)&&(!dfs)) 
-			setFreq(c,getfreq(c,getfinalperiod(c,chnInf->hasVibrato ? chnInf->finalVibratoPer : chnInf->per),chnInf->freqadjust));
-		
-		if (!dvs) 
-			setVol(c,getvolume(c,chnInf-> hasTremolo ? chnInf->finalTremoloVol : chnInf->vol));
-
-		setPan(c,getpanning(c,chnInf->pan));
+		updateChannel(c, chnInf);
 
 		if (chnInf->venv.envstruc != NULL &&
 			!chnInf->venv.envstruc->speed)
@@ -2857,6 +2880,7 @@ void PlayerSTD::tickhandler()
 
 				if (!b)
 				{
+					haltedAtLoop = true;
 					halt();
 					return;
 				}
@@ -3218,5 +3242,10 @@ void PlayerSTD::playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 i, mp_sint32 vo
 		}
 		
 	}
+	
+	// live notes don't have to come in on a tick, 
+	// the mixer needs to know about them right away
+	if (!(chnInf->flags & CHANNEL_FLAGS_UPDATE_IGNORE))
+		updateChannel(chn, chnInf);
 			
 }
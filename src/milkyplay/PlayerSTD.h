@@ -427,6 +427,7 @@ private:
 	
 	void			doTickeffects();	
 	void			progressRow();	
+	void			updateChannel(mp_sint32 c, TModuleChannel* chnInf);
 	void			update();	
 	void			updateBPMIndependent();
 
@@ -454,6 +455,7 @@ public:
 
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
 	virtual mp_sint32 setBufferSize(mp_uint32 bufferSize);	
+	virtual mp_sint32 setNumBuffersAhead(mp_uint32 num);
 	
 	// virtual from mixer class, perform playing here
 	virtual void	timerHandler(mp_sint32 currentBeatPacket);
@@ -48,71 +48,113 @@ private:
 	enum 
 	{
 		BLEP_SCALE = 17,
-		MAX_BLEPS = 32,
+		MAX_BLEPS = 32, // must be a power of two
 		MAX_AGE = 2048,
 		PAULA_FREQ = 3546895
 	};
 	
-	// the structure that holds data of bleps
-	struct blepState_t 
+	// Bleps of one channel, newest first. Every blep is written twice
+	// (at index and index + MAX_BLEPS) so the live bleps are always 
+	// contiguous from head on and can be summed without wrapping.
+	// All bleps age at the same rate, so instead of aging each of them 
+	// we store their birth time and advance a single clock.
+	struct blepRing_t 
 	{
-		mp_sint32 level;
-		mp_uword age;
+		mp_sint32 level[MAX_BLEPS*2];
+		mp_uint32 birth[MAX_BLEPS*2];
+		mp_uint32 head;
+		mp_uint32 count;
+		mp_uint32 time;
 	};
 	
-	const int* table;
-	
 	// Storage
 	mp_sint32 numChannels;
 	
-	blepState_t** bleps;
+	blepRing_t* bleps;
 	mp_sint32* currentLevel;
-	mp_sint32* activeBleps;
 	
 	mp_sint32 paulaAdvance;
 	
-	void cleanUp(mp_sint32 num)
+	void cleanUp()
 	{
-		for (mp_sint32 i = 0; i < num; i++)
-			delete[] bleps[i];
-			
 		delete[] bleps;
 		delete[] currentLevel;
-		delete[] activeBleps;
 	}
 	
-	void realloc(mp_sint32 oldNum, mp_sint32 newNum)
+	void realloc(mp_sint32 newNum)
 	{
-		cleanUp(oldNum);
+		cleanUp();
 		
-		bleps = new blepState_t*[newNum];
-		for (mp_sint32 i = 0; i < newNum; i++)
-			bleps[i] = new blepState_t[MAX_BLEPS];
+		bleps = new blepRing_t[newNum];
 		currentLevel = new mp_sint32[newNum];
-		activeBleps = new mp_sint32[newNum];
 	}
 	
 	void clearState()
 	{
-		memset(currentLevel, 0, numChannels*sizeof(mp_uint32));
-		memset(activeBleps, 0, numChannels*sizeof(mp_sint32));
+		memset(currentLevel, 0, numChannels*sizeof(mp_sint32));
+		memset(bleps, 0, numChannels*sizeof(blepRing_t));
+	}
+	
+	inline void addBlep(blepRing_t& ring, mp_sint32 level, mp_uint32 age)
+	{
+		ring.head = (ring.head - 1) & (MAX_BLEPS-1);
+		ring.level[ring.head] = ring.level[ring.head + MAX_BLEPS] = level;
+		ring.birth[ring.head] = ring.birth[ring.head + MAX_BLEPS] = ring.time - age;
 		
-		for (mp_sint32 i = 0; i < numChannels; i++)
-			memset(bleps[i], 0, MAX_BLEPS*sizeof(blepState_t));
+		// the oldest blep is dropped when the list is full
+		if (++ring.count == MAX_BLEPS)
+		{
+#ifndef WIN32
+			fprintf(stderr, "AMIGA: Blep list truncated!\n");
+#endif
+			ring.count--;
+		}
+	}
+	
+	// Sum all live bleps against the integral table, then age them
+	template<mp_uint32 tableShift>
+	inline mp_sint32 sumBleps(blepRing_t& ring)
+	{
+		const int* table = winsinc_integral + filterTable*WINSINCSIZE;
+		const mp_sint32* level = ring.level + ring.head;
+		const mp_uint32* birth = ring.birth + ring.head;
+		const mp_uint32 time = ring.time;
+		
+		// Age teh bleps! The oldest are at the end of the list, the
+		// first one to die is still summed up for the last time
+		ring.time += paulaAdvance;
+		mp_sint32 count = ring.count;
+		while (ring.count && ring.time - birth[ring.count-1] >= (mp_uint32)MAX_AGE)
+			ring.count--; // It died of old age :(
+		if (ring.count < (mp_uint32)count)
+			count = ring.count + 1;
+
+		// independent partial sums, so the loop isn't bound by the add latency
+		// (integer adds, the result is the same as with a single sum)
+		mp_sint32 s0 = 0, s1 = 0;
+		mp_sint32 i;
+		for (i = 0; i < count - 1; i+=2)
+		{
+			s0 -= (table[time - birth[i]] >> tableShift) * level[i];
+			s1 -= (table[time - birth[i+1]] >> tableShift) * level[i+1];
+		}
+		if (i < count)
+			s0 -= (table[time - birth[i]] >> tableShift) * level[i];
+		
+		return s0 + s1;
 	}
 	
 public:
 	ResamplerAmiga() : 
 		numChannels(0),
 		bleps(NULL),
-		currentLevel(NULL),
-		activeBleps(NULL)
+		currentLevel(NULL)
 	{
 	}
 	
 	virtual ~ResamplerAmiga()
 	{
-		cleanUp(numChannels);
+		cleanUp();
 	}
 
 	virtual void setFrequency(mp_sint32 frequency)
@@ -124,7 +166,7 @@ public:
 	{ 
 		// one more channel for the scope dummy 
 		num++;	
-		realloc(numChannels, num);	
+		realloc(num);	
 		numChannels = num;		
 		clearState();
 	}	
@@ -133,31 +175,17 @@ public:
 											const mp_sint32 channel,
 											const ChannelMixer::TMixerChannel* chn)
 	{
+		blepRing_t& ring = bleps[channel];
+	
 		if(sample != currentLevel[channel])
 		{
 			// We have a newborn blep!
-			// Make room for it
-			memmove(&bleps[channel][1], &bleps[channel][0], sizeof(blepState_t) * activeBleps[channel]);
-			if(++activeBleps[channel] == MAX_BLEPS)
-			{
-#ifndef WIN32
-				fprintf(stderr, "AMIGA: Blep list truncated!\n");
-#endif
-				activeBleps[channel]--;
-			}
-			bleps[channel][0].level = sample - currentLevel[channel];
-			bleps[channel][0].age = ((chn->fixedtimefrac + (chn->fixedtime & 0xffff))  * paulaAdvance) >> 16;
+			addBlep(ring, sample - currentLevel[channel], 
+					((chn->fixedtimefrac + (chn->fixedtime & 0xffff))  * paulaAdvance) >> 16);
 			currentLevel[channel] = sample;
 		}
 		
-		mp_sint32 s = 0;
-		// Age teh bleps!
-		for(mp_sint32 i = 0; i < activeBleps[channel]; i++)
-		{
-			s -= winsinc_integral[filterTable*WINSINCSIZE+bleps[channel][i].age] * bleps[channel][i].level;
-			if((bleps[channel][i].age += paulaAdvance) >= MAX_AGE)
-				activeBleps[channel]  = i; // It died of old age :(
-		}
+		mp_sint32 s = sumBleps<0>(ring);
 		
 		s >>= (BLEP_SCALE - 8);
 		
@@ -167,36 +195,21 @@ public:
 	}
 	
 	// Due to 32-bit limitations the 16-bit resampler is less precise
-	// PS, copy & paste is quicker than messing around with templates ;)
 	inline mp_sint32 interpolate_amiga_16bit(const mp_sint32 sample,
 											 const mp_sint32 channel,
 											 const ChannelMixer::TMixerChannel* chn)
 	{
+		blepRing_t& ring = bleps[channel];
+
 		if(sample != currentLevel[channel])
 		{
 			// We have a newborn blep!
-			// Make room for it
-			memmove(&bleps[channel][1], &bleps[channel][0], sizeof(blepState_t) * activeBleps[channel]);
-			if(++activeBleps[channel] == MAX_BLEPS)
-			{
-#ifndef WIN32
-				fprintf(stderr, "AMIGA: Blep list truncated!\n");
-#endif
-				activeBleps[channel]--;
-			}
-			bleps[channel][0].level = sample - currentLevel[channel];
-			bleps[channel][0].age = ((chn->fixedtimefrac + (chn->fixedtime & 0xffff))  * paulaAdvance) >> 16;
+			addBlep(ring, sample - currentLevel[channel], 
+					((chn->fixedtimefrac + (chn->fixedtime & 0xffff))  * paulaAdvance) >> 16);
 			currentLevel[channel] = sample;
 		}
 		
-		mp_sint32 s = 0;
-		// Age teh bleps!
-		for(mp_sint32 i = 0; i < activeBleps[channel]; i++)
-		{
-			s -= (winsinc_integral[filterTable*WINSINCSIZE+bleps[channel][i].age]>>3) * bleps[channel][i].level;
-			if((bleps[channel][i].age += paulaAdvance) >= MAX_AGE)
-				activeBleps[channel]  = i; // It died of old age :(
-		}
+		mp_sint32 s = sumBleps<3>(ring);
 		
 		s >>= BLEP_SCALE - 3;
 		
@@ -45,6 +45,9 @@
  * Website: http://www.student.oulu.fi/~oniemita/DSP/INDEX.HTM
  *
  */
+
+#ifndef __RESAMPLERCUBIC_H__
+#define __RESAMPLERCUBIC_H__
  
 #define __DEIP__
 #define fpmul MP_FP_MUL
@@ -214,3 +217,5 @@ public:
 
 #undef __DEIP__
 #undef fpmul
+
+#endif
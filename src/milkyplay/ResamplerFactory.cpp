@@ -40,9 +40,97 @@
 #include "ResamplerFast.h"
 #include "ResamplerSinc.h"
 #include "ResamplerAmiga.h"
+#include "ResamplerSSE2.h"
+
+#if defined(__MPSSE2__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+bool ResamplerFactory::simdEnabled = true;
+mp_uint32 ResamplerFactory::sincTaps = 128;
+
+bool ResamplerFactory::hasSSE2()
+{
+#if !defined(__MPSSE2__)
+	return false;
+#elif defined(__x86_64__) || defined(_M_X64)
+	// part of the x86-64 base instruction set
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2") != 0;
+#endif
+}
+
+void ResamplerFactory::setSIMDEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
+
+void ResamplerFactory::setSincTaps(mp_uint32 taps)
+{
+	if (taps <= 32)
+		sincTaps = 32;
+	else if (taps <= 64)
+		sincTaps = 64;
+	else
+		sincTaps = 128;
+}
+
+template<bool ramping>
+static ChannelMixer::ResamplerBase* createSincResampler(mp_uint32 taps)
+{
+	switch (taps)
+	{
+		case 32:
+			return new ResamplerSinc<ramping, 32>();
+		case 64:
+			return new ResamplerSinc<ramping, 64>();
+		default:
+			return new ResamplerSinc<ramping, 128>();
+	}
+}
 
 ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes type)
 {
+#ifdef __MPSSE2__
+	if (simdEnabled && hasSSE2())
+	{
+		switch (type)
+		{
+			case MIXER_NORMAL:
+				return new ResamplerSimpleSSE2();
+
+			case MIXER_NORMAL_RAMPING:
+				return new ResamplerSimpleRampSSE2();
+
+			case MIXER_LERPING:
+				return new ResamplerLerpSSE2();
+
+			case MIXER_LERPING_RAMPING:
+				return new ResamplerLerpRampFilterSSE2();
+
+			case MIXER_LAGRANGE:
+				return new ResamplerLagrangeSSE2<false, CubicResamplerLagrange>();
+
+			case MIXER_LAGRANGE_RAMPING:
+				return new ResamplerLagrangeSSE2<true, CubicResamplerLagrange>();
+
+			case MIXER_SPLINE:
+				return new ResamplerLagrangeSSE2<false, CubicResamplerSpline>();
+
+			case MIXER_SPLINE_RAMPING:
+				return new ResamplerLagrangeSSE2<true, CubicResamplerSpline>();
+
+			default:
+				break;
+		}
+	}
+#endif
+
 	switch (type)
 	{
 		case MIXER_NORMAL:
@@ -76,10 +164,10 @@ ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes ty
 			return new ResamplerSincTable<true, 16>();
 
 		case MIXER_SINC:
-			return new ResamplerSinc<false, 128>();
+			return createSincResampler<false>(sincTaps);
 
 		case MIXER_SINC_RAMPING:
-			return new ResamplerSinc<true, 128>();
+			return createSincResampler<true>(sincTaps);
 
 		case MIXER_AMIGA500:
 			return new ResamplerAmiga<0>();
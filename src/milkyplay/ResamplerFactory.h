@@ -42,8 +42,25 @@
 
 class ResamplerFactory : public MixerSettings
 {
+private:
+	static bool simdEnabled;
+	static mp_uint32 sincTaps;
+
 public:
 	static ChannelMixer::ResamplerBase* createResampler(ResamplerTypes type);
+
+	// the SIMD resamplers produce the same output as the scalar ones,
+	// disabling them is only useful for verification and benchmarking
+	static void setSIMDEnabled(bool enabled);
+	static bool isSIMDEnabled() { return simdEnabled; }
+
+	// runtime CPU feature detection
+	static bool hasSSE2();
+
+	// taps of the MIXER_SINC resamplers created from now on, 32, 64 or 128
+	// (default), other values select the next larger one
+	static void setSincTaps(mp_uint32 taps);
+	static mp_uint32 getSincTaps() { return sincTaps; }
 };
 
 #endif
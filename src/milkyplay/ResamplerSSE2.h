@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ResamplerSSE2.h
+ *  MilkyPlay
+ *
+ *  SSE2 versions of the no-check inner loops of the nearest, linear and
+ *  cubic resamplers. Four output frames are interpolated at once, the
+ *  sample fetches are still scalar because every frame has its own position.
+ *
+ *  All arithmetic mirrors the scalar 32 bit (and 64 bit fpmul) code exactly,
+ *  so the output is bit-identical to the resamplers in ResamplerFast.h and
+ *  ResamplerCubic.h. Loop handling, the IT filter and the block full paths
+ *  are inherited from the scalar resamplers.
+ *
+ */
+
+#ifndef __RESAMPLERSSE2_H__
+#define __RESAMPLERSSE2_H__
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define __MPSSE2__
+#endif
+
+#ifdef __MPSSE2__
+
+#include <emmintrin.h>
+#include <string.h>
+#include "ResamplerFast.h"
+#include "ResamplerCubic.h"
+
+enum SSE2Interpolation
+{
+	SSE2InterpolationNone,
+	SSE2InterpolationLinear,
+	SSE2InterpolationLagrange,
+	SSE2InterpolationSpline
+};
+
+// low 32 bits of a signed 32x32 multiplication, there is no pmulld in SSE2
+static inline __m128i mp_mullo_epi32(const __m128i a, const __m128i b)
+{
+	const __m128i even = _mm_mul_epu32(a, b);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+							  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+// MP_FP_MUL(a, x) for signed a and 0 <= x < 65536:
+// bits 16..47 of the 64 bit product, the unsigned multiply is corrected for negative a
+static inline __m128i mp_fpmul_epi32(const __m128i a, const __m128i x)
+{
+	const __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, x), 16);
+	const __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(x, 32)), 16);
+	const __m128i res = _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(odd, 32));
+	return _mm_sub_epi32(res, _mm_and_si128(_mm_srai_epi32(a, 31), _mm_slli_epi32(x, 16)));
+}
+
+// interleave the lower 16 bits of a and b into a madd-able pair per lane
+static inline __m128i mp_pair_epi16(const __m128i a, const __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(a, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(b, 16));
+}
+
+template<class bufferType, mp_uint32 shift, SSE2Interpolation interpolation, bool ramping>
+class SSE2ResamplerDummy
+{
+private:
+	static inline __m128i fetch(const bufferType* sample, const mp_sint32* index, const mp_sint32 offset)
+	{
+		return _mm_set_epi32((mp_sint32)sample[index[3] + offset] << (16-shift),
+							 (mp_sint32)sample[index[2] + offset] << (16-shift),
+							 (mp_sint32)sample[index[1] + offset] << (16-shift),
+							 (mp_sint32)sample[index[0] + offset] << (16-shift));
+	}
+
+	// the two neighbouring sample points of every frame as a madd-able word pair
+	static inline __m128i fetchPair(const bufferType* sample, const mp_sint32* index)
+	{
+		if (shift == 16)
+		{
+			// 16 bit samples are already stored as word pairs
+			mp_sint32 pair[4];
+			for (mp_uint32 i = 0; i < 4; i++)
+				memcpy(&pair[i], sample + index[i], sizeof(mp_sint32));
+			return _mm_loadu_si128((const __m128i*)pair);
+		}
+
+		return mp_pair_epi16(fetch(sample, index, 0), fetch(sample, index, 1));
+	}
+
+	static inline __m128i interpolate(const bufferType* sample, const __m128i vpos)
+	{
+		mp_sint32 index[4];
+		_mm_storeu_si128((__m128i*)index, _mm_srai_epi32(vpos, 16));
+
+		switch (interpolation)
+		{
+			case SSE2InterpolationNone:
+				return fetch(sample, index, 0);
+
+			case SSE2InterpolationLinear:
+			{
+				// ((sd1<<12)+frac*(sd2-sd1)) == sd1*(4096-frac)+sd2*frac, one pmaddwd
+				const __m128i frac = _mm_and_si128(_mm_srai_epi32(vpos, 4), _mm_set1_epi32(0xfff));
+				const __m128i weights = mp_pair_epi16(_mm_sub_epi32(_mm_set1_epi32(4096), frac), frac);
+				return _mm_srai_epi32(_mm_madd_epi16(fetchPair(sample, index), weights), 12);
+			}
+
+			case SSE2InterpolationLagrange:
+			{
+				const __m128i v1 = fetch(sample, index, 0);
+				const __m128i v2 = fetch(sample, index, 1);
+				const __m128i v0 = fetch(sample, index, -1);
+				const __m128i v3 = fetch(sample, index, 2);
+				const __m128i x = _mm_and_si128(vpos, _mm_set1_epi32(65535));
+
+				const __m128i c0 = v1;
+				__m128i c1 = _mm_sub_epi32(v2, _mm_srai_epi32(_mm_madd_epi16(v0, _mm_set1_epi32(65536/3)), 16));
+				c1 = _mm_sub_epi32(c1, _mm_srai_epi32(_mm_madd_epi16(v3, _mm_set1_epi32(65536/6)), 16));
+				c1 = _mm_sub_epi32(c1, _mm_srai_epi32(v1, 1));
+				const __m128i c2 = _mm_sub_epi32(_mm_srai_epi32(_mm_add_epi32(v0, v2), 1), v1);
+				const __m128i c3 = _mm_add_epi32(_mm_srai_epi32(_mm_madd_epi16(mp_pair_epi16(v3, v0),
+																			   mp_pair_epi16(_mm_set1_epi32(65536/6), _mm_set1_epi32(-(65536/6)))), 16),
+												 _mm_srai_epi32(_mm_sub_epi32(v1, v2), 1));
+
+				__m128i res = _mm_add_epi32(mp_fpmul_epi32(c3, x), c2);
+				res = _mm_add_epi32(mp_fpmul_epi32(res, x), c1);
+				return _mm_add_epi32(mp_fpmul_epi32(res, x), c0);
+			}
+
+			case SSE2InterpolationSpline:
+			{
+				const __m128i v1 = fetch(sample, index, 0);
+				const __m128i v2 = fetch(sample, index, 1);
+				const __m128i v0 = fetch(sample, index, -1);
+				const __m128i v3 = fetch(sample, index, 2);
+				const __m128i x = _mm_and_si128(vpos, _mm_set1_epi32(65535));
+
+				const __m128i ym1py1 = _mm_add_epi32(v0, v2);
+				// (65536*2/3)*v1 doesn't fit into a signed word, use (65536/3)*(v1+v1)
+				const __m128i c0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(mp_pair_epi16(v0, v2), _mm_set1_epi32(((65536/6)<<16) + (65536/6))),
+																_mm_madd_epi16(mp_pair_epi16(v1, v1), _mm_set1_epi32(((65536/3)<<16) + (65536/3)))), 16);
+				const __m128i c1 = _mm_srai_epi32(_mm_sub_epi32(v2, v0), 1);
+				const __m128i c2 = _mm_sub_epi32(_mm_srai_epi32(ym1py1, 1), v1);
+				const __m128i c3 = _mm_add_epi32(_mm_srai_epi32(_mm_sub_epi32(v1, v2), 1),
+												 _mm_srai_epi32(_mm_madd_epi16(mp_pair_epi16(v3, v0),
+																			   mp_pair_epi16(_mm_set1_epi32(65536/6), _mm_set1_epi32(-(65536/6)))), 16));
+
+				__m128i res = _mm_add_epi32(mp_fpmul_epi32(c3, x), c2);
+				res = _mm_add_epi32(mp_fpmul_epi32(res, x), c1);
+				return _mm_add_epi32(mp_fpmul_epi32(res, x), c0);
+			}
+		}
+
+		return _mm_setzero_si128();
+	}
+
+	// (s*(vol>>15))>>15 for two stereo frames, when the samples and the
+	// volumes fit into a signed word this is a single pmaddwd
+	template<bool wordVolume>
+	static inline void mixFrames(mp_sint32* buffer, const __m128i s, const __m128i vol, const bool full)
+	{
+		const __m128i res = wordVolume ?
+			_mm_srai_epi32(_mm_madd_epi16(s, _mm_and_si128(_mm_srai_epi32(vol, 15), _mm_set1_epi32(0xFFFF))), 15) :
+			_mm_srai_epi32(mp_mullo_epi32(s, _mm_srai_epi32(vol, 15)), 15);
+		if (full)
+			_mm_storeu_si128((__m128i*)buffer, _mm_add_epi32(_mm_loadu_si128((const __m128i*)buffer), res));
+		else
+			_mm_storel_epi64((__m128i*)buffer, _mm_add_epi32(_mm_loadl_epi64((const __m128i*)buffer), res));
+	}
+
+	template<bool wordVolume>
+	static inline void addBlock(mp_sint32* buffer,
+								const bufferType* sample,
+								mp_sint32 posfixed,
+								const mp_sint32 smpadd,
+								__m128i vol,
+								const __m128i volStep,
+								mp_uint32 count)
+	{
+		__m128i vpos = _mm_add_epi32(_mm_set1_epi32(posfixed), mp_mullo_epi32(_mm_set1_epi32(smpadd), _mm_set_epi32(3, 2, 1, 0)));
+		const __m128i posStep = _mm_set1_epi32(smpadd*4);
+
+		for (; count >= 4; count-=4)
+		{
+			const __m128i s = interpolate(sample, vpos);
+			vpos = _mm_add_epi32(vpos, posStep);
+
+			mixFrames<wordVolume>(buffer, _mm_unpacklo_epi32(s, s), vol, true);
+			if (ramping)
+				vol = _mm_add_epi32(vol, volStep);
+			mixFrames<wordVolume>(buffer + 4, _mm_unpackhi_epi32(s, s), vol, true);
+			if (ramping)
+				vol = _mm_add_epi32(vol, volStep);
+
+			buffer+=4*MP_NUMCHANNELS;
+		}
+
+		if (count)
+		{
+			// unused lanes repeat the last position so we never fetch outside the sample
+			const __m128i last = _mm_set1_epi32(_mm_cvtsi128_si32(vpos) + smpadd*(mp_sint32)(count - 1));
+			const __m128i used = _mm_cmplt_epi32(_mm_set_epi32(3, 2, 1, 0), _mm_set1_epi32(count));
+			vpos = _mm_or_si128(_mm_and_si128(used, vpos), _mm_andnot_si128(used, last));
+
+			const __m128i s = interpolate(sample, vpos);
+
+			mixFrames<wordVolume>(buffer, _mm_unpacklo_epi32(s, s), vol, count >= 2);
+			if (count > 2)
+			{
+				if (ramping)
+					vol = _mm_add_epi32(vol, volStep);
+				mixFrames<wordVolume>(buffer + 4, _mm_unpackhi_epi32(s, s), vol, false);
+			}
+		}
+	}
+
+	static inline bool isWordVolume(const mp_sint32 vol)
+	{
+		return (vol >> 15) >= -32768 && (vol >> 15) <= 32767;
+	}
+
+public:
+	// sample points to the integer sample position, posfixed holds the 16 bit
+	// fractional part and is advanced by smpadd for each frame
+	static inline void addBlock(mp_sint32* buffer,
+								const bufferType* sample,
+								mp_sint32 posfixed,
+								const mp_sint32 smpadd,
+								mp_sint32& voll,
+								mp_sint32& volr,
+								const mp_sint32 rampFromVolStepL,
+								const mp_sint32 rampFromVolStepR,
+								mp_uint32 count)
+	{
+		// [left, right] volumes of two consecutive frames
+		const __m128i vol = ramping ?
+			_mm_set_epi32(volr + rampFromVolStepR, voll + rampFromVolStepL, volr, voll) :
+			_mm_set_epi32(volr, voll, volr, voll);
+		const __m128i volStep = _mm_set_epi32(rampFromVolStepR*2, rampFromVolStepL*2, rampFromVolStepR*2, rampFromVolStepL*2);
+
+		const mp_sint32 endvoll = voll + rampFromVolStepL*(mp_sint32)count;
+		const mp_sint32 endvolr = volr + rampFromVolStepR*(mp_sint32)count;
+
+		// nearest and linear interpolation never leave the word range, the
+		// ramp is linear so checking both ends covers every volume in between
+		if ((interpolation == SSE2InterpolationNone || interpolation == SSE2InterpolationLinear) &&
+			isWordVolume(voll) && isWordVolume(volr) && isWordVolume(endvoll) && isWordVolume(endvolr))
+			addBlock<true>(buffer, sample, posfixed, smpadd, vol, volStep, count);
+		else
+			addBlock<false>(buffer, sample, posfixed, smpadd, vol, volStep, count);
+
+		if (ramping)
+		{
+			voll = endvoll;
+			volr = endvolr;
+		}
+	}
+
+	static inline void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		const mp_sint32 rampFromVolStepL = ramping ? chn->rampFromVolStepL : 0;
+		const mp_sint32 rampFromVolStepR = ramping ? chn->rampFromVolStepR : 0;
+
+		const mp_sint32 smppos = chn->smppos;
+		const mp_sint32 posfixed = chn->smpposfrac;
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+
+		mp_sint32 fp = smpadd*count;
+		MP_INCREASESMPPOS(chn->smppos, chn->smpposfrac, fp, 16);
+
+		// the fast resamplers skip silent channels, the cubic ones don't care
+		if ((interpolation == SSE2InterpolationNone || interpolation == SSE2InterpolationLinear) &&
+			(voll == 0 && rampFromVolStepL == 0) && (volr == 0 && rampFromVolStepR == 0))
+			return;
+
+		addBlock(buffer, ((const bufferType*)chn->sample) + smppos, posfixed, smpadd,
+				 voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+
+		if (ramping)
+		{
+			chn->finalvoll = voll;
+			chn->finalvolr = volr;
+		}
+	}
+};
+
+template<SSE2Interpolation interpolation, bool ramping>
+static inline void addBlockNoCheckSSE2(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+{
+	if (chn->flags & 4)
+		SSE2ResamplerDummy<mp_sword, 16, interpolation, ramping>::addBlockNoCheck(buffer, chn, count);
+	else
+		SSE2ResamplerDummy<mp_sbyte, 8, interpolation, ramping>::addBlockNoCheck(buffer, chn, count);
+}
+
+class ResamplerSimpleSSE2 : public ResamplerSimple
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		addBlockNoCheckSSE2<SSE2InterpolationNone, false>(buffer, chn, count);
+	}
+};
+
+class ResamplerSimpleRampSSE2 : public ResamplerSimpleRamp
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		if (chn->rampFromVolStepL || chn->rampFromVolStepR)
+			addBlockNoCheckSSE2<SSE2InterpolationNone, true>(buffer, chn, count);
+		else
+			addBlockNoCheckSSE2<SSE2InterpolationNone, false>(buffer, chn, count);
+	}
+};
+
+class ResamplerLerpSSE2 : public ResamplerLerp
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		addBlockNoCheckSSE2<SSE2InterpolationLinear, false>(buffer, chn, count);
+	}
+};
+
+class ResamplerLerpRampFilterSSE2 : public ResamplerLerpRampFilter
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		// the resonant filter is recursive, leave it to the scalar code
+		if (chn->cutoff != ChannelMixer::MP_INVALID_VALUE && chn->resonance != ChannelMixer::MP_INVALID_VALUE)
+			ResamplerLerpRampFilter::addBlockNoCheck(buffer, chn, count);
+		else if (chn->rampFromVolStepL || chn->rampFromVolStepR)
+			addBlockNoCheckSSE2<SSE2InterpolationLinear, true>(buffer, chn, count);
+		else
+			addBlockNoCheckSSE2<SSE2InterpolationLinear, false>(buffer, chn, count);
+	}
+};
+
+template<bool ramping, CubicResamplers type>
+class ResamplerLagrangeSSE2 : public ResamplerLagrange<ramping, type>
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		addBlockNoCheckSSE2<type == CubicResamplerLagrange ? SSE2InterpolationLagrange : SSE2InterpolationSpline, ramping>(buffer, chn, count);
+	}
+};
+
+#endif
+
+#endif
@@ -104,33 +104,144 @@
 		} \
 	} 
 
-// double precision sinc without window function
-
-template<bool ramping, mp_sint32 windowSize, class bufferType, mp_uint32 shift>
-class SincResamplerDummy
+// polyphase windowed sinc, the kernel is tabulated once for every
+// combination of width and phase resolution and shared by all channels
+template<mp_sint32 windowSize, mp_uint32 phaseShift>
+class SincKernel
 {
+public:
+	enum 
+	{
+		WINDOWSIZE = windowSize, // number of taps, must be even
+		WIDTH = (WINDOWSIZE / 2),
+		PHASES = (1 << phaseShift), // table entries per zero crossing
+		FRACSHIFT = (16 - phaseShift),
+		LENGTH = WIDTH*PHASES
+	};	
+
 private:
-	static inline double sinc(double x)
+	// Kaiser window beta, ~90dB stop band attenuation
+	static inline double beta() { return 8.6; }
+
+	// zeroth order modified bessel function of the first kind
+	static double besselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		const double x2 = x*x*0.25;
+		for (mp_sint32 k = 1; k < 64 && term > sum*1e-12; k++)
+		{
+			term *= x2 / ((double)k*(double)k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// kernel value and difference to the next value for LENGTH+1 points
+	float* table;
+	// the same values ordered by phase, row p holds the WINDOWSIZE
+	// taps for a fractional position of p/PHASES (PHASES+1 rows)
+	float* phases;
+
+	SincKernel() :
+		table(new float[(LENGTH+1)*2]),
+		phases(new float[(PHASES+1)*WINDOWSIZE])
 	{
-		if (x==0.0) 
-			return 1.0;
-		else 
+		const double i0beta = besselI0(beta());
+		
+		double* values = new double[LENGTH+2];
+		for (mp_sint32 i = 0; i <= LENGTH; i++)
+		{
+			const double x = (double)i / PHASES;
+			const double r = x / WIDTH;
+			const double sinc = i ? sin(M_PI*x) / (M_PI*x) : 1.0;
+			values[i] = r < 1.0 ? sinc * besselI0(beta()*sqrt(1.0 - r*r)) / i0beta : 0.0;
+		}
+		values[LENGTH+1] = 0.0;
+		
+		for (mp_sint32 i = 0; i <= LENGTH; i++)
 		{
-			double temp = M_PI * x;
-			return sin(temp) / (temp);
+			table[i*2] = (float)values[i];
+			table[i*2+1] = (float)(values[i+1] - values[i]);
 		}
+		
+		// tap k is the sample at offset k-(WIDTH-1) from the current position,
+		// the last tap is always 0 (lookup() has no tap beyond WIDTH-1 either)
+		for (mp_sint32 p = 0; p <= PHASES; p++)
+		{
+			float* row = phases + p*WINDOWSIZE;
+			for (mp_sint32 k = 0; k < WINDOWSIZE-1; k++)
+			{
+				const mp_sint32 offset = k - (WIDTH-1);
+				row[k] = (float)values[offset <= 0 ? p - offset*PHASES : offset*PHASES - p];
+			}
+			row[WINDOWSIZE-1] = 0.0f;
+		}
+		
+		delete[] values;
 	}
 	
-	enum 
+	~SincKernel()
 	{
-		WINDOWSIZE = windowSize, // must be even
-		WIDTH = (WINDOWSIZE / 2)
-	};	
+		delete[] table;
+		delete[] phases;
+	}
+	
+	static const SincKernel& instance()
+	{
+		static const SincKernel kernel;
+		return kernel;
+	}
+	
+public:
+	static const float* get() { return instance().table; }
+	static const float* getPhases() { return instance().phases; }
+	
+	// kernel at time (16.16 fixed point zero crossings, any sign)
+	static inline float lookup(const float* table, mp_sint32 time)
+	{
+		const mp_uint32 t = (mp_uint32)abs(time);
+		const mp_uint32 index = t >> FRACSHIFT;
+		if (index >= (mp_uint32)LENGTH)
+			return 0.0f;
+		const float frac = (float)(t & ((1 << FRACSHIFT) - 1)) * (1.0f / (float)(1 << FRACSHIFT));
+		return table[index*2] + table[index*2+1]*frac;
+	}
+
+	// filter WINDOWSIZE samples starting at sample[0] for the fractional
+	// position timefrac (16 bit) between sample[WIDTH-1] and sample[WIDTH]
+	template<class bufferType>
+	static inline float convolve(const float* phases, const bufferType* sample, mp_sint32 timefrac)
+	{
+		const float* c0 = phases + (timefrac >> FRACSHIFT)*WINDOWSIZE;
+		const float* c1 = c0 + WINDOWSIZE;
+		const float frac = (float)(timefrac & ((1 << FRACSHIFT) - 1)) * (1.0f / (float)(1 << FRACSHIFT));
+	
+		// four independent sums, so the loop isn't bound by the add latency
+		float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+		for (mp_sint32 k = 0; k < WINDOWSIZE; k+=4)
+		{
+			sum0 += (float)sample[k] * (c0[k] + (c1[k] - c0[k])*frac);
+			sum1 += (float)sample[k+1] * (c0[k+1] + (c1[k+1] - c0[k+1])*frac);
+			sum2 += (float)sample[k+2] * (c0[k+2] + (c1[k+2] - c0[k+2])*frac);
+			sum3 += (float)sample[k+3] * (c0[k+3] + (c1[k+3] - c0[k+3])*frac);
+		}
+		
+		return (sum0 + sum1) + (sum2 + sum3);
+	}
+};
+
+template<bool ramping, mp_sint32 windowSize, mp_uint32 phaseShift, class bufferType, mp_uint32 shift>
+class SincResamplerDummy
+{
+private:
+	typedef SincKernel<windowSize, phaseShift> Kernel;
 
 public:
 	static inline void addBlock(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
 	{
 		const bufferType* sample = (const bufferType*)chn->sample;
+		const float* kernel = Kernel::get();
+		const float* phases = Kernel::getPhases();
 
 		mp_sint32 voll = chn->finalvoll;
 		mp_sint32 volr = chn->finalvolr;
@@ -141,6 +252,7 @@ public:
 		mp_sint32 smppos = chn->smppos;
 		mp_sint32 smpposfrac = chn->smpposfrac;
 		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+		const mp_sint32 rsmpadd = chn->rsmpadd;
 		
 		const mp_sint32 flags = chn->flags;
 		const mp_sint32 loopstart = chn->loopstart;
@@ -151,132 +263,87 @@ public:
 		mp_sint32 fixedtimefrac = chn->fixedtimefrac;
 		const mp_sint32 timeadd = chn->smpadd;
 	
-		ChannelMixer::TMixerChannel pos(true);
-
+		const mp_sint32 negflags = smpadd < 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD);
+		const mp_sint32 posflags = smpadd > 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD);
+		
+		// when downsampling the kernel is stretched by the resampling 
+		// factor to move the cut off below the new nyquist frequency
+		const bool downSampling = timeadd >= 65536;
+		const mp_sint32 timeStep = downSampling ? rsmpadd : 65536;
+		const float scale = (downSampling ? (float)rsmpadd * (1.0f / 65536.0f) : 1.0f) * (float)(1 << (16-shift));
+		
+		mp_sint32 tmpsmppos;
+		mp_sint32 tmpflags;
+		mp_sint32 tmploopstart;
+		mp_sint32 tmploopend;
+		
 		while (count--)
 		{
-			double result = 0;
+			float result = 0.0f;
 			
-			const double time_now = fixedtimefrac * (1.0 / 65536.0);
-		
-			if (abs(smpadd)<65536) 
+			tmpsmppos = smppos; 
+			tmploopstart = loopstart;
+			tmploopend = loopend;
+			tmpflags = negflags; 
+			// check whether we are outside loop points
+			// if that's the case we're treating the sample as a normal finite signal
+			// note that this is still not totally correct treatment
+			const bool outSideLoop = !(((flags & 3) && tmpsmppos >= loopstart && tmpsmppos < loopend));
+			if (outSideLoop)
 			{
-				pos.smppos = smppos; 
-				pos.loopstart = loopstart;
-				pos.loopend = loopend;
-				pos.loopendcopy = loopendcopy;
-				pos.flags = smpadd < 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD); 
-				// check whether we are outside loop points
-				// if that's the case we're treating the sample as a normal finite signal
-				// note that this is still not totally correct treatment
-				const bool outSideLoop = !(((flags & 3) && pos.smppos >= loopstart && pos.smppos < loopend));
-				if (outSideLoop)
-				{
-					pos.loopstart = 0;
-					pos.loopend = smplen;
-					pos.flags &= ~3;
-				}
-																								
-				double time = time_now;
-				if (!fixedtimefrac && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
-					time = 1.0;
+				tmploopstart = 0;
+				tmploopend = smplen;
+				tmpflags &= ~3;
+			}
 			
-				mp_sint32 j;				
-				for (j = 0; j<WIDTH; j++)
-				{
-					//double w = 0.42 - 0.5 * cos(2.0*M_PI*(WIDTH-1-j)/(WIDTH*2)) + 0.08*cos(4.0*M_PI*(WIDTH-1-j)/(WIDTH*2));
-				
-					result += (sample[pos.smppos]) * sinc(time);											
-
-					time++;
-					advancePos(pos.smppos, pos.flags, pos.loopstart, pos.loopend, pos.loopendcopy);
-					if (!(pos.flags & ChannelMixer::MP_SAMPLE_PLAY))
-						break;
-				}
-
-				pos.smppos = smppos; 
-				pos.flags = smpadd > 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD); 
-				if (outSideLoop)
-					pos.flags &= ~3;
-
-				time = time_now;
-				if (!fixedtimefrac && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
-					time = 1.0;
-
-				for (j = 1; j<WIDTH; j++)
-				{							
-					//double w = 0.42 - 0.5 * cos(2.0*M_PI*(j-1+WIDTH)/(WIDTH*2)) + 0.08*cos(4.0*M_PI*(j-1+WIDTH)/(WIDTH*2));
-
-					advancePos(pos.smppos, pos.flags, pos.loopstart, pos.loopend, pos.loopendcopy);
-					time--;
-					if (!(pos.flags & ChannelMixer::MP_SAMPLE_PLAY))
-						break;
-
-					result += (sample[pos.smppos]) * sinc(time);				
-				}
+			// playing forward without downsampling and all taps are in 
+			// between the loop points (or within the sample): use the 
+			// polyphase table, no need to walk along the sample
+			if (!downSampling && smpadd > 0 && 
+				smppos - (Kernel::WIDTH-1) >= tmploopstart && smppos + Kernel::WIDTH < tmploopend)
+			{
+				result = Kernel::convolve(phases, sample + smppos - (Kernel::WIDTH-1), fixedtimefrac);
 			}
-			else 
-			{					
-				double factor = smpadd * (1.0 / 65536.0);
-				double one_over_factor = 1.0 / factor;
-
-				pos.smppos = smppos; 
-				pos.loopstart = loopstart;
-				pos.loopend = loopend;
-				pos.loopendcopy = loopendcopy;
-				pos.flags = smpadd < 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD); 
-				// check whether we are outside loop points
-				// if that's the case we're treating the sample as a normal finite signal
-				// note that this is still not totally correct treatment
-				const bool outSideLoop = !(((flags & 3) && pos.smppos >= loopstart && pos.smppos < loopend));
-				if (outSideLoop)
-				{
-					pos.loopstart = 0;
-					pos.loopend = smplen;
-					pos.flags &= ~3;
-				}
-									
-				double time = time_now;
-				if (!fixedtimefrac && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
-					time = 1.0;
+			else
+			{
+				const mp_sint32 startTime = downSampling ? fpmul(fixedtimefrac, rsmpadd) : fixedtimefrac;
+			
+				mp_sint32 time = startTime;
+				if (!time && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
+					time = 65536;
 			
 				mp_sint32 j;				
-				for (j = 0; j<WIDTH; j++)
+				for (j = 0; j<Kernel::WIDTH; j++)
 				{
-					//double w = 0.42 - 0.5 * cos(2.0*M_PI*(WIDTH-1-j)/(WIDTH*2)) + 0.08*cos(4.0*M_PI*(WIDTH-1-j)/(WIDTH*2));
+					result += (float)sample[tmpsmppos] * Kernel::lookup(kernel, time);
 				
-					result += (sample[pos.smppos]) * one_over_factor * sinc(one_over_factor * time);											
-
-					advancePos(pos.smppos, pos.flags, pos.loopstart, pos.loopend, pos.loopendcopy);
-					time++;
-					if (!(pos.flags & ChannelMixer::MP_SAMPLE_PLAY))
+					time+=timeStep;
+					advancePos(tmpsmppos, tmpflags, tmploopstart, tmploopend, loopendcopy);
+					if (!(tmpflags & ChannelMixer::MP_SAMPLE_PLAY))
 						break;
 				}
-
-				pos.smppos = smppos; 
-				pos.flags = smpadd > 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD);
+			
+				tmpsmppos = smppos; 
+				tmpflags = posflags; 
 				if (outSideLoop)
-					pos.flags &= ~3;
-
-				time = time_now;
-				if (!fixedtimefrac && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
-					time = 1.0;
-
-				for (j = 1; j<WIDTH; j++)
+					tmpflags &= ~3;
+			
+				time = startTime;
+				if (!time && (flags & ChannelMixer::MP_SAMPLE_BACKWARD)) 
+					time = 65536;
+			
+				for (j = 1; j<Kernel::WIDTH; j++)
 				{							
-					//double w = 0.42 - 0.5 * cos(2.0*M_PI*(j-1+WIDTH)/(WIDTH*2)) + 0.08*cos(4.0*M_PI*(j-1+WIDTH)/(WIDTH*2));
-
-					advancePos(pos.smppos, pos.flags, pos.loopstart, pos.loopend, pos.loopendcopy);
-					time--;
-					if (!(pos.flags & ChannelMixer::MP_SAMPLE_PLAY))
+					advancePos(tmpsmppos, tmpflags, tmploopstart, tmploopend, loopendcopy);
+					time-=timeStep;
+					if (!(tmpflags & ChannelMixer::MP_SAMPLE_PLAY))
 						break;
-
-					result += (sample[pos.smppos]) * one_over_factor * sinc(one_over_factor * time);					
+				
+					result += (float)sample[tmpsmppos] * Kernel::lookup(kernel, time);
 				}
 			}
 			
-			
-			mp_sint32 final = (mp_sint32)(result*(1 << (16-shift)));
+			const mp_sint32 final = (mp_sint32)(result*scale);
 			
 			(*buffer++)+=((final*(voll>>15))>>15); 
 			(*buffer++)+=((final*(volr>>15))>>15); 
@@ -302,15 +369,21 @@ public:
 			chn->finalvolr = volr;	
 		}
 	}
-
 };
 
-template<bool ramping, mp_sint32 windowSize>
+// windowSize taps (32, 64 or 128), 1 << phaseShift kernel entries per zero crossing
+template<bool ramping, mp_sint32 windowSize, mp_uint32 phaseShift = 8>
 class ResamplerSinc : public ChannelMixer::ResamplerBase
 {
 private:
 	
 public:
+	ResamplerSinc()
+	{
+		// build the shared kernel now instead of in the mixer thread
+		SincKernel<windowSize, phaseShift>::get();
+	}
+
 	virtual bool isRamping() { return ramping; }
 	virtual bool supportsFullChecking() { return false; }
 	virtual bool supportsNoChecking() { return true; }
@@ -318,9 +391,9 @@ public:
 	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
 	{
 		if (chn->flags & 4)
-			SincResamplerDummy<ramping, windowSize, mp_sword, 16>::addBlock(buffer, chn, count);		
+			SincResamplerDummy<ramping, windowSize, phaseShift, mp_sword, 16>::addBlock(buffer, chn, count);		
 		else
-			SincResamplerDummy<ramping, windowSize, mp_sbyte, 8>::addBlock(buffer, chn, count);
+			SincResamplerDummy<ramping, windowSize, phaseShift, mp_sbyte, 8>::addBlock(buffer, chn, count);
 	}
 };
 
@@ -0,0 +1,814 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  SongAnalyzer.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "SongAnalyzer.h"
+#include "PlayerGeneric.h"
+#include "XModule.h"
+
+SongAnalyzer::SongAnalyzer(XModule* module, mp_uint32 frequency/* = 44100*/) :
+	module(module),
+	frequency(frequency),
+	bufferSize(DefaultBufferSize),
+	playMode(PlayModeSettings::PlayMode_Auto),
+	timingLUT(NULL),
+	lengthInSamples(0),
+	endReason(EndReasonEndOfSong),
+	loopOrder(-1),
+	loopRow(-1),
+	numSubSongs(0)
+{
+}
+
+// same as PlayerSTD::getbpmrate
+mp_uint32 SongAnalyzer::getbpmrate(mp_uint32 bpm) const
+{
+	// digibooster "real BPM" setting
+	mp_uint32 realCiaTempo = (bpm * (baseBpm << 8) / 125) >> 8;
+
+	if (!realCiaTempo) realCiaTempo++;
+	
+	mp_int64 t = ((mp_int64)realCiaTempo)<<(32+2);
+	
+	const mp_uint32 timerBase = (mp_uint32)(5.0f*500.0f*(ChannelMixer::MP_BEATLENGTH*ChannelMixer::MP_TIMERFREQ / (float)ChannelMixer::MP_BASEFREQ));
+	
+	return (mp_uint32)(t/timerBase);
+}
+
+// The player adds the BPM rate to a 32 bit counter every beat and plays a 
+// tick whenever the counter carries over. Find the beat of the numTicks-th
+// carry directly instead of counting beats.
+void SongAnalyzer::advanceTicks(mp_sint32 numTicks)
+{
+	const mp_int64 target = ((mp_int64)numTicks << 32) - bpmCounter;
+	const mp_int64 n = (target + adder - 1) / adder;
+	
+	numBeats+=n;
+	bpmCounter+=n*adder - ((mp_int64)numTicks << 32);
+}
+
+// beats are mixed at beat*beatLength, see ChannelMixer::mix
+mp_int64 SongAnalyzer::getBufferOfBeat(mp_int64 beat) const
+{
+	return beat*beatLength / bufferSize;
+}
+
+mp_int64 SongAnalyzer::getFirstBeatOfBuffer(mp_int64 buffer) const
+{
+	return (buffer*bufferSize + beatLength - 1) / beatLength;
+}
+
+// The player records the order before each beat, the export looks at
+// the one of the first beat in a buffer. An order set on a beat is seen
+// by the next buffer starting with a beat.
+void SongAnalyzer::changeOrder(mp_int64 beat, mp_sint32 order)
+{
+	const mp_int64 buffer = getBufferOfBeat(getFirstBeatOfBuffer(getBufferOfBeat(beat) + 1));
+	
+	if (pendingBuffer != -1 && pendingBuffer != buffer)
+		observeOrder();
+	
+	pendingBuffer = buffer;
+	pendingOrder = order;
+}
+
+// same as PlayerGeneric::exportToWAV after mixing the pending buffer
+void SongAnalyzer::observeOrder()
+{
+	const mp_int64 buffer = pendingBuffer;
+	pendingBuffer = -1;
+	
+	// not mixed anymore
+	if (buffer >= maxBuffers || (endBuffer != -1 && buffer > endBuffer))
+		return;
+	
+	if (pendingOrder == curOrderPos)
+		return;
+	
+	curOrderPos = pendingOrder;
+	if (timingLUT && curOrderPos < module->header.ordnum && timingLUT[curOrderPos] == -1)
+		timingLUT[curOrderPos] = (mp_sint32)((buffer+1)*bufferSize);
+	
+	if (curOrderPos > endOrder && endBuffer == -1)
+	{
+		endBuffer = buffer;
+		endReason = EndReasonEndOfSong;
+	}
+}
+
+// the player halts on this beat, the export stops after its buffer
+void SongAnalyzer::haltAt(mp_int64 beat, EndReasons reason)
+{
+	const mp_int64 buffer = getBufferOfBeat(beat);
+	
+	if (pendingBuffer != -1 && pendingBuffer <= buffer)
+		observeOrder();
+	
+	// the end order has been left before
+	if (endBuffer != -1 && endBuffer < buffer)
+		return;
+	
+	if (buffer >= maxBuffers)
+	{
+		endBuffer = maxBuffers - 1;
+		endReason = EndReasonHalt;
+		return;
+	}
+	
+	endBuffer = buffer;
+	endReason = reason;
+}
+
+void SongAnalyzer::resetLooping(TChannel& channel)
+{
+	channel.loopstart = channel.loopcounter = channel.execloop = 0;
+	channel.isLooping = false;
+	channel.loopingValidPosition = poscnt;
+}
+
+void SongAnalyzer::setNewPosition(mp_sint32 newPos)
+{
+	if (newPos == poscnt)
+		return;
+	
+	if (newPos >= module->header.ordnum)
+		newPos = module->header.restart;
+	
+	poscnt = newPos;
+
+	// reset looping flags
+	for (mp_sint32 c = 0; c < numModuleChannels; c++)
+		resetLooping(channels[c]);
+}
+
+// only the effects which have an influence on the song position or timing
+bool SongAnalyzer::isSequencerEffect(mp_ubyte eff)
+{
+	switch (eff)
+	{
+		case 0x0B:
+		case 0x0D:
+		case 0x0F:
+		case 0x16:
+		case 0x2B:
+		case 0x36:
+		case 0x3E:
+		case 0x52:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void SongAnalyzer::doEffect(mp_sint32 chn, mp_sint32 effcnt, const mp_ubyte* slot, mp_sint32 numEffects)
+{
+	TChannel* chnInf = &channels[chn];
+	mp_ubyte eop = slot[2+(effcnt*2)+1];
+
+	switch (slot[2+(effcnt*2)])
+	{
+		case 0x0B : {
+						pjump = 1;
+						pjumppos = eop;
+						pjumprow = 0;
+						pjumpPriority = MP_NUMEFFECTS*chn + effcnt;
+					}; 
+					break;
+		case 0x0D : {
+						pbreak=1;
+						pbreakpos = (eop>>4)*10+(eop&0xf);
+						if (pbreakpos > 63)
+							pbreakpos = 0;
+						pbreakPriority = MP_NUMEFFECTS*chn + effcnt;
+					}; break;
+		case 0x0F : {
+						if (eop) 
+						{
+							if (eop>=32) {
+								bpm=eop;
+								adder = getbpmrate(eop);
+							}
+						}
+						else
+						{
+							haltFlag = true;
+						}
+					}; break;
+		// set BPM
+		case 0x16 : {
+						if (eop) {
+							if (isIT)
+							{
+								chnInf->temposlide[effcnt] = eop; 
+								if ((module->header.flags & XModule::MODULE_ITTEMPOSLIDE) && eop < 0x20)
+									break;
+							}
+							bpm=eop;
+							adder = getbpmrate(eop);
+						}
+					}; break;
+		// Far position jump (PLM support)
+		case 0x2B : {
+						pjump = 1;
+						pjumppos = eop;
+						pjumprow = slot[2+((effcnt+1)%numEffects)*2+1];
+						pjumpPriority = MP_NUMEFFECTS*chn + effcnt;
+					}; break;
+		case 0x36 : {
+						mp_ubyte op = eop;
+						
+						// PlayerIT: not only S60 can be the loop start point
+						if (isIT && newInsST3Flag && (chnInf->loopstart==rowcnt) && chnInf->isLooping)
+							op = 0;
+		
+						if (!op) {
+							chnInf->execloop=0;
+							chnInf->loopstart=rowcnt;
+							chnInf->loopingValidPosition = poscnt;
+						}
+						else {
+							if (chnInf->loopcounter==op) 
+							{
+								// Imitate nasty XM bug here:
+								if (playModeFT2)
+								{
+									startNextRow = chnInf->loopstart;
+								}
+							
+								resetLooping(*chnInf);
+								
+								if (isIT && newInsST3Flag)
+								{
+									chnInf->execloop=0;
+									chnInf->loopstart=rowcnt;
+									chnInf->loopingValidPosition = poscnt;
+								}
+							}
+							else {
+								chnInf->execloop=1;
+								chnInf->loopcounter++;
+							}
+						}
+					}; break;
+		case 0x3E : {
+						patDelay = true;
+						patDelayCount = (mp_sint32)tickSpeed*((mp_sint32)eop+1);
+					}; break;
+		// Digibooster set real BPM
+		case 0x52 : {
+						if (eop) 
+						{
+							baseBpm = eop >= 32 ? eop : 32;
+							adder = getbpmrate(bpm);
+						}
+						break;
+					}
+	}
+}
+
+// PlayerIT tempo slide, returns true if the tempo is going to change on the following ticks
+bool SongAnalyzer::doTickEffect(mp_sint32 chn, mp_sint32 effcnt, const mp_ubyte* slot, mp_sint32 ticker)
+{
+	TChannel* chnInf = &channels[chn];
+
+	if (slot[2+(effcnt*2)] != 0x16)
+		return false;
+
+	if (chnInf->temposlide[effcnt] >= 0x20 || 
+		!(module->header.flags & XModule::MODULE_ITTEMPOSLIDE))
+		return false;
+	
+	if (!ticker)
+		return true;
+	
+	mp_ubyte x = chnInf->temposlide[effcnt]>>4;
+	mp_ubyte y = chnInf->temposlide[effcnt]&0xf;
+	
+	// this is what PlayerIT does
+	switch (x >> 4)
+	{
+		case 0:
+			bpm-=y & 0x0F;
+			if (bpm < 32)
+				bpm = 32;
+			break;
+		case 1:
+			bpm+=y & 0x0F;
+			if (bpm > 255)
+				bpm = 255;
+			break;
+	}
+	
+	adder = getbpmrate(bpm);
+	return true;
+}
+
+mp_sint32 SongAnalyzer::prepare()
+{
+	switch (PlayerGeneric::getPreferredPlayerType(module))
+	{
+		case PlayerBase::PlayerType_Generic:
+			isIT = false;
+			break;
+		case PlayerBase::PlayerType_IT:
+			isIT = true;
+			break;
+		default:
+			return MP_UNSUPPORTED;
+	}
+	
+	numModuleChannels = module->header.channum < 256 ? module->header.channum : 256;
+	
+	// same as PlayerSTD/PlayerIT::updatePlayModeFlags
+	newInsST3Flag = (module->header.flags & XModule::MODULE_ST3NEWINSTRUMENT) != 0;
+	switch (playMode)
+	{
+		case PlayModeSettings::PlayMode_ScreamTracker3:
+		case PlayModeSettings::PlayMode_ImpulseTracker:
+			newInsST3Flag = true;
+			break;
+		case PlayModeSettings::PlayMode_Auto:
+			break;
+		default:
+			newInsST3Flag = false;
+	}
+
+	playModeFT2 = (playMode == PlayModeSettings::PlayMode_FastTracker2 ? true : false);
+	if (playMode == PlayModeSettings::PlayMode_Auto && (module->header.flags & XModule::MODULE_XMARPEGGIO))
+		playModeFT2 = true;
+	
+	return MP_OK;
+}
+
+// Mirrors PlayerSTD::tickhandler (PlayerIT does the same), but instead of
+// being called on every tick, a row is processed as a whole and the time 
+// is advanced by the number of ticks the row lasts
+void SongAnalyzer::walk(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT)
+{
+	mp_sint32 i, c;
+	
+	// PlayerSTD::restart
+	bpm = module->header.speed;
+	tickSpeed = module->header.tempo;
+	baseBpm = 125;
+	adder = getbpmrate(bpm);
+	
+	poscnt = startOrder;
+	rowcnt = 0;
+
+	patDelay = false;
+	patDelayCount = 0;
+	haltFlag = false;
+	startNextRow = -1;
+	
+	memset(channels, 0, sizeof(channels));
+	for (c = 0; c < numModuleChannels; c++)
+		resetLooping(channels[c]);
+
+	memset(rowHits, 0, sizeof(rowHits));
+	for (i = 0; i < startOrder; i++)
+		for (mp_sint32 j = 0; j < 256; j++)
+			visitRow(i*256+j);
+	
+	numBeats = 0;
+	bpmCounter = 0;
+	beatLength = ChannelMixer::beatPacketsToBufferSize(frequency, 1);
+
+	// PlayerGeneric::exportToWAV
+	this->timingLUT = timingLUT;
+	this->endOrder = endOrder;
+	curOrderPos = startOrder;
+	if (timingLUT)
+		timingLUT[curOrderPos] = 0;
+	
+	pendingBuffer = endBuffer = -1;
+	maxBuffers = ((mp_int64)MaxLengthInSeconds*frequency + bufferSize - 1) / bufferSize;
+
+	endReason = EndReasonEndOfSong;
+	loopOrder = loopRow = -1;
+
+	for (;;)
+	{
+		// first tick of the next row
+		advanceTicks(1);
+		const mp_int64 beat = numBeats - 1;
+		
+		// the buffer which sees the last order change has been mixed
+		if (pendingBuffer != -1 && getFirstBeatOfBuffer(pendingBuffer) <= beat)
+			observeOrder();
+		
+		const mp_int64 buffer = getBufferOfBeat(beat);
+		if (endBuffer == -1 && buffer >= maxBuffers)
+		{
+			endBuffer = maxBuffers - 1;
+			endReason = EndReasonHalt;
+		}
+		
+		// the export has stopped before this row
+		if (endBuffer != -1 && buffer > endBuffer)
+			break;
+		
+		// sanity check 1
+		if (poscnt >= module->header.ordnum)
+		{
+			haltAt(beat, EndReasonHalt);
+			break;
+		}
+		
+		const mp_sint32 lastPos = poscnt;
+		const mp_sint32 patternIndex = module->header.ord[poscnt];
+		const TXMPattern* pattern = &module->phead[patternIndex];
+		
+		if (pattern->patternData == NULL)
+		{
+			haltAt(beat, EndReasonHalt);
+			break;
+		}
+		
+		// rows behind the end of the pattern take one tick (sanity check 2)
+		if (rowcnt < pattern->rows)
+		{
+			const mp_sint32 numEffects = pattern->effnum;
+			const mp_sint32 numChannels = pattern->channum <= numModuleChannels ? pattern->channum : numModuleChannels;
+		
+			// Keep track of visited rows
+			mp_sint32 absolutePos = poscnt*256+rowcnt;
+			if (isRowVisited(absolutePos))
+			{
+				// pattern loop active?
+				bool b = false;
+				for (c=0;c<numChannels;c++) 
+				{
+					if (channels[c].isLooping && channels[c].loopingValidPosition == poscnt)
+					{
+						b = true;
+						break;
+					}
+				}
+
+				if (!b)
+				{
+					haltAt(beat, EndReasonLoop);
+					if (endReason == EndReasonLoop)
+					{
+						loopOrder = poscnt;
+						loopRow = rowcnt;
+					}
+					break;
+				}
+			}
+			else
+			{
+				visitRow(absolutePos);
+			}
+			
+			orderHits[poscnt] = true;
+		
+			pbreak = pbreakpos = pbreakPriority = pjump = pjumppos = pjumprow = pjumpPriority = 0;
+			
+			const mp_sint32 slotsize = (numEffects*2)+2;
+			const mp_ubyte* row = pattern->patternData+(pattern->channum*slotsize*rowcnt);
+		
+			// search for note delays and set the speed in advance
+			const mp_ubyte* slot = row;
+			for (c=0;c<numChannels;c++) 
+			{
+				channels[c].attick = 0;
+				channels[c].hasEffects = false;
+				
+				for (mp_sint32 effcnt=0;effcnt<numEffects;effcnt++) 
+				{
+					const mp_ubyte eff = slot[2+(effcnt*2)];
+					const mp_ubyte eop = slot[2+(effcnt*2)+1];
+					
+					if (isSequencerEffect(eff))
+						channels[c].hasEffects = true;
+					
+					if (eff == 0x3D)
+						channels[c].attick = eop;
+					else if (eff == 0xf && eop && eop < 32)
+						tickSpeed = eop;
+					else if (eff == 0x1c && eop)
+						tickSpeed = eop;
+				}
+				
+				slot+=slotsize;
+			}
+			
+			mp_sint32 ticker = 0;
+			for (;;)
+			{
+				bool pendingEffects = false;
+				
+				// PlayerSTD::progressRow
+				slot = row;
+				for (c=0;c<numChannels;c++,slot+=slotsize) 
+				{
+					const mp_sint32 attick = channels[c].attick;
+					if (attick == ticker && ticker < tickSpeed)
+					{
+						if (channels[c].hasEffects)
+							for (mp_sint32 effcnt=0;effcnt<numEffects;effcnt++) 
+								doEffect(c, effcnt, slot, numEffects);
+					}
+					else if (attick > ticker && attick < tickSpeed)
+					{
+						pendingEffects = true;
+					}
+				}
+				
+				// PlayerIT::doTickeffects, only the tempo slide matters
+				if (isIT)
+				{
+					slot = row;
+					for (c=0;c<numChannels;c++,slot+=slotsize) 
+					{
+						if (channels[c].hasEffects && channels[c].attick <= ticker && channels[c].attick < tickSpeed)
+						{
+							for (mp_sint32 effcnt=0;effcnt<numEffects;effcnt++) 
+								pendingEffects |= doTickEffect(c, effcnt, slot, ticker);
+						}
+					}
+				}
+				
+				ticker++;
+
+				mp_sint32 maxTicks = tickSpeed;
+				if (patDelay)
+					maxTicks = patDelayCount;
+				
+				if (ticker >= maxTicks)
+					break;
+				
+				// nothing left to do in this row except waiting for the row to end?
+				if (!pendingEffects)
+				{
+					advanceTicks(maxTicks - ticker);
+					break;
+				}
+				
+				advanceTicks(1);
+			}
+			
+			if (patDelay)
+				patDelay = false;
+
+			// break pattern?
+			if (pbreak&&(poscnt<(module->header.ordnum-1))) 
+			{
+				if (!pjump || (pjump && pjumpPriority > pbreakPriority))
+					setNewPosition(poscnt+1);
+				rowcnt=pbreakpos-1;
+				startNextRow = -1;
+			}
+			else if (pbreak&&(poscnt==(module->header.ordnum-1))) 
+			{
+				// Pattern break on the last order? Break to restart position
+				if (!pjump || (pjump && pjumpPriority > pbreakPriority))
+					setNewPosition(module->header.restart);
+				rowcnt=pbreakpos-1;
+				startNextRow = -1;
+			}
+			
+			// pattern jump?
+			if (pjump) 
+			{
+				if (!pbreak || (pbreak && pjumpPriority > pbreakPriority))
+					rowcnt = pjumprow-1;					
+				setNewPosition(pjumppos);					
+				startNextRow = -1;
+			}
+
+			// handle loop
+			for (c=0;c<numChannels;c++) 
+			{			
+				if (channels[c].execloop) 
+				{
+					rowcnt = channels[c].loopstart-1;
+					channels[c].execloop = 0;
+					channels[c].isLooping = true;
+				}
+			}
+			
+			// next row
+			rowcnt++;
+		}
+		
+		// reached end of pattern? 
+		// (the pattern might have changed because of position jumps)
+		if (rowcnt>=module->phead[module->header.ord[poscnt]].rows) 
+		{
+			// start at row 0?
+			if (startNextRow != -1)
+			{
+				rowcnt = startNextRow;
+				startNextRow = -1;
+			}
+			else
+			{
+				rowcnt = 0;
+			}
+			
+			// play next order
+			setNewPosition(poscnt+1);
+		}
+		
+		// everything above happens on the last tick of the row
+		if (poscnt != lastPos)
+			changeOrder(numBeats - 1, poscnt);
+		
+		if (haltFlag)
+		{
+			haltAt(numBeats - 1, EndReasonHalt);
+			break;
+		}
+	}
+	
+	lengthInSamples = (mp_sint32)((endBuffer+1)*bufferSize);
+}
+
+mp_sint32 SongAnalyzer::playThrough(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT)
+{
+	lengthInSamples = 0;
+	endReason = EndReasonEndOfSong;
+	loopOrder = loopRow = -1;
+
+	// the same player the song is played with
+	PlayerGeneric settings(frequency);
+	PlayerBase* player = settings.getPreferredPlayer(module);
+	if (player == NULL)
+		return MP_UNSUPPORTED;
+
+	player->adjustFrequency(frequency);
+	player->setBufferSize(bufferSize);
+	player->setPlayMode(playMode);
+	// only the sequencer is processed
+	player->setDisableMixing(true);
+
+	mp_sint32 res = player->startPlaying(module, false, startOrder, 0, -1, NULL, false, -1);
+	if (res != MP_OK)
+	{
+		delete player;
+		return res;
+	}
+
+	// nothing is mixed into it, but the mixer wants a buffer
+	mp_sint32* buffer = new mp_sint32[bufferSize*MP_NUMCHANNELS];
+
+	const mp_int64 maxLength = (mp_int64)MaxLengthInSeconds*frequency;
+
+	mp_sint32 curOrderPos = startOrder;
+	orderHits[curOrderPos] = true;
+	if (timingLUT)
+		timingLUT[curOrderPos] = 0;
+
+	// same as PlayerGeneric::exportToWAV
+	while (!player->hasSongHalted() && player->getOrder(0) <= endOrder)
+	{
+		if (lengthInSamples >= maxLength)
+		{
+			endReason = EndReasonHalt;
+			break;
+		}
+
+		player->mix(buffer, bufferSize);
+		lengthInSamples+=bufferSize;
+
+		// orders entered within the buffer
+		for (mp_uint32 i = 0; i <= player->getNumBeatPackets(); i++)
+			orderHits[player->getOrder(i)] = true;
+
+		if (player->getOrder(0) != curOrderPos)
+		{
+			curOrderPos = player->getOrder(0);
+			if (timingLUT && curOrderPos < module->header.ordnum && timingLUT[curOrderPos] == -1)
+				timingLUT[curOrderPos] = lengthInSamples;
+		}
+	}
+
+	if (player->hasSongLooped())
+	{
+		endReason = EndReasonLoop;
+		player->getLoopPosition(loopOrder, loopRow);
+	}
+	else if (player->hasSongHalted())
+	{
+		endReason = EndReasonHalt;
+	}
+
+	player->stopPlaying();
+
+	delete[] buffer;
+	delete player;
+
+	return MP_OK;
+}
+
+mp_sint32 SongAnalyzer::analyzeOrders(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT)
+{
+	if (startOrder < 0 || startOrder >= module->header.ordnum)
+		return MP_UNSPECIFIED;
+
+	if (prepare() != MP_OK)
+		return playThrough(startOrder, endOrder, timingLUT);
+	
+	walk(startOrder, endOrder, timingLUT);
+	return MP_OK;
+}
+
+mp_sint32 SongAnalyzer::analyze(mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/, mp_sint32* timingLUT/* = NULL*/)
+{
+	if (module == NULL)
+		return MP_UNSPECIFIED;
+
+	if (endOrder == -1 || endOrder < startOrder || endOrder > module->header.ordnum - 1)
+		endOrder = module->header.ordnum - 1;
+
+	if (timingLUT)
+	{
+		for (mp_sint32 i = 0; i < module->header.ordnum; i++)
+			timingLUT[i] = -1;
+	}
+
+	memset(orderHits, 0, sizeof(orderHits));
+
+	mp_sint32 res = analyzeOrders(startOrder, endOrder, timingLUT);
+	if (res != MP_OK)
+		return res;
+
+	return lengthInSamples;
+}
+
+mp_sint32 SongAnalyzer::findSubSongs()
+{
+	if (module == NULL)
+		return MP_UNSPECIFIED;
+
+	// keep the result of the last analyze() call
+	const mp_sint32 lastLengthInSamples = lengthInSamples;
+	const EndReasons lastEndReason = endReason;
+	const mp_sint32 lastLoopOrder = loopOrder, lastLoopRow = loopRow;
+
+	memset(orderHits, 0, sizeof(orderHits));
+
+	numSubSongs = 0;
+	for (mp_sint32 i = 0; i < module->header.ordnum && i < 256 && numSubSongs < MaxSubSongs; i++)
+	{
+		if (orderHits[i])
+			continue;
+
+		mp_sint32 res = analyzeOrders(i, module->header.ordnum - 1, NULL);
+		if (res != MP_OK)
+		{
+			numSubSongs = 0;
+			lengthInSamples = lastLengthInSamples;
+			endReason = lastEndReason;
+			loopOrder = lastLoopOrder;
+			loopRow = lastLoopRow;
+			return res;
+		}
+
+		subSongs[numSubSongs].startOrder = i;
+		subSongs[numSubSongs].numSamples = lengthInSamples;
+		subSongs[numSubSongs].endReason = endReason;
+		numSubSongs++;
+	}
+
+	lengthInSamples = lastLengthInSamples;
+	endReason = lastEndReason;
+	loopOrder = lastLoopOrder;
+	loopRow = lastLoopRow;
+
+	return numSubSongs;
+}
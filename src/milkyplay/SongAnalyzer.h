@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  SongAnalyzer.h
+ *  MilkyPlay
+ *
+ *	Walks the order list of a module with the sequencer rules of the players
+ *	(speed, BPM, pattern jumps/breaks/loops/delays, note delays) without 
+ *	running the player. Rows are processed as a whole, the timer beat each
+ *	tick falls on is computed directly. Gives the song length, the position
+ *	of each order in time, whether the song loops and which subsongs the
+ *	order list contains. Lengths and timings are the same as the ones of a
+ *	WAV export with the same buffer size.
+ *
+ */
+
+#ifndef __SONGANALYZER_H__
+#define __SONGANALYZER_H__
+
+#include "MilkyPlayCommon.h"
+#include "PlayerBase.h"
+
+class XModule;
+
+class SongAnalyzer
+{
+public:
+	enum
+	{
+		// the buffer size the tracker exports with
+		DefaultBufferSize = 1024,
+		MaxSubSongs = 256,
+		// stop broken songs which never end (e.g. endless E6x loops)
+		MaxLengthInSeconds = 4*60*60
+	};
+
+	enum EndReasons
+	{
+		// the end order has been left
+		EndReasonEndOfSong,
+		// the song jumped back to a row which has already been played
+		EndReasonLoop,
+		// F00, invalid pattern data or the maximum length has been reached
+		EndReasonHalt
+	};
+
+private:
+	struct TChannel
+	{
+		mp_sint32	loopstart;
+		mp_sint32	loopcounter;
+		mp_sint32	execloop;
+		bool		isLooping;
+		mp_sint32	loopingValidPosition;
+		mp_ubyte	temposlide[MP_NUMEFFECTS];
+		mp_ubyte	attick;
+		bool		hasEffects;
+	};
+
+	struct TSubSong
+	{
+		mp_sint32	startOrder;
+		mp_sint32	numSamples;
+		EndReasons	endReason;
+	};
+
+	XModule*		module;
+	mp_uint32		frequency;
+	mp_uint32		bufferSize;
+	PlayModeSettings::PlayModes	playMode;
+
+	// sequencer state, mirrors PlayerSTD/PlayerIT
+	bool			isIT;
+	bool			playModeFT2;
+	bool			newInsST3Flag;
+	
+	mp_sint32		numModuleChannels;
+	mp_sint32		poscnt, rowcnt;
+	mp_sint32		bpm, tickSpeed, baseBpm;
+	mp_uint32		adder;
+	mp_sint32		pbreak, pbreakpos, pbreakPriority;
+	mp_sint32		pjump, pjumppos, pjumprow, pjumpPriority;
+	bool			patDelay;
+	mp_sint32		patDelayCount;
+	bool			haltFlag;
+	mp_sint32		startNextRow;
+	
+	TChannel		channels[256];
+	mp_ubyte		rowHits[256*256/8];
+	bool			orderHits[256];
+
+	// timing state, counted in 250Hz timer beats
+	mp_int64		numBeats;
+	mp_int64		bpmCounter;
+	mp_sint32		beatLength;
+
+	// An export looks at the order of the first beat in each buffer it
+	// has mixed, the last order change is held back until we know which
+	// buffer sees it
+	mp_sint32*		timingLUT;
+	mp_sint32		endOrder;
+	mp_sint32		curOrderPos;
+	mp_int64		pendingBuffer;
+	mp_sint32		pendingOrder;
+	mp_int64		endBuffer;
+	mp_int64		maxBuffers;
+
+	// results of the last analysis
+	mp_sint32		lengthInSamples;
+	EndReasons		endReason;
+	mp_sint32		loopOrder, loopRow;
+
+	TSubSong		subSongs[MaxSubSongs];
+	mp_sint32		numSubSongs;
+
+	bool isRowVisited(mp_sint32 row) const
+	{		
+		return (rowHits[row>>3]>>(row&7))&1;
+	}
+
+	void visitRow(mp_sint32 row)
+	{
+		rowHits[row>>3] |= (1<<(row&7));
+	}	
+
+	mp_uint32		getbpmrate(mp_uint32 bpm) const;
+	
+	void			advanceTicks(mp_sint32 numTicks);
+	void			resetLooping(TChannel& channel);
+	void			setNewPosition(mp_sint32 newPos);
+	
+	static bool		isSequencerEffect(mp_ubyte eff);
+	void			doEffect(mp_sint32 chn, mp_sint32 effcnt, const mp_ubyte* slot, mp_sint32 numEffects);
+	bool			doTickEffect(mp_sint32 chn, mp_sint32 effcnt, const mp_ubyte* slot, mp_sint32 ticker);
+
+	mp_int64		getBufferOfBeat(mp_int64 beat) const;
+	mp_int64		getFirstBeatOfBuffer(mp_int64 buffer) const;
+	void			changeOrder(mp_int64 beat, mp_sint32 order);
+	void			observeOrder();
+	void			haltAt(mp_int64 beat, EndReasons reason);
+	
+	void			walk(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT);
+	// the same for the players which don't sequence like PlayerSTD/PlayerIT
+	mp_sint32		playThrough(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT);
+	
+	mp_sint32		prepare();
+	mp_sint32		analyzeOrders(mp_sint32 startOrder, mp_sint32 endOrder, mp_sint32* timingLUT);
+
+public:
+	/**
+	 * Construct an analyzer
+	 * @param  module		the module to analyze
+	 * @param  frequency	sample rate the returned sample positions refer to
+	 */
+	SongAnalyzer(XModule* module, mp_uint32 frequency = 44100);
+
+	/**
+	 * Select the play mode, this should match the play mode of the player
+	 * which is going to play the song
+	 */
+	void			setPlayMode(PlayModeSettings::PlayModes mode) { playMode = mode; }
+
+	/**
+	 * Lengths and timings are counted in whole buffers of this size,
+	 * like the song would be exported
+	 */
+	void			setBufferSize(mp_uint32 bufferSize) { this->bufferSize = bufferSize; }
+
+	/**
+	 * Walk through the song like the player would do when exporting it
+	 * @param  startOrder	the start position within the order list of the song
+	 * @param  endOrder		the last order to be played
+	 * @param  timingLUT	optional: specify a pointer to a buffer which will hold the
+	 *						sample position at which each order is entered,
+	 *						orders which aren't played are set to -1.
+	 *						The buffer needs to hold module->header.ordnum values
+	 * @return				length of the song in samples, negative on error
+	 */
+	mp_sint32		analyze(mp_sint32 startOrder = 0, mp_sint32 endOrder = -1, mp_sint32* timingLUT = NULL);
+
+	/**
+	 * Length of the last analyzed song in samples
+	 */
+	mp_sint32		getLengthInSamples() const { return lengthInSamples; }
+
+	/**
+	 * Length of the last analyzed song in seconds
+	 */
+	float			getLengthInSeconds() const { return (float)lengthInSamples / (float)frequency; }
+
+	/**
+	 * Tell why the last analyzed song has ended
+	 */
+	EndReasons		getEndReason() const { return endReason; }
+
+	/**
+	 * If the last analyzed song loops, the order and row the song would
+	 * continue at, otherwise -1
+	 */
+	mp_sint32		getLoopOrder() const { return loopOrder; }
+	mp_sint32		getLoopRow() const { return loopRow; }
+
+	/**
+	 * Find all subsongs within the order list. The first subsong starts at
+	 * order 0, every following subsong starts at the first order which
+	 * hasn't been played by any of the previous subsongs.
+	 * @return				number of subsongs found, negative on error
+	 */
+	mp_sint32		findSubSongs();
+
+	mp_sint32		getNumSubSongs() const { return numSubSongs; }
+	mp_sint32		getSubSongStartOrder(mp_sint32 index) const { return subSongs[index].startOrder; }
+	mp_sint32		getSubSongLengthInSamples(mp_sint32 index) const { return subSongs[index].numSamples; }
+	EndReasons		getSubSongEndReason(mp_sint32 index) const { return subSongs[index].endReason; }
+};
+
+#endif
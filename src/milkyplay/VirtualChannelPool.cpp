@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  VirtualChannelPool.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "VirtualChannelPool.h"
+
+// index of the lowest set bit, x must not be 0
+static inline mp_uint32 lowestBit(mp_uint32 x)
+{
+	static const mp_ubyte deBruijn[32] = 
+	{
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8, 
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	
+	return deBruijn[((x & (0-x)) * 0x077CB531U) >> 27];
+}
+
+VirtualChannelPool::VirtualChannelPool(mp_uint32 numChannels, mp_uint32 numOwners) :
+	numChannels(numChannels),
+	numOwners(numOwners),
+	channels(new TChannel[numChannels]),
+	freeMap(new mp_uint32[(numChannels + 31) >> 5]),
+	freeMapSize((numChannels + 31) >> 5),
+	ownerLists(new mp_sint32[numOwners]),
+	heap(new mp_sint32[numChannels]),
+	heapSize(0)
+{
+	reset();
+}
+
+VirtualChannelPool::~VirtualChannelPool()
+{
+	delete[] channels;
+	delete[] freeMap;
+	delete[] ownerLists;
+	delete[] heap;
+}
+
+void VirtualChannelPool::reset()
+{
+	for (mp_uint32 i = 0; i < numChannels; i++)
+	{
+		channels[i].prev = channels[i].next = -1;
+		channels[i].owner = -1;
+		channels[i].heapPos = -1;
+		channels[i].volume = 0;
+	}
+	
+	for (mp_uint32 i = 0; i < freeMapSize; i++)
+		freeMap[i] = 0xFFFFFFFF;
+	// no bits for channels which don't exist
+	if (numChannels & 31)
+		freeMap[freeMapSize-1] = (1U << (numChannels & 31)) - 1;
+	
+	for (mp_uint32 i = 0; i < numOwners; i++)
+		ownerLists[i] = -1;
+	
+	heapSize = 0;
+}
+
+mp_sint32 VirtualChannelPool::getFree() const
+{
+	for (mp_uint32 i = 0; i < freeMapSize; i++)
+		if (freeMap[i])
+			return (i << 5) + lowestBit(freeMap[i]);
+	
+	return -1;
+}
+
+void VirtualChannelPool::siftUp(mp_uint32 pos)
+{
+	const mp_sint32 c = heap[pos];
+	while (pos)
+	{
+		const mp_uint32 parent = (pos - 1) >> 1;
+		if (!isQuieter(c, heap[parent]))
+			break;
+		heapSet(pos, heap[parent]);
+		pos = parent;
+	}
+	heapSet(pos, c);
+}
+
+void VirtualChannelPool::siftDown(mp_uint32 pos)
+{
+	const mp_sint32 c = heap[pos];
+	for (;;)
+	{
+		mp_uint32 child = pos*2 + 1;
+		if (child >= heapSize)
+			break;
+		if (child + 1 < heapSize && isQuieter(heap[child + 1], heap[child]))
+			child++;
+		if (!isQuieter(heap[child], c))
+			break;
+		heapSet(pos, heap[child]);
+		pos = child;
+	}
+	heapSet(pos, c);
+}
+
+void VirtualChannelPool::addBackground(mp_sint32 c, mp_sint32 owner, mp_sint32 volume)
+{
+	if (isBackground(c))
+		removeBackground(c);
+	
+	TChannel& channel = channels[c];
+	channel.owner = owner;
+	channel.volume = volume;
+	
+	channel.prev = -1;
+	channel.next = ownerLists[owner];
+	if (channel.next >= 0)
+		channels[channel.next].prev = c;
+	ownerLists[owner] = c;
+	
+	heapSet(heapSize, c);
+	siftUp(heapSize++);
+}
+
+void VirtualChannelPool::removeBackground(mp_sint32 c)
+{
+	TChannel& channel = channels[c];
+	if (channel.owner < 0)
+		return;
+	
+	if (channel.prev >= 0)
+		channels[channel.prev].next = channel.next;
+	else
+		ownerLists[channel.owner] = channel.next;
+	if (channel.next >= 0)
+		channels[channel.next].prev = channel.prev;
+	
+	channel.prev = channel.next = -1;
+	channel.owner = -1;
+	
+	const mp_uint32 pos = channel.heapPos;
+	channel.heapPos = -1;
+	// the last one takes its place and moves to wherever it belongs
+	if (pos != --heapSize)
+	{
+		const mp_sint32 moved = heap[heapSize];
+		heapSet(pos, moved);
+		siftUp(pos);
+		siftDown(channels[moved].heapPos);
+	}
+}
+
+void VirtualChannelPool::setVolume(mp_sint32 c, mp_sint32 volume)
+{
+	TChannel& channel = channels[c];
+	if (channel.owner < 0 || channel.volume == volume)
+		return;
+	
+	const bool quieter = volume < channel.volume;
+	channel.volume = volume;
+	if (quieter)
+		siftUp(channel.heapPos);
+	else
+		siftDown(channel.heapPos);
+}
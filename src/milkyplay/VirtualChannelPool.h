@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  VirtualChannelPool.h
+ *  MilkyPlay
+ *
+ *	Book keeping for the virtual channels of the IT player, so a note
+ *	trigger doesn't have to look at every virtual channel:
+ *	Free channels are kept in a bitmap, the lowest free one is found
+ *	a word at a time. Background channels (the ones left playing by
+ *	a new note action) are linked into a list per module channel they
+ *	were played on and kept in a min-heap ordered by their resulting
+ *	volume, the quietest one is stolen when no channel is free. Equally
+ *	loud channels are ordered by index, so the choice is the same as
+ *	when looking at every channel in turn.
+ *	Channels are only referred to by index.
+ *
+ */
+
+#ifndef __VIRTUALCHANNELPOOL_H__
+#define __VIRTUALCHANNELPOOL_H__
+
+#include "MilkyPlayTypes.h"
+
+class VirtualChannelPool
+{
+private:
+	struct TChannel
+	{
+		// owner's background list, -1 terminates
+		mp_sint32 prev, next;
+		// -1 if not in the background
+		mp_sint32 owner;
+		mp_sint32 heapPos;
+		mp_sint32 volume;
+	};
+
+	mp_uint32	numChannels;
+	mp_uint32	numOwners;
+	
+	TChannel*	channels;
+	mp_uint32*	freeMap;
+	mp_uint32	freeMapSize;
+	mp_sint32*	ownerLists;
+	mp_sint32*	heap;
+	mp_uint32	heapSize;
+	
+	bool		isQuieter(mp_sint32 a, mp_sint32 b) const
+	{
+		return channels[a].volume < channels[b].volume || 
+			   (channels[a].volume == channels[b].volume && a < b);
+	}
+	
+	void		heapSet(mp_uint32 pos, mp_sint32 c)
+	{
+		heap[pos] = c;
+		channels[c].heapPos = pos;
+	}
+	
+	void		siftUp(mp_uint32 pos);
+	void		siftDown(mp_uint32 pos);
+	
+public:
+	VirtualChannelPool(mp_uint32 numChannels, mp_uint32 numOwners);
+	~VirtualChannelPool();
+	
+	// every channel is free, nothing is in the background
+	void		reset();
+	
+	mp_uint32	getNumChannels() const { return numChannels; }
+	
+	// lowest free channel, -1 if there is none
+	mp_sint32	getFree() const;
+	void		setFree(mp_sint32 c, bool free)
+	{
+		if (free)
+			freeMap[c >> 5] |= 1U << (c & 31);
+		else
+			freeMap[c >> 5] &= ~(1U << (c & 31));
+	}
+	bool		isFree(mp_sint32 c) const { return ((freeMap[c >> 5] >> (c & 31)) & 1) != 0; }
+	
+	void		addBackground(mp_sint32 c, mp_sint32 owner, mp_sint32 volume);
+	void		removeBackground(mp_sint32 c);
+	bool		isBackground(mp_sint32 c) const { return channels[c].owner >= 0; }
+	void		setVolume(mp_sint32 c, mp_sint32 volume);
+	
+	// quietest background channel, -1 if there is none
+	mp_sint32	getQuietest() const { return heapSize ? heap[0] : -1; }
+	
+	// background channels of one owner, fetch the next one before 
+	// removing the current one, -1 ends the list
+	mp_sint32	getFirstBackground(mp_sint32 owner) const { return ownerLists[owner]; }
+	mp_sint32	getNextBackground(mp_sint32 c) const { return channels[c].next; }
+};
+
+#endif
@@ -101,14 +101,35 @@ mp_dword XMFileBase::readDword()
 
 void XMFileBase::readWords(mp_uword* buffer,mp_sint32 count)
 {
-	for (mp_sint32 i = 0; i < count; i++)
-		*buffer++ = readWord();
+	// read everything in one go and convert in place
+	mp_sint32 bytesRead = read(buffer, 2, count);
+	mp_sint32 wordsRead = bytesRead > 0 ? (bytesRead >> 1) : 0;
+	
+	const mp_ubyte* src = (const mp_ubyte*)buffer;
+	mp_sint32 i;
+	for (i = 0; i < wordsRead; i++, src+=2)
+		buffer[i] = (mp_uword)((mp_uword)src[0]+((mp_uword)src[1]<<8));
+	
+	for (; i < count; i++)
+		buffer[i] = 0;
 }
 
 void XMFileBase::readDwords(mp_dword* buffer,mp_sint32 count)
 {
-	for (mp_sint32 i = 0; i < count; i++)
-		*buffer++ = readDword();
+	// read everything in one go and convert in place
+	mp_sint32 bytesRead = read(buffer, 4, count);
+	mp_sint32 dwordsRead = bytesRead > 0 ? (bytesRead >> 2) : 0;
+	
+	const mp_ubyte* src = (const mp_ubyte*)buffer;
+	mp_sint32 i;
+	for (i = 0; i < dwordsRead; i++, src+=4)
+		buffer[i] = (mp_dword)((mp_uint32)src[0]+
+							   ((mp_uint32)src[1]<<8)+
+							   ((mp_uint32)src[2]<<16)+
+							   ((mp_uint32)src[3]<<24));
+	
+	for (; i < count; i++)
+		buffer[i] = 0;
 }
 
 void XMFileBase::writeByte(mp_ubyte b)
@@ -160,7 +181,191 @@ void XMFileBase::writeString(const char* string)
 	write(string, 1, static_cast<mp_uint32> (strlen(string)));
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Memory files															//
+//////////////////////////////////////////////////////////////////////////
+XMFileMemory::XMFileMemory(const void* buffer, mp_uint32 size, const SYSCHAR* fileName/* = NULL*/) :
+	XMFileBase(),
+	fileName(fileName),
+	fileNameASCII(NULL),
+	buffer((const mp_ubyte*)buffer),
+	bufferSize(size),
+	position(0)
+{
+}
+
+XMFileMemory::~XMFileMemory()
+{
+	if (fileNameASCII)
+		delete[] fileNameASCII;
+}
+
+void XMFileMemory::setBuffer(const void* buffer, mp_uint32 size)
+{
+	this->buffer = (const mp_ubyte*)buffer;
+	bufferSize = size;
+	position = 0;
+}
+
+mp_sint32 XMFileMemory::read(void* ptr,mp_sint32 size,mp_sint32 count)
+{
+	if (size <= 0 || count <= 0 || position >= bufferSize)
+		return 0;
+	
+	// like fread only complete items are read
+	mp_uint32 items = (bufferSize - position) / size;
+	if (items > (mp_uint32)count)
+		items = count;
+	
+	mp_uint32 numBytes = items*size;
+	memcpy(ptr, buffer + position, numBytes);
+	position+=numBytes;
+	
+	return (mp_sint32)numBytes;
+}
+
+mp_sint32 XMFileMemory::write(const void* ptr,mp_sint32 size,mp_sint32 count)
+{
+	return -1;
+}
+
+void XMFileMemory::seek(mp_uint32 pos, SeekOffsetTypes seekOffsetType/* = SeekOffsetTypeStart*/)
+{
+	mp_int64 newPos = pos;
+	
+	if (seekOffsetType == XMFileBase::SeekOffsetTypeCurrent)
+		newPos = (mp_int64)position + (mp_sint32)pos;
+	else if (seekOffsetType == XMFileBase::SeekOffsetTypeEnd)
+		newPos = (mp_int64)bufferSize + (mp_sint32)pos;
+	
+	// seeking behind the end is allowed, reading from there is not
+	if (newPos < 0)
+		newPos = 0;
+	else if (newPos > 0xFFFFFFFF)
+		newPos = 0xFFFFFFFF;
+	
+	position = (mp_uint32)newPos;
+}
+
+const mp_ubyte* XMFileMemory::readInPlace(mp_uint32& numBytes)
+{
+	if (buffer == NULL)
+		return NULL;
+
+	mp_uint32 pos = position < bufferSize ? position : bufferSize;
+	
+	if (numBytes > bufferSize - pos)
+		numBytes = bufferSize - pos;
+	
+	position = pos + numBytes;
+	return buffer + pos;
+}
+
+const char* XMFileMemory::getFileNameASCII()
+{
+	if (fileNameASCII)
+		return fileNameASCII;
+
+	const SYSCHAR* ptr = fileName;
+	mp_uint32 len = 0;
+	
+	// strip path
+	for (const SYSCHAR* src = fileName; src && *src; src++)
+	{
+		if (*src == '/' || *src == '\\')
+			ptr = src + 1;
+	}
+	
+	while (ptr && ptr[len])
+		len++;
+	
+	fileNameASCII = new char[len+1];
+	
+	for (mp_uint32 i = 0; i < len; i++)
+		fileNameASCII[i] = (char)ptr[i];
+	fileNameASCII[len] = 0;
+	
+	return fileNameASCII;
+}
+
+XMFileBuffer::XMFileBuffer(const SYSCHAR* fileName/* = NULL*/) :
+	XMFileMemory(NULL, 0, fileName),
+	data(NULL),
+	capacity(0)
+{
+}
+
+XMFileBuffer::~XMFileBuffer()
+{
+	delete[] data;
+}
+
+mp_sint32 XMFileBuffer::write(const void* ptr,mp_sint32 size,mp_sint32 count)
+{
+	if (size <= 0 || count <= 0)
+		return 0;
+
+	mp_int64 numBytes = (mp_int64)size*count;
+	mp_int64 end = (mp_int64)position + numBytes;
+	if (end > 0xFFFFFFFF)
+		return -1;
+	
+	if ((mp_uint32)end > capacity)
+	{
+		// grow geometrically to keep streaming writes linear
+		mp_int64 newCapacity = capacity ? (mp_int64)capacity*2 : 65536;
+		while (newCapacity < end)
+			newCapacity*=2;
+		if (newCapacity > 0xFFFFFFFF)
+			newCapacity = 0xFFFFFFFF;
+		
+		mp_ubyte* newData = new mp_ubyte[(mp_uint32)newCapacity];
+		if (bufferSize)
+			memcpy(newData, data, bufferSize);
+		delete[] data;
+		
+		data = newData;
+		capacity = (mp_uint32)newCapacity;
+	}
+	
+	// seeking behind the end leaves a gap of zeros
+	if (position > bufferSize)
+		memset(data + bufferSize, 0, position - bufferSize);
+	
+	memcpy(data + position, ptr, (mp_uint32)numBytes);
+	position = (mp_uint32)end;
+	
+	if (position > bufferSize)
+		bufferSize = position;
+	
+	buffer = data;
+	return (mp_sint32)numBytes;
+}
+
+bool XMFileBuffer::truncate(mp_uint32 size)
+{
+	if (size < bufferSize)
+		bufferSize = size;
+	position = bufferSize;
+	return true;
+}
+
+void XMFileMapped::loadIntoHeap(const SYSCHAR* fileName)
+{
+	XMFile f(fileName);
+	if (!f.isOpen())
+		return;
+		
+	mp_uint32 size = f.size();
+	
+	heapBuffer = new mp_ubyte[size ? size : 1];
+	size = f.read(heapBuffer, 1, size) > 0 ? size : 0;
+	
+	setBuffer(heapBuffer, size);
+}
+
 #define BUFFERSIZE 16384
+#define MINMAPSIZE (1024*1024)
 
 //////////////////////////////////////////////////////////////////////////
 // WIN32 implentation													//
@@ -352,6 +557,59 @@ const char* XMFile::getFileNameASCII()
 	return fileNameASCII;
 }
 
+XMFileMapped::XMFileMapped(const SYSCHAR* fileName) :
+	XMFileMemory(NULL, 0, fileName),
+	heapBuffer(NULL),
+	mappedView(NULL),
+	mappedSize(0)
+{
+	HANDLE handle = CreateFile(fileName,
+							   GENERIC_READ,
+							   FILE_SHARE_READ,
+							   NULL,
+							   OPEN_EXISTING, 
+							   FILE_ATTRIBUTE_NORMAL, 
+							   NULL);
+							   
+	if (handle == INVALID_HANDLE_VALUE)
+		return;
+	
+	DWORD sizeHigh = 0;
+	DWORD sizeLow = GetFileSize(handle, &sizeHigh);
+	
+	// small files are cheaper to read than to map
+	if (sizeLow != INVALID_FILE_SIZE && sizeHigh == 0 && sizeLow >= MINMAPSIZE)
+	{
+		HANDLE mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+		{
+			mappedView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// the view keeps a reference to the mapping object
+			CloseHandle(mapping);
+		}
+		
+		if (mappedView)
+		{
+			mappedSize = sizeLow;
+			setBuffer(mappedView, mappedSize);
+		}
+	}
+	
+	CloseHandle(handle);
+	
+	if (mappedView == NULL)
+		loadIntoHeap(fileName);
+}
+
+XMFileMapped::~XMFileMapped()
+{
+	if (mappedView)
+		UnmapViewOfFile(mappedView);
+		
+	if (heapBuffer)
+		delete[] heapBuffer;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // C compatible implentation											//
 //////////////////////////////////////////////////////////////////////////
@@ -359,6 +617,13 @@ const char* XMFile::getFileNameASCII()
 
 #include <unistd.h>
 
+#if defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+#define HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 XMFile::XMFile(const SYSCHAR*	fileName, bool writeAccess /* = false*/) :
 	XMFileBase(),
 	fileName(fileName),
@@ -513,4 +778,51 @@ const char* XMFile::getFileNameASCII()
 	return fileNameASCII;
 }
 
+XMFileMapped::XMFileMapped(const SYSCHAR* fileName) :
+	XMFileMemory(NULL, 0, fileName),
+	heapBuffer(NULL),
+	mappedView(NULL),
+	mappedSize(0)
+{
+#ifdef HAVE_MMAP
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return;
+	
+	struct stat st;
+	// small files are cheaper to read than to map
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && 
+		st.st_size >= MINMAPSIZE && (mp_int64)st.st_size <= 0xFFFFFFFF)
+	{
+		void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view != MAP_FAILED)
+		{
+#ifdef MADV_SEQUENTIAL
+			madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+			mappedView = view;
+			mappedSize = (mp_uint32)st.st_size;
+			setBuffer(mappedView, mappedSize);
+		}
+	}
+	
+	// the mapping stays valid after closing the descriptor
+	close(fd);
+#endif
+
+	if (mappedView == NULL)
+		loadIntoHeap(fileName);
+}
+
+XMFileMapped::~XMFileMapped()
+{
+#ifdef HAVE_MMAP
+	if (mappedView)
+		munmap(mappedView, mappedSize);
+#endif
+		
+	if (heapBuffer)
+		delete[] heapBuffer;
+}
+
 #endif
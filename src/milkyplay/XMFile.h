@@ -70,6 +70,19 @@ public:
 	virtual	bool			isOpen() = 0;
 	virtual	bool			isOpenForWriting()  = 0;
 
+	// Bulk read fast path for files residing in memory:
+	// Returns a pointer to the next numBytes bytes and advances the position,
+	// numBytes is clipped to the number of bytes left in the file.
+	// Returns NULL if the file can't be accessed directly, use read() then
+	virtual const mp_ubyte*	readInPlace(mp_uint32& numBytes) { return NULL; }
+
+	// Cut the file off after size bytes and continue writing there,
+	// returns false if the file can't be truncated
+	virtual bool			truncate(mp_uint32 size) { return false; }
+	
+	// True if getFileName() names a file on disk holding the same data
+	virtual bool			isBackedByFile() { return false; }
+
 	mp_ubyte				readByte();
 	mp_uword				readWord();
 	mp_dword				readDword();
@@ -126,8 +139,85 @@ public:
 	virtual bool			isOpen();
 	virtual bool			isOpenForWriting() { return isOpen() && writeAccess; }
 	
+	virtual bool			isBackedByFile() { return true; }
+	
 	static bool				exists(const SYSCHAR* file);
 	static bool				remove(const SYSCHAR* file);
 };
 
+// Read-only file on top of a memory block, the memory is not copied
+class XMFileMemory : public XMFileBase
+{
+private:
+	const SYSCHAR*	fileName;
+	
+	char*			fileNameASCII;
+
+protected:
+	const mp_ubyte*	buffer;
+	mp_uint32		bufferSize;
+	mp_uint32		position;
+	
+	void			setBuffer(const void* buffer, mp_uint32 size);
+	
+public:
+							XMFileMemory(const void* buffer, mp_uint32 size, const SYSCHAR* fileName = NULL);
+	virtual					~XMFileMemory();
+	
+	virtual mp_sint32		read(void* ptr,mp_sint32 size,mp_sint32 count);
+	virtual mp_sint32		write(const void* ptr,mp_sint32 size,mp_sint32 count);
+	
+	virtual void			seek(mp_uint32 pos, SeekOffsetTypes seekOffsetType = SeekOffsetTypeStart);
+	virtual mp_uint32		pos() { return position; }
+	virtual mp_uint32		size() { return bufferSize; }
+	
+	virtual const SYSCHAR*  getFileName() { return fileName; }
+	
+	virtual const char*		getFileNameASCII();
+	
+	virtual bool			isOpen() { return buffer != NULL; }
+	virtual bool			isOpenForWriting() { return false; }
+
+	virtual const mp_ubyte*	readInPlace(mp_uint32& numBytes);
+};
+
+// Growable file in memory, everything written can be read back
+class XMFileBuffer : public XMFileMemory
+{
+private:
+	mp_ubyte*		data;
+	mp_uint32		capacity;
+	
+public:
+							XMFileBuffer(const SYSCHAR* fileName = NULL);
+	virtual					~XMFileBuffer();
+	
+	virtual mp_sint32		write(const void* ptr,mp_sint32 size,mp_sint32 count);
+	
+	virtual bool			isOpen() { return true; }
+	virtual bool			isOpenForWriting() { return true; }
+	
+	virtual bool			truncate(mp_uint32 size);
+	
+	const mp_ubyte*			getBuffer() const { return data; }
+};
+
+// Read-only file which is mapped into memory as a whole,
+// falls back to reading the file into a heap buffer where mapping is not available
+class XMFileMapped : public XMFileMemory
+{
+private:
+	mp_ubyte*		heapBuffer;
+	void*			mappedView;
+	mp_uint32		mappedSize;
+	
+	void			loadIntoHeap(const SYSCHAR* fileName);
+	
+public:
+							XMFileMapped(const SYSCHAR* fileName);
+	virtual					~XMFileMapped();
+	
+	virtual bool			isBackedByFile() { return true; }
+};
+
 #endif
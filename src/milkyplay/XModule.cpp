@@ -1483,71 +1483,89 @@ bool XModule::loadSample(XMFileBase& f,void* buffer,mp_uint32 size,mp_uint32 len
 		
 		return true;
 	}
-	else
+	
+	const mp_uint32 numBytes = (flags & ST_16BIT) ? length*2 : length;
+	
+	// Files residing in memory are decoded straight from the source,
+	// PTM delta storing works on the raw bytes and needs a copy though
+	mp_uint32 bytesAvailable = numBytes;
+	const mp_ubyte* srcPtr = (flags & ST_DELTA_PTM) ? NULL : f.readInPlace(bytesAvailable);
+	
+	if (srcPtr == NULL || bytesAvailable < numBytes)
 	{
 		memset(buffer, 0, size);
-		f.read(buffer,flags & ST_16BIT ? 2 : 1, length);
+		if (srcPtr)
+			memcpy(buffer, srcPtr, bytesAvailable);
+		else
+			f.read(buffer,flags & ST_16BIT ? 2 : 1, length);
+		srcPtr = (const mp_ubyte*)buffer;
+	}
+	else if (size > numBytes)
+	{
+		memset((mp_ubyte*)buffer + numBytes, 0, size - numBytes);
 	}
 
 	// 16 bit sample 
 	if (flags & ST_16BIT)
 	{
 		mp_sword* dstPtr = (mp_sword*)buffer;
-		mp_ubyte* srcPtr = (mp_ubyte*)buffer;
 
-		// PTM delta storing
+		// PTM delta storing (source is the destination buffer here)
 		if (flags & ST_DELTA_PTM)
 		{
+			mp_ubyte* ptr = (mp_ubyte*)buffer;
 			mp_sbyte b1=0;
 			for (mp_uint32 i = 0; i < length*2; i++) 
-				srcPtr[i] = b1+=srcPtr[i];
+				ptr[i] = b1+=ptr[i];
 		}
 
 		mp_uint32 i;
-		if (flags & ST_BIGENDIAN)
+		if (!(flags & (ST_BIGENDIAN | ST_DELTA | ST_UNSIGNED)))
 		{
-			for (i = 0; i < length; i++)
-				dstPtr[i] = BigEndian::GET_WORD(srcPtr+i*2);
+			for (i = 0; i < length; i++, srcPtr+=2)
+				dstPtr[i] = (mp_sword)((mp_uword)srcPtr[0] | ((mp_uword)srcPtr[1] << 8));
 		}
 		else
 		{
-			for (i = 0; i < length; i++)
-				dstPtr[i] = LittleEndian::GET_WORD(srcPtr+i*2);
-		}
-		
-		// delta-storing
-		if (flags & ST_DELTA)
-		{
+			// endianness, delta-storing and unsigned sample data in one pass
+			const mp_sint32 hi = (flags & ST_BIGENDIAN) ? 0 : 1;
+			const bool delta = (flags & ST_DELTA) != 0;
+			const mp_sword xorMask = (flags & ST_UNSIGNED) ? 32767 : 0;
+			
 			mp_sword b1=0;
-			for (i = 0; i < length; i++) 
-				dstPtr[i] = b1+=dstPtr[i];
-		}
-
-		// unsigned sample data
-		if (flags & ST_UNSIGNED)
-		{
-			for (i = 0; i < length; i++) 
-				dstPtr[i] = (dstPtr[i]^32767);
+			for (i = 0; i < length; i++, srcPtr+=2)
+			{
+				mp_sword smp = (mp_sword)((mp_uword)srcPtr[hi^1] | ((mp_uword)srcPtr[hi] << 8));
+				if (delta)
+					smp = b1+=smp;
+				dstPtr[i] = smp^xorMask;
+			}
 		}
 	}
 	// 8 bit sample
 	else
 	{	
-		mp_sbyte* smpPtr = (mp_sbyte*)buffer;
+		mp_sbyte* dstPtr = (mp_sbyte*)buffer;
 	
-		// delta-storing
-		if (flags & ST_DELTA)
+		if (!(flags & (ST_DELTA | ST_UNSIGNED)))
 		{
-			mp_sbyte b1=0;
-			for (mp_uint32 i = 0; i < length; i++) 
-				smpPtr[i] = b1+=smpPtr[i];
+			if ((void*)srcPtr != buffer)
+				memcpy(dstPtr, srcPtr, length);
 		}
-
-		// unsigned sample data
-		if (flags & ST_UNSIGNED)
+		else
 		{
-			for (mp_uint32 i = 0; i < length; i++) 
-				smpPtr[i] ^= 127;
+			// delta-storing and unsigned sample data in one pass
+			const bool delta = (flags & ST_DELTA) != 0;
+			const mp_sbyte xorMask = (flags & ST_UNSIGNED) ? 127 : 0;
+			
+			mp_sbyte b1=0;
+			for (mp_uint32 i = 0; i < length; i++)
+			{
+				mp_sbyte smp = (mp_sbyte)srcPtr[i];
+				if (delta)
+					smp = b1+=smp;
+				dstPtr[i] = smp^xorMask;
+			}
 		}
 	}
 
@@ -1958,7 +1976,7 @@ const char* XModule::identifyModule(const mp_ubyte* buffer)
 
 mp_sint32 XModule::loadModule(const SYSCHAR* fileName, bool scanForSubSongs/* = false*/)
 {
-	XMFile f(fileName);
+	XMFileMapped f(fileName);
 	return f.isOpen() ? loadModule(f, scanForSubSongs) : -8; 
 }
 
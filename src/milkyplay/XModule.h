@@ -227,6 +227,12 @@ public:
 		return loopBufferProps->samplesize;
 	}
 
+	static void setSampleSizeInBytes(mp_ubyte* mem, mp_uint32 size)
+	{
+		TLoopDoubleBuffProps* loopBufferProps = (TLoopDoubleBuffProps*)getPadStartAddr(mem);
+		loopBufferProps->samplesize = size;
+	}
+
 	static mp_uint32 getSampleSizeInSamples(mp_ubyte* mem)
 	{
 		TLoopDoubleBuffProps* loopBufferProps = (TLoopDoubleBuffProps*)getPadStartAddr(mem);
@@ -638,6 +644,7 @@ public:
 	// Module exporters								 //
 	///////////////////////////////////////////////////
 	mp_sint32		saveExtendedModule(const SYSCHAR* fileName);		// FT2 (.XM)
+	mp_sint32		saveExtendedModule(XMFileBase& f);				// FT2 (.XM)
 	mp_sint32		saveProtrackerModule(const SYSCHAR* fileName);   // Protracker compatible (.MOD)
 
 	///////////////////////////////////////////////////
@@ -56,6 +56,7 @@ void AudioDriver_ALSA::async_direct_callback(snd_async_handler_t *ahandler)
 	while (1) {
 		state = snd_pcm_state(handle);
 		if (state == SND_PCM_STATE_XRUN) {
+			audioDriver->countXRun();
 			err = snd_pcm_recover(handle, -EPIPE, 0);
 			if (err < 0) {
 				fprintf(stderr, "ALSA: XRUN recovery failed: %s\n", snd_strerror(err));
@@ -69,6 +70,8 @@ void AudioDriver_ALSA::async_direct_callback(snd_async_handler_t *ahandler)
 		}
 		avail = snd_pcm_avail_update(handle);
 		if (avail < 0) {
+			if (avail == -EPIPE)
+				audioDriver->countXRun();
 			err = snd_pcm_recover(handle, avail, 0);
 			if (err < 0) {
 				fprintf(stderr, "ALSA: avail update failed: %s\n", snd_strerror(err));
@@ -180,6 +183,7 @@ mp_sint32 AudioDriver_ALSA::stop()
 {
 	snd_pcm_drop(pcm);
 	deviceHasStarted = false;
+	stopRenderAhead();
 	return 0;
 }
 
@@ -189,6 +193,7 @@ mp_sint32 AudioDriver_ALSA::closeDevice()
 	delete[] stream;
 	stream = NULL;
 	deviceHasStarted = false;
+	stopRenderAhead();
 	return 0;
 }
 
@@ -198,6 +203,7 @@ mp_sint32 AudioDriver_ALSA::start()
 	snd_pcm_uframes_t offset, frames, size;
 	snd_async_handler_t *ahandler;
 	int err;
+	startRenderAhead();
 	err = snd_async_add_pcm_handler(&ahandler, pcm, async_direct_callback, this);
 	if (err < 0) {
 		fprintf(stderr, "ALSA: Unable to register async handler (%s)\n", snd_strerror(err));
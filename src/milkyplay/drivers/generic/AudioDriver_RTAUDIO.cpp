@@ -140,3 +140,13 @@ void		AudioDriver_RTAUDIO::setIdle(bool idle)
 {
 	impl->setIdle(idle);
 }
+
+void		AudioDriver_RTAUDIO::setNumBuffersAhead(mp_uint32 num)
+{
+	impl->setNumBuffersAhead(num);
+}
+
+mp_uint32	AudioDriver_RTAUDIO::getNumBuffersAhead() const
+{
+	return impl->getNumBuffersAhead();
+}
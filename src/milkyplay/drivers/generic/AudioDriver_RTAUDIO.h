@@ -80,6 +80,8 @@ public:
 	virtual		void		msleep(mp_uint32 msecs);
 	virtual		bool		isMixerActive();
 	virtual		void		setIdle(bool idle);
+	virtual		void		setNumBuffersAhead(mp_uint32 num);
+	virtual		mp_uint32	getNumBuffersAhead() const;
 	
 	void createRt4Instance(Api audioApi = UNSPECIFIED);
 	void createRt3Instance(Api audioApi = UNSPECIFIED);
@@ -188,6 +188,7 @@ public:
             {
                 audio->stopStream();
                 deviceHasStarted = false;
+                stopRenderAhead();
                 return MP_OK;
             }
             catch (RtAudioError &error)
@@ -208,6 +209,7 @@ public:
             {
                 audio->closeStream();
                 deviceHasStarted = false;
+                stopRenderAhead();
                 return MP_OK;
             }
             catch (RtAudioError &error)
@@ -226,6 +228,7 @@ public:
         {
             try
             {
+                startRenderAhead();
                 audio->startStream();
                 deviceHasStarted = true;
                 return MP_OK;
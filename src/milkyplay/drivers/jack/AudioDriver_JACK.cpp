@@ -63,17 +63,24 @@ int AudioDriver_JACK::jackProcess(jack_nframes_t nframes, void *arg)
 	leftBuffer = (jack_default_audio_sample_t*) audioDriver->jack_port_get_buffer(audioDriver->leftPort, nframes);
 	rightBuffer = (jack_default_audio_sample_t*) audioDriver->jack_port_get_buffer(audioDriver->rightPort, nframes);
 
-	audioDriver->fillAudioWithCompensation((char*)audioDriver->rawStream, nframes * 4);
+	audioDriver->fillAudioWithCompensation(audioDriver->rawStream, nframes);
 
-	// JACK uses non-interleaved floating-point samples, we need to convert
+	// JACK uses non-interleaved floating-point samples, we need to deinterleave
 	for(int out = 0, in = 0; in < nframes; in++)
 	{
-		leftBuffer[in] = audioDriver->rawStream[out++] * (1.0/32768.0);
-		rightBuffer[in] = audioDriver->rawStream[out++] * (1.0/32768.0);
+		leftBuffer[in] = audioDriver->rawStream[out++];
+		rightBuffer[in] = audioDriver->rawStream[out++];
 	}
 	return 0;
 }
 
+int AudioDriver_JACK::jackXRun(void *arg)
+{
+	AudioDriver_JACK* audioDriver = (AudioDriver_JACK*)arg;
+	audioDriver->countXRun();
+	return 0;
+}
+
 AudioDriver_JACK::AudioDriver_JACK() :
 	AudioDriver_COMPENSATE(),
 	paused(false),
@@ -129,6 +136,9 @@ mp_sint32 AudioDriver_JACK::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mi
 		fprintf(stderr, "JACK: An error occured whilst loading symbols, aborting.\n");
 		return -1;
 	}
+	// only used for counting xruns, not having it is fine
+	jack_set_xrun_callback = (int (*)(jack_client_t*, int (*)(void*), void*))
+		dlsym(libJack, "jack_set_xrun_callback");
 
 	mp_sint32 res = AudioDriverBase::initDevice(bufferSizeInWords, mixFrequency, mixer);
 	if (res < 0)
@@ -152,6 +162,8 @@ mp_sint32 AudioDriver_JACK::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mi
 	
 	// Set callback
 	jack_set_process_callback(hJack, jackProcess, (void *) this);
+	if (jack_set_xrun_callback)
+		jack_set_xrun_callback(hJack, jackXRun, (void *) this);
 
 	// Get buffer-size
 	jackFrames = jack_get_buffer_size(hJack);
@@ -160,7 +172,7 @@ mp_sint32 AudioDriver_JACK::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mi
 	printf("JACK: Mixer frequency: %i\n", this->mixFrequency);
 	//delete[] rawStream; // pailes: make sure this isn't allocated yet
 	assert(!rawStream);		// If it is allocated, something went wrong and we need to know about it
-	rawStream = new mp_sword[bufferSize];
+	rawStream = new float[bufferSize];
 	printf("JACK: Latency = %i frames\n", jackFrames);
 	return bufferSize;
 }
@@ -169,6 +181,7 @@ mp_sint32 AudioDriver_JACK::stop()
 {
 	jack_deactivate(hJack);
 	deviceHasStarted = false;
+	stopRenderAhead();
 	return 0;
 }
 
@@ -176,6 +189,7 @@ mp_sint32 AudioDriver_JACK::closeDevice()
 {
 	deviceHasStarted = false;
 	jack_client_close(hJack);
+	stopRenderAhead();
 	if(rawStream) delete[] rawStream;
 	rawStream = NULL;
 	dlclose(libJack);
@@ -191,6 +205,7 @@ mp_sint32 AudioDriver_JACK::start()
 		dlsym(libJack, "jack_connect");
 	jack_port_name = (const char* (*)(const jack_port_t *))
 		dlsym(libJack, "jack_port_name");
+	startRenderAhead(true);
 	jack_activate(hJack);
 	deviceHasStarted = true;
 	return 0;
@@ -46,12 +46,13 @@ class AudioDriver_JACK : public AudioDriver_COMPENSATE
 private:
 	jack_client_t *hJack;
 	jack_port_t *leftPort, *rightPort;
-	mp_sword *rawStream;
+	float *rawStream;
 	int jackFrames;
 	bool paused;
 	void *libJack;
 
 	static int jackProcess(jack_nframes_t nframes, void *arg);
+	static int jackXRun(void *arg);
 
 	// Jack library functions
 	jack_client_t *(*jack_client_new) (const char *client_name);
@@ -59,6 +60,9 @@ private:
 	int (*jack_set_process_callback) (jack_client_t *client,
 					JackProcessCallback process_callback,
 					void *arg);
+	int (*jack_set_xrun_callback) (jack_client_t *client,
+					JackXRunCallback xrun_callback,
+					void *arg);
 	int (*jack_activate) (jack_client_t *client);
 	int (*jack_deactivate) (jack_client_t *client);
 	jack_port_t *(*jack_port_register) (jack_client_t *client,
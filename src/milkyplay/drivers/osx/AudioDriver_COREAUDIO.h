@@ -48,7 +48,7 @@ private:
 	bool			defaultDevice;
 	char*			driverID;
 	mp_uint32		sampleCounter;
-	mp_sword*		compensateBuffer;
+	float*			compensateBuffer;
 
 	AudioDeviceID	soundDeviceID;
 	UInt32			channelsPerFrame;
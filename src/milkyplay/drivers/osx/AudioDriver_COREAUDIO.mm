@@ -88,7 +88,7 @@ OSStatus AudioDriver_COREAUDIO::OSX_AudioIOProc16Bit (AudioDeviceID inDevice,
 
 	MasterMixer* mixer = audioDriver->mixer;
 
-	SInt16*	myInBuffer = (SInt16*)audioDriver->compensateBuffer;
+	float*	myInBuffer = audioDriver->compensateBuffer;
 	UInt32	size = (outOutputData->mBuffers[0].mDataByteSize /
 					outOutputData->mBuffers[0].mNumberChannels) /
 					sizeof(float);
@@ -101,7 +101,7 @@ OSStatus AudioDriver_COREAUDIO::OSX_AudioIOProc16Bit (AudioDeviceID inDevice,
 	}
 	else
 	{
-		memset(myInBuffer, 0, size*MP_NUMCHANNELS*sizeof(mp_sword));
+		memset(myInBuffer, 0, size*MP_NUMCHANNELS*sizeof(float));
 	}
 
 	UInt32 i;
@@ -110,7 +110,7 @@ OSStatus AudioDriver_COREAUDIO::OSX_AudioIOProc16Bit (AudioDeviceID inDevice,
 	{
 		for (i = 0; i < size; i++)
 		{
-			myOutBuffer[i] = (myInBuffer[i*2]+myInBuffer[i*2+1])*(1.0f/(32768.0f*2.0f));
+			myOutBuffer[i] = (myInBuffer[i*2]+myInBuffer[i*2+1])*0.5f;
 		}
 	}
 	else
@@ -119,8 +119,8 @@ OSStatus AudioDriver_COREAUDIO::OSX_AudioIOProc16Bit (AudioDeviceID inDevice,
 
 		for (i = 0; i < size; i++)
 		{
-			myOutBuffer[i*channelsPerFrame] = (myInBuffer[i*2])*(1.0f/32768.0f);
-			myOutBuffer[i*channelsPerFrame+1] = (myInBuffer[i*2+1])*(1.0f/32768.0f);
+			myOutBuffer[i*channelsPerFrame] = myInBuffer[i*2];
+			myOutBuffer[i*channelsPerFrame+1] = myInBuffer[i*2+1];
 		}
 	}
 
@@ -378,7 +378,7 @@ mp_sint32 AudioDriver_COREAUDIO::initDevice(mp_sint32 bufferSizeInWords, mp_uint
 	{
 		delete[] compensateBuffer;
 	}
-	compensateBuffer = new mp_sword[bufferSizeInWords];
+	compensateBuffer = new float[bufferSizeInWords];
 
 	NSLog(@"Core Audio: Wanted %d bytes, got %d\n", bufferSizeInWords / 2 * 4, myBufferFrameSize * 4);
 
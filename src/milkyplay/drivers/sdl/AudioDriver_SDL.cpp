@@ -45,6 +45,14 @@ void SDLCALL AudioDriver_SDL::fill_audio(void *udata, Uint8 *stream, int length)
 {
 	AudioDriver_SDL* audioDriver = (AudioDriver_SDL*)udata;
 
+	// SDL doesn't report underruns, a callback coming more than half
+	// a period late has most likely left the device without data
+	const Uint64 now = SDL_GetPerformanceCounter();
+	if (audioDriver->lastCallbackTime &&
+		(now - audioDriver->lastCallbackTime) * audioDriver->mixFrequency * 2 > SDL_GetPerformanceFrequency() * audioDriver->periodSize * 3)
+		audioDriver->countXRun();
+	audioDriver->lastCallbackTime = now;
+
 	if(length>>2 != audioDriver->periodSize)
 	{
 		fprintf(stderr, "SDL: Invalid buffer size: %i (should be %i), skipping..\n", length >> 2, audioDriver->periodSize);
@@ -57,7 +65,9 @@ void SDLCALL AudioDriver_SDL::fill_audio(void *udata, Uint8 *stream, int length)
 }
 
 AudioDriver_SDL::AudioDriver_SDL() :
-	AudioDriver_COMPENSATE()
+	AudioDriver_COMPENSATE(),
+	periodSize(0),
+	lastCallbackTime(0)
 {
 }
 
@@ -132,6 +142,7 @@ mp_sint32 AudioDriver_SDL::stop()
 {
 	SDL_PauseAudio(1);
 	deviceHasStarted = false;
+	stopRenderAhead();
 	return MP_OK;
 }
 
@@ -139,11 +150,14 @@ mp_sint32 AudioDriver_SDL::closeDevice()
 {
 	SDL_CloseAudio();
 	deviceHasStarted = false;
+	stopRenderAhead();
 	return MP_OK;
 }
 
 mp_sint32 AudioDriver_SDL::start()
 {
+	lastCallbackTime = 0;
+	startRenderAhead();
 	SDL_PauseAudio(0);
 	deviceHasStarted = true;
 	return MP_OK;
@@ -157,6 +171,7 @@ mp_sint32 AudioDriver_SDL::pause()
 
 mp_sint32 AudioDriver_SDL::resume()
 {
+	lastCallbackTime = 0;
 	SDL_PauseAudio(0);
 	return MP_OK;
 }
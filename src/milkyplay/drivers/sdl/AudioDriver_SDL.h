@@ -46,6 +46,8 @@ class AudioDriver_SDL : public AudioDriver_COMPENSATE
 {
 private:
 	mp_uint32	periodSize;
+	// performance counter at the last callback, 0 after (re)starting
+	Uint64		lastCallbackTime;
 	
 	static void SDLCALL fill_audio(void *udata, Uint8 *stream, int len); 
 									 
@@ -160,6 +160,17 @@ struct PPRect
 		return true;
 	} 
 	
+	// grow to the bounding rectangle of both
+	void unite(const PPRect& rc)
+	{
+		if (rc.x1 < x1) x1 = rc.x1;
+		if (rc.y1 < y1) y1 = rc.y1;
+		if (rc.x2 > x2) x2 = rc.x2;
+		if (rc.y2 > y2) y2 = rc.y2;
+	}
+	
+	pp_int32 area() const { return width()*height(); }
+	
 };
 
 struct PPColor
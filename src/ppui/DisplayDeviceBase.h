@@ -206,6 +206,19 @@ public:
 
 	virtual void update(const PPRect& r) = 0;
 
+	// update several areas at once, devices which present the whole
+	// screen on every update should override this and present only once
+	virtual void update(const PPRect* rects, pp_int32 numRects)
+	{
+		for (pp_int32 i = 0; i < numRects; i++)
+			update(rects[i]);
+	}
+
+	// the content of r has moved down by dy pixels (up if negative) since 
+	// the last update, devices may use this to move what they've got 
+	// instead of converting it again
+	virtual void setScrollHint(const PPRect& r, pp_int32 dy) { }
+
 	virtual void setSize(const PPSize& size) { this->size = size; }
 	virtual const PPSize& getSize() const { return this->size; }
 
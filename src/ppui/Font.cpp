@@ -1579,7 +1579,8 @@ void PPFont::createLargeFromSystem(pp_uint32 index)
 }
 
 PPFont::PPFont(pp_uint8* bits, const pp_uint32 chrWidth, const pp_uint32 chrHeight, pp_uint32 fontId) :
-	charWidth(chrWidth), charHeight(chrHeight), charDim(chrHeight*chrWidth)
+	charWidth(chrWidth), charHeight(chrHeight), charDim(chrHeight*chrWidth),
+	spans(NULL), lineSpans(NULL)
 {
 	fontBits = bits;
 
@@ -1587,14 +1588,68 @@ PPFont::PPFont(pp_uint8* bits, const pp_uint32 chrWidth, const pp_uint32 chrHeig
 
 	this->fontId = fontId;
 
+	expandGlyphs();
+
 	fontInstances[numFontInstances++] = this;
 }
 
 PPFont::~PPFont()
 {
+	delete[] lineSpans;
+	delete[] spans;
 	delete bitstream;
 }
 
+void PPFont::expandGlyphs()
+{
+	delete[] lineSpans;
+	delete[] spans;
+	spans = NULL;
+
+	// glyph lines are stored back to back, line l of character c
+	// is line c*charHeight+l
+	const pp_uint32 numLines = 256*charHeight;
+	lineSpans = new pp_uint32[numLines+1];
+
+	// first pass counts the spans, second pass fills them in
+	pp_uint32 numSpans = 0;
+	for (pp_uint32 pass = 0; pass < 2; pass++)
+	{
+		numSpans = 0;
+		for (pp_uint32 line = 0; line < numLines; line++)
+		{
+			lineSpans[line] = numSpans;
+
+			const pp_uint32 offset = line*charWidth;
+			pp_uint32 i = 0;
+			while (i < charWidth)
+			{
+				if (!bitstream->read(offset+i))
+				{
+					i++;
+					continue;
+				}
+				
+				const pp_uint32 start = i;
+				while (i < charWidth && bitstream->read(offset+i))
+					i++;
+				
+				if (spans)
+				{
+					spans[numSpans].x = (pp_uint8)start;
+					spans[numSpans].length = (pp_uint8)(i - start);
+				}
+				numSpans++;
+			}
+		}
+
+		if (spans == NULL)
+			spans = new Span[numSpans ? numSpans : 1];
+	}
+
+	lineSpans[numLines] = numSpans;
+}
+
 PPFont* PPFont::getFont(pp_uint32 fontId)
 {
 	pp_uint32 i;
@@ -1770,6 +1825,8 @@ void PPFont::selectFontFace(FontID fontID, const char* faceName)
 				fontInstances[j]->fontBits = (pp_uint8*)fontEntries[i].data;
 				fontInstances[j]->bitstream->setSource(fontInstances[j]->fontBits, fontEntries[i].width*fontEntries[i].height / 8);
 			}
+			
+			fontInstances[j]->expandGlyphs();
 		}
 }
 
@@ -115,6 +115,12 @@ private:
 	static void createLargeFromSystem(pp_uint32 index);
 
 public:
+	// horizontal run of set pixels within a glyph line
+	struct Span
+	{
+		pp_uint8 x;
+		pp_uint8 length;
+	};
 
 	pp_uint8* fontBits;
 	Bitstream* bitstream;
@@ -122,6 +128,16 @@ public:
 	const pp_uint32 charWidth, charHeight;
 	const pp_uint32 charDim;
 
+private:
+	// glyphs expanded into spans, so the blitters don't have to
+	// test every single bit when drawing text
+	Span* spans;
+	// index of the first span of every glyph line, the spans of
+	// line l of character c are [lineSpans[c*charHeight+l], lineSpans[c*charHeight+l+1])
+	pp_uint32* lineSpans;
+
+	void expandGlyphs();
+
 public:
 	~PPFont();
 
@@ -132,6 +148,9 @@ public:
 
 	bool getPixelBit(pp_uint8 chr, pp_uint32 x, pp_uint32 y) const { return bitstream->read(chr*charDim+y*charWidth+x); }
 
+	const Span* getLineSpans(pp_uint8 chr, pp_uint32 line) const { return spans + lineSpans[chr*charHeight+line]; }
+	const Span* getLineSpansEnd(pp_uint8 chr, pp_uint32 line) const { return spans + lineSpans[chr*charHeight+line+1]; }
+
 	pp_uint32 getStrWidth(const char* str) const;
 	
 	enum ShrinkTypes
@@ -242,125 +242,52 @@ void PPGraphics_16BIT::blit(const pp_uint8* src, const PPPoint& p, const PPSize&
 	}
 }
 
-void PPGraphics_16BIT::drawChar(pp_uint8 chr, pp_int32 x, pp_int32 y, bool underlined)
+// fill the spans of a glyph, clipped against the clip rect
+// returns false if the glyph is completely outside of it
+static inline bool drawGlyph(pp_uint8* buffer, pp_int32 pitch, const PPFont* font, const PPRect& clipRect,
+							 pp_uint8 chr, pp_int32 x, pp_int32 y, pp_uint16 color16)
 {
-
-	if (currentFont == NULL)
-		return;
-
-
-	pp_int32 charWidth = (signed)currentFont->getCharWidth();
-	pp_int32 charHeight = (signed)currentFont->getCharHeight(); 
-	pp_int32 charDim = currentFont->charDim;
-
-	if (x + (signed)charWidth < currentClipRect.x1 ||
-		x > currentClipRect.x2 ||
-		y + (signed)charHeight < currentClipRect.y1 ||
-		y > currentClipRect.y2)
-		return;
-	
-	/*pp_uint8 r = (pp_uint8)currentColor.r;
-	pp_uint8 g = (pp_uint8)currentColor.g;
-	pp_uint8 b = (pp_uint8)currentColor.b;
-
-	if (x>= currentClipRect.x1 && x + (signed)currentFont->charWidth < currentClipRect.x2 &&
-		y>= currentClipRect.y1 && y + (signed)currentFont->charHeight < currentClipRect.y2)
+	const pp_int32 charWidth = (signed)font->getCharWidth();
+	const pp_int32 charHeight = (signed)font->getCharHeight();
+
+	if (x + charWidth < clipRect.x1 ||
+		x > clipRect.x2 ||
+		y + charHeight < clipRect.y1 ||
+		y > clipRect.y2)
+		return false;
+
+	const pp_int32 firstLine = y < clipRect.y1 ? clipRect.y1 - y : 0;
+	const pp_int32 lastLine = y + charHeight > clipRect.y2 ? clipRect.y2 - y : charHeight;
+	// clip rect in glyph coordinates
+	const pp_int32 cx1 = clipRect.x1 - x;
+	const pp_int32 cx2 = clipRect.x2 - x;
+
+	for (pp_int32 i = firstLine; i < lastLine; i++)
 	{
-		for (pp_uint32 i = 0; i < currentFont->charHeight; i++)
+		pp_uint16* line = reinterpret_cast<pp_uint16*>(buffer + (y+i)*pitch) + x;
+		const PPFont::Span* span = font->getLineSpans(chr, i);
+		const PPFont::Span* end = font->getLineSpansEnd(chr, i);
+		for (; span < end; span++)
 		{
-			pp_uint8* buff = (pp_uint8*)buffer + (y+i)*pitch + x*3;
-			for (pp_uint32 j = 0; j < currentFont->charWidth; j++)
-			{
-				
-				if (currentFont->getPixelBit(chr, j,i))
-				{
-					buff[0] = b;
-					buff[1] = g;
-					buff[2] = r;					
-				}
-				buff+=3;
-			}
+			pp_int32 x1 = span->x;
+			pp_int32 x2 = x1 + span->length;
+			if (x1 < cx1) x1 = cx1;
+			if (x2 > cx2) x2 = cx2;
+			for (pp_int32 j = x1; j < x2; j++)
+				line[j] = color16;
 		}
 	}
-	else
-	{
-		for (pp_uint32 i = 0; i < currentFont->charHeight; i++)
-			for (pp_uint32 j = 0; j < currentFont->charWidth; j++)
-			{
-				
-				if (y+(signed)i >= currentClipRect.y1 && y+(signed)i < currentClipRect.y2 &&
-					x+(signed)j >= currentClipRect.x1 && x+(signed)j < currentClipRect.x2 &&
-					currentFont->getPixelBit(chr, j,i))
-				{
-					
-					pp_uint8* buff = (pp_uint8*)buffer+((y+i)*pitch+(x+j)*3);
-					
-					buff[0] = b;
-					buff[1] = g;
-					buff[2] = r;
-					
-				}
-			}
 
-	}*/
-	Bitstream* bitstream = currentFont->bitstream;
-	pp_uint8* fontbuffer = bitstream->buffer;
-
-	pp_uint16* buff = (pp_uint16*)buffer+(pitch>>1)*y+x;	
-	
-	const pp_uint32 cchrDim = chr*charDim;
-	const pp_uint32 incr = (pitch>>1)-(charWidth);
-
-	if (x>= currentClipRect.x1 && x + charWidth < currentClipRect.x2 &&
-		y>= currentClipRect.y1 && y + charHeight < currentClipRect.y2)
-	{
-		
-		pp_uint32 yChr = cchrDim;
-		for (pp_uint32 i = 0; i < (unsigned)charHeight; i++)
-		{
-			pp_uint32 xChr = yChr;
-			for (pp_uint32 j = 0; j < (unsigned)charWidth; j++)
-			{
-				if ((fontbuffer[xChr>>3]>>(xChr&7)&1))
-				{
-					*buff = color16;
-				}
-				buff++;
-				xChr++;
-			}
-			
-			buff+=incr;
-			yChr+=charWidth;
-		}
-	}
-	else
-	{
-		pp_uint32 yChr = cchrDim;
-		for (pp_uint32 i = 0; i < (unsigned)charHeight; i++)
-		{
-			pp_uint32 xChr = yChr;
-			for (pp_uint32 j = 0; j < (unsigned)charWidth; j++)
-			{
-				
-				if (y+(signed)i >= currentClipRect.y1 && y+(signed)i < currentClipRect.y2 &&
-					x+(signed)j >= currentClipRect.x1 && x+(signed)j < currentClipRect.x2 &&
-					(fontbuffer[xChr>>3]>>(xChr&7)&1))
-				{
-					
-					pp_uint16* buff = (pp_uint16*)buffer+(pitch>>1)*(y+i)+(x+j);	
-					*buff = color16;
-				}
-				xChr++;
-
-			}
-			yChr+=charWidth;
-		}
-
-	}
+	return true;
+}
 
-	if (underlined)
-		drawHLine(x, x+charWidth, y+charHeight);
+void PPGraphics_16BIT::drawChar(pp_uint8 chr, pp_int32 x, pp_int32 y, bool underlined)
+{
+	if (currentFont == NULL)
+		return;
 
+	if (drawGlyph(buffer, pitch, currentFont, currentClipRect, chr, x, y, color16) && underlined)
+		drawHLine(x, x+currentFont->getCharWidth(), y+currentFont->getCharHeight());
 }
 
 void PPGraphics_16BIT::drawString(const char* str, pp_int32 x, pp_int32 y, bool underlined/* = false*/)
@@ -385,7 +312,8 @@ void PPGraphics_16BIT::drawString(const char* str, pp_int32 x, pp_int32 y, bool
 				x=sx-charWidth;
 				break;
 			default:
-				drawChar(*str, x, y, underlined);
+				if (drawGlyph(buffer, pitch, currentFont, currentClipRect, *str, x, y, color16) && underlined)
+					drawHLine(x, x+charWidth, y+charHeight);
 		}
         x += charWidth;
         str++;
@@ -408,7 +336,8 @@ void PPGraphics_16BIT::drawStringVertical(const char* str, pp_int32 x, pp_int32
 				setPixel(x+(charWidth>>1), y+(charHeight>>1));
 				break;
 			default:
-				drawChar(*str, x, y, underlined);
+				if (drawGlyph(buffer, pitch, currentFont, currentClipRect, *str, x, y, color16) && underlined)
+					drawHLine(x, x+charWidth, y+charHeight);
 		}
         y += charHeight;
         str++;
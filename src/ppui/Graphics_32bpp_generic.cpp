@@ -250,82 +250,56 @@ void PPGraphics_32bpp_generic::blit(const pp_uint8* src, const PPPoint& p, const
 }
 
 
-void PPGraphics_32bpp_generic::drawChar(pp_uint8 chr, pp_int32 x, pp_int32 y, bool underlined/* = false*/)
+// fill the spans of a glyph, clipped against the clip rect
+// returns false if the glyph is completely outside of it
+static inline bool drawGlyph(pp_uint8* buffer, pp_int32 pitch, const PPFont* font, const PPRect& clipRect,
+							 pp_uint8 chr, pp_int32 x, pp_int32 y, pp_uint32 rgb)
 {
-
-	if (currentFont == NULL)
-		return;
-
-	pp_int32 charWidth = (signed)currentFont->getCharWidth();
-	pp_int32 charHeight = (signed)currentFont->getCharHeight(); 
-
-	if (x + (signed)charWidth < currentClipRect.x1 ||
-		x > currentClipRect.x2 ||
-		y + (signed)charHeight < currentClipRect.y1 ||
-		y > currentClipRect.y2)
-		return;
-
-	pp_int32 charDim = currentFont->charDim;
-
-	Bitstream* bitstream = currentFont->bitstream;
-	pp_uint8* fontbuffer = bitstream->buffer;
-
-	pp_uint32 rgb1 = (currentColor.r << bitPosR) + 
-		(currentColor.g << bitPosG) +
-		(currentColor.b << bitPosB);
-
-	pp_uint32 cchrDim = chr*charDim;
-
-	if (x>= currentClipRect.x1 && x + charWidth < currentClipRect.x2 &&
-		y>= currentClipRect.y1 && y + charHeight < currentClipRect.y2)
+	const pp_int32 charWidth = (signed)font->getCharWidth();
+	const pp_int32 charHeight = (signed)font->getCharHeight();
+
+	if (x + charWidth < clipRect.x1 ||
+		x > clipRect.x2 ||
+		y + charHeight < clipRect.y1 ||
+		y > clipRect.y2)
+		return false;
+
+	const pp_int32 firstLine = y < clipRect.y1 ? clipRect.y1 - y : 0;
+	const pp_int32 lastLine = y + charHeight > clipRect.y2 ? clipRect.y2 - y : charHeight;
+	// clip rect in glyph coordinates
+	const pp_int32 cx1 = clipRect.x1 - x;
+	const pp_int32 cx2 = clipRect.x2 - x;
+
+	for (pp_int32 i = firstLine; i < lastLine; i++)
 	{
-		pp_uint8* buff = (pp_uint8*)buffer + y*pitch + x*BPP;
-		
-		pp_uint32 yChr = cchrDim;
-		for (pp_uint32 i = 0; i < charHeight; i++)
+		pp_uint32* line = reinterpret_cast<pp_uint32*>(buffer + (y+i)*pitch) + x;
+		const PPFont::Span* span = font->getLineSpans(chr, i);
+		const PPFont::Span* end = font->getLineSpansEnd(chr, i);
+		for (; span < end; span++)
 		{
-			pp_uint32 xChr = yChr;
-			for (pp_uint32 j = 0; j < charWidth; j++)
-			{
-				if ((fontbuffer[xChr>>3]>>(xChr&7)&1))
-				{
-					*reinterpret_cast<pp_uint32*>(buff) = rgb1;
-				}
-				buff+=BPP;
-				xChr++;
-			}
-			buff+=pitch-(charWidth*BPP);
-			yChr+=charWidth;
+			pp_int32 x1 = span->x;
+			pp_int32 x2 = x1 + span->length;
+			if (x1 < cx1) x1 = cx1;
+			if (x2 > cx2) x2 = cx2;
+			for (pp_int32 j = x1; j < x2; j++)
+				line[j] = rgb;
 		}
 	}
-	else
-	{
-		pp_uint32 yChr = cchrDim;
-		for (pp_int32 i = 0; i < charHeight; i++)
-		{
-			pp_uint32 xChr = yChr;
-			for (pp_int32 j = 0; j < charWidth; j++)
-			{
-				
-				if (y+(signed)i >= currentClipRect.y1 && y+(signed)i < currentClipRect.y2 &&
-					x+(signed)j >= currentClipRect.x1 && x+(signed)j < currentClipRect.x2 &&
-					(fontbuffer[xChr>>3]>>(xChr&7)&1))
-				{
-					
-					pp_uint8* buff = (pp_uint8*)buffer+((y+i)*pitch+(x+j)*BPP);
-					
-					*reinterpret_cast<pp_uint32*>(buff) = rgb1;					
-				}
-				xChr++;
 
-			}
-			yChr+=charWidth;
-		}
+	return true;
+}
 
-	}
+void PPGraphics_32bpp_generic::drawChar(pp_uint8 chr, pp_int32 x, pp_int32 y, bool underlined/* = false*/)
+{
+	if (currentFont == NULL)
+		return;
 
-	if (underlined)
-		drawHLine(x, x+charWidth, y+charHeight);
+	const pp_uint32 rgb = (currentColor.r << bitPosR) + 
+		(currentColor.g << bitPosG) +
+		(currentColor.b << bitPosB);
+
+	if (drawGlyph(buffer, pitch, currentFont, currentClipRect, chr, x, y, rgb) && underlined)
+		drawHLine(x, x+currentFont->getCharWidth(), y+currentFont->getCharHeight());
 }
 
 void PPGraphics_32bpp_generic::drawString(const char* str, pp_int32 x, pp_int32 y, bool underlined/* = false*/)
@@ -336,6 +310,10 @@ void PPGraphics_32bpp_generic::drawString(const char* str, pp_int32 x, pp_int32
 	pp_int32 charWidth = (signed)currentFont->getCharWidth();
 	pp_int32 charHeight = (signed)currentFont->getCharHeight();
 
+	const pp_uint32 rgb = (currentColor.r << bitPosR) + 
+		(currentColor.g << bitPosG) +
+		(currentColor.b << bitPosB);
+
 	pp_int32 sx = x;
 
     while (*str) 
@@ -350,7 +328,8 @@ void PPGraphics_32bpp_generic::drawString(const char* str, pp_int32 x, pp_int32
 				x=sx-charWidth;
 				break;
 			default:
-				drawChar(*str, x, y, underlined);
+				if (drawGlyph(buffer, pitch, currentFont, currentClipRect, *str, x, y, rgb) && underlined)
+					drawHLine(x, x+charWidth, y+charHeight);
 		}
         x += charWidth;
         str++;
@@ -365,6 +344,10 @@ void PPGraphics_32bpp_generic::drawStringVertical(const char* str, pp_int32 x, p
 	pp_int32 charWidth = (signed)currentFont->getCharWidth();
 	pp_int32 charHeight = (signed)currentFont->getCharHeight();
 
+	const pp_uint32 rgb = (currentColor.r << bitPosR) + 
+		(currentColor.g << bitPosG) +
+		(currentColor.b << bitPosB);
+
     while (*str) 
 	{
 		switch (*str)
@@ -373,7 +356,8 @@ void PPGraphics_32bpp_generic::drawStringVertical(const char* str, pp_int32 x, p
 				setPixel(x+(charWidth>>1), y+(charHeight>>1));
 				break;
 			default:
-				drawChar(*str, x, y, underlined);
+				if (drawGlyph(buffer, pitch, currentFont, currentClipRect, *str, x, y, rgb) && underlined)
+					drawHLine(x, x+charWidth, y+charHeight);
 		}
         y += charHeight;
         str++;
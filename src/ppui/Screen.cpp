@@ -56,6 +56,8 @@ PPScreen::PPScreen(PPDisplayDeviceBase* displayDevice, EventListenerInterface* e
 	modalControl(NULL),
 	showDragHilite(false),
 	rootContainer(NULL),
+	numDirtyRects(0),
+	deferredUpdateCount(0),
 	lastMouseOverControl(NULL)
 {
 	contextMenuControls = new PPSimpleVector<PPControl>(16, false);
@@ -89,6 +91,20 @@ void PPScreen::adjustEventMouseCoordinates(PPEvent* event)
 }
 
 void PPScreen::raiseEvent(PPEvent* event)
+{
+	// everything repainted during one timer tick is presented at once
+	const bool isTimerEvent = event->getID() == eTimer;
+	
+	if (isTimerEvent)
+		deferUpdate(true);
+	
+	routeEvent(event);
+	
+	if (isTimerEvent)
+		deferUpdate(false);
+}
+
+void PPScreen::routeEvent(PPEvent* event)
 {
 	if (event->isMouseEvent())
 		adjustEventMouseCoordinates(event);
@@ -227,6 +243,108 @@ void PPScreen::raiseEvent(PPEvent* event)
 	rootContainer->dispatchEvent(event);
 }
 
+void PPScreen::invalidate(const PPRect& r)
+{
+	PPRect rect(r);
+	
+	if (rect.x1 < 0) rect.x1 = 0;
+	if (rect.y1 < 0) rect.y1 = 0;
+	if (rect.x2 > getWidth()) rect.x2 = getWidth();
+	if (rect.y2 > getHeight()) rect.y2 = getHeight();
+	
+	if (rect.x1 >= rect.x2 || rect.y1 >= rect.y2)
+		return;
+		
+	for (;;)
+	{
+		// swallow everything touching the new rectangle, the result 
+		// might touch some of the remaining ones, so start over
+		bool merged = false;
+		for (pp_int32 i = 0; i < numDirtyRects; i++)
+		{
+			if (dirtyRects[i].intersect(rect))
+			{
+				rect.unite(dirtyRects[i]);
+				dirtyRects[i] = dirtyRects[--numDirtyRects];
+				merged = true;
+				break;
+			}
+		}
+		
+		if (merged)
+			continue;
+
+		if (numDirtyRects < MAXDIRTYRECTS)
+			break;
+			
+		// out of space, merge with the one growing the least
+		pp_int32 best = 0;
+		pp_int32 bestGrowth = -1;
+		for (pp_int32 i = 0; i < numDirtyRects; i++)
+		{
+			PPRect united(dirtyRects[i]);
+			united.unite(rect);
+			const pp_int32 growth = united.area() - dirtyRects[i].area();
+			if (bestGrowth < 0 || growth < bestGrowth)
+			{
+				best = i;
+				bestGrowth = growth;
+			}
+		}
+		
+		rect.unite(dirtyRects[best]);
+		dirtyRects[best] = dirtyRects[--numDirtyRects];
+	}
+	
+	dirtyRects[numDirtyRects++] = rect;
+}
+
+void PPScreen::updateDisplay()
+{
+	if (deferredUpdateCount)
+		invalidate(PPRect(0, 0, getWidth(), getHeight()));
+	else
+		displayDevice->update();
+}
+
+void PPScreen::updateDisplay(const PPRect& rect)
+{
+	if (deferredUpdateCount)
+		invalidate(rect);
+	else
+		displayDevice->update(rect);
+}
+
+void PPScreen::deferUpdate(bool defer)
+{
+	if (defer)
+	{
+		deferredUpdateCount++;
+		return;
+	}
+	
+	if (deferredUpdateCount == 0 || --deferredUpdateCount > 0)
+		return;
+		
+	if (numDirtyRects == 1 && 
+		dirtyRects[0].width() == getWidth() && 
+		dirtyRects[0].height() == getHeight())
+	{
+		displayDevice->update();
+	}
+	else if (numDirtyRects)
+	{
+		displayDevice->update(dirtyRects, numDirtyRects);
+	}
+	
+	numDirtyRects = 0;
+}
+
+void PPScreen::setScrollHint(const PPRect& rect, pp_int32 dy)
+{
+	displayDevice->setScrollHint(rect, dy);
+}
+
 void PPScreen::pauseUpdate(bool pause)
 {
 	displayDevice->allowForUpdates(!pause);
@@ -332,7 +450,7 @@ void PPScreen::paint(bool update/*= true*/, bool clean/*=false*/)
 	displayDevice->close();
 	
 	if (update)
-		displayDevice->update();
+		updateDisplay();
 }
 
 void PPScreen::paintContextMenuControl(PPControl* control, bool update/* = true*/)
@@ -372,7 +490,7 @@ void PPScreen::paintContextMenuControl(PPControl* control, bool update/* = true*
 		rect.y2++;
 		if (rect.y2 > getHeight()) rect.y2 = getHeight();
 		
-		displayDevice->update(rect);
+		updateDisplay(rect);
 	}
 
 }
@@ -483,7 +601,7 @@ void PPScreen::update()
 			paintDragHighlite(g);		
 			displayDevice->close();
 		}
-		displayDevice->update(); 
+		updateDisplay(); 
 	}
 }
 
@@ -501,7 +619,7 @@ void PPScreen::updateControl(PPControl* control)
 	rect.y2++;
 	if (rect.y2 > getHeight()) rect.y2 = getHeight();
 	
-	displayDevice->update(rect);
+	updateDisplay(rect);
 }
 
 void PPScreen::setFocus(PPControl* control, bool repaint/* = true*/)
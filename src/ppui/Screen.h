@@ -69,12 +69,29 @@ protected:
 	
 	PPContainer* rootContainer;
 
+	// areas invalidated while updates are deferred
+	enum
+	{
+		MAXDIRTYRECTS = 16
+	};
+	
+	PPRect dirtyRects[MAXDIRTYRECTS];
+	pp_int32 numDirtyRects;
+	pp_int32 deferredUpdateCount;
+
 private:
 	PPPoint lastMousePoint;
 	PPControl* lastMouseOverControl;
 	
 	void paintDragHighlite(PPGraphicsAbstract* g);
 
+	void routeEvent(PPEvent* event);
+
+	// add to the dirty rectangles, touching ones are merged
+	void invalidate(const PPRect& rect);
+	void updateDisplay();
+	void updateDisplay(const PPRect& rect);
+
 	void adjustEventMouseCoordinates(PPEvent* event);
 
 public:
@@ -95,6 +112,12 @@ public:
 
 	void update();
 	void updateControl(PPControl* control);
+
+	// collect all updates until the matching deferUpdate(false) and 
+	// present them at once, timer events are always deferred
+	void deferUpdate(bool defer);
+	// see PPDisplayDeviceBase::setScrollHint
+	void setScrollHint(const PPRect& rect, pp_int32 dy);
 	
 	void pauseUpdate(bool pause);
 	void enableDisplay(bool enable);
@@ -212,4 +212,153 @@ public:
 	bool IsOverflowed() const { return m_bOverflow; }
 };
 
+//--- Undo-record-stack -----------------------------------------------------
+// Other than PPUndoStack this one doesn't keep states but records of
+// changes, every record knows how to get from the state before to the 
+// state after the change and back:
+//
+//	|###|  <-- Advance() returns the next record to redo
+//	|###|  <-- Pop() returns the last record to undo
+//	|###|
+//	|###|  
+//	  |
+//	  \-->--> /dev/null (bottom record will be deleted when the stack is full)
+//
+// Pushing a new record drops all records which could have been redone.
+
+template<class type>
+class PPUndoRecordStack
+{
+private:
+	enum 
+	{
+		DEFAULTSTACKSIZE = 1024
+	};
+	
+	pp_int32 m_nStackSize;
+	
+	type** m_pUndoStack;
+
+	// number of records which can be undone
+	pp_int32 m_nCurIndex;
+
+	// number of valid records
+	pp_int32 m_nTopIndex;
+
+	// stack has overflowed and bottom records have been removed
+	bool m_bOverflow;
+
+public:
+	PPUndoRecordStack(pp_int32 nStackSize = DEFAULTSTACKSIZE) :
+		m_nStackSize(nStackSize),
+		m_nCurIndex(0),
+		m_nTopIndex(0),
+		m_bOverflow(false)
+	{
+		m_pUndoStack = new type*[nStackSize];
+		
+		for (pp_int32 i = 0; i < nStackSize; i++)
+			m_pUndoStack[i] = NULL;
+	}
+	
+	~PPUndoRecordStack()
+	{
+		for (pp_int32 i = 0; i < m_nTopIndex; i++)
+			delete m_pUndoStack[i];
+		
+		delete[] m_pUndoStack;
+	}
+
+	// Remove the records which can be redone
+	void DropRedo()
+	{
+		for (pp_int32 i = m_nCurIndex; i < m_nTopIndex; i++)
+		{
+			delete m_pUndoStack[i];
+			m_pUndoStack[i] = NULL;
+		}
+		
+		m_nTopIndex = m_nCurIndex;
+	}
+
+	// Save record on stack
+	void Push(const type& record)
+	{
+		DropRedo();
+		
+		// stack is full, kill bottom record and move content
+		if (m_nCurIndex == m_nStackSize)
+		{
+			delete m_pUndoStack[0];
+			
+			for (pp_int32 i = 0; i < m_nCurIndex-1; i++)
+				m_pUndoStack[i] = m_pUndoStack[i+1];
+			
+			m_nCurIndex--;
+			m_bOverflow = true;
+		}
+		
+		m_pUndoStack[m_nCurIndex++] = new type(record);
+		m_nTopIndex = m_nCurIndex;
+	}
+	
+	// Replace the last record which can be undone (used for merging records)
+	void Replace(const type& record)
+	{
+		if (m_nCurIndex == 0)
+		{
+			Push(record);
+			return;
+		}
+		
+		DropRedo();
+		
+		delete m_pUndoStack[m_nCurIndex-1];
+		m_pUndoStack[m_nCurIndex-1] = new type(record);
+	}
+
+	// Remove the last record which can be undone
+	void Remove()
+	{
+		if (m_nCurIndex == 0)
+			return;
+		
+		DropRedo();
+		
+		delete m_pUndoStack[--m_nCurIndex];
+		m_pUndoStack[m_nCurIndex] = NULL;
+		m_nTopIndex = m_nCurIndex;
+	}
+
+	// Last record which can be undone without removing it
+	const type* Peek() const
+	{
+		return m_nCurIndex ? m_pUndoStack[m_nCurIndex-1] : NULL;
+	}
+
+	// Next record which can be redone without advancing
+	const type* PeekRedo() const
+	{
+		return m_nCurIndex < m_nTopIndex ? m_pUndoStack[m_nCurIndex] : NULL;
+	}
+
+	// Get record to undo
+	const type* Pop()
+	{
+		return m_nCurIndex ? m_pUndoStack[--m_nCurIndex] : NULL;
+	}
+
+	// Get record to redo
+	const type* Advance()
+	{
+		return m_nCurIndex < m_nTopIndex ? m_pUndoStack[m_nCurIndex++] : NULL;
+	}
+
+	bool IsEmpty() const { return m_nCurIndex == 0; }
+
+	bool IsTop() const { return m_nCurIndex == m_nTopIndex; }
+
+	bool IsOverflowed() const { return m_bOverflow; }
+};
+
 #endif
@@ -30,6 +30,8 @@
 
 #include "DisplayDeviceFB_SDL.h"
 #include "Graphics.h"
+#include <stdlib.h>
+#include <string.h>
 
 PPDisplayDeviceFB::PPDisplayDeviceFB(pp_int32 width,
 									 pp_int32 height, 
@@ -40,7 +42,11 @@ PPDisplayDeviceFB::PPDisplayDeviceFB(pp_int32 width,
 									 bool swapRedBlue/* = false*/) :
 	PPDisplayDevice(width, height, scaleFactor, bpp, fullScreen, theOrientation),
 	needsTemporaryBuffer((orientation != ORIENTATION_NORMAL) || (scaleFactor != 1)),
-	temporaryBuffer(NULL)
+	temporaryBuffer(NULL),
+	shadowBuffer(NULL),
+	lineStates(NULL),
+	shadowValid(false),
+	scrollDelta(0)
 {
 	// Create an SDL window and surface
 	theWindow = CreateWindow(realWidth, realHeight, bpp,
@@ -166,6 +172,8 @@ PPDisplayDeviceFB::PPDisplayDeviceFB(pp_int32 width,
 		temporaryBuffer = new pp_uint8[getSize().width*getSize().height*(bpp/8)];
 	}
 	
+	allocateShadowBuffer();
+	
 	currentGraphics->lock = true;
 }
 
@@ -176,6 +184,8 @@ PPDisplayDeviceFB::~PPDisplayDeviceFB()
 	SDL_DestroyWindow(theWindow);
 
 	delete[] temporaryBuffer;
+	delete[] shadowBuffer;
+	delete[] lineStates;
 	// base class is responsible for deleting currentGraphics
 }
 
@@ -209,6 +219,36 @@ void PPDisplayDeviceFB::close()
 	currentGraphics->lock = true;
 }
 
+void PPDisplayDeviceFB::allocateShadowBuffer()
+{
+	delete[] shadowBuffer;
+	delete[] lineStates;
+	
+	shadowPitch = getSize().width*theSurface->format->BytesPerPixel;
+	shadowBuffer = new pp_uint8[shadowPitch*getSize().height];
+	lineStates = new pp_uint8[getSize().height];
+	shadowValid = false;
+}
+
+const pp_uint8* PPDisplayDeviceFB::getSourceBuffer(pp_uint32& pitch) const
+{
+	if (needsTemporaryBuffer)
+	{
+		pitch = temporaryBufferPitch;
+		return temporaryBuffer;
+	}
+	
+	pitch = theSurface->pitch;
+	return (const pp_uint8*)theSurface->pixels;
+}
+
+void PPDisplayDeviceFB::present()
+{
+	SDL_RenderClear(theRenderer);
+	SDL_RenderCopy(theRenderer, theTexture, NULL, NULL);
+	SDL_RenderPresent(theRenderer);
+}
+
 void PPDisplayDeviceFB::update()
 {
 	if (!isUpdateAllowed() || !isEnabled())
@@ -224,12 +264,28 @@ void PPDisplayDeviceFB::update()
 	
 	// Update entire texture and copy to renderer
 	SDL_UpdateTexture(theTexture, NULL, theSurface->pixels, theSurface->pitch);
-	SDL_RenderClear(theRenderer);
-	SDL_RenderCopy(theRenderer, theTexture, NULL, NULL);
-	SDL_RenderPresent(theRenderer);
+	present();
+
+	if (orientation == ORIENTATION_NORMAL)
+	{
+		pp_uint32 srcPitch;
+		const pp_uint8* src = getSourceBuffer(srcPitch);
+		
+		for (pp_int32 y = 0; y < getSize().height; y++)
+			memcpy(shadowBuffer + y*shadowPitch, src + y*srcPitch, shadowPitch);
+		
+		shadowValid = true;
+	}
+	
+	scrollDelta = 0;
 }
 
 void PPDisplayDeviceFB::update(const PPRect& r)
+{
+	update(&r, 1);
+}
+
+void PPDisplayDeviceFB::update(const PPRect* rects, pp_int32 numRects)
 {
 	if (!isUpdateAllowed() || !isEnabled())
 		return;
@@ -239,23 +295,194 @@ void PPDisplayDeviceFB::update(const PPRect& r)
 		return;
 	}
 
-	swap(r);
+	if (orientation == ORIENTATION_NORMAL)
+	{
+		// nothing to compare with yet
+		if (!shadowValid)
+		{
+			update();
+			return;
+		}
 	
-	PPRect r2(r);
-	r2.scale(scaleFactor);
+		bool changed = false;
+		for (pp_int32 i = 0; i < numRects; i++)
+			changed |= updateChangedLines(rects[i]);
+		
+		scrollDelta = 0;
+		
+		if (changed)
+			present();
+		return;
+	}
+
+	for (pp_int32 i = 0; i < numRects; i++)
+	{
+		const PPRect& r = rects[i];
 	
-	transformInverse(r2);
+		swap(r);
+		
+		PPRect r2(r);
+		r2.scale(scaleFactor);
+		
+		transformInverse(r2);
 
-	SDL_Rect r3 = { r2.x1, r2.y1, r2.width(), r2.height() };
+		SDL_Rect r3 = { r2.x1, r2.y1, r2.width(), r2.height() };
+		
+		// Calculate destination pixel data offset based on row pitch and x coordinate
+		void* surfaceOffset = (char*) theSurface->pixels + r2.y1 * theSurface->pitch + r2.x1 * theSurface->format->BytesPerPixel;
+		
+		// Update dirty area of texture
+		SDL_UpdateTexture(theTexture, &r3, surfaceOffset, theSurface->pitch);
+	}
 	
-	// Calculate destination pixel data offset based on row pitch and x coordinate
-	void* surfaceOffset = (char*) theSurface->pixels + r2.y1 * theSurface->pitch + r2.x1 * theSurface->format->BytesPerPixel;
+	present();
+}
+
+void PPDisplayDeviceFB::setScrollHint(const PPRect& r, pp_int32 dy)
+{
+	scrollRect = r;
+	scrollDelta = dy;
+}
+
+bool PPDisplayDeviceFB::moveConvertedLines(const PPRect& r, pp_int32 dy)
+{
+	if (SDL_LockSurface(theSurface) < 0)
+		return false;
+
+	PPRect destRect(r);
+	destRect.scale(scaleFactor);
+	const pp_int32 delta = dy*scaleFactor;
 	
-	// Update dirty area of texture and copy to renderer
-	SDL_UpdateTexture(theTexture, &r3, surfaceOffset, theSurface->pitch);
-	SDL_RenderClear(theRenderer);
-	SDL_RenderCopy(theRenderer, theTexture, NULL, NULL);
-	SDL_RenderPresent(theRenderer);
+	const pp_uint32 bytesPerPixel = theSurface->format->BytesPerPixel;
+	const pp_uint32 pitch = theSurface->pitch;
+	const pp_uint32 offset = destRect.x1*bytesPerPixel;
+	const pp_uint32 length = destRect.width()*bytesPerPixel;
+	pp_uint8* pixels = (pp_uint8*)theSurface->pixels;
+	
+	if (delta > 0)
+	{
+		for (pp_int32 y = destRect.y2 - 1; y >= destRect.y1 + delta; y--)
+			memcpy(pixels + y*pitch + offset, pixels + (y - delta)*pitch + offset, length);
+	}
+	else
+	{
+		for (pp_int32 y = destRect.y1; y < destRect.y2 + delta; y++)
+			memcpy(pixels + y*pitch + offset, pixels + (y - delta)*pitch + offset, length);
+	}
+	
+	SDL_UnlockSurface(theSurface);
+	return true;
+}
+
+bool PPDisplayDeviceFB::updateChangedLines(const PPRect& rect)
+{
+	PPRect r(rect);
+	if (r.x1 > r.x2) { pp_int32 h = r.x1; r.x1 = r.x2; r.x2 = h; }
+	if (r.y1 > r.y2) { pp_int32 h = r.y1; r.y1 = r.y2; r.y2 = h; }
+	if (r.x1 < 0) r.x1 = 0;
+	if (r.y1 < 0) r.y1 = 0;
+	if (r.x2 > getSize().width) r.x2 = getSize().width;
+	if (r.y2 > getSize().height) r.y2 = getSize().height;
+	
+	if (r.x1 >= r.x2 || r.y1 >= r.y2)
+		return false;
+
+	pp_uint32 srcPitch;
+	const pp_uint8* src = getSourceBuffer(srcPitch);
+	
+	const pp_uint32 bytesPerPixel = theSurface->format->BytesPerPixel;
+	const pp_uint32 offset = r.x1*bytesPerPixel;
+	const pp_uint32 length = r.width()*bytesPerPixel;
+
+	// moving the scaled lines only pays off if they would have to be 
+	// converted again, the scrolled area has to be updated entirely, 
+	// otherwise the lines moved outside of this update get out of sync 
+	PPRect s(scrollRect);
+	bool scrolled = needsTemporaryBuffer && scrollDelta &&
+					s.x1 >= r.x1 && s.x2 <= r.x2 && s.y1 >= r.y1 && s.y2 <= r.y2 &&
+					s.x1 < s.x2 && abs(scrollDelta) < s.height();
+	
+	if (scrolled)
+		scrolled = moveConvertedLines(s, scrollDelta);
+	
+	const pp_uint32 scrollOffset = scrolled ? s.x1*bytesPerPixel : 0;
+	const pp_uint32 scrollLength = scrolled ? s.width()*bytesPerPixel : 0;
+	
+	pp_int32 y;
+	for (y = r.y1; y < r.y2; y++)
+	{
+		const pp_uint8* line = src + y*srcPitch;
+		const pp_uint8* shadowLine = shadowBuffer + y*shadowPitch;
+		
+		if (scrolled && y >= s.y1 && y < s.y2)
+		{
+			// the converted line has been replaced by the one it moved from
+			const pp_int32 oldY = y - scrollDelta;
+			const pp_uint8* oldLine = shadowBuffer + oldY*shadowPitch;
+			
+			if (oldY >= s.y1 && oldY < s.y2 &&
+				memcmp(line + scrollOffset, oldLine + scrollOffset, scrollLength) == 0 &&
+				memcmp(line + offset, shadowLine + offset, scrollOffset - offset) == 0 &&
+				memcmp(line + scrollOffset + scrollLength, shadowLine + scrollOffset + scrollLength, offset + length - (scrollOffset + scrollLength)) == 0)
+				lineStates[y] = LineMoved;
+			else
+				lineStates[y] = LineChanged;
+		}
+		else
+		{
+			lineStates[y] = memcmp(line + offset, shadowLine + offset, length) ? LineChanged : LineUnchanged;
+		}
+	}
+	
+	// the shadow lines are compared against above, so update them afterwards
+	for (y = r.y1; y < r.y2; y++)
+	{
+		if (lineStates[y] != LineUnchanged)
+			memcpy(shadowBuffer + y*shadowPitch + offset, src + y*srcPitch + offset, length);
+	}
+	
+	bool changed = false;
+	
+	y = r.y1;
+	while (y < r.y2)
+	{
+		if (lineStates[y] == LineUnchanged)
+		{
+			y++;
+			continue;
+		}
+		
+		const pp_int32 start = y;
+		while (y < r.y2 && lineStates[y] != LineUnchanged)
+			y++;
+		
+		// convert the changed lines within this span
+		for (pp_int32 i = start; i < y;)
+		{
+			if (lineStates[i] != LineChanged)
+			{
+				i++;
+				continue;
+			}
+			
+			const pp_int32 first = i;
+			while (i < y && lineStates[i] == LineChanged)
+				i++;
+				
+			swap(PPRect(r.x1, first, r.x2, i));
+		}
+		
+		PPRect r2(r.x1, start, r.x2, y);
+		r2.scale(scaleFactor);
+		
+		SDL_Rect r3 = { r2.x1, r2.y1, r2.width(), r2.height() };
+		void* surfaceOffset = (char*) theSurface->pixels + r2.y1 * theSurface->pitch + r2.x1 * bytesPerPixel;
+		
+		SDL_UpdateTexture(theTexture, &r3, surfaceOffset, theSurface->pitch);
+		changed = true;
+	}
+	
+	return changed;
 }
 
 void PPDisplayDeviceFB::swap(const PPRect& r2)
@@ -287,8 +514,11 @@ void PPDisplayDeviceFB::swap(const PPRect& r2)
 			PPRect destRect(r);		
 			destRect.scale(scaleFactor);
 
-			const pp_uint32 stepU = (r.x2 - r.x1) * 65536 / (destRect.x2 - destRect.x1);
-			const pp_uint32 stepV = (r.y2 - r.y1) * 65536 / (destRect.y2 - destRect.y1);
+			// round the steps up, otherwise every scaleFactor-th pixel 
+			// is taken from the previous one and the result depends on
+			// where the converted rectangle starts
+			const pp_uint32 stepU = ((r.x2 - r.x1) * 65536 + (destRect.x2 - destRect.x1) - 1) / (destRect.x2 - destRect.x1);
+			const pp_uint32 stepV = ((r.y2 - r.y1) * 65536 + (destRect.y2 - destRect.y1) - 1) / (destRect.y2 - destRect.y1);
 			
 			switch (temporaryBufferBPP)
 			{
@@ -727,4 +957,6 @@ void PPDisplayDeviceFB::setSize(const PPSize& size)
 	theSurface = SDL_CreateRGBSurface(0, size.width, size.height, theSurface->format->BitsPerPixel, 0, 0, 0, 0);
 	theTexture = SDL_CreateTextureFromSurface(theRenderer, theSurface);
 	theRenderer = SDL_GetRenderer(theWindow);
+	
+	allocateShadowBuffer();
 }
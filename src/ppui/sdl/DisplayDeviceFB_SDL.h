@@ -40,6 +40,30 @@ private:
 	pp_uint8* temporaryBuffer;
 	pp_uint32 temporaryBufferPitch, temporaryBufferBPP;
 	
+	enum LineStates
+	{
+		LineUnchanged,
+		LineMoved,		// already converted, only needs uploading
+		LineChanged
+	};
+
+	// unscaled copy of what the texture shows, lines which haven't 
+	// changed are neither converted nor uploaded again 
+	// (normal orientation only)
+	pp_uint8* shadowBuffer;
+	pp_uint32 shadowPitch;
+	pp_uint8* lineStates;
+	bool shadowValid;
+	
+	PPRect scrollRect;
+	pp_int32 scrollDelta;
+	
+	void allocateShadowBuffer();
+	const pp_uint8* getSourceBuffer(pp_uint32& pitch) const;
+	bool moveConvertedLines(const PPRect& r, pp_int32 dy);
+	bool updateChangedLines(const PPRect& r);
+	void present();
+	
 	// used for rotating coordinates etc.
 	void swap(const PPRect& r);
 
@@ -62,6 +86,8 @@ public:
 
 	void update();
 	void update(const PPRect& r);
+	virtual void update(const PPRect* rects, pp_int32 numRects);
+	virtual void setScrollHint(const PPRect& r, pp_int32 dy);
 protected:
 	SDL_Surface* theSurface;
 	SDL_Texture* theTexture;
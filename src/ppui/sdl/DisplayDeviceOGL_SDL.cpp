@@ -124,4 +124,10 @@ void PPDisplayDeviceOGL::update(const PPRect& r)
 	update();
 }
 
+void PPDisplayDeviceOGL::update(const PPRect* rects, pp_int32 numRects)
+{
+	// the whole window is swapped anyway
+	update();
+}
+
 #endif
@@ -0,0 +1,854 @@
+/*
+ * Copyright (c) 2009, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  milkyplaybench.cpp
+ *  MilkyTracker
+ *
+ *  Benchmarks of the milkyplay mixing, sequencing and loading code.
+ *  The workloads are synthesized XM, IT and MOD modules, generated from
+ *  a fixed seed so every run measures exactly the same thing. Every
+ *  result is printed as one "name value unit" line, the output of an
+ *  earlier run can be passed to --compare to spot regressions.
+ *
+ */
+
+#include "MilkyPlay.h"
+#include "PlayerSTD.h"
+#include "PlayerIT.h"
+#include "ResamplerFactory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------
+// settings
+// ------------------------------------------------------------------------
+static mp_uint32 numChannels = 32;
+static mp_uint32 mixFrequency = 44100;
+static mp_uint32 bufferSize = 1024;
+static mp_uint32 mixSeconds = 10;
+static mp_uint32 numRuns = 5;
+static const char* filter = NULL;
+
+static const char* resamplerNames[] =
+{
+	"NORMAL", "NORMAL_RAMPING",
+	"LERPING", "LERPING_RAMPING",
+	"LAGRANGE", "LAGRANGE_RAMPING",
+	"SPLINE", "SPLINE_RAMPING",
+	"SINCTABLE", "SINCTABLE_RAMPING",
+	"SINC", "SINC_RAMPING",
+	"AMIGA500", "AMIGA500_RAMPING",
+	"AMIGA500LED", "AMIGA500LED_RAMPING",
+	"AMIGA1200", "AMIGA1200_RAMPING",
+	"AMIGA1200LED", "AMIGA1200LED_RAMPING"
+};
+
+// ------------------------------------------------------------------------
+// helpers
+// ------------------------------------------------------------------------
+class Random
+{
+private:
+	mp_uint32 state;
+
+public:
+	Random(mp_uint32 seed) : state(seed) {}
+
+	mp_uint32 next(mp_uint32 range)
+	{
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % range;
+	}
+};
+
+class Writer
+{
+public:
+	std::vector<mp_ubyte> data;
+
+	mp_uint32 pos() const { return (mp_uint32)data.size(); }
+
+	void u8(mp_uint32 v) { data.push_back((mp_ubyte)v); }
+	void u16(mp_uint32 v) { u8(v); u8(v >> 8); }
+	void u32(mp_uint32 v) { u16(v); u16(v >> 16); }
+	void u16be(mp_uint32 v) { u8(v >> 8); u8(v); }
+	void zeros(mp_uint32 n) { data.insert(data.end(), n, 0); }
+
+	void str(const char* s, mp_uint32 n)
+	{
+		const mp_uint32 len = (mp_uint32)strlen(s);
+		for (mp_uint32 i = 0; i < n; i++)
+			u8(i < len ? s[i] : 0);
+	}
+
+	void patch16(mp_uint32 at, mp_uint32 v) { data[at] = (mp_ubyte)v; data[at+1] = (mp_ubyte)(v >> 8); }
+	void patch32(mp_uint32 at, mp_uint32 v) { patch16(at, v); patch16(at+2, v >> 16); }
+};
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool selected(const std::string& name)
+{
+	return filter == NULL || name.find(filter) != std::string::npos;
+}
+
+static void report(const std::string& name, double value, const char* unit)
+{
+	printf("%s %.3f %s\n", name.c_str(), value, unit);
+	fflush(stdout);
+}
+
+// ------------------------------------------------------------------------
+// workload synthesis
+// ------------------------------------------------------------------------
+enum
+{
+	NUMPATTERNS = 4,
+	NUMROWS = 64,
+	NUMINSTRUMENTS = 4
+};
+
+// a few harmonics and a bit of noise, so the interpolation has work to do
+static mp_sint32 sampleValue(mp_uint32 ins, mp_uint32 i, Random& rnd)
+{
+	const double t = (double)i * (ins + 1) * 2.0 * M_PI / 256.0;
+	const double v = sin(t) * 0.6 + sin(t * 3.0) * 0.2 + sin(t * 7.0) * 0.1;
+	return (mp_sint32)(v * 32767.0) + (mp_sint32)rnd.next(2048) - 1024;
+}
+
+// FT2 module, notes on every row of every channel with vibrato, porta
+// and volume slides, long 16 bit samples and instruments with volume
+// and panning envelopes and auto vibrato
+static void synthesizeXM(Writer& w, mp_uint32 channels)
+{
+	Random rnd(0x584D);
+	const mp_uint32 sampleLength = 65536;
+
+	w.str("Extended Module: ", 17);
+	w.str("milkyplay_bench", 20);
+	w.u8(0x1A);
+	w.str("milkyplay_bench", 20);
+	w.u16(0x0104);
+	w.u32(276);
+	w.u16(NUMPATTERNS);
+	w.u16(0);
+	w.u16(channels);
+	w.u16(NUMPATTERNS);
+	w.u16(NUMINSTRUMENTS);
+	w.u16(1);
+	w.u16(6);
+	w.u16(125);
+	for (mp_uint32 i = 0; i < 256; i++)
+		w.u8(i < NUMPATTERNS ? i : 0);
+
+	for (mp_uint32 p = 0; p < NUMPATTERNS; p++)
+	{
+		w.u32(9);
+		w.u8(0);
+		w.u16(NUMROWS);
+		w.u16(NUMROWS*channels*5);
+		for (mp_uint32 r = 0; r < NUMROWS; r++)
+			for (mp_uint32 c = 0; c < channels; c++)
+			{
+				static const mp_ubyte effects[4][2] = {{0x4,0x48}, {0x3,0x10}, {0xA,0x02}, {0x0,0x00}};
+				const mp_uint32 e = rnd.next(4);
+				// every other note slides into the previous one
+				const bool porta = effects[e][0] == 0x3;
+				w.u8(37 + rnd.next(36));
+				w.u8(porta ? 0 : 1 + rnd.next(NUMINSTRUMENTS));
+				w.u8(0x10 + 32 + rnd.next(33));
+				w.u8(effects[e][0]);
+				w.u8(effects[e][1]);
+			}
+	}
+
+	for (mp_uint32 i = 0; i < NUMINSTRUMENTS; i++)
+	{
+		static const mp_uword venv[6][2] = {{0,64}, {8,48}, {16,56}, {32,40}, {64,32}, {160,0}};
+		static const mp_uword penv[4][2] = {{0,32}, {16,0}, {32,64}, {48,32}};
+
+		w.u32(263);
+		w.str("instrument", 22);
+		w.u8(0);
+		w.u16(1);
+		w.u32(40);
+		w.zeros(96);
+		for (mp_uint32 j = 0; j < 12; j++)
+		{
+			w.u16(j < 6 ? venv[j][0] : 0);
+			w.u16(j < 6 ? venv[j][1] : 0);
+		}
+		for (mp_uint32 j = 0; j < 12; j++)
+		{
+			w.u16(j < 4 ? penv[j][0] : 0);
+			w.u16(j < 4 ? penv[j][1] : 0);
+		}
+		w.u8(6);
+		w.u8(4);
+		w.u8(2); w.u8(2); w.u8(4);
+		w.u8(1); w.u8(0); w.u8(3);
+		w.u8(1|2|4);
+		w.u8(1|4);
+		w.u8(0); w.u8(0x10); w.u8(4); w.u8(8);
+		w.u16(0x200);
+		w.zeros(22);
+
+		w.u32(sampleLength*2);
+		w.u32(sampleLength/4*2);
+		w.u32(sampleLength/2*2);
+		w.u8(48);
+		w.u8(0);
+		w.u8(1|16);
+		w.u8(128);
+		w.u8(0);
+		w.u8(0);
+		w.str("sample", 22);
+
+		mp_sint32 last = 0;
+		for (mp_uint32 j = 0; j < sampleLength; j++)
+		{
+			mp_sint32 s = sampleValue(i, j, rnd);
+			s = s < -32768 ? -32768 : (s > 32767 ? 32767 : s);
+			w.u16((mp_uword)(s - last));
+			last = s;
+		}
+	}
+}
+
+// Impulse Tracker module, notes on every row of every channel played
+// by instruments with new note actions continue and fade, so the
+// background voices pile up until they're stolen
+static void synthesizeIT(Writer& w, mp_uint32 channels)
+{
+	Random rnd(0x4954);
+	const mp_uint32 sampleLength = 32768;
+
+	w.str("IMPM", 4);
+	w.str("milkyplay_bench", 26);
+	w.u16(0x1004);
+	w.u16(NUMPATTERNS+1);
+	w.u16(NUMINSTRUMENTS);
+	w.u16(NUMINSTRUMENTS);
+	w.u16(NUMPATTERNS);
+	w.u16(0x0214);
+	w.u16(0x0214);
+	w.u16(1|4|8);
+	w.u16(0);
+	w.u8(128);
+	w.u8(48);
+	w.u8(6);
+	w.u8(125);
+	w.u8(128);
+	w.u8(0);
+	w.u16(0);
+	w.u32(0);
+	w.u32(0);
+	for (mp_uint32 c = 0; c < 64; c++)
+		w.u8(c < channels ? 32 : 32|128);
+	for (mp_uint32 c = 0; c < 64; c++)
+		w.u8(64);
+
+	for (mp_uint32 i = 0; i < NUMPATTERNS; i++)
+		w.u8(i);
+	w.u8(255);
+
+	const mp_uint32 insOffsets = w.pos();
+	w.zeros(NUMINSTRUMENTS*4);
+	const mp_uint32 smpOffsets = w.pos();
+	w.zeros(NUMINSTRUMENTS*4);
+	const mp_uint32 patOffsets = w.pos();
+	w.zeros(NUMPATTERNS*4);
+
+	for (mp_uint32 i = 0; i < NUMINSTRUMENTS; i++)
+	{
+		static const mp_ubyte venv[5][2] = {{64,0}, {48,10}, {56,20}, {32,40}, {0,120}};
+		static const mp_sbyte penv[3][2] = {{-32,0}, {32,30}, {0,60}};
+
+		w.patch32(insOffsets + i*4, w.pos());
+		w.str("IMPI", 4);
+		w.zeros(13);
+		// continue and fade
+		w.u8((i & 1) ? 3 : 1);
+		w.u8(0);
+		w.u8(0);
+		w.u16(32);
+		w.u8(0);
+		w.u8(60);
+		w.u8(128);
+		w.u8(32|128);
+		w.u8(0);
+		w.u8(0);
+		w.u16(0x0214);
+		w.u8(1);
+		w.u8(0);
+		w.str("instrument", 26);
+		w.u8(0);
+		w.u8(0);
+		w.u8(0);
+		w.u8(0xFF);
+		w.u16(0xFFFF);
+		for (mp_uint32 n = 0; n < 120; n++)
+		{
+			w.u8(n);
+			w.u8(i+1);
+		}
+
+		// volume envelope
+		w.u8(1);
+		w.u8(5);
+		w.u8(0); w.u8(0); w.u8(0); w.u8(0);
+		for (mp_uint32 j = 0; j < 25; j++)
+		{
+			w.u8(j < 5 ? venv[j][0] : 0);
+			w.u16(j < 5 ? venv[j][1] : 0);
+		}
+		w.u8(0);
+		// panning envelope
+		w.u8(1|2);
+		w.u8(3);
+		w.u8(0); w.u8(2); w.u8(0); w.u8(0);
+		for (mp_uint32 j = 0; j < 25; j++)
+		{
+			w.u8(j < 3 ? (mp_ubyte)penv[j][0] : 0);
+			w.u16(j < 3 ? penv[j][1] : 0);
+		}
+		w.u8(0);
+		// pitch envelope
+		w.zeros(82);
+		w.zeros(4);
+	}
+
+	mp_uint32 samplePointers[NUMINSTRUMENTS];
+	for (mp_uint32 i = 0; i < NUMINSTRUMENTS; i++)
+	{
+		w.patch32(smpOffsets + i*4, w.pos());
+		w.str("IMPS", 4);
+		w.zeros(13);
+		w.u8(64);
+		w.u8(1|2|16);
+		w.u8(64);
+		w.str("sample", 26);
+		w.u8(1);
+		w.u8(32);
+		w.u32(sampleLength);
+		w.u32(sampleLength/4);
+		w.u32(sampleLength);
+		w.u32(22050);
+		w.u32(0);
+		w.u32(0);
+		samplePointers[i] = w.pos();
+		w.u32(0);
+		w.u8(0); w.u8(0); w.u8(0); w.u8(0);
+	}
+
+	for (mp_uint32 p = 0; p < NUMPATTERNS; p++)
+	{
+		w.patch32(patOffsets + p*4, w.pos());
+		const mp_uint32 start = w.pos();
+		w.u16(0);
+		w.u16(NUMROWS);
+		w.u32(0);
+		for (mp_uint32 r = 0; r < NUMROWS; r++)
+		{
+			for (mp_uint32 c = 0; c < channels; c++)
+			{
+				w.u8((c+1)|128);
+				w.u8(1|2|4|8);
+				w.u8(36 + rnd.next(36));
+				w.u8(1 + rnd.next(NUMINSTRUMENTS));
+				w.u8(32 + rnd.next(33));
+				// vibrato or volume slide
+				if (rnd.next(2))
+				{
+					w.u8(8);
+					w.u8(0x46);
+				}
+				else
+				{
+					w.u8(4);
+					w.u8(0x02);
+				}
+			}
+			w.u8(0);
+		}
+		w.patch16(start, w.pos() - start - 8);
+	}
+
+	for (mp_uint32 i = 0; i < NUMINSTRUMENTS; i++)
+	{
+		w.patch32(samplePointers[i], w.pos());
+		for (mp_uint32 j = 0; j < sampleLength; j++)
+		{
+			mp_sint32 s = sampleValue(i, j, rnd);
+			w.u16((mp_uword)(s < -32768 ? -32768 : (s > 32767 ? 32767 : s)));
+		}
+	}
+}
+
+// Protracker module, 8 bit samples and Amiga periods
+static void synthesizeMOD(Writer& w, mp_uint32 channels)
+{
+	static const mp_uint32 periods[36] =
+	{
+		856,808,762,720,678,640,604,570,538,508,480,453,
+		428,404,381,360,339,320,302,285,269,254,240,226,
+		214,202,190,180,170,160,151,143,135,127,120,113
+	};
+
+	Random rnd(0x4D4F);
+	const mp_uint32 sampleLength = 16384;
+
+	w.str("milkyplay_bench", 20);
+	for (mp_uint32 i = 0; i < 31; i++)
+	{
+		const bool used = i < NUMINSTRUMENTS;
+		w.str(used ? "sample" : "", 22);
+		w.u16be(used ? sampleLength/2 : 0);
+		w.u8(0);
+		w.u8(used ? 64 : 0);
+		w.u16be(used ? sampleLength/8 : 0);
+		w.u16be(used ? sampleLength/4 : 1);
+	}
+	w.u8(NUMPATTERNS);
+	w.u8(127);
+	for (mp_uint32 i = 0; i < 128; i++)
+		w.u8(i < NUMPATTERNS ? i : 0);
+
+	char id[5];
+	if (channels == 4)
+		strcpy(id, "M.K.");
+	else if (channels < 10)
+		sprintf(id, "%dCHN", channels);
+	else
+		sprintf(id, "%dCH", channels);
+	w.str(id, 4);
+
+	for (mp_uint32 p = 0; p < NUMPATTERNS; p++)
+		for (mp_uint32 r = 0; r < NUMROWS; r++)
+			for (mp_uint32 c = 0; c < channels; c++)
+			{
+				if ((r + c) & 1)
+				{
+					w.u32(0);
+					continue;
+				}
+				const mp_uint32 period = periods[rnd.next(36)];
+				const mp_uint32 ins = 1 + rnd.next(NUMINSTRUMENTS);
+				const mp_uint32 effect = rnd.next(2) ? 0x4 : 0xA;
+				w.u8((ins & 0xF0) | (period >> 8));
+				w.u8(period & 0xFF);
+				w.u8(((ins & 0x0F) << 4) | effect);
+				w.u8(effect == 0x4 ? 0x46 : 0x01);
+			}
+
+	for (mp_uint32 i = 0; i < NUMINSTRUMENTS; i++)
+		for (mp_uint32 j = 0; j < sampleLength; j++)
+			w.u8((mp_ubyte)(sampleValue(i, j, rnd) >> 8));
+}
+
+struct Workload
+{
+	const char* name;
+	Writer file;
+	XModule module;
+};
+
+// ------------------------------------------------------------------------
+// benchmarks
+// ------------------------------------------------------------------------
+static PlayerBase* createPlayer(XModule& module, bool itPlayer)
+{
+	PlayerBase* player;
+	if (itPlayer)
+	{
+		PlayerIT* playerIT = new PlayerIT(mixFrequency);
+		playerIT->setNumMaxVirChannels(256);
+		player = playerIT;
+	}
+	else
+	{
+		player = new PlayerSTD(mixFrequency);
+	}
+
+	player->adjustFrequency(mixFrequency);
+	player->setBufferSize(bufferSize);
+	player->initDevice();
+	return player;
+}
+
+// best of numRuns, nanoseconds per frame of mixSeconds of the module
+// (looped), a resampler type of -1 only runs the player
+static double timePlayback(XModule& module, bool itPlayer, mp_sint32 resamplerType)
+{
+	PlayerBase* player = createPlayer(module, itPlayer);
+	if (resamplerType >= 0)
+		player->setResamplerType((ChannelMixer::ResamplerTypes)resamplerType);
+	else
+		player->setDisableMixing(true);
+
+	mp_sint32* buffer = new mp_sint32[bufferSize*MP_NUMCHANNELS];
+	const mp_uint32 numBuffers = (mixSeconds*mixFrequency + bufferSize - 1) / bufferSize;
+
+	double best = 0.0;
+	for (mp_uint32 run = 0; run < numRuns; run++)
+	{
+		player->startPlaying(&module, true);
+
+		const double start = now();
+		for (mp_uint32 i = 0; i < numBuffers; i++)
+		{
+			memset(buffer, 0, bufferSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+			player->mix(buffer, bufferSize);
+		}
+		const double time = now() - start;
+
+		player->stopPlaying();
+
+		if (run == 0 || time < best)
+			best = time;
+	}
+
+	delete[] buffer;
+	delete player;
+
+	return best * 1e9 / ((double)numBuffers * bufferSize);
+}
+
+// MB/s loading the module from memory
+static double timeLoading(const mp_ubyte* data, mp_uint32 size, const char* name)
+{
+	// repeat until a run takes a measurable amount of time
+	mp_uint32 numLoads = 1;
+	double best = 0.0;
+	for (mp_uint32 run = 0; run < numRuns; run++)
+	{
+		double time;
+		for (;;)
+		{
+			const double start = now();
+			for (mp_uint32 i = 0; i < numLoads; i++)
+			{
+				XModule module;
+				XMFileMemory f(data, size, name);
+				if (module.loadModule(f) != MP_OK)
+					return 0.0;
+			}
+			time = now() - start;
+
+			if (time >= 0.05 || numLoads >= (1 << 20))
+				break;
+			numLoads*=2;
+		}
+
+		time/=numLoads;
+		if (run == 0 || time < best)
+			best = time;
+	}
+
+	return (double)size / (1024.0*1024.0) / best;
+}
+
+// MB/s of uncompressed pattern data
+static double timePatternCompression(const XModule& module)
+{
+	mp_uint32 numBytes = 0;
+	mp_uint32 maxSize = 0;
+	for (mp_uint32 p = 0; p < module.header.patnum; p++)
+	{
+		const TXMPattern& pattern = module.phead[p];
+		const mp_uint32 size = pattern.compress(NULL);
+		if (size > maxSize)
+			maxSize = size;
+		numBytes+=pattern.rows*pattern.channum*(2+pattern.effnum*2);
+	}
+
+	mp_ubyte* dest = new mp_ubyte[maxSize];
+
+	mp_uint32 numPasses = 1;
+	double best = 0.0;
+	for (mp_uint32 run = 0; run < numRuns; run++)
+	{
+		double time;
+		for (;;)
+		{
+			const double start = now();
+			for (mp_uint32 i = 0; i < numPasses; i++)
+				for (mp_uint32 p = 0; p < module.header.patnum; p++)
+					module.phead[p].compress(dest);
+			time = now() - start;
+
+			if (time >= 0.05 || numPasses >= (1 << 20))
+				break;
+			numPasses*=2;
+		}
+
+		time/=numPasses;
+		if (run == 0 || time < best)
+			best = time;
+	}
+
+	delete[] dest;
+
+	return (double)numBytes / (1024.0*1024.0) / best;
+}
+
+// ------------------------------------------------------------------------
+// regression compare
+// ------------------------------------------------------------------------
+struct Result
+{
+	std::string name;
+	double value;
+	std::string unit;
+};
+
+static bool readResults(const char* fileName, std::vector<Result>& results)
+{
+	FILE* f = fopen(fileName, "r");
+	if (f == NULL)
+		return false;
+
+	char line[512], name[256], unit[64];
+	double value;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%255s %lf %63s", name, &value, unit) == 3)
+		{
+			Result result = {name, value, unit};
+			results.push_back(result);
+		}
+	}
+
+	fclose(f);
+	return true;
+}
+
+// returns the number of results which got worse by more than threshold percent
+static mp_uint32 compareResults(const char* baselineName, const char* currentName, double threshold)
+{
+	std::vector<Result> baseline, current;
+	if (!readResults(baselineName, baseline) || !readResults(currentName, current))
+	{
+		fprintf(stderr, "Could not read %s or %s\n", baselineName, currentName);
+		exit(2);
+	}
+
+	mp_uint32 numRegressions = 0;
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		const Result& cur = current[i];
+		for (size_t j = 0; j < baseline.size(); j++)
+		{
+			const Result& base = baseline[j];
+			if (base.name != cur.name || base.unit != cur.unit || base.value <= 0.0)
+				continue;
+
+			// times per frame go down, throughput goes up
+			const bool lowerIsBetter = cur.unit.find("/s") == std::string::npos;
+			double change = (cur.value - base.value) / base.value * 100.0;
+			if (lowerIsBetter)
+				change = -change;
+
+			const bool regression = change < -threshold;
+			if (regression)
+				numRegressions++;
+
+			printf("%s %.3f %.3f %s %+.1f%%%s\n", cur.name.c_str(), base.value, cur.value, cur.unit.c_str(), change, regression ? " REGRESSION" : "");
+			break;
+		}
+	}
+
+	return numRegressions;
+}
+
+// ------------------------------------------------------------------------
+static void usage()
+{
+	fprintf(stderr,
+			"Usage: milkyplay_bench [options] [module files to load...]\n"
+			"  --channels n      channels of the synthesized modules (default 32)\n"
+			"  --seconds n       seconds of audio mixed per run (default 10)\n"
+			"  --runs n          runs per benchmark, the best one counts (default 5)\n"
+			"  --buffer n        mixing buffer size in frames (default 1024)\n"
+			"  --filter text     only run benchmarks containing text\n"
+			"  --no-simd         use the scalar resamplers only\n"
+			"  --sinc-taps n     taps of the sinc resampler: 32, 64 or 128 (default)\n"
+			"  --compare a b     compare the results b against the baseline a\n"
+			"  --threshold pct   changes beyond pct percent are regressions (default 5)\n");
+	exit(2);
+}
+
+int main(int argc, const char* argv[])
+{
+	std::vector<const char*> fileNames;
+	const char* compareWith[2] = {NULL, NULL};
+	double threshold = 5.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--channels") == 0 && hasValue)
+			numChannels = atoi(argv[++i]);
+		else if (strcmp(arg, "--seconds") == 0 && hasValue)
+			mixSeconds = atoi(argv[++i]);
+		else if (strcmp(arg, "--runs") == 0 && hasValue)
+			numRuns = atoi(argv[++i]);
+		else if (strcmp(arg, "--buffer") == 0 && hasValue)
+			bufferSize = atoi(argv[++i]);
+		else if (strcmp(arg, "--filter") == 0 && hasValue)
+			filter = argv[++i];
+		else if (strcmp(arg, "--no-simd") == 0)
+			ResamplerFactory::setSIMDEnabled(false);
+		else if (strcmp(arg, "--sinc-taps") == 0 && hasValue)
+			ResamplerFactory::setSincTaps(atoi(argv[++i]));
+		else if (strcmp(arg, "--compare") == 0 && i + 2 < argc)
+		{
+			compareWith[0] = argv[++i];
+			compareWith[1] = argv[++i];
+		}
+		else if (strcmp(arg, "--threshold") == 0 && hasValue)
+			threshold = atof(argv[++i]);
+		else if (arg[0] == '-')
+			usage();
+		else
+			fileNames.push_back(arg);
+	}
+
+	if (compareWith[0])
+		return compareResults(compareWith[0], compareWith[1], threshold) ? 1 : 0;
+
+	if (numChannels < 1 || numChannels > 64 || numRuns < 1 || mixSeconds < 1 || bufferSize < 16)
+		usage();
+
+	printf("# milkyplay_bench channels=%d seconds=%d runs=%d buffer=%d frequency=%d simd=%d\n",
+		   numChannels, mixSeconds, numRuns, bufferSize, mixFrequency, ResamplerFactory::isSIMDEnabled() ? 1 : 0);
+
+	Workload workloads[3];
+	workloads[0].name = "xm";
+	synthesizeXM(workloads[0].file, numChannels);
+	workloads[1].name = "it";
+	synthesizeIT(workloads[1].file, numChannels);
+	workloads[2].name = "mod";
+	synthesizeMOD(workloads[2].file, numChannels > 32 ? 32 : numChannels);
+
+	for (mp_uint32 i = 0; i < 3; i++)
+	{
+		Workload& workload = workloads[i];
+		const std::string fileName = std::string("bench.") + workload.name;
+		XMFileMemory f(&workload.file.data[0], workload.file.pos(), fileName.c_str());
+		if (workload.module.loadModule(f) != MP_OK)
+		{
+			fprintf(stderr, "Could not load the synthesized %s module\n", workload.name);
+			return 2;
+		}
+	}
+
+	// mixing with every resampler, sequencing included
+	for (mp_uint32 i = 0; i < 3; i++)
+	{
+		Workload& workload = workloads[i];
+		const bool itPlayer = workload.module.getType() == XModule::ModuleType_IT;
+		for (mp_sint32 r = 0; r < ChannelMixer::MIXER_DUMMY; r++)
+		{
+			const std::string name = std::string("mix.") + workload.name + "." + resamplerNames[r];
+			if (selected(name))
+				report(name, timePlayback(workload.module, itPlayer, r), "ns/frame");
+		}
+	}
+
+	// sequencing only
+	for (mp_uint32 i = 0; i < 3; i++)
+	{
+		Workload& workload = workloads[i];
+		const bool itPlayer = workload.module.getType() == XModule::ModuleType_IT;
+		const std::string name = std::string("tick.") + workload.name + (itPlayer ? ".PlayerIT" : ".PlayerSTD");
+		if (selected(name))
+			report(name, timePlayback(workload.module, itPlayer, -1), "ns/frame");
+	}
+
+	for (mp_uint32 i = 0; i < 3; i++)
+	{
+		Workload& workload = workloads[i];
+		const std::string name = std::string("load.") + workload.name;
+		if (selected(name))
+			report(name, timeLoading(&workload.file.data[0], workload.file.pos(), name.c_str()), "MB/s");
+	}
+
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		const char* fileName = fileNames[i];
+		const char* baseName = strrchr(fileName, '/');
+		baseName = baseName ? baseName + 1 : fileName;
+		const std::string name = std::string("load.file.") + baseName;
+		if (!selected(name))
+			continue;
+
+		FILE* f = fopen(fileName, "rb");
+		if (f == NULL)
+		{
+			fprintf(stderr, "Could not open %s\n", fileName);
+			continue;
+		}
+		std::vector<mp_ubyte> data;
+		mp_ubyte block[65536];
+		size_t numRead;
+		while ((numRead = fread(block, 1, sizeof(block), f)) > 0)
+			data.insert(data.end(), block, block + numRead);
+		fclose(f);
+
+		const double speed = data.empty() ? 0.0 : timeLoading(&data[0], (mp_uint32)data.size(), baseName);
+		if (speed > 0.0)
+			report(name, speed, "MB/s");
+		else
+			fprintf(stderr, "Could not load %s\n", fileName);
+	}
+
+	for (mp_uint32 i = 0; i < 3; i++)
+	{
+		Workload& workload = workloads[i];
+		const std::string name = std::string("compress.") + workload.name;
+		if (selected(name))
+			report(name, timePatternCompression(workload.module), "MB/s");
+	}
+
+	return 0;
+}
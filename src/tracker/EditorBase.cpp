@@ -39,6 +39,7 @@ void EditorBase::notifyListener(EditorNotifications notification)
 
 EditorBase::EditorBase() :
 	lazyUpdateNotifications(false),
+	criticalCommit(NULL),
 	module(NULL)
 {
 	notificationListeners = new PPSimpleVector<EditorNotificationListener>(16, false);
@@ -83,3 +84,13 @@ void EditorBase::leaveCriticalSection()
 	notifyListener(NotificationUnprepareCritical);
 }
 
+
+void EditorBase::commitCriticalSection(ChannelMixer::SyncedCommit& commit)
+{
+	criticalCommit = &commit;
+	notifyListener(NotificationCommitCritical);
+
+	// no player attached, just do it
+	if (takeCriticalCommit())
+		commit.commit(NULL);
+}
@@ -32,6 +32,7 @@
 #define __EDITORBASE_H__
 
 #include "BasicTypes.h"
+#include "ChannelMixer.h"
 
 class XModule;
 
@@ -59,7 +60,8 @@ public:
 		NotificationUnprepareLengthy,
 
 		NotificationPrepareCritical,
-		NotificationUnprepareCritical
+		NotificationUnprepareCritical,
+		NotificationCommitCritical
 	};
 
 	class EditorNotificationListener
@@ -73,6 +75,7 @@ public:
 private:
 	PPSimpleVector<EditorNotificationListener>* notificationListeners;
 	bool lazyUpdateNotifications;
+	ChannelMixer::SyncedCommit* criticalCommit;
 	
 protected:
 	XModule* module;
@@ -91,6 +94,11 @@ protected:
 	// continue playing module after a critical change/update
 	void leaveCriticalSection();
 
+	// publish a change which has been prepared on a copy of the data
+	// the player is using, the commit is executed in sync with the 
+	// player so it doesn't need to be stopped
+	void commitCriticalSection(ChannelMixer::SyncedCommit& commit);
+
 public:
 	virtual ~EditorBase();
 	
@@ -103,6 +111,15 @@ public:
 	bool getLazyUpdateNotifications() const { return lazyUpdateNotifications; }
 	
 	XModule* getModule() { return module; }	
+
+	// a listener handling NotificationCommitCritical takes the commit
+	// over, if nobody does it's executed without synchronization
+	ChannelMixer::SyncedCommit* takeCriticalCommit() 
+	{ 
+		ChannelMixer::SyncedCommit* commit = criticalCommit; 
+		criticalCommit = NULL; 
+		return commit; 
+	}
 };
 
 #endif
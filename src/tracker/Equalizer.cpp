@@ -67,3 +67,27 @@ void Equalizer::Filter(double xL, double xR, double &yL, double &yR)
 	yR2 = yR1;
 	yR1 = yR;
 }
+
+void Equalizer::Filter(double* buffer, int numSamples)
+{
+	const double denorm 	= 1e-24f;
+
+	double x1 = xL1, x2 = xL2;
+	double y1 = yL1, y2 = yL2;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		const double x = buffer[i];
+		const double y = denorm + (b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2);
+
+		x2 = x1;
+		x1 = x;
+		y2 = y1;
+		y1 = y;
+
+		buffer[i] = y;
+	}
+
+	xL1 = x1; xL2 = x2;
+	yL1 = y1; yL2 = y2;
+}
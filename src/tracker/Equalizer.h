@@ -32,6 +32,8 @@ public:
 
 	void CalcCoeffs(float centre, float width, float rate, float gain);
 	void Filter(double xL, double xR, double &yL, double &yR);
+	// filter a block of mono samples in place (uses the left channel state)
+	void Filter(double* buffer, int numSamples);
 
 	// Calculate frequency from 20Hz to 20,000 Hz, a value of 0 to 1 should be passed (as is normally used in linear controls)
 	static float CalcFreq(float f) { return (float)(pow(1000.0f,f)*20); }
@@ -35,7 +35,8 @@
 #include "Decompressor.h"
 
 FileIdentificator::FileIdentificator(const PPSystemString& fileName) :
-	fileName(fileName)
+	fileName(fileName),
+	ownsFile(true)
 {
 	f = new XMFile(fileName);
 	if (!f->isOpen())
@@ -45,9 +46,17 @@ FileIdentificator::FileIdentificator(const PPSystemString& fileName) :
 	}
 }
 
+FileIdentificator::FileIdentificator(XMFileBase& file, const PPSystemString& fileName) :
+	fileName(fileName),
+	f(&file),
+	ownsFile(false)
+{
+}
+
 FileIdentificator::~FileIdentificator() 
 {
-	delete f;
+	if (ownsFile)
+		delete f;
 }
 
 FileIdentificator::FileTypes FileIdentificator::getFileType()
@@ -106,6 +115,11 @@ bool FileIdentificator::isInstrument()
 
 bool FileIdentificator::isSample()
 {
+	// sample loaders need a file on disk, anything else
+	// would end up as raw sample data anyway
+	if (!ownsFile)
+		return f->size() != 0;
+
 	XModule* module = NULL;
 
 	SampleLoaderGeneric sampleLoader(fileName, *module);
@@ -34,6 +34,7 @@
 #include "BasicTypes.h"
 
 class XMFile;
+class XMFileBase;
 
 class FileIdentificator
 {
@@ -51,7 +52,8 @@ public:
 	
 private:
 	PPSystemString fileName;
-	XMFile* f;
+	XMFileBase* f;
+	bool ownsFile;
 	
 	bool isModule();
 	bool isInstrument();
@@ -62,6 +64,9 @@ private:
 	
 public:
 	FileIdentificator(const PPSystemString& fileName);
+	// Identify data which is not on disk (e.g. decompressed into memory),
+	// fileName is only used for looking at the extension
+	FileIdentificator(XMFileBase& file, const PPSystemString& fileName);
 	~FileIdentificator();
 	
 	bool isValid() { return f != NULL; }
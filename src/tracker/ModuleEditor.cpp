@@ -86,6 +86,14 @@ private:
 			case EditorBase::NotificationUnprepareCritical:
 				moduleEditor.leaveCriticalSection();
 				break;
+
+			case EditorBase::NotificationCommitCritical:
+			{
+				ChannelMixer::SyncedCommit* commit = sender->takeCriticalCommit();
+				if (commit)
+					moduleEditor.commitCriticalSection(*commit);
+				break;
+			}
 			default:
 				break;
 		}
@@ -221,6 +229,14 @@ void ModuleEditor::leaveCriticalSection()
 		playerCriticalSection->leave();
 }
 
+void ModuleEditor::commitCriticalSection(ChannelMixer::SyncedCommit& commit)
+{
+	if (playerCriticalSection)
+		playerCriticalSection->commit(commit);
+	else
+		commit.commit(NULL);
+}
+
 void ModuleEditor::adjustExtension(bool hasExtension/* = true*/)
 {
 	if (hasExtension)
@@ -664,7 +680,16 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 	if (!XMFile::exists(fileName))
 		return false;
 
-	mp_sint32 nRes = module->loadModule(fileName);
+	XMFileMapped f(fileName);
+	if (!f.isOpen())
+		return false;
+	
+	return openSong(f, preferredFileName ? preferredFileName : fileName);
+}
+
+bool ModuleEditor::openSong(XMFileBase& f, const SYSCHAR* fileName)
+{
+	mp_sint32 nRes = module->loadModule(f);
 	
 	// unknown format
 	if (nRes == MP_UNKNOWN_FORMAT)
@@ -696,13 +721,15 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 			}
 		} 
 	
-		PPSystemString tempFile(getTempFilename());
+		// convert to XM by exporting and reloading, this all happens in memory
+		XMFileBuffer convertedFile;
 	
-		res = module->saveExtendedModule(tempFile) == MP_OK;
+		res = module->saveExtendedModule(convertedFile) == MP_OK;
 		if (!res)
 			return res;
 
-		res = module->loadModule(tempFile) == MP_OK;
+		convertedFile.seek(0);
+		res = module->loadModule(convertedFile) == MP_OK;
 	
 		// restore one shot looping flag
 		if (type == XModule::ModuleType_MOD)
@@ -717,8 +744,6 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 				}
 			}
 		} 
-	
-		XMFile::remove(tempFile);
 	}
 
 	if (module->header.channum > TrackerConfig::numPlayerChannels)
@@ -736,7 +761,7 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 		for (mp_sint32 i = 0; i < module->header.patnum; i++)
 			getPattern(i);
 		
-		PPSystemString strFileName = preferredFileName ? preferredFileName : fileName;
+		PPSystemString strFileName = fileName;
 
 		moduleFileName = strFileName.stripExtension();
 		
@@ -2013,31 +2038,41 @@ void ModuleEditor::updateInstrumentData(mp_sint32 index)
 
 }
 
-pp_int32 ModuleEditor::insRemapSong(pp_int32 oldIns, pp_int32 newIns)
+pp_int32 ModuleEditor::insRemapSong(pp_int32 oldIns, pp_int32 newIns, bool withUndo/* = false*/)
 {
 	mp_sint32 resCnt = 0;
 
 	PatternEditorTools patternEditorTools;
 
+	if (withUndo)
+		patternEditor->prepareSongUndo();
+
 	for (mp_sint32 k = 0; k < module->header.patnum; k++)
 	{
 		patternEditorTools.attachPattern(&module->phead[k]);
 		resCnt+=patternEditorTools.insRemap(oldIns, newIns);				
 	}
 
+	if (withUndo)
+		patternEditor->finishSongUndo();
+
 	if (resCnt)
 		changed = true;
 		
 	return resCnt;
 }
 
-pp_int32 ModuleEditor::noteTransposeSong(const PatternEditorTools::TransposeParameters& transposeParameters, bool evaluate/* = false*/)
+pp_int32 ModuleEditor::noteTransposeSong(const PatternEditorTools::TransposeParameters& transposeParameters, bool evaluate/* = false*/, bool withUndo/* = false*/)
 {
 	mp_sint32 resCnt = 0;
 	pp_int32 fuckupCnt = 0;
 
 	PatternEditorTools patternEditorTools;
 
+	withUndo = withUndo && !evaluate;
+	if (withUndo)
+		patternEditor->prepareSongUndo();
+
 	for (mp_sint32 k = 0; k < module->header.patnum; k++)
 	{
 		patternEditorTools.attachPattern(&module->phead[k]);
@@ -2048,6 +2083,9 @@ pp_int32 ModuleEditor::noteTransposeSong(const PatternEditorTools::TransposePara
 			resCnt+=patternEditorTools.noteTranspose(transposeParameters, evaluate);				
 	}
 
+	if (withUndo)
+		patternEditor->finishSongUndo();
+
 	if (!evaluate)
 	{
 		if (resCnt)
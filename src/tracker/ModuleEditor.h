@@ -107,6 +107,7 @@ private:
 
 	void enterCriticalSection();
 	void leaveCriticalSection();
+	void commitCriticalSection(ChannelMixer::SyncedCommit& commit);
 
 	void adjustExtension(bool hasExtension = true);
 
@@ -237,6 +238,8 @@ public:
 	bool isEmpty() const;
 						 
 	bool openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFileName = NULL);	
+	// Load from a file which might not be on disk, fileName is used for naming the song
+	bool openSong(XMFileBase& f, const SYSCHAR* fileName);
 	bool saveSong(const SYSCHAR* fileName, ModSaveTypes saveType = ModSaveTypeXM);
 	mp_sint32 saveBackup(const SYSCHAR* fileName);
 	
@@ -346,10 +349,10 @@ public:
 	void updateInstrumentData(mp_sint32 index);
 	
 	// remap instruments in entire song
-	pp_int32 insRemapSong(pp_int32 oldIns, pp_int32 newIns);	
+	pp_int32 insRemapSong(pp_int32 oldIns, pp_int32 newIns, bool withUndo = false);	
 
 	// transpose notes in entire song
-	pp_int32 noteTransposeSong(const PatternEditorTools::TransposeParameters& transposeParameters, bool evaluate = false);	
+	pp_int32 noteTransposeSong(const PatternEditorTools::TransposeParameters& transposeParameters, bool evaluate = false, bool withUndo = false);	
 	
 	// panning effect conversion
 	enum PanConversionTypes
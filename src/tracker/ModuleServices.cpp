@@ -30,6 +30,7 @@
 
 #include "ModuleServices.h"
 #include "SongLengthEstimator.h"
+#include "SongAnalyzer.h"
 #include "PlayerGeneric.h"
 #include "AudioDriver_NULL.h"
 #include "XModule.h"
@@ -75,28 +76,11 @@ pp_int32 ModuleServices::estimateMixerVolume(WAVWriterParameters& parameters,
 
 pp_int32 ModuleServices::estimateWaveLengthInSamples(WAVWriterParameters& parameters)
 {
-	PlayerGeneric* player = new PlayerGeneric(parameters.sampleRate);
-
-	player->setBufferSize(1024);
-	player->setPlayMode((PlayerGeneric::PlayModes)parameters.playMode);
-	player->setResamplerType((ChannelMixer::ResamplerTypes)parameters.resamplerType);
-	player->setSampleShift(parameters.mixerShift);
-	player->setMasterVolume(256);
-	player->setPeakAutoAdjust(false);
-
-	AudioDriver_NULL* audioDriver = new AudioDriver_NULL;
-
-	pp_int32 res = player->exportToWAV(NULL, &module, 
-									   parameters.fromOrder, parameters.toOrder, 
-									   parameters.muting, 
-									   module.header.channum, 
-									   parameters.panning, 
-									   audioDriver);
+	SongAnalyzer analyzer(&module, parameters.sampleRate);
 	
-	delete audioDriver;
-	delete player;
+	analyzer.setPlayMode((PlayModeSettings::PlayModes)parameters.playMode);
 	
-	return res;
+	return analyzer.analyze(parameters.fromOrder, parameters.toOrder);
 }
 
 pp_int32 ModuleServices::exportToWAV(const PPSystemString& fileName, WAVWriterParameters& parameters)
@@ -113,34 +97,33 @@ pp_int32 ModuleServices::exportToWAV(const PPSystemString& fileName, WAVWriterPa
 	
 	if (parameters.multiTrack)
 	{
-		mp_ubyte* muting = new mp_ubyte[module.header.channum];
+		PPSystemString* fileNames = new PPSystemString[module.header.channum];
+		const SYSCHAR** fileNamePtrs = new const SYSCHAR*[module.header.channum];
 		
 		PPSystemString baseName = fileName.stripExtension();
 		PPSystemString extension = fileName.getExtension();
 		
 		for (pp_uint32 i = 0; i < module.header.channum; i++)
 		{
-			PPSystemString fileName = baseName;
+			fileNames[i] = baseName;
 			
 			char infix[80];
 			sprintf(infix, "_%02d", i+1);
 			
-			fileName.append(infix);
-			fileName.append(extension);
+			fileNames[i].append(infix);
+			fileNames[i].append(extension);
 		
-			if (!parameters.muting[i])
-			{
-				memset(muting, 1, module.header.channum);				
-				muting[i] = 0;				
-				res = player->exportToWAV(fileName, &module, 
+			// muted channels are not exported
+			fileNamePtrs[i] = parameters.muting[i] ? NULL : fileNames[i].getStrBuffer();
+		}
+		
+		// all channels are rendered in one pass
+		res = player->exportChannelsToWAV(fileNamePtrs, module.header.channum, &module, 
 										  parameters.fromOrder, parameters.toOrder, 
-										  muting, 
-										  module.header.channum, 
 										  parameters.panning);
-			}
-		}
 		
-		delete[] muting;
+		delete[] fileNamePtrs;
+		delete[] fileNames;
 	}
 	else
 	{
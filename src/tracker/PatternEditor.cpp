@@ -57,6 +57,19 @@ PatternEditor::ClipBoard* PatternEditor::ClipBoard::getInstance(ClipBoardTypes t
 	return instances[type];
 }
 
+// keystrokes in the same channel are merged into one undo step 
+// as long as they stay within this many rows
+#define UNDOMERGEROWS 16
+
+PatternUndoStackEntry::CursorPosition PatternEditor::getUndoCursor() const
+{
+	PatternUndoStackEntry::CursorPosition position;
+	position.channel = cursor.channel;
+	position.row = cursor.row;
+	position.inner = cursor.inner;
+	return position;
+}
+
 void PatternEditor::prepareUndo()
 {
 	PatternEditorTools patternEditorTools(pattern); 
@@ -65,8 +78,49 @@ void PatternEditor::prepareUndo()
 	undoUserData.clear();
 	notifyListener(NotificationFeedUndoData);
 
-	delete before; 
-	before = new PatternUndoStackEntry(*pattern, cursor.channel, cursor.row, cursor.inner, &undoUserData);
+	undoUserDataBefore = undoUserData;
+	undoCursor = getUndoCursor();
+
+	if (pattern->patternData)
+		undoPattern = *pattern;
+	else
+	{
+		delete[] undoPattern.patternData;
+		undoPattern.patternData = NULL;
+	}
+}
+
+bool PatternEditor::canMergeUndo(const PatternUndoStackEntry& last, const PatternUndoStackEntry& entry, 
+								 LastChanges lastChange, bool nonRepeat) const
+{
+	if (lastChange != this->lastChange)
+		return false;
+		
+	if (last.getNumDiffs() != 1 || last.getDiff(0).getPatternIndex() >= 0)
+		return false;
+	
+	if (nonRepeat)
+		return true;
+	
+	if (lastChange != LastChangeSlotChange)
+		return false;
+		
+	const PatternUndoStackEntry::Diff& lastDiff = last.getDiff(0);
+	const PatternUndoStackEntry::Diff& diff = entry.getDiff(0);
+	
+	if (lastDiff.getLayoutChanged() || diff.getLayoutChanged())
+		return false;
+
+	if (lastDiff.getNumChannels() != 1 || diff.getNumChannels() != 1 ||
+		lastDiff.getStartChannel() != diff.getStartChannel())
+		return false;
+	
+	pp_int32 startRow = lastDiff.getStartRow() < diff.getStartRow() ? lastDiff.getStartRow() : diff.getStartRow();
+	pp_int32 endRow = lastDiff.getStartRow() + lastDiff.getNumRows();
+	if (diff.getStartRow() + diff.getNumRows() > endRow)
+		endRow = diff.getStartRow() + diff.getNumRows();
+		
+	return endRow - startRow <= UNDOMERGEROWS;
 }
 
 bool PatternEditor::finishUndo(LastChanges lastChange, bool nonRepeat/* = false*/)
@@ -79,39 +133,196 @@ bool PatternEditor::finishUndo(LastChanges lastChange, bool nonRepeat/* = false*
 	undoUserData.clear();
 	notifyListener(NotificationFeedUndoData);
 
-	PatternUndoStackEntry after(*pattern, cursor.channel, cursor.row, cursor.inner, &undoUserData); 
-	if (*before != after) 
+	PatternUndoStackEntry entry(undoCursor, getUndoCursor(), &undoUserDataBefore, &undoUserData);
+	entry.addDiff(-1, undoPattern, *pattern);
+	
+	if (!entry.isEmpty()) 
 	{ 
-		PatternEditorTools::Position afterPos;
-		afterPos.channel = after.getCursorPositionChannel();
-		afterPos.row = after.getCursorPositionRow();
-		afterPos.inner = after.getCursorPositionInner();
+		PatternEditorTools::Position afterPos = cursor;
 
 		PatternEditorTools::Position beforePos;		
-		beforePos.channel = before->getCursorPositionChannel();
-		beforePos.row = before->getCursorPositionRow();
-		beforePos.inner = before->getCursorPositionInner();
+		beforePos.channel = undoCursor.channel;
+		beforePos.row = undoCursor.row;
+		beforePos.inner = undoCursor.inner;
 	
 		result = true;
 		
-		lastOperationDidChangeRows = after.GetPattern().rows != before->GetPattern().rows;
+		lastOperationDidChangeRows = pattern->rows != undoPattern.rows;
 		lastOperationDidChangeCursor = beforePos != afterPos;
 		notifyListener(NotificationChanges);
 		if (undoStack) 
 		{ 
-			if (nonRepeat && this->lastChange != lastChange)
-				undoStack->Push(*before); 	
-			else if (!nonRepeat)
-				undoStack->Push(*before); 				
-			undoStack->Push(after); 
-			undoStack->Pop(); 
+			const PatternUndoStackEntry* last = undoStack->IsTop() ? undoStack->Peek() : NULL;
+
+			if (last && canMergeUndo(*last, entry, lastChange, nonRepeat))
+			{
+				// get the pattern back to where it was before the last step
+				// and store both steps as one
+				last->getDiff(0).apply(undoPattern, true);
+			
+				PatternUndoStackEntry merged(last->getCursorPosition(true), getUndoCursor(), 
+											 &last->getUserData(true), &undoUserData);
+				merged.addDiff(-1, undoPattern, *pattern);
+				
+				// the steps cancel each other out
+				if (merged.isEmpty())
+					undoStack->Remove();
+				else
+				{
+					merged.setSequence(++undoSequence);
+					undoStack->Replace(merged);
+				}
+			}
+			else
+			{
+				entry.setSequence(++undoSequence);
+				undoStack->Push(entry);
+			}
 		} 
+		
+		// song wide steps undone before can't be redone on top of this
+		songUndoStack->DropRedo();
 	} 
 	this->lastChange = lastChange; 
 
 	return result;
 }
 
+void PatternEditor::prepareSongUndo()
+{
+	if (module == NULL)
+		return;
+
+	undoUserData.clear();
+	notifyListener(NotificationFeedUndoData);
+
+	undoUserDataBefore = undoUserData;
+	undoCursor = getUndoCursor();
+
+	delete[] undoSongPatterns;
+	undoSongNumPatterns = module->header.patnum;
+	undoSongPatterns = new TXMPattern[undoSongNumPatterns]();
+	
+	for (pp_int32 i = 0; i < undoSongNumPatterns; i++)
+	{
+		if (module->phead[i].patternData)
+			undoSongPatterns[i] = module->phead[i];
+	}
+}
+
+bool PatternEditor::finishSongUndo()
+{
+	if (module == NULL || undoSongPatterns == NULL)
+		return false;
+
+	undoUserData.clear();
+	notifyListener(NotificationFeedUndoData);
+
+	PatternUndoStackEntry entry(undoCursor, getUndoCursor(), &undoUserDataBefore, &undoUserData);
+	
+	for (pp_int32 i = 0; i < undoSongNumPatterns && i < module->header.patnum; i++)
+	{
+		entry.addDiff(i, undoSongPatterns[i], module->phead[i]);
+		delete[] undoSongPatterns[i].patternData;
+	}
+	
+	delete[] undoSongPatterns;
+	undoSongPatterns = NULL;
+	undoSongNumPatterns = 0;
+
+	// nothing to merge with
+	this->lastChange = LastChangeNone;
+
+	if (entry.isEmpty())
+		return false;
+	
+	entry.setSequence(++undoSequence);
+	songUndoStack->Push(entry);
+	
+	// neither can the current pattern's steps undone before
+	if (undoStack)
+		undoStack->DropRedo();
+
+	lastOperationDidChangeRows = false;
+	lastOperationDidChangeCursor = false;
+	notifyListener(NotificationChanges);
+	
+	return true;
+}
+
+class PatternCommit : public ChannelMixer::SyncedCommit
+{
+private:
+	TXMPattern& livePattern;
+	const TXMPattern& workPattern;
+
+public:
+	PatternCommit(TXMPattern& livePattern, const TXMPattern& workPattern) :
+		livePattern(livePattern),
+		workPattern(workPattern)
+	{
+	}
+	
+	virtual void commit(ChannelMixer* mixer)
+	{
+		// TXMPattern::operator= would copy the pattern data
+		livePattern.len = workPattern.len;
+		livePattern.ptype = workPattern.ptype;
+		livePattern.rows = workPattern.rows;
+		livePattern.effnum = workPattern.effnum;
+		livePattern.channum = workPattern.channum;
+		livePattern.patdata = workPattern.patdata;
+		livePattern.patternData = workPattern.patternData;
+	}
+};
+
+void PatternEditor::enterCriticalSection()
+{
+	if (criticalSectionDepth++)
+		return;
+
+	livePattern = NULL;
+	if (pattern == NULL || pattern->patternData == NULL)
+	{
+		EditorBase::enterCriticalSection();
+		return;
+	}
+
+	// work on a copy of the pattern, the player is not stopped
+	workPattern = *pattern;
+
+	livePattern = pattern;
+	pattern = &workPattern;
+}
+
+void PatternEditor::leaveCriticalSection()
+{
+	if (--criticalSectionDepth)
+		return;
+
+	if (livePattern == NULL)
+	{
+		EditorBase::leaveCriticalSection();
+		return;
+	}
+
+	mp_ubyte* oldPatternData = livePattern->patternData;
+	
+	PatternCommit commit(*livePattern, workPattern);
+	commitCriticalSection(commit);
+
+	// the player doesn't use the old data anymore
+	if (oldPatternData != livePattern->patternData)
+		delete[] oldPatternData;
+
+	pattern = livePattern;
+	livePattern = NULL;
+	workPattern.patternData = NULL;
+	
+	// listeners have only seen the changes on the copy so far
+	notifyListener(NotificationChanges);
+}
+
 PatternEditor::PatternEditor() :
 	EditorBase(),
 	pattern(NULL),
@@ -121,13 +332,22 @@ PatternEditor::PatternEditor() :
 	instrumentEnabled(true),
 	instrumentBackTrace(false),
 	currentOctave(5),
-	before(NULL),
 	undoStack(NULL),
-	lastChange(LastChangeNone)	
+	undoSequence(0),
+	undoPattern(),
+	undoSongPatterns(NULL),
+	undoSongNumPatterns(0),
+	lastChange(LastChangeNone),
+	livePattern(NULL),
+	workPattern(),
+	criticalSectionDepth(0)
 {
 	// Undo history
-	undoHistory = new UndoHistory<TXMPattern, PatternUndoStackEntry>(UNDOHISTORYSIZE_PATTERNEDITOR);
+	undoHistory = new UndoHistory<TXMPattern, PatternUndoStackEntry, PPUndoRecordStack<PatternUndoStackEntry> >(UNDOHISTORYSIZE_PATTERNEDITOR);
+	songUndoStack = new PPUndoRecordStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);
 	
+	memset(&undoCursor, 0, sizeof(undoCursor));
+
 	resetCursor();
 	resetSelection();
 	
@@ -138,7 +358,9 @@ PatternEditor::~PatternEditor()
 {
 	delete undoHistory;
 	delete undoStack;
-	delete before;
+	delete songUndoStack;
+	delete[] undoPattern.patternData;
+	delete[] undoSongPatterns;
 }
 
 void PatternEditor::attachPattern(TXMPattern* pattern, XModule* module) 
@@ -170,8 +392,11 @@ void PatternEditor::attachPattern(TXMPattern* pattern, XModule* module)
 	// couldn't get any from history, create new one
 	if (!undoStack)
 	{
-		undoStack = new PPUndoStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);
+		undoStack = new PPUndoRecordStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);
 	}
+	
+	// nothing to merge with on another pattern
+	lastChange = LastChangeNone;
 
 	notifyListener(NotificationReload);
 }
@@ -181,10 +406,15 @@ void PatternEditor::reset()
 	resetSelection();
 
 	delete undoHistory;
-	undoHistory = new UndoHistory<TXMPattern, PatternUndoStackEntry>(UNDOHISTORYSIZE_PATTERNEDITOR);
+	undoHistory = new UndoHistory<TXMPattern, PatternUndoStackEntry, PPUndoRecordStack<PatternUndoStackEntry> >(UNDOHISTORYSIZE_PATTERNEDITOR);
 			
 	delete undoStack;
-	undoStack = new PPUndoStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);	
+	undoStack = new PPUndoRecordStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);	
+	
+	delete songUndoStack;
+	songUndoStack = new PPUndoRecordStack<PatternUndoStackEntry>(UNDODEPTH_PATTERNEDITOR);
+	
+	lastChange = LastChangeNone;
 }
 
 pp_int32 PatternEditor::getNumChannels() const
@@ -272,66 +502,93 @@ pp_int32 PatternEditor::getCurrentActiveInstrument()
 
 bool PatternEditor::undo()
 {
-	if (undoStack->IsEmpty()) return false;
-	if (undoStack)
-		return revoke(undoStack->Pop());
+	// the step made last goes first
+	const PatternUndoStackEntry* last = undoStack ? undoStack->Peek() : NULL;
+	const PatternUndoStackEntry* lastSong = songUndoStack->Peek();
+	
+	if (lastSong && (last == NULL || lastSong->getSequence() > last->getSequence()))
+		return revoke(songUndoStack->Pop(), true);
+	if (last)
+		return revoke(undoStack->Pop(), true);
 	return false;	
 }
 
 bool PatternEditor::redo()
 {
-	if (undoStack->IsTop()) return false;
-	if (undoStack)
-		return revoke(undoStack->Advance());
+	// the step undone last goes first
+	const PatternUndoStackEntry* next = undoStack ? undoStack->PeekRedo() : NULL;
+	const PatternUndoStackEntry* nextSong = songUndoStack->PeekRedo();
+	
+	if (nextSong && (next == NULL || nextSong->getSequence() < next->getSequence()))
+		return revoke(songUndoStack->Advance(), false);
+	if (next)
+		return revoke(undoStack->Advance(), false);
 	return false;
 }
 
-bool PatternEditor::revoke(const PatternUndoStackEntry* stackEntry)
+bool PatternEditor::revoke(const PatternUndoStackEntry* stackEntry, bool undo)
 {
-	const TXMPattern& stackPattern = stackEntry->GetPattern();
+	if (stackEntry == NULL)
+		return false;
+
+	// a song wide step changes patterns the player reads from directly,
+	// the copy-and-commit only covers the current pattern
+	bool songWide = false;
+	for (pp_int32 i = 0; i < stackEntry->getNumDiffs(); i++)
+		if (stackEntry->getDiff(i).getPatternIndex() >= 0)
+			songWide = true;
+
+	if (songWide)
+		EditorBase::enterCriticalSection();
 
 	enterCriticalSection();
 
 	bool res = false;
 
-	if (stackPattern.rows != pattern->rows ||
-		stackPattern.channum != pattern->channum ||
-		stackPattern.effnum != pattern->effnum)
-	{
-		pattern->rows = stackPattern.rows;
-		pattern->channum = stackPattern.channum;
-		pattern->effnum = stackPattern.effnum;
+	// while in the critical section the edited pattern is a copy
+	const TXMPattern* editedPattern = livePattern ? livePattern : pattern;
 	
-		mp_sint32 patternSize = pattern->rows*pattern->channum*(2+pattern->effnum*2);	
-
-		if (pattern->patternData)
+	for (pp_int32 i = 0; i < stackEntry->getNumDiffs(); i++)
+	{
+		const PatternUndoStackEntry::Diff& diff = stackEntry->getDiff(i);
+		
+		TXMPattern* dstPattern = pattern;
+		if (diff.getPatternIndex() >= 0)
 		{
-			delete[] pattern->patternData;
-			pattern->patternData = new mp_ubyte[patternSize];
-			memset(pattern->patternData, 0, patternSize);
+			if (module == NULL || diff.getPatternIndex() >= module->header.patnum)
+				continue;
+			
+			dstPattern = &module->phead[diff.getPatternIndex()];
+			if (dstPattern == editedPattern)
+				dstPattern = pattern;
 		}
+		
+		if (dstPattern && diff.apply(*dstPattern, undo))
+			res = true;
 	}
 	
-	if (stackPattern.rows == pattern->rows &&
-		stackPattern.channum == pattern->channum &&
-		stackPattern.effnum == pattern->effnum)
+	if (res)
 	{
-		cursor.channel = stackEntry->getCursorPositionChannel();
-		cursor.row = stackEntry->getCursorPositionRow();
-		cursor.inner = stackEntry->getCursorPositionInner();
+		const PatternUndoStackEntry::CursorPosition& position = stackEntry->getCursorPosition(undo);
+		cursor.channel = position.channel;
+		cursor.row = position.row;
+		cursor.inner = position.inner;
 		
-		pattern->decompress(stackPattern.patternData, stackPattern.len);
-
 		// keep over userdata
-		undoUserData = stackEntry->getUserData();
+		undoUserData = stackEntry->getUserData(undo);
 		notifyListener(NotificationFetchUndoData);
 
 		notifyListener(NotificationChanges);
-		res = true;
 	}
 	
 	leaveCriticalSection();
 	
+	if (songWide)
+		EditorBase::leaveCriticalSection();
+	
+	// don't merge the next step into the one before this
+	lastChange = LastChangeNone;
+	
 	return res;
 }
 
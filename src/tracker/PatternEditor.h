@@ -210,19 +210,42 @@ private:
 		
 	// undo/redo information
 	UndoStackEntry::UserData undoUserData;
-	PatternUndoStackEntry* before;
-	PPUndoStack<PatternUndoStackEntry>* undoStack;	
-	UndoHistory<TXMPattern, PatternUndoStackEntry>* undoHistory;
+	PPUndoRecordStack<PatternUndoStackEntry>* undoStack;	
+	UndoHistory<TXMPattern, PatternUndoStackEntry, PPUndoRecordStack<PatternUndoStackEntry> >* undoHistory;
+	// song wide steps don't belong to any pattern
+	PPUndoRecordStack<PatternUndoStackEntry>* songUndoStack;
+	// order of the steps on both stacks
+	pp_uint32 undoSequence;
+	// state before the current operation, see prepareUndo()
+	TXMPattern undoPattern;
+	PatternUndoStackEntry::CursorPosition undoCursor;
+	UndoStackEntry::UserData undoUserDataBefore;
+	// copy of all patterns before a song wide operation
+	TXMPattern* undoSongPatterns;
+	pp_int32 undoSongNumPatterns;
 	LastChanges lastChange;	
 	bool lastOperationDidChangeRows;
 	bool lastOperationDidChangeCursor;
 
 	TCommand effectMacros[20];
 
+	// pattern changes which reallocate the pattern data are done
+	// on a copy, the player keeps on playing the live pattern
+	TXMPattern* livePattern;
+	TXMPattern workPattern;
+	pp_int32 criticalSectionDepth;
+
+	void enterCriticalSection();
+	void leaveCriticalSection();
+
 	void prepareUndo();
 	bool finishUndo(LastChanges lastChange, bool nonRepeat = false);
 	
-	bool revoke(const PatternUndoStackEntry* stackEntry);
+	bool revoke(const PatternUndoStackEntry* stackEntry, bool undo);
+	
+	PatternUndoStackEntry::CursorPosition getUndoCursor() const;
+	bool canMergeUndo(const PatternUndoStackEntry& last, const PatternUndoStackEntry& entry, 
+					  LastChanges lastChange, bool nonRepeat) const;
 
 	void cut(ClipBoard& clipBoard);
 	void copy(ClipBoard& clipBoard);
@@ -280,8 +303,8 @@ public:
 	void decreaseCurrentOctave() { if (currentOctave > 1) currentOctave--; }	
 
 	// --- Multilevel UNDO / REDO --------------------------------------------
-	bool canUndo() const { if (undoStack) return !undoStack->IsEmpty(); else return false; }
-	bool canRedo() const { if (undoStack) return !undoStack->IsTop(); else return false; }
+	bool canUndo() const { return !songUndoStack->IsEmpty() || (undoStack && !undoStack->IsEmpty()); }
+	bool canRedo() const { return !songUndoStack->IsTop() || (undoStack && !undoStack->IsTop()); }
 	// undo last changes
 	bool undo();
 	// redo last changes
@@ -289,6 +312,11 @@ public:
 	void setUndoUserData(const void* data, pp_uint32 dataLen) { this->undoUserData = UndoStackEntry::UserData((pp_uint8*)data, dataLen); }
 	pp_uint32 getUndoUserDataLen() const { return undoUserData.getDataLen(); }
 	const void* getUndoUserData() const { return (void*)undoUserData.getData(); }
+	// operations on all patterns of the module, the changes of all
+	// patterns become a single step on the song wide undo stack, 
+	// undo/redo take the steps of both stacks in the order they were made
+	void prepareSongUndo();
+	bool finishSongUndo();
 	
 	// --- dealing with the pattern data -------------------------------------
 	void clearSelection();
@@ -69,6 +69,9 @@ PatternEditorControl::PatternEditorControl(pp_int32 id, PPScreen* parentScreen,
 	startIndex = 0;	
 	startPos = 0;
 
+	lastPaintedPattern = NULL;
+	lastPaintedStartIndex = 0;
+
 	songPos.orderListIndex = songPos.row = -1;
 
 	startSelection = false;
@@ -281,6 +284,17 @@ void PatternEditorControl::paint(PPGraphicsAbstract* g)
 			startIndex--;
 	}
 
+	// ;----------------- rows only moved, the display can move what it's got
+	if (this->pattern == lastPaintedPattern && startIndex != lastPaintedStartIndex)
+	{
+		PPRect rowArea(location.x + SCROLLBARWIDTH, location.y + SCROLLBARWIDTH + font->getCharHeight() + 4,
+					   location.x + size.width - SCROLLBARWIDTH, location.y + size.height - SCROLLBARWIDTH);
+		parentScreen->setScrollHint(rowArea, (lastPaintedStartIndex - startIndex) * (pp_int32)font->getCharHeight());
+	}
+
+	lastPaintedPattern = this->pattern;
+	lastPaintedStartIndex = startIndex;
+
 	// ;----------------- start painting rows
 	pp_int32 startx = location.x + SCROLLBARWIDTH + getRowCountWidth() + 4;
 	
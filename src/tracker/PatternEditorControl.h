@@ -148,6 +148,10 @@ private:
 	pp_int32 startIndex;
 	pp_int32 startPos;
 
+	// what the last paint has shown, for the scroll hint
+	TXMPattern* lastPaintedPattern;
+	pp_int32 lastPaintedStartIndex;
+
 	pp_int32 visibleWidth;
 	pp_int32 visibleHeight;
 	pp_int32 slotSize;
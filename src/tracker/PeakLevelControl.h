@@ -49,6 +49,8 @@ private:
 	pp_int32 visibleHeight;
 
 	pp_int32 peak[2];
+	// DSP load, shown in a strip below the peaks
+	pp_int32 load;
 	
 	pp_uint8 peakColorLUT[256][3];
 
@@ -69,6 +71,10 @@ public:
 	void setPeak(pp_int32 whichPeak, pp_int32 p) { if (p>65536) p = 65536; if (p < 0) p = 0; peak[whichPeak] = p; }
 	pp_int32 getPeak(pp_int32 whichPeak) const { return peak[whichPeak]; } 
 
+	// 65536 is a fully loaded audio thread
+	void setLoad(pp_int32 l) { if (l>65536) l = 65536; if (l < 0) l = 0; load = l; }
+	pp_int32 getLoad() const { return load; }
+
 	// from PPControl
 	virtual void paint(PPGraphicsAbstract* graphics);
 	
@@ -52,24 +52,10 @@ public:
 		{			
 			mp_sint32 idx = rbReadIndex & (UPDATEBUFFSIZE-1);			
 			
-			// handle notes that are played from external source
-			// i.e. keyboard playback
+			// handle samples that are played from external source
+			// i.e. sample editor playback (notes go through the mixer's live events)
 			switch (updateCommandBuff[idx].code)
 			{
-				case UpdateCommandCodeNote:
-				{
-					UpdateCommandNote* command = reinterpret_cast<UpdateCommandNote*>(&updateCommandBuff[idx]);
-					mp_sint32 note = command->note;
-					if (note)
-					{
-						player.playNote(command->channel, note, 
-										command->ins, 
-										command->volume);
-						command->note = 0;
-					}
-					break;
-				}
-
 				case UpdateCommandCodeSample:
 				{
 					UpdateCommandSample* command = reinterpret_cast<UpdateCommandSample*>(&updateCommandBuff[idx]);
@@ -94,21 +80,6 @@ public:
 		handleQueuedPositions(player, newOrderIndex);
 	}
 
-	void playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 ins, mp_sint32 vol/* = -1*/)
-	{	
-		// fill ring buffer with note entries
-		// the callback will query these notes and play them 
-		mp_sint32 idx = rbWriteIndex & (UPDATEBUFFSIZE-1);
-		UpdateCommandNote* command = reinterpret_cast<UpdateCommandNote*>(&updateCommandBuff[idx]);
-		command->channel = chn;
-		command->ins = ins;
-		command->volume = vol;
-		command->note = note;
-		// code needs to be filled in last
-		command->code = UpdateCommandCodeNote;
-		rbWriteIndex++;
-	}
-
 	void playSample(mp_ubyte chn, const TXMSample& smp, mp_sint32 currentSamplePlayNote, mp_sint32 rangeStart, mp_sint32 rangeEnd)
 	{
 		// fill ring buffer with sample playback entries
@@ -205,7 +176,6 @@ private:
 	enum UpdateCommandCodes
 	{
 		UpdateCommandCodeInvalid = 0,
-		UpdateCommandCodeNote,
 		UpdateCommandCodeSample,
 	};
 	
@@ -216,17 +186,6 @@ private:
 		void* pdata[8];
 	};
 
-	struct UpdateCommandNote
-	{
-		mp_ubyte code;			
-		mp_sint32 note;
-		mp_sint32 channel;
-		mp_sint32 ins;
-		mp_sint32 volume;
-		mp_uint32 data[4];
-		void* pdata[8];
-	};
-	
 	struct UpdateCommandSample
 	{
 		mp_ubyte code;
@@ -304,6 +263,10 @@ PlayerController::PlayerController(MasterMixer* mixer, bool fakeScopes) :
 	player->setPlayMode(PlayerBase::PlayMode_FastTracker2);
 	player->resetMainVolumeOnStartPlay(false);
 	player->setBufferSize(mixer->getBufferSize());
+	player->setNumBuffersAhead(mixer->getNumBuffersAhead());
+	// the scopes show what the mixer has actually played
+	if (!fakeScopes)
+		player->setNumChannelScopes(numPlayerChannels);
 
 	currentPlayingChannel = useVirtualChannels ? numPlayerChannels : 0;
 	
@@ -777,14 +740,28 @@ void PlayerController::stopInstrument(mp_sint32 insIndex)
 }
 
 void PlayerController::playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 i, mp_sint32 vol/* = -1*/)
+{
+	if (!player)
+		return;
+		
+	playNote(chn, note, i, vol, getSyncSampleCounter());
+}
+
+void PlayerController::playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 i, mp_sint32 vol, mp_uint32 triggerTime)
 {
 	if (!player)
 		return;
 		
 	assureNotSuspended();
 
-	// note playing goes synchronized in the playback callback
-	playerStatusTracker->playNote(chn, note, i, vol);
+	// the mixer starts the note at the sample it has been triggered on,
+	// it's ahead of what's played by the buffers the driver has queued
+	player->postLiveEvent(chn, note, i, vol, triggerTime - (mp_uint32)getCurrentSamplePosition());
+}
+
+mp_uint32 PlayerController::getSyncSampleCounter()
+{
+	return player ? player->getSyncSampleCounter(getCurrentSamplePosition()) : 0;
 }
 
 void PlayerController::suspendPlayer(bool bResetMainVolume/* = true*/, bool stopPlaying/* = true*/)
@@ -817,6 +794,50 @@ void PlayerController::resumePlayer(bool continuePlaying)
 	}
 }
 
+void PlayerController::commitEdit(ChannelMixer::SyncedCommit& commit)
+{
+	// player is not being mixed, no need to synchronize
+	if (!player || suspended || !mixer->isActive() ||
+		mixer->isDeviceRemoved(player) || mixer->isDevicePaused(player))
+	{
+		commit.commit(player);
+		return;
+	}
+
+	const mp_uint32 numExecutedCommits = player->getNumExecutedCommits();
+
+	if (player->postCommit(&commit))
+	{
+		// the mixer should pick up the commit within the next buffer
+		mp_uint32 waitMillis = (mp_uint32)(((double)(mixer->getBufferSize()/2) / (double)mixer->getSampleRate()) * 1000.0 * 2.0);
+		if (waitMillis < 10)
+			waitMillis = 10;
+
+		mp_uint32 time = 0;
+		while (player->getNumExecutedCommits() == numExecutedCommits && time < waitMillis)
+		{
+			System::msleep(1);
+			time++;
+		}
+
+		if (player->getNumExecutedCommits() != numExecutedCommits)
+			return;
+
+		// mixer has already taken it, it's about to be done
+		if (!player->revokeCommit(&commit))
+		{
+			while (player->getNumExecutedCommits() == numExecutedCommits)
+				System::msleep(1);
+			return;
+		}
+	}
+
+	// audio device seems to be stuck, fall back to pausing the player
+	mixer->pauseDevice(player);
+	commit.commit(player);
+	mixer->resumeDevice(player);
+}
+
 void PlayerController::muteChannel(mp_sint32 c, bool m)
 {
 	muteChannels[c] = m;
@@ -875,6 +896,17 @@ void PlayerController::reallocateChannels(mp_sint32 moduleChannels/* = 32*/, mp_
 	numVirtualChannels = virtualChannels;
 	totalPlayerChannels = numPlayerChannels + numVirtualChannels + 2;
 
+	if (player && player->getNumChannelScopes() && 
+		player->getNumChannelScopes() != (unsigned)numPlayerChannels)
+	{
+		// the scope taps can't be replaced while the player is mixing
+		const bool wasSuspended = suspended;
+		suspendPlayer(false, false);
+		player->setNumChannelScopes(numPlayerChannels);
+		if (!wasSuspended)
+			resumePlayer(false);
+	}
+
 	reallocChannels();
 }
 
@@ -1028,6 +1060,12 @@ void PlayerController::getPosition(mp_sint32& order, mp_sint32& row, mp_sint32&
 	player->getPosition(order, row, ticker, index);
 }
 
+void PlayerController::getPosition(mp_sint32& order, mp_sint32& row, mp_sint32& ticker, mp_uint32 triggerTime)
+{
+	mp_uint32 index = player->getBeatIndexFromSyncSampleCounter(triggerTime);	
+	player->getPosition(order, row, ticker, index);
+}
+
 void PlayerController::setPatternPos(mp_sint32 pos, mp_sint32 row)
 {
 	player->setPatternPos(pos, row, false, false);
@@ -1285,6 +1323,27 @@ void PlayerController::grabSampleData(mp_uint32 chnIndex, mp_sint32 count, mp_si
 		mixerDataCache = new mp_sint32[mixerDataCacheSize];
 	}
 	
+	// read what the mixer has played on this channel from its scope tap,
+	// fMul is the number of frames shown
+	if (chnIndex < player->getNumChannelScopes())
+	{
+		mp_sint32 numFrames = fMul >> player->getChannelScopeDecimationShift();
+		if (numFrames < 1)
+			numFrames = 1;
+		if (numFrames*2 > mixerDataCacheSize)
+			numFrames = mixerDataCacheSize >> 1;
+
+		player->readChannelScope(chnIndex, getCurrentSamplePosition(), mixerDataCache, numFrames);
+		
+		for (mp_sint32 i = 0; i < count; i++)
+		{
+			const mp_sint32* frame = mixerDataCache + ((i*numFrames) / count)*2;
+			// fold down to mono, a centered channel keeps its full level
+			fetcher.fetchSampleData((((frame[0]>>1) + (frame[1]>>1))*181)>>7);
+		}
+		return;
+	}
+
 	ChannelMixer* mixer = player;
 
 	ChannelMixer::TMixerChannel* chn = &mixer->channel[chnIndex];
@@ -32,6 +32,7 @@
 #define __PLAYERCONTROLLER_H__
 
 #include "MilkyPlayCommon.h"
+#include "ChannelMixer.h"
 #include "TrackerConfig.h"
 
 class XModule;
@@ -152,9 +153,18 @@ public:
 
 	void playNote(mp_ubyte chn, 
 				  mp_sint32 note, mp_sint32 i, mp_sint32 vol = -1);
+	// play a note at the sync sample counter it has been triggered on
+	void playNote(mp_ubyte chn, 
+				  mp_sint32 note, mp_sint32 i, mp_sint32 vol, mp_uint32 triggerTime);
+	
+	// now, as a trigger time for playNote()
+	mp_uint32 getSyncSampleCounter();
 
 	void suspendPlayer(bool bResetMainVolume = true, bool stopPlaying = true);	
 	void resumePlayer(bool continuePlaying);
+	
+	// execute a commit in between two beat packets of the running player
+	void commitEdit(ChannelMixer::SyncedCommit& commit);
 
 	void muteChannel(mp_sint32 c, bool m);
 	bool isChannelMuted(mp_sint32 c);
@@ -191,6 +201,8 @@ public:
 
 	void getPosition(mp_sint32& pos, mp_sint32& row);
 	void getPosition(mp_sint32& order, mp_sint32& row, mp_sint32& ticker);
+	// position a note triggered at triggerTime is played at
+	void getPosition(mp_sint32& order, mp_sint32& row, mp_sint32& ticker, mp_uint32 triggerTime);
 	void setPatternPos(mp_sint32 pos, mp_sint32 row);
 	
 	// change playmode
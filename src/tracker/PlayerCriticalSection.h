@@ -61,6 +61,12 @@ public:
 		playerController.resumePlayer(continuePlaying);
 		enabled = false;
 	}
+	
+	// doesn't stop the player, see PlayerController::commitEdit
+	void commit(ChannelMixer::SyncedCommit& commit)
+	{
+		playerController.commitEdit(commit);
+	}
 };
 
 #endif
@@ -277,4 +277,11 @@ void PlayerLogic::playNote(class PlayerController& playerController,
 {
 	playerController.playNote(chn, note, i, vol);
 }
+
+void PlayerLogic::playNote(class PlayerController& playerController, 
+						   pp_uint8 chn, 
+						   pp_int32 note, pp_int32 i, pp_int32 vol, pp_uint32 triggerTime)
+{
+	playerController.playNote(chn, note, i, vol, triggerTime);
+}
 						   
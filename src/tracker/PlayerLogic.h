@@ -79,6 +79,9 @@ public:
 	static void playNote(class PlayerController& playerController, 
 						 pp_uint8 chn, 
 						 pp_int32 note, pp_int32 i, pp_int32 vol = -1);
+	static void playNote(class PlayerController& playerController, 
+						 pp_uint8 chn, 
+						 pp_int32 note, pp_int32 i, pp_int32 vol, pp_uint32 triggerTime);
 	
 	friend class Tracker;
 };
@@ -30,12 +30,15 @@
 
 #include "PlayerMaster.h"
 #include "MasterMixer.h"
+#include "MixerStatistics.h"
+#include "XMFile.h"
 #include "SimpleVector.h"
 #include "PlayerController.h"
 #include "PlayerCriticalSection.h"
 #include "AudioDriverManager.h"
 #include "PlayerSTD.h"
 #include "ResamplerHelper.h"
+#include "PPSystem.h"
 
 class MasterMixerNotificationListener : public MasterMixer::MasterMixerNotificationListener
 {
@@ -65,6 +68,7 @@ void PlayerMaster::adjustSettings()
 
 		player->setBufferSize(bufferSize);
 		player->adjustFrequency(sampleRate);
+		player->setNumBuffersAhead(mixer->getNumBuffersAhead());
 
 		if (!player->isPlaying())
 			player->resumePlaying(false);
@@ -159,7 +163,8 @@ PlayerMaster::PlayerMaster(pp_uint32 numDevices/* = DefaultMaxDevices*/) :
 	oldBufferSize(getPreferredBufferSize()),
 	forcePowerOfTwoBufferSize(false),
 	multiChannelKeyJazz(true),
-	multiChannelRecord(true)	
+	multiChannelRecord(true),
+	dspTraceFile(NULL)
 {
 	listener = new MasterMixerNotificationListener(*this);
 
@@ -191,6 +196,8 @@ PlayerMaster::PlayerMaster(pp_uint32 numDevices/* = DefaultMaxDevices*/) :
 
 PlayerMaster::~PlayerMaster()
 {
+	setDSPTraceFile(PPSystemString());
+	
 	delete playerControllers;
 	delete mixer;
 	delete listener;
@@ -277,6 +284,32 @@ bool PlayerMaster::applyNewMixerSettings(const TMixerSettings& settings, bool al
 		mixer->setSampleShift(settings.mixerShift);
 	}
 
+	if (settings.floatMasterBus >= 0)
+	{
+		currentSettings.floatMasterBus = settings.floatMasterBus;
+		mixer->setFloatBus(settings.floatMasterBus != 0);
+	}
+
+	if (settings.numMixerThreads >= 0)
+	{
+		currentSettings.numMixerThreads = settings.numMixerThreads;
+		if (mixer->getNumMixerThreads() != (mp_uint32)settings.numMixerThreads)
+		{
+			mixer->setNumMixerThreads(settings.numMixerThreads);
+			restart = true;
+		}
+	}
+
+	if (settings.numBuffersAhead >= 0)
+	{
+		currentSettings.numBuffersAhead = settings.numBuffersAhead;
+		if (mixer->getNumBuffersAhead() != (mp_uint32)settings.numBuffersAhead)
+		{
+			mixer->setNumBuffersAhead(settings.numBuffersAhead);
+			restart = true;
+		}
+	}
+
 	if (settings.powerOfTwoCompensation >= 0)
 	{
 		currentSettings.powerOfTwoCompensation = settings.powerOfTwoCompensation;
@@ -442,6 +475,48 @@ void PlayerMaster::getCurrentSamplePeak(pp_int32& left, pp_int32& right)
 	right = mixer->getCurrentSamplePeak(pos, 1);
 }
 
+void PlayerMaster::getDSPLoad(pp_int32& load, pp_int32& numXRuns)
+{
+	MixerStatistics& statistics = mixer->getStatistics();
+	
+	load = mixer->isActive() ? statistics.getAverageLoad() : 0;
+	numXRuns = statistics.getNumXRuns();
+}
+
+bool PlayerMaster::setDSPTraceFile(const PPSystemString& fileName)
+{
+	MixerStatistics& statistics = mixer->getStatistics();
+	
+	if (dspTraceFile)
+	{
+		statistics.setTraceEnabled(false);
+		statistics.writeTrace(*dspTraceFile);
+		delete dspTraceFile;
+		dspTraceFile = NULL;
+	}
+	
+	if (fileName.length() == 0)
+		return true;
+	
+	dspTraceFile = new XMFile(fileName, true);
+	if (!dspTraceFile->isOpenForWriting())
+	{
+		delete dspTraceFile;
+		dspTraceFile = NULL;
+		return false;
+	}
+	
+	statistics.writeTrace(*dspTraceFile, true);
+	statistics.setTraceEnabled(true);
+	return true;
+}
+
+void PlayerMaster::flushDSPTrace()
+{
+	if (dspTraceFile)
+		mixer->getStatistics().writeTrace(*dspTraceFile);
+}
+
 void PlayerMaster::resetQueuedPositions()
 {
 	for (pp_int32 i = 0; i < playerControllers->size(); i++)
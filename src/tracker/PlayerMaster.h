@@ -50,6 +50,13 @@ struct TMixerSettings
 	pp_int32 resampler;
 	// 0 = false, 1 = true, negative values means ignore 
 	pp_int32 ramping;
+	// 0 = false, 1 = true, negative values means ignore 
+	pp_int32 floatMasterBus;
+	// worker threads mixing the devices, each one spins on a core while
+	// a buffer is mixed, negative values means ignore
+	pp_int32 numMixerThreads;
+	// buffers mixed ahead of the audio device, negative values means ignore
+	pp_int32 numBuffersAhead;
 	// NULL means ignore
 	char* audioDriverName;
 	// 0 means disable virtual channels, negative value means ignore
@@ -63,6 +70,9 @@ struct TMixerSettings
 		powerOfTwoCompensation(-1),
 		resampler(-1),
 		ramping(-1),
+		floatMasterBus(-1),
+		numMixerThreads(-1),
+		numBuffersAhead(-1),
 		audioDriverName(NULL),
 		numVirtualChannels(-1)
 	{
@@ -108,6 +118,15 @@ struct TMixerSettings
 		if (ramping != source.ramping)
 			return false;
 
+		if (floatMasterBus != source.floatMasterBus)
+			return false;
+
+		if (numMixerThreads != source.numMixerThreads)
+			return false;
+
+		if (numBuffersAhead != source.numBuffersAhead)
+			return false;
+
 		if (numVirtualChannels != source.numVirtualChannels)
 			return false;
 
@@ -124,6 +143,7 @@ struct TMixerSettings
 template<class Type>
 class PPSimpleVector;
 class PlayerController;
+class PPSystemString;
 
 class PlayerMaster
 {
@@ -147,6 +167,8 @@ private:
 	bool multiChannelKeyJazz;
 	bool multiChannelRecord;
 	
+	class XMFile* dspTraceFile;
+	
 	void adjustSettings();
 	void applySettingsToPlayerController(PlayerController& playerController, const TMixerSettings& settings);
 	
@@ -188,6 +210,16 @@ public:
 	
 	void getCurrentSamplePeak(pp_int32& left, pp_int32& right);
 	
+	// average load of the audio thread in 1/10 percent of the buffer
+	// duration and the number of xruns the audio driver has counted
+	void getDSPLoad(pp_int32& load, pp_int32& numXRuns);
+	
+	// Record the timing of every mixed buffer into a CSV file, an empty
+	// file name stops recording. The trace is written by flushDSPTrace(), 
+	// call that regularly (a few times per second is fine).
+	bool setDSPTraceFile(const PPSystemString& fileName);
+	void flushDSPTrace();
+	
 	void resetQueuedPositions();
 	
 	friend class MasterMixerNotificationListener;
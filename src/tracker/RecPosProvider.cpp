@@ -37,6 +37,20 @@ void RecPosProvider::getPosition(pp_int32& order, pp_int32& row, pp_int32& ticke
 	if (playerController.isPlayingPattern())
 		order = -1;
 	
+	roundPosition(order, row, ticker);
+}
+
+void RecPosProvider::getPosition(pp_int32& order, pp_int32& row, pp_int32& ticker, pp_uint32 triggerTime)
+{
+	playerController.getPosition((mp_sint32&)order, (mp_sint32&)row, (mp_sint32&)ticker, triggerTime);
+	if (playerController.isPlayingPattern())
+		order = -1;
+	
+	roundPosition(order, row, ticker);
+}
+
+void RecPosProvider::roundPosition(pp_int32& order, pp_int32& row, pp_int32& ticker)
+{
 	if (roundToClosestRow)
 	{
 		mp_sint32 speed, bpm;
@@ -29,6 +29,8 @@ private:
 	
 	bool roundToClosestRow;
 	
+	void roundPosition(pp_int32& order, pp_int32& row, pp_int32& ticker);
+	
 public:
 	RecPosProvider(PlayerController& playerController) :
 		playerController(playerController),
@@ -38,5 +40,7 @@ public:
 	
 	void getPosition(pp_int32& order, pp_int32& row);
 	void getPosition(pp_int32& order, pp_int32& row, pp_int32& ticker);	
+	// position of a note triggered at triggerTime (see PlayerController::getSyncSampleCounter())
+	void getPosition(pp_int32& order, pp_int32& row, pp_int32& ticker, pp_uint32 triggerTime);
  };
  
@@ -68,6 +68,10 @@ void RecorderLogic::sendNoteDownToPatternEditor(PPEvent* event, pp_int32 note, P
 	PlayerController* playerController = tracker.playerController;
 	PatternEditor* patternEditor = patternEditorControl->getPatternEditor();
 
+	// play and record the note at the time the key has been pressed,
+	// not when we're done figuring out where it goes
+	const pp_uint32 triggerTime = playerController->getSyncSampleCounter();
+
 	pp_int32 i;
 	
 	if (note >= 1 && note != PatternTools::getNoteOffNote() /* Key Off */)
@@ -171,7 +175,7 @@ void RecorderLogic::sendNoteDownToPatternEditor(PPEvent* event, pp_int32 note, P
 		
 		// if we are recording we are doing a query on the current position
 		if (isLiveRecording)
-			recPosProvider.getPosition(pos, row, ticker);
+			recPosProvider.getPosition(pos, row, ticker, triggerTime);
 		else
 		{
 			pos = row = -1;
@@ -202,7 +206,7 @@ void RecorderLogic::sendNoteDownToPatternEditor(PPEvent* event, pp_int32 note, P
 			
 			// play it
 			tracker.playerLogic->playNote(*playerController, (mp_ubyte)chn, note, 
-										  (mp_ubyte)ins, keyVolume);
+										  (mp_ubyte)ins, keyVolume, triggerTime);
 			
 			// if we're recording send the note to the pattern editor
 			if (isLiveRecording)
@@ -260,6 +264,8 @@ void RecorderLogic::sendNoteUpToPatternEditor(PPEvent* event, pp_int32 note, Pat
 				PlayerController* playerController = tracker.playerController;
 				if (keys[i].playerController)
 					playerController = keys[i].playerController;
+				
+				const pp_uint32 triggerTime = playerController->getSyncSampleCounter();
 			
 				bool isLiveRecording = playerController->isPlaying() && 
 									   !playerController->isPlayingRowOnly() &&
@@ -270,7 +276,7 @@ void RecorderLogic::sendNoteUpToPatternEditor(PPEvent* event, pp_int32 note, Pat
 				RecPosProvider recPosProvider(*playerController);
 				if (isLiveRecording)
 				{
-					recPosProvider.getPosition(pos, row, ticker);
+					recPosProvider.getPosition(pos, row, ticker, triggerTime);
 					if (pos == -1)
 						recPat = true;
 				}
@@ -282,7 +288,7 @@ void RecorderLogic::sendNoteUpToPatternEditor(PPEvent* event, pp_int32 note, Pat
 				// send key off
 				tracker.playerLogic->playNote(*playerController, (mp_ubyte)keys[i].channel, 
 											  PatternTools::getNoteOffNote(), 
-											  keys[i].ins);
+											  keys[i].ins, -1, triggerTime);
 				
 				if (isLiveRecording && recordKeyOff)
 				{														
@@ -127,10 +127,7 @@ void SampleEditor::ClipBoard::paste(TXMSample& sample, XModule& module, pp_int32
 		// copy stuff after insert start point
 		for (i = 0;  i < ((signed)sample.samplen - pos); i++)
 			sample.setSampleValue((mp_ubyte*)newBuffer, i+pos+selectionWidth, sample.getSampleValue(i+pos));
-	
-		if (sample.sample)
-			module.freeSampleMem((mp_ubyte*)sample.sample);
-		
+
 		sample.sample = (mp_sbyte*)newBuffer;
 	}
 	else
@@ -149,9 +146,6 @@ void SampleEditor::ClipBoard::paste(TXMSample& sample, XModule& module, pp_int32
 		for (i = 0;  i < ((signed)sample.samplen - pos); i++)
 			sample.setSampleValue((mp_ubyte*)newBuffer, i+pos+selectionWidth, sample.getSampleValue(i+pos));
 
-		if (sample.sample)
-			module.freeSampleMem((mp_ubyte*)sample.sample);
-
 		sample.sample = newBuffer;
 	}
 
@@ -171,10 +165,27 @@ void SampleEditor::ClipBoard::paste(TXMSample& sample, XModule& module, pp_int32
 
 }
 
+void SampleEditor::markChanged(pp_int32 start, pp_int32 end)
+{
+	if (changedStart >= changedEnd)
+	{
+		changedStart = start;
+		changedEnd = end;
+		return;
+	}
+	
+	if (start < changedStart)
+		changedStart = start;
+	if (end > changedEnd)
+		changedEnd = end;
+}
+
 void SampleEditor::prepareUndo()
 {
 	delete before; 
 	before = NULL; 
+	
+	operationDidWrite = false;
 		
 	if (undoStackEnabled && undoStackActivated && undoStack) 
 	{
@@ -190,6 +201,11 @@ void SampleEditor::prepareUndo()
 
 void SampleEditor::finishUndo()
 {
+	// operation didn't go through setFloatSampleInWaveform(), 
+	// we don't know which part of the sample has been changed
+	if (!operationDidWrite)
+		markChanged(0, 0x7FFFFFFF);
+
 	if (undoStackEnabled && undoStackActivated && undoStack) 
 	{ 
 		// first of all the listener should get the chance to adjust
@@ -228,6 +244,9 @@ bool SampleEditor::revoke(const SampleUndoStackEntry* stackEntry)
 	 if (undoStack == NULL || !undoStackEnabled)
 		return false;
 		
+	// the restored sample data replaces the current one
+	enterCriticalSection(false);
+
 	sample->samplen = stackEntry->getSampLen();
 	sample->loopstart = stackEntry->getLoopStart(); 
 	sample->looplen = stackEntry->getLoopLen(); 
@@ -238,30 +257,27 @@ bool SampleEditor::revoke(const SampleUndoStackEntry* stackEntry)
 	setSelectionStart(stackEntry->getSelectionStart());
 	setSelectionEnd(stackEntry->getSelectionEnd());
 	
-	enterCriticalSection();
-	
 	// free old sample memory
-	if (sample->sample)
-	{
-		module->freeSampleMem((mp_ubyte*)sample->sample);
-		sample->sample = NULL;
-	}
+	freeSampleData(sample->sample);
+	sample->sample = NULL;
 	
-	if (stackEntry->getBuffer())
+	if (stackEntry->hasBuffer())
 	{			
-		if (sample->type & 16)
-		{
-			sample->sample = (mp_sbyte*)module->allocSampleMem(sample->samplen*2);
-			TXMSample::copyPaddedMem(sample->sample, stackEntry->getBuffer(), sample->samplen*2);
-		}
-		else
+		const mp_uint32 size = (sample->type & 16) ? sample->samplen*2 : sample->samplen;
+		
+		sample->sample = (mp_sbyte*)module->allocSampleMem(size);
+		if (sample->sample && !stackEntry->restoreBuffer(sample->sample))
 		{
-			sample->sample = (mp_sbyte*)module->allocSampleMem(sample->samplen);
-			TXMSample::copyPaddedMem(sample->sample, stackEntry->getBuffer(), sample->samplen);
+			// undo swap file couldn't be read, rather silence than garbage
+			module->freeSampleMem((mp_ubyte*)sample->sample);
+			sample->sample = (mp_sbyte*)module->allocSampleMem(size);
+			if (sample->sample)
+				memset(sample->sample, 0, size);
 		}
 	}
 	
 	leaveCriticalSection();
+	markChanged(0, 0x7FFFFFFF);
 	undoUserData = stackEntry->getUserData();
 	notifyListener(NotificationFetchUndoData);
 	notifyListener(NotificationChanges);
@@ -286,6 +302,106 @@ void SampleEditor::notifyChanges(bool condition, bool lazy/* = true*/)
 	}
 }
 
+class SampleCommit : public ChannelMixer::SyncedCommit
+{
+private:
+	TXMSample& liveSample;
+	const TXMSample& workSample;
+
+public:
+	SampleCommit(TXMSample& liveSample, const TXMSample& workSample) :
+		liveSample(liveSample),
+		workSample(workSample)
+	{
+	}
+	
+	virtual void commit(ChannelMixer* mixer)
+	{
+		const mp_sbyte* oldSample = liveSample.sample;
+		
+		liveSample = workSample;
+
+		if (mixer)
+			mixer->replaceSample(oldSample, liveSample.sample, liveSample.samplen, (liveSample.type & 16) != 0);
+	}
+};
+
+void SampleEditor::enterCriticalSection(bool copySampleData/* = true*/)
+{
+	if (criticalSectionDepth++)
+		return;
+
+	liveSample = NULL;
+	workSampleShared = false;
+	if (sample == NULL || module == NULL)
+	{
+		EditorBase::enterCriticalSection();
+		return;
+	}
+	
+	// work on a copy of the sample data, the player is not stopped
+	workSample = *sample;
+	if (sample->sample && !copySampleData)
+	{
+		workSampleShared = true;
+	}
+	else if (sample->sample)
+	{
+		mp_uint32 size = TXMSample::getSampleSizeInBytes((mp_ubyte*)sample->sample);
+		workSample.sample = (mp_sbyte*)module->allocSampleMem(size);
+		if (workSample.sample == NULL)
+		{
+			EditorBase::enterCriticalSection();
+			return;
+		}
+		TXMSample::copyPaddedMem(workSample.sample, sample->sample, size);
+	}
+	
+	liveSample = sample;
+	sample = &workSample;
+}
+
+void SampleEditor::leaveCriticalSection()
+{
+	if (--criticalSectionDepth)
+		return;
+
+	if (liveSample == NULL)
+	{
+		EditorBase::leaveCriticalSection();
+		return;
+	}
+	
+	mp_sbyte* oldSample = liveSample->sample;
+	// buffer has only been modified in place by the operation
+	bool inPlace = !workSampleShared && (lastSample.sample == oldSample) && (workSample.sample != NULL);
+	
+	// the player is still reading shared data which hasn't been replaced
+	if (!workSampleShared || workSample.sample != oldSample)
+		workSample.postProcessSamples();
+	
+	SampleCommit commit(*liveSample, workSample);
+	commitCriticalSection(commit);
+
+	// the player doesn't use the old buffer anymore
+	if (oldSample && oldSample != liveSample->sample)
+		module->freeSampleMem((mp_ubyte*)oldSample);
+	
+	sample = liveSample;
+	liveSample = NULL;
+
+	// don't let attachSample() take the copy for a different sample
+	if (inPlace && lastSample.samplen == sample->samplen)
+		lastSample.sample = sample->sample;
+}
+
+void SampleEditor::freeSampleData(mp_sbyte* data)
+{
+	// data the player is using is freed by leaveCriticalSection()
+	if (data && (liveSample == NULL || data != liveSample->sample))
+		module->freeSampleMem((mp_ubyte*)data);
+}
+
 SampleEditor::SampleEditor() :
 	EditorBase(),
 	sample(NULL),
@@ -297,6 +413,12 @@ SampleEditor::SampleEditor() :
 	lastOperation(OperationRegular),
 	drawing(false),
 	lastSamplePos(-1),
+	changedStart(0),
+	changedEnd(0),
+	operationDidWrite(false),
+	liveSample(NULL),
+	criticalSectionDepth(0),
+	workSampleShared(false),
 	lastParameters(NULL),
 	lastFilterFunc(NULL)
 {
@@ -891,12 +1013,21 @@ bool SampleEditor::cutSampleInternal()
 	if (sStart == sEnd)
 		return false;
 
-	// reset loop area double buffer to original sample state
-	// (switch buffering off)
-	sample->restoreOriginalState();
+	// build the remaining sample data in a new buffer, the old one
+	// might still be played
+	const pp_uint32 newSampleSize = sample->samplen - (sEnd - sStart);
+	mp_ubyte* newBuffer = module->allocSampleMem((sample->type & 16) ? newSampleSize*2 : newSampleSize);
+	if (newBuffer == NULL)
+		return false;
+
+	pp_uint32 i;
+	for (i = 0; i < (unsigned)sStart; i++)
+		sample->setSampleValue(newBuffer, i, sample->getSampleValue(i));
+	for (i = sEnd; i < sample->samplen; i++)
+		sample->setSampleValue(newBuffer, (i-sEnd)+sStart, sample->getSampleValue(i));
 
-	for (pp_uint32 i = selectionEnd; i <= sample->samplen; i++)
-		sample->setSampleValue((i-selectionEnd)+selectionStart, sample->getSampleValue(i));
+	freeSampleData(sample->sample);
+	sample->sample = (mp_sbyte*)newBuffer;
 
 	mp_sint32 sLoopStart = sample->loopstart;
 	if (sEnd < (signed)sample->loopstart + (signed)sample->looplen)
@@ -919,7 +1050,7 @@ void SampleEditor::cut()
 		return;
 
 	// we're going to change the sample buffers, better stop
-	enterCriticalSection();
+	enterCriticalSection(false);
 	// undo stuff going on
 	prepareUndo();
 
@@ -959,7 +1090,7 @@ void SampleEditor::paste()
 	if (sample == NULL)
 		return;
 
-	enterCriticalSection();
+	enterCriticalSection(false);
 
 	prepareUndo();
 
@@ -973,7 +1104,9 @@ void SampleEditor::paste()
 		sample->looplen = looplen;
 	}
 
+	mp_sbyte* oldSample = sample->sample;
 	ClipBoard::getInstance()->paste(*sample, *module, getSelectionStart());
+	freeSampleData(oldSample);
 
 	setSelectionEnd(getSelectionStart() + ClipBoard::getInstance()->getWidth());
 
@@ -997,13 +1130,13 @@ SampleEditor::WorkSample* SampleEditor::createWorkSample(pp_uint32 size, pp_uint
 
 void SampleEditor::pasteOther(WorkSample& src)
 {
-	enterCriticalSection();
+	enterCriticalSection(false);
 
 	prepareUndo();
 
 	if (sample->sample)
 	{
-		module->freeSampleMem((mp_ubyte*)sample->sample);
+		freeSampleData(sample->sample);
 		sample->sample = NULL;
 		sample->samplen = 0;
 	}
@@ -1092,6 +1225,120 @@ void SampleEditor::setFloatSampleInWaveform(pp_int32 index, float singleSample,
 		else
 			sample->setSampleValue(index, s);
 	}
+	
+	if (!src)
+	{
+		markChanged(index, index+1);
+		operationDidWrite = true;
+	}
+}
+
+// the buffer differs from the sample data around the loop start and
+// end (loop area backup), these samples go through get/setSampleValue
+pp_int32 SampleEditor::getNextLoopAreaIndex(pp_int32 index, pp_int32 end, bool& inLoopArea) const
+{
+	inLoopArea = false;
+	if (!(sample->type & 3))
+		return end;
+
+	// more than the actual size of the backup area
+	const pp_int32 areaSize = 16;
+	const pp_int32 areas[2] = {(pp_int32)sample->loopstart, (pp_int32)(sample->loopstart + sample->looplen)};
+	
+	pp_int32 next = end;
+	for (pp_int32 i = 0; i < 2; i++)
+	{
+		if (index >= areas[i] && index < areas[i] + areaSize)
+		{
+			inLoopArea = true;
+			return areas[i] + areaSize < end ? areas[i] + areaSize : end;
+		}
+		if (areas[i] > index && areas[i] < next)
+			next = areas[i];
+	}
+	
+	return next;
+}
+
+void SampleEditor::getFloatSamplesFromWaveform(pp_int32 start, pp_int32 count, float* dest)
+{
+	const pp_int32 end = start + count;
+	
+	while (start < end)
+	{
+		bool inLoopArea;
+		pp_int32 next = getNextLoopAreaIndex(start, end, inLoopArea);
+		
+		if (inLoopArea)
+		{
+			for (pp_int32 i = start; i < next; i++)
+				*dest++ = getFloatSampleFromWaveform(i);
+		}
+		else if (sample->type & 16)
+		{
+			const mp_sword* src = (const mp_sword*)sample->sample;
+			for (pp_int32 i = start; i < next; i++)
+			{
+				const mp_sword s = src[i];
+				*dest++ = s > 0 ? (float)s*(1.0f/32767.0f) : (float)s*(1.0f/32768.0f);
+			}
+		}
+		else
+		{
+			const mp_sbyte* src = sample->sample;
+			for (pp_int32 i = start; i < next; i++)
+			{
+				const mp_sbyte s = src[i];
+				*dest++ = s > 0 ? (float)s*(1.0f/127.0f) : (float)s*(1.0f/128.0f);
+			}
+		}
+		
+		start = next;
+	}
+}
+
+void SampleEditor::setFloatSamplesInWaveform(pp_int32 start, pp_int32 count, const float* src)
+{
+	const pp_int32 end = start + count;
+	
+	markChanged(start, end);
+	operationDidWrite = true;
+	
+	while (start < end)
+	{
+		bool inLoopArea;
+		pp_int32 next = getNextLoopAreaIndex(start, end, inLoopArea);
+		
+		if (inLoopArea)
+		{
+			for (pp_int32 i = start; i < next; i++)
+				setFloatSampleInWaveform(i, *src++);
+		}
+		else if (sample->type & 16)
+		{
+			mp_sword* dest = (mp_sword*)sample->sample;
+			for (pp_int32 i = start; i < next; i++)
+			{
+				float f = *src++;
+				if (f > 1.0f) f = 1.0f;
+				if (f < -1.0f) f = -1.0f;
+				dest[i] = f > 0 ? (mp_sword)(f*32767.0f+0.5f) : (mp_sword)(f*32768.0f-0.5f);
+			}
+		}
+		else
+		{
+			mp_sbyte* dest = sample->sample;
+			for (pp_int32 i = start; i < next; i++)
+			{
+				float f = *src++;
+				if (f > 1.0f) f = 1.0f;
+				if (f < -1.0f) f = -1.0f;
+				dest[i] = f > 0 ? (mp_sbyte)(f*127.0f+0.5f) : (mp_sbyte)(f*128.0f-0.5f);
+			}
+		}
+		
+		start = next;
+	}
 }
 
 void SampleEditor::preFilter(TFilterFunc filterFuncPtr, const FilterParameters* par)
@@ -1430,11 +1677,17 @@ void SampleEditor::tool_scaleSample(const FilterParameters* par)
 	
 	float step = (endScale - startScale) / (float)(sEnd - sStart);
 	
-	for (pp_int32 i = sStart; i < sEnd; i++)
+	float buffer[FloatBlockSize];
+	for (pp_int32 i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		float f = getFloatSampleFromWaveform(i);
-		setFloatSampleInWaveform(i, f*startScale);
-		startScale+=step;
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (pp_int32 j = 0; j < count; j++)
+		{
+			buffer[j]*=startScale;
+			startScale+=step;
+		}
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 				
 	finishUndo();	
@@ -1473,21 +1726,29 @@ void SampleEditor::tool_normalizeSample(const FilterParameters* par)
 	float maxLevel = ((par == NULL)? 1.0f : par->getParameter(0).floatPart);
 	float peak = 0.0f;
 
-	pp_int32 i;
+	pp_int32 i, j;
+	float buffer[FloatBlockSize];
 
 	// find peak value
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		float f = getFloatSampleFromWaveform(i);
-		if (ppfabs(f) > peak) peak = ppfabs(f);
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (j = 0; j < count; j++)
+		{
+			if (ppfabs(buffer[j]) > peak) peak = ppfabs(buffer[j]);
+		}
 	}
 	
 	float scale = maxLevel / peak;
 	
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		float f = getFloatSampleFromWaveform(i);
-		setFloatSampleInWaveform(i, f*scale);
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (j = 0; j < count; j++)
+			buffer[j]*=scale;
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 				
 	finishUndo();	
@@ -1523,15 +1784,21 @@ void SampleEditor::tool_reverseSample(const FilterParameters* par)
 	
 	prepareUndo();
 	
-	pp_int32 i;
-	for (i = 0; i < (sEnd-sStart)>>1; i++)
+	// swap blocks from both ends
+	float left[FloatBlockSize], right[FloatBlockSize];
+	const pp_int32 half = (sEnd-sStart)>>1;
+	for (pp_int32 i = 0; i < half; i+=FloatBlockSize)
 	{
-		float f1 = getFloatSampleFromWaveform(sStart + i);
-		float f2 = getFloatSampleFromWaveform(sEnd - 1 - i);
-		float h = f2;
-		f2 = f1; f1 = h;
-		setFloatSampleInWaveform(sStart + i, f1);
-		setFloatSampleInWaveform(sEnd - 1 - i, f2);
+		const pp_int32 count = (half - i) < FloatBlockSize ? (half - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(sStart + i, count, left);
+		getFloatSamplesFromWaveform(sEnd - i - count, count, right);
+		for (pp_int32 j = 0; j < (count>>1); j++)
+		{
+			float h = left[j]; left[j] = left[count-1-j]; left[count-1-j] = h;
+			h = right[j]; right[j] = right[count-1-j]; right[count-1-j] = h;
+		}
+		setFloatSamplesInWaveform(sStart + i, count, right);
+		setFloatSamplesInWaveform(sEnd - i - count, count, left);
 	}
 				
 	finishUndo();	
@@ -1569,32 +1836,42 @@ void SampleEditor::tool_PTboostSample(const FilterParameters* par)
 	
 	pp_int32 i;
 	
+	float buffer[FloatBlockSize];
+	
 	float d0 = 0.0f, d1, d2;
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		d1 = d2 = getFloatSampleFromWaveform(i);
-		d1 -= d0;
-		d0 = d2;
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
 		
-		if (d1 < 0.0f)
-		{
-			d1 = -d1;
-			d1*= 0.25f;
-			d2 -= d1;
-		}
-		else
+		for (pp_int32 j = 0; j < count; j++)
 		{
-			d1*= 0.25f;
-			d2 += d1;
+			d1 = d2 = buffer[j];
+			d1 -= d0;
+			d0 = d2;
+			
+			if (d1 < 0.0f)
+			{
+				d1 = -d1;
+				d1*= 0.25f;
+				d2 -= d1;
+			}
+			else
+			{
+				d1*= 0.25f;
+				d2 += d1;
+			}
+			
+			if (d2 > 1.0f)
+				d2 = 1.0f;
+			
+			if (d2 < -1.0f)
+				d2 = -1.0f;
+			
+			buffer[j] = d2;
 		}
 		
-		if (d2 > 1.0f)
-			d2 = 1.0f;
-		
-		if (d2 < -1.0f)
-			d2 = -1.0f;
-		
-		setFloatSampleInWaveform(i, d2);
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 	
 	finishUndo();	
@@ -1925,15 +2202,25 @@ void SampleEditor::tool_DCNormalizeSample(const FilterParameters* par)
 	
 	pp_int32 i;
 
+	pp_int32 j;
+	float buffer[FloatBlockSize];
+
 	float DC = 0.0f;
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		DC += getFloatSampleFromWaveform(i);		
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (j = 0; j < count; j++)
+			DC += buffer[j];
 	}
 	DC = DC / (float)(sEnd-sStart);
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		setFloatSampleInWaveform(i, getFloatSampleFromWaveform(i) - DC);
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (j = 0; j < count; j++)
+			buffer[j]-=DC;
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 	
 	finishUndo();	
@@ -1971,10 +2258,16 @@ void SampleEditor::tool_DCOffsetSample(const FilterParameters* par)
 	
 	pp_int32 i;
 
+	float buffer[FloatBlockSize];
+
 	float DC = par->getParameter(0).floatPart;
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		setFloatSampleInWaveform(i, getFloatSampleFromWaveform(i) + DC);
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (pp_int32 j = 0; j < count; j++)
+			buffer[j]+=DC;
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 	
 	finishUndo();	
@@ -1982,6 +2275,26 @@ void SampleEditor::tool_DCOffsetSample(const FilterParameters* par)
 	postFilter();
 }
 
+// the samples [start, start+count) with SmoothingBorder copies of the first 
+// and last sample on either side, the result can be written to the start
+// of the buffer as the source is always SmoothingBorder samples ahead
+float* SampleEditor::getFloatSmoothingBuffer(pp_int32 start, pp_int32 count)
+{
+	if (count <= 0)
+		return NULL;
+
+	float* buffer = new float[count + SmoothingBorder*2];
+	
+	getFloatSamplesFromWaveform(start, count, buffer + SmoothingBorder);
+	for (pp_int32 i = 0; i < SmoothingBorder; i++)
+	{
+		buffer[i] = buffer[SmoothingBorder];
+		buffer[SmoothingBorder + count + i] = buffer[SmoothingBorder + count - 1];
+	}
+	
+	return buffer;
+}
+
 void SampleEditor::tool_rectangularSmoothSample(const FilterParameters* par)
 {
 	if (isEmptySample())
@@ -2010,24 +2323,19 @@ void SampleEditor::tool_rectangularSmoothSample(const FilterParameters* par)
 	
 	mp_sint32 sLen = sEnd - sStart;
 	
-	mp_ubyte* buffer = new mp_ubyte[(sample->type & 16) ? sLen*2 : sLen];
+	float* buffer = getFloatSmoothingBuffer(sStart, sLen);
 	if (!buffer)
 		return;
 
-	memcpy(buffer, sample->sample + sStart, (sample->type & 16) ? sLen*2 : sLen);
-
 	prepareUndo();	
 	
-	pp_int32 i;
+	float* dest = buffer;
+	const float* src = buffer + SmoothingBorder;
 
-	for (i = sStart; i < sEnd; i++)
-	{
-		float f = (getFloatSampleFromWaveform(i - sStart - 1, buffer, sLen) +
-				  getFloatSampleFromWaveform(i - sStart, buffer, sLen) +
-				  getFloatSampleFromWaveform(i - sStart + 1, buffer, sLen)) * (1.0f/3.0f);
-				  
-		setFloatSampleInWaveform(i, f);		
-	}
+	for (pp_int32 i = 0; i < sLen; i++)
+		dest[i] = (src[i-1] + src[i] + src[i+1]) * (1.0f/3.0f);
+	
+	setFloatSamplesInWaveform(sStart, sLen, buffer);
 	
 	delete[] buffer;
 	
@@ -2064,27 +2372,26 @@ void SampleEditor::tool_triangularSmoothSample(const FilterParameters* par)
 	
 	mp_sint32 sLen = sEnd - sStart;
 	
-	mp_ubyte* buffer = new mp_ubyte[(sample->type & 16) ? sLen*2 : sLen];
+	float* buffer = getFloatSmoothingBuffer(sStart, sLen);
 	if (!buffer)
 		return;
 
-	memcpy(buffer, sample->sample + sStart, (sample->type & 16) ? sLen*2 : sLen);
-
 	prepareUndo();	
 	
-	pp_int32 i;
+	float* dest = buffer;
+	const float* src = buffer + SmoothingBorder;
 
-	for (i = sStart; i < sEnd; i++)
+	for (pp_int32 i = 0; i < sLen; i++)
 	{
-		float f = (getFloatSampleFromWaveform(i - sStart - 2, buffer, sLen) +
-				   getFloatSampleFromWaveform(i - sStart - 1, buffer, sLen)*2.0f +
-				   getFloatSampleFromWaveform(i - sStart, buffer, sLen)*3.0f +
-				   getFloatSampleFromWaveform(i - sStart + 1, buffer, sLen)*2.0f +
-				   getFloatSampleFromWaveform(i - sStart + 2, buffer, sLen)) * (1.0f/9.0f);
-				  
-		setFloatSampleInWaveform(i, f);		
+		dest[i] = (src[i-2] + 
+				   src[i-1]*2.0f + 
+				   src[i]*3.0f + 
+				   src[i+1]*2.0f + 
+				   src[i+2]) * (1.0f/9.0f);
 	}
 	
+	setFloatSamplesInWaveform(sStart, sLen, buffer);
+	
 	delete[] buffer;
 	
 	finishUndo();	
@@ -2150,26 +2457,26 @@ void SampleEditor::tool_eqSample(const FilterParameters* par)
 		return;
 	}
 	
-	// apply EQ here
-	pp_int32 i;
+	// apply EQ here, block by block through all bands
+	pp_int32 i, j;
+	
+	float buffer[FloatBlockSize];
+	double filterBuffer[FloatBlockSize];
 
-	for (i = sStart; i < sEnd; i++)
+	for (i = sStart; i < sEnd; i+=FloatBlockSize)
 	{
-		// Fetch a stereo signal
-		double xL = getFloatSampleFromWaveform(i);
-		double xR = xL;
-			
-		for (pp_int32 j = 0; j < par->getNumParameters(); j++)
-		{
-			double yL, yR;
-			// Pass the stereo input
-			eqs[j]->Filter(xL, xR, yL, yR);
+		const pp_int32 count = (sEnd - i) < FloatBlockSize ? (sEnd - i) : FloatBlockSize;
+		
+		getFloatSamplesFromWaveform(i, count, buffer);
+		for (j = 0; j < count; j++)
+			filterBuffer[j] = buffer[j];
 			
-			xL = yL;
-			xR = yR;
-		}
+		for (j = 0; j < par->getNumParameters(); j++)
+			eqs[j]->Filter(filterBuffer, count);
 		
-		setFloatSampleInWaveform(i, (float)xL);
+		for (j = 0; j < count; j++)
+			buffer[j] = (float)filterBuffer[j];
+		setFloatSamplesInWaveform(i, count, buffer);
 	}
 	
 	for (i = 0; i < par->getNumParameters(); i++)
@@ -60,6 +60,7 @@ public:
 		~ClipBoard();
 		
 		void makeCopy(TXMSample& sample, XModule& module, pp_int32 selectionStart, pp_int32 selectionEnd, bool cut = false);
+		// the old sample data is left to the caller
 		void paste(TXMSample& sample, XModule& module, pp_int32 pos);
 		bool isEmpty() const { return buffer == NULL; }
 		
@@ -120,6 +121,25 @@ private:
 	bool drawing;
 	pp_int32 lastSamplePos;
 
+	// sample data changed since the last clearChangedRange()
+	pp_int32 changedStart, changedEnd;
+	bool operationDidWrite;
+	
+	void markChanged(pp_int32 start, pp_int32 end);
+
+	// while the sample is being edited the player keeps on
+	// playing the live sample, the changes are done on a copy
+	TXMSample* liveSample;
+	TXMSample workSample;
+	pp_int32 criticalSectionDepth;
+	// operations which build new sample data don't need a copy of the old
+	// one, the work sample reads the live data until it is replaced
+	bool workSampleShared;
+
+	void enterCriticalSection(bool copySampleData = true);
+	void leaveCriticalSection();
+	void freeSampleData(mp_sbyte* data);
+
 	void prepareUndo();
 	void finishUndo();
 	
@@ -238,6 +258,10 @@ public:
 
 	bool isEmpty() const { if (sample && !sample->sample) return true; else return false; } 
 
+	// range of the waveform which has been modified, start >= end if nothing changed
+	void getChangedRange(pp_int32& start, pp_int32& end) const { start = changedStart; end = changedEnd; }
+	void clearChangedRange() { changedStart = changedEnd = 0; }
+
 	void startDrawing();
 	bool isDrawing() const { return drawing; }
 	void drawSample(pp_int32 sampleIndex, float s);
@@ -299,6 +323,16 @@ private:
 
 	float getFloatSampleFromWaveform(pp_int32 index, void* source = NULL, pp_int32 size = 0);
 	void setFloatSampleInWaveform(pp_int32 index, float singleSample, void* source = NULL);
+
+	// block versions of the above for the samples [start, start+count),
+	// the tools process their range in FloatBlockSize chunks
+	enum { FloatBlockSize = 4096 };
+	void getFloatSamplesFromWaveform(pp_int32 start, pp_int32 count, float* dest);
+	void setFloatSamplesInWaveform(pp_int32 start, pp_int32 count, const float* src);
+	pp_int32 getNextLoopAreaIndex(pp_int32 index, pp_int32 end, bool& inLoopArea) const;
+	
+	enum { SmoothingBorder = 2 };
+	float* getFloatSmoothingBuffer(pp_int32 start, pp_int32 count);
 	
 	typedef void (SampleEditor::*TFilterFunc)(const FilterParameters* par);
 	FilterParameters* lastParameters;
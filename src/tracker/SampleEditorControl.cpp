@@ -21,6 +21,7 @@
  */
 
 #include "SampleEditorControl.h"
+#include "SamplePeakCache.h"
 #include "Screen.h"
 #include "GraphicsAbstract.h"
 #include "PPUIConfig.h"
@@ -102,6 +103,8 @@ SampleEditorControl::SampleEditorControl(pp_int32 id,
 	
 	adjustScrollbars();
 
+	peakCache = new SamplePeakCache();
+
 	showMarks = new ShowMark[TrackerConfig::maximumPlayerChannels];
 	for (pp_int32 i = 0; i < TrackerConfig::maximumPlayerChannels; i++)
 	{
@@ -183,6 +186,8 @@ SampleEditorControl::~SampleEditorControl()
 
 	delete[] showMarks;
 
+	delete peakCache;
+
 	delete hScrollbar;
 	
 	delete editMenuControl;	
@@ -413,11 +418,29 @@ void SampleEditorControl::paint(PPGraphicsAbstract* g)
 	g->setColor(*borderColor);
 	g->setPixel(xOffset, yOffset);
 	
+	// more than one sample per column: draw the peaks from the cache
+	const bool drawPeaks = xScale > 1.0f;
+	if (drawPeaks)
+	{
+		pp_int32 changedStart, changedEnd;
+		sampleEditor->getChangedRange(changedStart, changedEnd);
+		if (changedStart < changedEnd)
+		{
+			peakCache->invalidate(changedStart, changedEnd);
+			sampleEditor->clearChangedRange();
+		}
+		peakCache->validate(sample);
+	}
+
+	PPColor rmsColor = TrackerConfig::colorSampleEditorWaveform;
+	rmsColor.scaleFixed(87163);
+	
 	for (mp_sint32 x = 1; x < visibleWidth; x++)
 	{
 		if ((pp_int32)((startPos+x)*xScale) < getVisibleLength())
 		{
-			if (sel && x >= (pp_int32)((sStart/xScale)-startPos) && x <= (pp_int32)((sEnd/xScale)-startPos) && (selectionTicker == -1))
+			bool selected = sel && x >= (pp_int32)((sStart/xScale)-startPos) && x <= (pp_int32)((sEnd/xScale)-startPos) && (selectionTicker == -1);
+			if (selected)
 			{
 				g->setColor(255-dColor.r,255-dColor.g,255-dColor.b);
 				g->setPixel(xOffset + x, yOffset);
@@ -430,6 +453,32 @@ void SampleEditorControl::paint(PPGraphicsAbstract* g)
 				g->setColor(TrackerConfig::colorSampleEditorWaveform);
 			}
 			
+			if (drawPeaks)
+			{
+				SamplePeakCache::Peak peak;
+				peakCache->query((pp_int32)((startPos+x)*xScale), (pp_int32)((startPos+x+1)*xScale), peak);
+				if (!peak.count)
+					continue;
+				
+				mp_sint32 y1 = -(mp_sint32)(peak.max*scale);
+				mp_sint32 y2 = -(mp_sint32)(peak.min*scale);
+				g->drawVLine(yOffset + y1, yOffset + y2 + 1, xOffset + x);
+				
+				// RMS inside the peaks in a brighter shade
+				mp_sint32 rms = (mp_sint32)(peak.getRMS()*scale);
+				mp_sint32 r1 = y1 > -rms ? y1 : -rms;
+				mp_sint32 r2 = y2 < rms ? y2 : rms;
+				if (rms && r1 <= r2)
+				{
+					if (!selected)
+						g->setColor(rmsColor);
+					g->drawVLine(yOffset + r1, yOffset + r2 + 1, xOffset + x);
+				}
+				
+				lasty = (y1 + y2) >> 1;
+				continue;
+			}
+			
 			float findex = ((startPos+x)*xScale);
 			pp_int32 index = (pp_int32)(floor(findex));
 			pp_int32 index2 = index+1;
@@ -1837,6 +1886,8 @@ void SampleEditorControl::editorNotification(EditorBase* sender, EditorBase::Edi
 	
 		case SampleEditor::NotificationReload:
 		{
+			peakCache->invalidate();
+			
 			if (!sampleEditor->isEmptySample())
 			{
 				xScale = calcScale();
@@ -1944,6 +1995,7 @@ void SampleEditorControl::editorNotification(EditorBase* sender, EditorBase::Edi
 		case SampleEditor::NotificationUndoRedo:
 	case EditorBase::NotificationPrepareCritical:
 		case EditorBase::NotificationUnprepareCritical:
+		case EditorBase::NotificationCommitCritical:
 			break;
 	}
 }
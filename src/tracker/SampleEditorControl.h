@@ -37,6 +37,7 @@ class PPControl;
 class PPContextMenu;
 class FilterParameters;
 class PPDialogBase;
+class SamplePeakCache;
 
 class SampleEditorControl : public PPControl, public EventListenerInterface, public EditorBase::EditorNotificationListener
 {
@@ -103,6 +104,9 @@ private:
 	// necessary for controlling
 	SampleEditor* sampleEditor;
 	
+	// min/max pyramid for drawing the zoomed out waveform
+	SamplePeakCache* peakCache;
+	
 	pp_int32 relativeNote;
 	OffsetFormats offsetFormat;
 
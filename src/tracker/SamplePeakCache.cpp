@@ -0,0 +1,283 @@
+/*
+ *  tracker/SamplePeakCache.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  SamplePeakCache.cpp
+ *  MilkyTracker
+ *
+ */
+
+#include "SamplePeakCache.h"
+#include "XModule.h"
+#include <math.h>
+
+float SamplePeakCache::Peak::getRMS() const
+{
+	return count ? sqrtf(sumSq / (float)count) : 0.0f;
+}
+
+SamplePeakCache::SamplePeakCache() :
+	sample(NULL),
+	sampleLength(0),
+	is16Bit(false),
+	numLevels(0),
+	dirtyStart(0),
+	dirtyEnd(0)
+{
+	for (pp_uint32 i = 0; i < MAXLEVELS; i++)
+	{
+		levels[i] = NULL;
+		levelSizes[i] = 0;
+	}
+}
+
+SamplePeakCache::~SamplePeakCache()
+{
+	cleanUp();
+}
+
+void SamplePeakCache::cleanUp()
+{
+	for (pp_uint32 i = 0; i < numLevels; i++)
+	{
+		delete[] levels[i];
+		levels[i] = NULL;
+		levelSizes[i] = 0;
+	}
+
+	numLevels = 0;
+}
+
+void SamplePeakCache::allocate()
+{
+	cleanUp();
+
+	pp_uint32 size = (sampleLength + BLOCKSIZE - 1) >> BLOCKSHIFT;
+	while (size && numLevels < MAXLEVELS)
+	{
+		levels[numLevels] = new Block[size];
+		levelSizes[numLevels] = size;
+		numLevels++;
+
+		if (size == 1)
+			break;
+		size = (size + 1) >> 1;
+	}
+}
+
+void SamplePeakCache::addSamples(Peak& peak, pp_uint32 start, pp_uint32 end) const
+{
+	// the loop area backup makes the buffer differ from the actual
+	// sample data for a few samples after the loop end, go through 
+	// getSampleValue() there (BLOCKSIZE is more than enough)
+	pp_uint32 backupStart = 0, backupEnd = 0;
+	if (sample->type & 3)
+	{
+		backupStart = sample->loopstart + sample->looplen;
+		backupEnd = backupStart + BLOCKSIZE;
+	}
+
+	if (start < backupEnd && end > backupStart)
+	{
+		for (pp_uint32 i = start; i < end; i++)
+		{
+			const pp_int32 s = sample->getSampleValue(i);
+			if (s < peak.min) peak.min = s;
+			if (s > peak.max) peak.max = s;
+			peak.sumSq += (float)(s*s);
+		}
+	}
+	else if (is16Bit)
+	{
+		const mp_sword* smp = (const mp_sword*)sample->sample;
+		for (pp_uint32 i = start; i < end; i++)
+		{
+			const pp_int32 s = smp[i];
+			if (s < peak.min) peak.min = s;
+			if (s > peak.max) peak.max = s;
+			peak.sumSq += (float)(s*s);
+		}
+	}
+	else
+	{
+		const mp_sbyte* smp = sample->sample;
+		for (pp_uint32 i = start; i < end; i++)
+		{
+			const pp_int32 s = smp[i];
+			if (s < peak.min) peak.min = s;
+			if (s > peak.max) peak.max = s;
+			peak.sumSq += (float)(s*s);
+		}
+	}
+
+	peak.count += end - start;
+}
+
+void SamplePeakCache::rebuild(pp_uint32 start, pp_uint32 end)
+{
+	if (end > sampleLength)
+		end = sampleLength;
+	if (start >= end || !numLevels)
+		return;
+
+	pp_uint32 first = start >> BLOCKSHIFT;
+	pp_uint32 last = (end - 1) >> BLOCKSHIFT;
+
+	for (pp_uint32 i = first; i <= last; i++)
+	{
+		pp_uint32 blockEnd = (i + 1) << BLOCKSHIFT;
+		if (blockEnd > sampleLength)
+			blockEnd = sampleLength;
+
+		Peak peak;
+		addSamples(peak, i << BLOCKSHIFT, blockEnd);
+
+		Block& block = levels[0][i];
+		block.min = (pp_int16)peak.min;
+		block.max = (pp_int16)peak.max;
+		block.sumSq = peak.sumSq;
+	}
+
+	// propagate the changed blocks up the pyramid
+	for (pp_uint32 l = 1; l < numLevels; l++)
+	{
+		first >>= 1;
+		last >>= 1;
+
+		const Block* children = levels[l-1];
+		const pp_uint32 numChildren = levelSizes[l-1];
+
+		for (pp_uint32 i = first; i <= last; i++)
+		{
+			Block& block = levels[l][i];
+			block = children[i*2];
+			if (i*2 + 1 < numChildren)
+			{
+				const Block& child = children[i*2 + 1];
+				if (child.min < block.min) block.min = child.min;
+				if (child.max > block.max) block.max = child.max;
+				block.sumSq += child.sumSq;
+			}
+		}
+	}
+}
+
+void SamplePeakCache::invalidate()
+{
+	dirtyStart = 0;
+	dirtyEnd = 0xFFFFFFFF;
+}
+
+void SamplePeakCache::invalidate(pp_int32 start, pp_int32 end)
+{
+	if (start < 0)
+		start = 0;
+	if (end <= start)
+		return;
+
+	if (dirtyStart >= dirtyEnd)
+	{
+		dirtyStart = start;
+		dirtyEnd = end;
+	}
+	else
+	{
+		if ((pp_uint32)start < dirtyStart)
+			dirtyStart = start;
+		if ((pp_uint32)end > dirtyEnd)
+			dirtyEnd = end;
+	}
+}
+
+void SamplePeakCache::validate(TXMSample* sample)
+{
+	if (sample == NULL || sample->sample == NULL)
+	{
+		this->sample = NULL;
+		cleanUp();
+		return;
+	}
+
+	const bool is16Bit = (sample->type & 16) != 0;
+
+	if (sample != this->sample || sample->samplen != sampleLength || is16Bit != this->is16Bit)
+	{
+		this->sample = sample;
+		this->sampleLength = sample->samplen;
+		this->is16Bit = is16Bit;
+
+		allocate();
+		invalidate();
+	}
+
+	if (dirtyStart < dirtyEnd)
+	{
+		rebuild(dirtyStart, dirtyEnd);
+		dirtyStart = dirtyEnd = 0;
+	}
+}
+
+void SamplePeakCache::query(pp_int32 start, pp_int32 end, Peak& peak) const
+{
+	if (sample == NULL)
+		return;
+
+	if (start < 0)
+		start = 0;
+	if (end > (pp_int32)sampleLength)
+		end = sampleLength;
+
+	pp_uint32 pos = start;
+	const pp_uint32 stop = end;
+
+	// unaligned head, no full block left
+	pp_uint32 headEnd = (pos + BLOCKSIZE - 1) & ~(BLOCKSIZE - 1);
+	if (headEnd > stop)
+		headEnd = stop;
+	if (pos < headEnd)
+	{
+		addSamples(peak, pos, headEnd);
+		pos = headEnd;
+	}
+
+	// take the largest aligned block that fits, at most two per level
+	while (pos + BLOCKSIZE <= stop)
+	{
+		pp_uint32 l = 0;
+		while (l + 1 < numLevels &&
+			   !(pos & ((BLOCKSIZE << (l + 1)) - 1)) &&
+			   pos + (BLOCKSIZE << (l + 1)) <= stop)
+			l++;
+
+		const Block& block = levels[l][pos >> (BLOCKSHIFT + l)];
+		if (block.min < peak.min) peak.min = block.min;
+		if (block.max > peak.max) peak.max = block.max;
+		peak.sumSq += block.sumSq;
+		peak.count += BLOCKSIZE << l;
+
+		pos += BLOCKSIZE << l;
+	}
+
+	// tail
+	if (pos < stop)
+		addSamples(peak, pos, stop);
+}
@@ -0,0 +1,106 @@
+/*
+ *  tracker/SamplePeakCache.h
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  SamplePeakCache.h
+ *  MilkyTracker
+ *
+ *  Min/max/RMS pyramid of a sample for drawing zoomed out waveforms.
+ *  Level 0 summarizes blocks of BLOCKSIZE samples, every further level
+ *  summarizes two blocks of the level below. Modified regions are
+ *  invalidated and rebuilt on the next validate().
+ *
+ */
+
+#ifndef __SAMPLEPEAKCACHE_H__
+#define __SAMPLEPEAKCACHE_H__
+
+#include "BasicTypes.h"
+
+struct TXMSample;
+
+class SamplePeakCache
+{
+public:
+	struct Peak
+	{
+		pp_int32 min, max;
+		float sumSq;
+		pp_uint32 count;
+
+		Peak() :
+			min(0x7FFFFFFF),
+			max(-0x7FFFFFFF-1),
+			sumSq(0.0f),
+			count(0)
+		{
+		}
+
+		float getRMS() const;
+	};
+
+private:
+	enum
+	{
+		BLOCKSHIFT = 4,
+		BLOCKSIZE = 1 << BLOCKSHIFT,
+		MAXLEVELS = 28
+	};
+
+	struct Block
+	{
+		pp_int16 min, max;
+		float sumSq;
+	};
+
+	TXMSample* sample;
+	pp_uint32 sampleLength;
+	bool is16Bit;
+
+	Block* levels[MAXLEVELS];
+	pp_uint32 levelSizes[MAXLEVELS];
+	pp_uint32 numLevels;
+
+	// samples [dirtyStart, dirtyEnd) need to be rebuilt
+	pp_uint32 dirtyStart, dirtyEnd;
+
+	void cleanUp();
+	void allocate();
+	void rebuild(pp_uint32 start, pp_uint32 end);
+	void addSamples(Peak& peak, pp_uint32 start, pp_uint32 end) const;
+
+public:
+	SamplePeakCache();
+	~SamplePeakCache();
+
+	void invalidate();
+	void invalidate(pp_int32 start, pp_int32 end);
+
+	// rebuild whatever has been invalidated, a different sample
+	// (or a change of its length or resolution) rebuilds everything
+	void validate(TXMSample* sample);
+
+	// peak over the samples [start, end), only valid after validate()
+	void query(pp_int32 start, pp_int32 end, Peak& peak) const;
+};
+
+#endif
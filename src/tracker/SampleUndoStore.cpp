@@ -0,0 +1,356 @@
+/*
+ *  tracker/SampleUndoStore.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  SampleUndoStore.cpp
+ *  MilkyTracker
+ *
+ */
+
+#include "SampleUndoStore.h"
+#include "MilkyPlayCommon.h"
+#include <string.h>
+
+SampleUndoStore* SampleUndoStore::instance = NULL;
+pp_uint32 SampleUndoStore::memoryBudget = SampleUndoStore::DEFAULTMEMORYBUDGET;
+
+SampleUndoStore::SampleUndoStore() :
+	numChunks(0),
+	memoryUsage(0),
+	lruHead(NULL),
+	lruTail(NULL),
+	swapFile(NULL),
+	swapFailed(false),
+	numSlots(0),
+	freeSlots(NULL),
+	numFreeSlots(0),
+	freeSlotsSize(0)
+{
+	for (pp_uint32 i = 0; i < NUMBUCKETS; i++)
+		buckets[i] = NULL;
+}
+
+SampleUndoStore::~SampleUndoStore()
+{
+	ASSERT(numChunks == 0);
+
+	// tmpfile() removes the swap file on close
+	if (swapFile)
+		fclose(swapFile);
+
+	delete[] freeSlots;
+}
+
+pp_uint32 SampleUndoStore::calcHash(const pp_uint8* data, pp_uint32 size)
+{
+	pp_uint32 hash = 2166136261U ^ size;
+
+	pp_uint32 i = 0;
+	for (; i + 4 <= size; i+=4)
+	{
+		pp_uint32 word;
+		memcpy(&word, data + i, 4);
+		hash = (hash ^ word) * 16777619U;
+		hash ^= hash >> 15;
+	}
+
+	for (; i < size; i++)
+		hash = (hash ^ data[i]) * 16777619U;
+
+	return hash;
+}
+
+void SampleUndoStore::lruUnlink(Chunk* chunk)
+{
+	if (chunk->lruPrev)
+		chunk->lruPrev->lruNext = chunk->lruNext;
+	else
+		lruHead = chunk->lruNext;
+
+	if (chunk->lruNext)
+		chunk->lruNext->lruPrev = chunk->lruPrev;
+	else
+		lruTail = chunk->lruPrev;
+
+	chunk->lruPrev = chunk->lruNext = NULL;
+}
+
+void SampleUndoStore::lruAppend(Chunk* chunk)
+{
+	chunk->lruPrev = lruTail;
+	chunk->lruNext = NULL;
+
+	if (lruTail)
+		lruTail->lruNext = chunk;
+	else
+		lruHead = chunk;
+
+	lruTail = chunk;
+}
+
+bool SampleUndoStore::seekSlot(pp_int32 slot)
+{
+	// the swap file can grow beyond 2GB, long is 32 bit on Windows
+	const pp_int64 offset = (pp_int64)slot * CHUNKSIZE;
+#ifdef WIN32
+	return _fseeki64(swapFile, offset, SEEK_SET) == 0;
+#else
+	return fseeko(swapFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool SampleUndoStore::readChunk(const Chunk* chunk, pp_uint8* dest)
+{
+	if (chunk->constant)
+	{
+		memset(dest, chunk->fillValue, chunk->size);
+		return true;
+	}
+
+	if (chunk->data)
+	{
+		memcpy(dest, chunk->data, chunk->size);
+		return true;
+	}
+
+	ASSERT(chunk->slot >= 0 && swapFile);
+	if (!seekSlot(chunk->slot))
+		return false;
+
+	return fread(dest, 1, chunk->size, swapFile) == chunk->size;
+}
+
+bool SampleUndoStore::equals(const Chunk* chunk, const pp_uint8* data, pp_uint32 size)
+{
+	if (chunk->size != size)
+		return false;
+
+	if (chunk->constant)
+	{
+		for (pp_uint32 i = 0; i < size; i++)
+			if (data[i] != chunk->fillValue)
+				return false;
+		return true;
+	}
+
+	if (chunk->data)
+		return memcmp(chunk->data, data, size) == 0;
+
+	pp_uint8 buffer[CHUNKSIZE];
+	if (!readChunk(chunk, buffer))
+		return false;
+
+	return memcmp(buffer, data, size) == 0;
+}
+
+bool SampleUndoStore::swapOut(Chunk* chunk)
+{
+	if (swapFailed)
+		return false;
+
+	if (swapFile == NULL)
+	{
+		swapFile = tmpfile();
+		if (swapFile == NULL)
+		{
+			swapFailed = true;
+			return false;
+		}
+	}
+
+	pp_int32 slot = numFreeSlots ? freeSlots[--numFreeSlots] : numSlots++;
+
+	if (!seekSlot(slot) ||
+		fwrite(chunk->data, 1, chunk->size, swapFile) != chunk->size)
+	{
+		// keep everything in memory from now on
+		freeSlot(slot);
+		swapFailed = true;
+		return false;
+	}
+
+	lruUnlink(chunk);
+
+	delete[] chunk->data;
+	chunk->data = NULL;
+	chunk->slot = slot;
+
+	memoryUsage-=chunk->size;
+	return true;
+}
+
+void SampleUndoStore::freeSlot(pp_int32 slot)
+{
+	if (numFreeSlots == freeSlotsSize)
+	{
+		freeSlotsSize = freeSlotsSize ? freeSlotsSize*2 : 256;
+		pp_int32* newFreeSlots = new pp_int32[freeSlotsSize];
+		if (freeSlots)
+			memcpy(newFreeSlots, freeSlots, numFreeSlots*sizeof(pp_int32));
+		delete[] freeSlots;
+		freeSlots = newFreeSlots;
+	}
+
+	freeSlots[numFreeSlots++] = slot;
+}
+
+void SampleUndoStore::enforceBudget()
+{
+	// the oldest history goes first
+	while (memoryUsage > memoryBudget && lruHead)
+	{
+		if (!swapOut(lruHead))
+			break;
+	}
+}
+
+SampleUndoStore::Chunk* SampleUndoStore::storeChunk(const pp_uint8* data, pp_uint32 size)
+{
+	ASSERT(size <= CHUNKSIZE);
+
+	const pp_uint32 hash = calcHash(data, size);
+	Chunk*& bucket = buckets[hash & (NUMBUCKETS-1)];
+
+	for (Chunk* chunk = bucket; chunk; chunk = chunk->nextInBucket)
+	{
+		if (chunk->hash != hash || !equals(chunk, data, size))
+			continue;
+
+		chunk->refCount++;
+
+		// a swapped out chunk keeps its slot, swapping it back in would
+		// only push other chunks out, one in memory is the most recent now
+		if (chunk->data)
+		{
+			lruUnlink(chunk);
+			lruAppend(chunk);
+		}
+
+		return chunk;
+	}
+
+	Chunk* chunk = new Chunk;
+	chunk->hash = hash;
+	chunk->size = size;
+	chunk->refCount = 1;
+	chunk->data = NULL;
+	chunk->constant = true;
+	chunk->fillValue = size ? data[0] : 0;
+	chunk->slot = -1;
+	chunk->lruPrev = chunk->lruNext = NULL;
+
+	for (pp_uint32 i = 1; i < size; i++)
+	{
+		if (data[i] != chunk->fillValue)
+		{
+			chunk->constant = false;
+			break;
+		}
+	}
+
+	chunk->nextInBucket = bucket;
+	bucket = chunk;
+	numChunks++;
+
+	if (!chunk->constant)
+	{
+		chunk->data = new pp_uint8[size];
+		memcpy(chunk->data, data, size);
+		memoryUsage+=size;
+
+		lruAppend(chunk);
+		enforceBudget();
+	}
+
+	return chunk;
+}
+
+void SampleUndoStore::releaseChunk(Chunk* chunk)
+{
+	ASSERT(chunk->refCount > 0);
+	if (--chunk->refCount)
+		return;
+
+	Chunk** link = &buckets[chunk->hash & (NUMBUCKETS-1)];
+	while (*link != chunk)
+		link = &(*link)->nextInBucket;
+	*link = chunk->nextInBucket;
+
+	if (chunk->data)
+	{
+		lruUnlink(chunk);
+		memoryUsage-=chunk->size;
+		delete[] chunk->data;
+	}
+	else if (chunk->slot >= 0)
+	{
+		freeSlot(chunk->slot);
+	}
+
+	delete chunk;
+	numChunks--;
+}
+
+SampleUndoStore::Chunk* SampleUndoStore::store(const pp_uint8* data, pp_uint32 size)
+{
+	if (instance == NULL)
+		instance = new SampleUndoStore();
+
+	return instance->storeChunk(data, size);
+}
+
+void SampleUndoStore::retain(Chunk* chunk)
+{
+	chunk->refCount++;
+}
+
+void SampleUndoStore::release(Chunk* chunk)
+{
+	ASSERT(instance);
+	instance->releaseChunk(chunk);
+
+	// last chunk is gone, close the swap file
+	if (instance->numChunks == 0)
+	{
+		delete instance;
+		instance = NULL;
+	}
+}
+
+bool SampleUndoStore::load(const Chunk* chunk, pp_uint8* dest)
+{
+	ASSERT(instance);
+	return instance->readChunk(chunk, dest);
+}
+
+pp_uint32 SampleUndoStore::getMemoryUsage()
+{
+	return instance ? instance->memoryUsage : 0;
+}
+
+void SampleUndoStore::setMemoryBudget(pp_uint32 bytes)
+{
+	memoryBudget = bytes;
+
+	if (instance)
+		instance->enforceBudget();
+}
@@ -0,0 +1,133 @@
+/*
+ *  tracker/SampleUndoStore.h
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  SampleUndoStore.h
+ *  MilkyTracker
+ *
+ *  Shared storage for the sample undo history. Sample data is split
+ *  into chunks of CHUNKSIZE bytes, identical chunks are only stored once
+ *  and reference counted, so two undo states only differ by the chunks
+ *  an operation has actually touched. Chunks filled with a single byte
+ *  value (silence) don't keep any data. When the chunks held in memory
+ *  exceed the memory budget the least recently used ones are swapped
+ *  out to a temporary file.
+ *
+ */
+
+#ifndef __SAMPLEUNDOSTORE_H__
+#define __SAMPLEUNDOSTORE_H__
+
+#include "BasicTypes.h"
+#include <stdio.h>
+
+class SampleUndoStore
+{
+public:
+	enum
+	{
+		CHUNKSIZE = 16384,
+		DEFAULTMEMORYBUDGET = 64*1024*1024
+	};
+
+	class Chunk
+	{
+	private:
+		pp_uint32 hash;
+		pp_uint32 size;
+		pp_int32 refCount;
+
+		// NULL if the chunk is constant or swapped out
+		pp_uint8* data;
+		bool constant;
+		pp_uint8 fillValue;
+		// slot in the swap file, -1 if not swapped out
+		pp_int32 slot;
+
+		Chunk* nextInBucket;
+		Chunk* lruPrev;
+		Chunk* lruNext;
+
+		friend class SampleUndoStore;
+	};
+
+private:
+	enum
+	{
+		NUMBUCKETS = 4096
+	};
+
+	static SampleUndoStore* instance;
+	static pp_uint32 memoryBudget;
+
+	Chunk* buckets[NUMBUCKETS];
+	pp_uint32 numChunks;
+	pp_uint32 memoryUsage;
+
+	// least recently used chunk with data in memory comes first
+	Chunk* lruHead;
+	Chunk* lruTail;
+
+	FILE* swapFile;
+	bool swapFailed;
+	pp_int32 numSlots;
+	pp_int32* freeSlots;
+	pp_int32 numFreeSlots;
+	pp_int32 freeSlotsSize;
+
+	SampleUndoStore();
+	~SampleUndoStore();
+
+	static pp_uint32 calcHash(const pp_uint8* data, pp_uint32 size);
+
+	void lruUnlink(Chunk* chunk);
+	void lruAppend(Chunk* chunk);
+
+	bool seekSlot(pp_int32 slot);
+	bool readChunk(const Chunk* chunk, pp_uint8* dest);
+	bool equals(const Chunk* chunk, const pp_uint8* data, pp_uint32 size);
+
+	bool swapOut(Chunk* chunk);
+	void freeSlot(pp_int32 slot);
+	void enforceBudget();
+
+	Chunk* storeChunk(const pp_uint8* data, pp_uint32 size);
+	void releaseChunk(Chunk* chunk);
+
+public:
+	// store size bytes (at most CHUNKSIZE), returns a chunk with
+	// one reference the caller owns
+	static Chunk* store(const pp_uint8* data, pp_uint32 size);
+	static void retain(Chunk* chunk);
+	static void release(Chunk* chunk);
+
+	static pp_uint32 getSize(const Chunk* chunk) { return chunk->size; }
+	// copy the chunk data to dest, fails if the swap file can't be read
+	static bool load(const Chunk* chunk, pp_uint8* dest);
+
+	// bytes of chunk data held in memory
+	static pp_uint32 getMemoryUsage();
+	static void setMemoryBudget(pp_uint32 bytes);
+	static pp_uint32 getMemoryBudget() { return memoryBudget; }
+};
+
+#endif
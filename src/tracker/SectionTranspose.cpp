@@ -822,7 +822,7 @@ void SectionTranspose::handleTransposeSong()
 {
 	pp_int32 fuckups = tracker.moduleEditor->noteTransposeSong(tp, true);
 	if (!fuckups)
-		tracker.moduleEditor->noteTransposeSong(tp);
+		tracker.moduleEditor->noteTransposeSong(tp, false, true);
 	else
 	{
 		char buffer[100];
@@ -833,6 +833,6 @@ void SectionTranspose::handleTransposeSong()
 
 void SectionTranspose::transposeSong()
 {
-	tracker.moduleEditor->noteTransposeSong(getTransposeParameters());
+	tracker.moduleEditor->noteTransposeSong(getTransposeParameters(), false, true);
 	tracker.screen->paint();				
 }
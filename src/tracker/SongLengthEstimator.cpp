@@ -29,54 +29,21 @@
  */
 
 #include "SongLengthEstimator.h"
-#include "MilkyPlay.h"
-#include "AudioDriver_NULL.h"
+#include "SongAnalyzer.h"
 
 SongLengthEstimator::SongLengthEstimator(XModule* theModule) :
-	player(NULL),
 	module(theModule)
 {
 }
 
-SongLengthEstimator::SongLengthEstimator(const SongLengthEstimator& src) :
-	player(NULL),
-	module(src.module)
-{
-}
-
-SongLengthEstimator::~SongLengthEstimator() 
-{
-	delete player;
-}
-
-const SongLengthEstimator& SongLengthEstimator::operator=(const SongLengthEstimator& src)
-{
-	if (&src != this)
-	{
-		module = src.module;
-	}
-	return *this;
-}
-
 mp_sint32 SongLengthEstimator::estimateSongLengthInSeconds()
 {
-	if (!player)
-	{
-		player = new PlayerGeneric(44100);
-		
-		if (!player)
-			return -1;
-		
-		player->setBufferSize(1024);
-		player->setResamplerType((ChannelMixer::ResamplerTypes)0);
-		player->setMasterVolume(256);
-		player->setDisableMixing(true);
-	}
+	// walks the song without mixing, fast enough to be done after each edit
+	SongAnalyzer analyzer(module, 44100);
 	
-	AudioDriver_NULL* audioDriver = new AudioDriver_NULL;
-	mp_sint32 res = player->exportToWAV(NULL, module, 0, -1, NULL, module->header.channum, NULL, audioDriver) / player->getMixFrequency();
-	delete audioDriver;
+	mp_sint32 res = analyzer.analyze();
+	if (res < 0)
+		return -1;
 
-	return res;
+	return res / 44100;
 }
-
@@ -33,21 +33,15 @@
 
 #include "MilkyPlayTypes.h"
 
-class PlayerGeneric;
 class XModule;
 
 class SongLengthEstimator
 {
 private:
-	PlayerGeneric* player;
 	XModule* module;
 	
 public:
 	SongLengthEstimator(XModule* theModule);
-	SongLengthEstimator(const SongLengthEstimator& src);
-	~SongLengthEstimator();
-	
-	const SongLengthEstimator& operator=(const SongLengthEstimator& src);
 	
 	mp_sint32 estimateSongLengthInSeconds();
 };
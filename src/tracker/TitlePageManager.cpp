@@ -141,9 +141,9 @@ void TitlePageManager::showPeakControl(bool update/* = true*/)
 	buttonShowTime->setPressed(false);
 	buttonShowTitle->setPressed(false);
 #ifdef __LOWRES__
-	text->setText("Peak:");
+	text->setText("Peak/DSP:");
 #else
-	text->setText("Peak level:");
+	text->setText("Peak level/DSP load:");
 #endif
 	text->setColor(PPUIConfig::getInstance()->getColor(PPUIConfig::ColorStaticText));
 
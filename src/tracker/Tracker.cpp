@@ -123,6 +123,7 @@ pp_int32 Tracker::MAXEDITORHEIGHT()
 Tracker::Tracker() :
 	screen(NULL),
 	peakLevelControl(NULL),
+	peakLevelXRuns(0),
 	scopesControl(NULL),
 	messageBoxContainerGeneric(NULL),
 	dialog(NULL),
@@ -1981,7 +1982,7 @@ bool Tracker::messageBoxEventListener(pp_int32 messageBoxID, pp_int32 messageBox
 							res = getPatternEditor()->insRemapPattern(oldIns, newIns);
 							break;
 						case PP_MESSAGEBOX_BUTTON_USER3:
-							res = moduleEditor->insRemapSong(oldIns, newIns);
+							res = moduleEditor->insRemapSong(oldIns, newIns, true);
 							break;
 						case PP_MESSAGEBOX_BUTTON_USER4:
 							res = getPatternEditor()->insRemapSelection(oldIns, newIns);
@@ -2546,19 +2547,31 @@ bool Tracker::loadGenericFileType(const PPSystemString& fileName)
 	// check for compression
 	if (type == FileIdentificator::FileTypeCompressed)
 	{
-		// if this is compressed, we try to uncompress it
+		// if this is compressed, we try to uncompress it into memory
 		// and choose that file type
-		PPSystemString tempFile(ModuleEditor::getTempFilename());
+		XMFileBuffer* decompressedFile = new XMFileBuffer(fileName);
 		Decompressor decompressor(fileName);
-		if (decompressor.decompress(tempFile, (DecompressorBase::Hints)fileTypeToHint(FileTypes::FileTypeAllFiles)))
+		if (decompressor.decompress(*decompressedFile, (DecompressorBase::Hints)fileTypeToHint(FileTypes::FileTypeAllFiles)))
 		{
-			fileIdentificator = new FileIdentificator(tempFile);
+			fileIdentificator = new FileIdentificator(*decompressedFile, fileName);
 			type = fileIdentificator->getFileType();
 			delete fileIdentificator;
-			Decompressor::removeFile(tempFile);
+			
+			// modules are loaded from the decompressed data right away,
+			// see prepareLoading
+			if (type == FileIdentificator::FileTypeModule)
+			{
+				delete loadingParameters.decompressedFile;
+				loadingParameters.decompressedFile = decompressedFile;
+			}
+			else
+			{
+				delete decompressedFile;
+			}
 		}
 		else
 		{
+			delete decompressedFile;
 			showMessageBox(MESSAGEBOX_UNIVERSAL, "Unrecognized type/corrupt file", MessageBox_OK);			
 			return false;
 		}
@@ -2593,8 +2606,20 @@ bool Tracker::prepareLoading(FileTypes eType, const PPSystemString& fileName, bo
 
 	loadingParameters.res = true;
 	
+	// data which has already been decompressed by loadGenericFileType
+	XMFileBuffer* decompressedFile = loadingParameters.decompressedFile;
+	loadingParameters.decompressedFile = NULL;
+	if (eType != FileTypes::FileTypeSongAllModules)
+	{
+		delete decompressedFile;
+		decompressedFile = NULL;
+	}
+	
 	if (saveCheck && eType == FileTypes::FileTypeSongAllModules && !checkForChangesOpenModule())
+	{
+		delete decompressedFile;
 		return false;
+	}
 	
 	loadingParameters.lastError = "Error while loading/unknown format";	
 
@@ -2620,6 +2645,12 @@ bool Tracker::prepareLoading(FileTypes eType, const PPSystemString& fileName, bo
 		playerController->suspendPlayer();
 	}
 	
+	if (decompressedFile)
+	{
+		loadingParameters.decompressedFile = decompressedFile;
+		return true;
+	}
+	
 	// check for compressed file type
 	FileIdentificator* fileIdentificator = new FileIdentificator(fileName);
 	FileIdentificator::FileTypes type = fileIdentificator->getFileType();
@@ -2627,20 +2658,40 @@ bool Tracker::prepareLoading(FileTypes eType, const PPSystemString& fileName, bo
 	
 	if (type == FileIdentificator::FileTypeCompressed)
 	{
+		bool res = false;
+		
 		// if this is compressed, try to decompress
-		PPSystemString tempFile(ModuleEditor::getTempFilename());
-		Decompressor decompressor(fileName);
-		if (decompressor.decompress(tempFile, (DecompressorBase::Hints)fileTypeToHint(eType)))
+		if (eType == FileTypes::FileTypeSongAllModules)
 		{
-			// we compressed to a temporary file
-			// load that instead, but keep the original file name as preferred 
-			// base name for the module we're going to edit
-			loadingParameters.preferredFilename = loadingParameters.filename;
-			loadingParameters.filename = tempFile;
-			// delete file after loading, it's temporary
-			loadingParameters.deleteFile = true;
+			// modules can be loaded from memory
+			decompressedFile = new XMFileBuffer(fileName);
+			Decompressor decompressor(fileName);
+			res = decompressor.decompress(*decompressedFile, (DecompressorBase::Hints)fileTypeToHint(eType));
+			
+			if (res)
+				loadingParameters.decompressedFile = decompressedFile;
+			else
+				delete decompressedFile;
 		}
 		else
+		{
+			PPSystemString tempFile(ModuleEditor::getTempFilename());
+			Decompressor decompressor(fileName);
+			res = decompressor.decompressToFile(tempFile, (DecompressorBase::Hints)fileTypeToHint(eType));
+			
+			if (res)
+			{
+				// we compressed to a temporary file
+				// load that instead, but keep the original file name as preferred 
+				// base name for the module we're going to edit
+				loadingParameters.preferredFilename = loadingParameters.filename;
+				loadingParameters.filename = tempFile;
+				// delete file after loading, it's temporary
+				loadingParameters.deleteFile = true;
+			}
+		}
+		
+		if (!res)
 		{
 			loadingParameters.lastError = "Unrecognized type/corrupt file";
 			loadingParameters.res = false;
@@ -2674,6 +2725,9 @@ bool Tracker::finishLoading()
 	if (loadingParameters.deleteFile)
 		Decompressor::removeFile(loadingParameters.filename);
 		
+	delete loadingParameters.decompressedFile;
+	loadingParameters.decompressedFile = NULL;
+		
 	if (!loadingParameters.res && loadingParameters.didOpenTab)
 		tabManager->closeTab();
 	
@@ -2690,7 +2744,10 @@ bool Tracker::loadTypeFromFile(FileTypes eType, const PPSystemString& fileName,
 	{
 		case FileTypes::FileTypeSongAllModules:
 		{
-			if (loadingParameters.preferredFilename.length())
+			if (loadingParameters.decompressedFile)
+				loadingParameters.res = moduleEditor->openSong(*loadingParameters.decompressedFile,
+				loadingParameters.filename);
+			else if (loadingParameters.preferredFilename.length())
 				loadingParameters.res = moduleEditor->openSong(loadingParameters.filename,
 				loadingParameters.preferredFilename);
 			else
@@ -56,6 +56,7 @@ class PPMessageBoxContainer;
 class TrackerSettingsDatabase;
 class PPDictionaryKey;
 class PPFont;
+class XMFileBuffer;
 
 // OS Interfaces
 class PPSavePanel;
@@ -123,6 +124,8 @@ private:
 	
 	PatternEditorControl* patternEditorControl;
 	PeakLevelControl* peakLevelControl;
+	// xruns the peak level heading has been flashed for
+	pp_int32 peakLevelXRuns;
 	ScopesControl* scopesControl;
 	PPStaticText* playTimeText;
 	
@@ -383,11 +386,14 @@ private:
 		bool abortLoading;
 		bool deleteFile;
 		bool didOpenTab;
+		// decompressed module data, loaded without going through a temp file
+		XMFileBuffer* decompressedFile;
 		
 		TPrepareLoadingParameters() :
 			abortLoading(false),
 			deleteFile(false),
-			didOpenTab(false)
+			didOpenTab(false),
+			decompressedFile(NULL)
 		{
 		}
 	} loadingParameters;
@@ -39,6 +39,7 @@
 #include "Dictionary.h"
 #include "PatternEditorControl.h"
 #include "SampleEditorControl.h"
+#include "SampleUndoStore.h"
 #include "EnvelopeEditorControl.h"
 #include "SectionSamples.h"
 #include "SystemMessage.h"
@@ -75,6 +76,10 @@ void Tracker::buildDefaultSettings()
 #endif
 	settingsDatabase->store("MIXERVOLUME", 256);
 	settingsDatabase->store("MIXERSHIFT", 1);
+	settingsDatabase->store("FLOATMASTERBUS", 0);
+	settingsDatabase->store("MIXERTHREADS", 0);
+	settingsDatabase->store("RENDERAHEAD", 0);
+	settingsDatabase->store("DSPTRACEFILE", "");
 	settingsDatabase->store("RAMPING", 1);
 	settingsDatabase->store("INTERPOLATION", 1);
 	settingsDatabase->store("MIXERFREQ", PlayerMaster::getPreferredSampleRate());
@@ -171,6 +176,8 @@ void Tracker::buildDefaultSettings()
 
 	// Enable sample undobuffer by default
 	settingsDatabase->store("SAMPLEEDITORUNDOBUFFER", 1);
+	// Sample undo data kept in memory (in MB), the rest is swapped to disk
+	settingsDatabase->store("SAMPLEEDITORUNDOMEMORY", SampleUndoStore::DEFAULTMEMORYBUDGET >> 20);
 	// Auto-mixdown to mono when loading samples
 	settingsDatabase->store("AUTOMIXDOWNSAMPLES", 0);
 	// Hexadecimal offsets in the sample editor by default
@@ -300,6 +307,18 @@ void Tracker::applySettingByKey(PPDictionaryKey* theKey, TMixerSettings& setting
 	{
 		settings.powerOfTwoCompensation = v2;
 	}
+	else if (theKey->getKey().compareTo("FLOATMASTERBUS") == 0)
+	{
+		settings.floatMasterBus = v2;
+	}
+	else if (theKey->getKey().compareTo("MIXERTHREADS") == 0)
+	{
+		settings.numMixerThreads = v2;
+	}
+	else if (theKey->getKey().compareTo("RENDERAHEAD") == 0)
+	{
+		settings.numBuffersAhead = v2;
+	}
 	else if (theKey->getKey().compareTo("AUDIODRIVER") == 0)
 	{
 		settings.setAudioDriverName(theKey->getStringValue());
@@ -473,6 +492,10 @@ void Tracker::applySettingByKey(PPDictionaryKey* theKey, TMixerSettings& setting
 		if (sampleEditor)
 			sampleEditor->enableUndoStack(v2 != 0);
 	}
+	else if (theKey->getKey().compareTo("SAMPLEEDITORUNDOMEMORY") == 0)
+	{
+		SampleUndoStore::setMemoryBudget((pp_uint32)v2 << 20);
+	}
 	else if (theKey->getKey().compareTo("SAMPLEEDITORDECIMALOFFSETS") == 0)
 	{
 		if (sectionSamples)
@@ -506,6 +529,11 @@ void Tracker::applySettingByKey(PPDictionaryKey* theKey, TMixerSettings& setting
 			sectionDiskMenu->setCurrentPath(path, false);
 		}
 	}
+	else if (theKey->getKey().compareTo("DSPTRACEFILE") == 0)
+	{
+		PPSystemString fileName(theKey->getStringValue());
+		playerMaster->setDSPTraceFile(fileName);
+	}
 	else if (theKey->getKey().compareTo("AUTOESTPLAYTIME") == 0)
 	{
 		if (v2)
@@ -695,6 +723,9 @@ void Tracker::getMixerSettingsFromDatabase(TMixerSettings& mixerSettings,
 	mixerSettings.powerOfTwoCompensation = currentSettings.restore("FORCEPOWEROFTWOBUFFERSIZE")->getIntValue();
 	mixerSettings.resampler = currentSettings.restore("INTERPOLATION")->getIntValue();
 	mixerSettings.ramping = currentSettings.restore("RAMPING")->getIntValue();
+	mixerSettings.floatMasterBus = currentSettings.restore("FLOATMASTERBUS")->getIntValue();
+	mixerSettings.numMixerThreads = currentSettings.restore("MIXERTHREADS")->getIntValue();
+	mixerSettings.numBuffersAhead = currentSettings.restore("RENDERAHEAD")->getIntValue();
 	mixerSettings.setAudioDriverName(currentSettings.restore("AUDIODRIVER")->getStringValue());
 	mixerSettings.numVirtualChannels = currentSettings.restore("VIRTUALCHANNELS")->getIntValue();
 }
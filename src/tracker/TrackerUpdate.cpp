@@ -170,6 +170,24 @@ bool Tracker::updatePeakLevelControl()
 		bUpdateR = true;
 	}
 	
+	// DSP load, the heading flashes like clipping when the audio 
+	// device ran out of data
+	pp_int32 load, numXRuns;
+	playerMaster->getDSPLoad(load, numXRuns);
+	if (numXRuns != peakLevelXRuns)
+	{
+		peakLevelXRuns = numXRuns;
+		TitlePageManager titlePageManager(*screen);
+		titlePageManager.setPeakControlHeadingColor(TrackerConfig::colorPeakClipIndicator, false);
+		bUpdateEntire = true;
+	}
+	load = (load << 16) / 1000;
+	if (load != peakLevelControl->getLoad())
+	{
+		peakLevelControl->setLoad(load);
+		bUpdateL = true;
+	}
+	
 	if (bUpdateEntire)
 	{
 		screen->paintControl(screen->getControlByID(CONTAINER_ABOUT), false);
@@ -936,6 +954,8 @@ void Tracker::doFollowSong()
 	
 	bool updatePeak = updatePeakLevelControl();
 	
+	playerMaster->flushDSPTrace();
+	
 	bool updateScopes = false;
 	if (scopesControl && scopesControl->isVisible())
 	{
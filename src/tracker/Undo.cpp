@@ -33,35 +33,292 @@
 // Post    : 
 // Globals : 
 // I/O     : 
-// Task    : Create new stack entry
+// Task    : Compare two patterns and keep what has changed
 //---------------------------------------------------------------------------
-PatternUndoStackEntry::PatternUndoStackEntry(const TXMPattern& pattern, 
-											 const pp_int32 cursorPositionChannel, 
-											 const pp_int32 cursorPositionRow, 
-											 const pp_int32 cursorPositionInner,
-											 const UserData* userData/* = NULL*/) :
-	UndoStackEntry(userData)
+PatternUndoStackEntry::Diff::Diff(pp_int32 patternIndex, const TXMPattern& before, const TXMPattern& after) :
+	patternIndex(patternIndex),
+	rows(after.rows), channum(after.channum), effnum(after.effnum),
+	startRow(0), numRows(0),
+	startChannel(0), numChannels(0),
+	startByte(0), numBytes(0),
+	beforeData(NULL),
+	afterData(NULL),
+	layoutChanged(false),
+	beforePattern(),
+	afterPattern()
 {
-	this->cursorPositionChannel = cursorPositionChannel;
-	this->cursorPositionRow = cursorPositionRow;
-	this->cursorPositionInner = cursorPositionInner;
+	if (before.patternData == NULL || after.patternData == NULL)
+		return;
 	
-	if (pattern.patternData)
+	if (before.rows != after.rows ||
+		before.channum != after.channum ||
+		before.effnum != after.effnum)
 	{
-		this->pattern.rows = pattern.rows;
-		this->pattern.channum = pattern.channum;
-		this->pattern.effnum = pattern.effnum;
+		layoutChanged = true;
+		compressPattern(beforePattern, before);
+		compressPattern(afterPattern, after);
+		return;
+	}
+	
+	const pp_int32 slotSize = after.effnum*2 + 2;
+	const pp_int32 rowSize = slotSize * after.channum;
 	
-		this->pattern.len = pattern.compress(NULL);
+	pp_int32 endRow = -1, endChannel = -1, endByte = -1;
+	startRow = after.rows;
+	startChannel = after.channum;
+	startByte = slotSize;
+	
+	for (pp_int32 i = 0; i < after.rows; i++)
+	{
+		const mp_ubyte* src = before.patternData + i*rowSize;
+		const mp_ubyte* dst = after.patternData + i*rowSize;
 		
-		this->pattern.patternData = new mp_ubyte[this->pattern.len];
-
-		mp_sint32 len = pattern.compress(this->pattern.patternData);
+		if (memcmp(src, dst, rowSize) == 0)
+			continue;
+			
+		if (i < startRow) startRow = i;
+		endRow = i;
 		
-		ASSERT(len == (signed)this->pattern.len);
+		for (pp_int32 j = 0; j < after.channum; j++)
+		{
+			for (pp_int32 k = 0; k < slotSize; k++)
+			{
+				if (src[j*slotSize+k] == dst[j*slotSize+k])
+					continue;
+				
+				if (j < startChannel) startChannel = j;
+				if (j > endChannel) endChannel = j;
+				if (k < startByte) startByte = k;
+				if (k > endByte) endByte = k;
+			}
+		}
+	}
+	
+	if (endRow < 0)
+	{
+		startRow = startChannel = startByte = 0;
+		return;
+	}
+	
+	numRows = endRow - startRow + 1;
+	numChannels = endChannel - startChannel + 1;
+	numBytes = endByte - startByte + 1;
+	
+	const pp_int32 size = numRows*numChannels*numBytes;
+	beforeData = new mp_ubyte[size];
+	afterData = new mp_ubyte[size];
+	
+	mp_ubyte* beforePtr = beforeData;
+	mp_ubyte* afterPtr = afterData;
+	for (pp_int32 i = startRow; i < startRow + numRows; i++)
+	{
+		for (pp_int32 j = startChannel; j < startChannel + numChannels; j++)
+		{
+			const pp_int32 offset = i*rowSize + j*slotSize + startByte;
+			memcpy(beforePtr, before.patternData + offset, numBytes);
+			memcpy(afterPtr, after.patternData + offset, numBytes);
+			beforePtr+=numBytes;
+			afterPtr+=numBytes;
+		}
+	}
+}
+
+PatternUndoStackEntry::Diff::Diff(const Diff& src) :
+	beforeData(NULL),
+	afterData(NULL),
+	beforePattern(),
+	afterPattern()
+{
+	copyFrom(src);
+}
+
+PatternUndoStackEntry::Diff::~Diff()
+{
+	delete[] beforeData;
+	delete[] afterData;
+	delete[] beforePattern.patternData;
+	delete[] afterPattern.patternData;
+}
+
+PatternUndoStackEntry::Diff& PatternUndoStackEntry::Diff::operator=(const Diff& src)
+{
+	if (this != &src)
+		copyFrom(src);
+	
+	return *this;
+}
+
+void PatternUndoStackEntry::Diff::copyFrom(const Diff& src)
+{
+	delete[] beforeData;
+	delete[] afterData;
+	delete[] beforePattern.patternData;
+	delete[] afterPattern.patternData;
+
+	patternIndex = src.patternIndex;
+	rows = src.rows;
+	channum = src.channum;
+	effnum = src.effnum;
+	startRow = src.startRow;
+	numRows = src.numRows;
+	startChannel = src.startChannel;
+	numChannels = src.numChannels;
+	startByte = src.startByte;
+	numBytes = src.numBytes;
+	layoutChanged = src.layoutChanged;
+	
+	beforeData = afterData = NULL;
+	if (src.beforeData)
+	{
+		const pp_int32 size = numRows*numChannels*numBytes;
+		beforeData = new mp_ubyte[size];
+		afterData = new mp_ubyte[size];
+		memcpy(beforeData, src.beforeData, size);
+		memcpy(afterData, src.afterData, size);
+	}
+
+	copyCompressedPattern(beforePattern, src.beforePattern);
+	copyCompressedPattern(afterPattern, src.afterPattern);
+}
+
+void PatternUndoStackEntry::Diff::compressPattern(TXMPattern& dst, const TXMPattern& src)
+{
+	dst.rows = src.rows;
+	dst.channum = src.channum;
+	dst.effnum = src.effnum;
+
+	dst.len = src.compress(NULL);
+	
+	dst.patternData = new mp_ubyte[dst.len];
+
+	mp_sint32 len = src.compress(dst.patternData);
+	
+	ASSERT(len == (signed)dst.len);
+}
+
+void PatternUndoStackEntry::Diff::copyCompressedPattern(TXMPattern& dst, const TXMPattern& src)
+{
+	// TXMPattern::operator= would copy the uncompressed size
+	dst.len = src.len;
+	dst.ptype = src.ptype;
+	dst.rows = src.rows;
+	dst.effnum = src.effnum;
+	dst.channum = src.channum;
+	dst.patdata = src.patdata;
+	dst.patternData = NULL;
+	
+	if (src.patternData)
+	{
+		dst.patternData = new mp_ubyte[src.len];
+		memcpy(dst.patternData, src.patternData, src.len);
+	}
+}
+
+bool PatternUndoStackEntry::Diff::decompressPattern(TXMPattern& dst, const TXMPattern& src)
+{
+	if (src.rows != dst.rows ||
+		src.channum != dst.channum ||
+		src.effnum != dst.effnum)
+	{
+		dst.rows = src.rows;
+		dst.channum = src.channum;
+		dst.effnum = src.effnum;
+	
+		mp_sint32 patternSize = dst.rows*dst.channum*(2+dst.effnum*2);	
+
+		delete[] dst.patternData;
+		dst.patternData = new mp_ubyte[patternSize];
+		memset(dst.patternData, 0, patternSize);
+	}
+	
+	dst.decompress(src.patternData, src.len);
+	return true;
+}
+
+void PatternUndoStackEntry::Diff::resizePattern(TXMPattern& pattern, pp_int32 rows, pp_int32 channum, pp_int32 effnum)
+{
+	const pp_int32 slotSize = effnum*2 + 2;
+	const pp_int32 srcSlotSize = pattern.effnum*2 + 2;
+	const pp_int32 patternSize = rows*channum*slotSize;
+
+	mp_ubyte* patternData = new mp_ubyte[patternSize];
+	memset(patternData, 0, patternSize);
+	
+	// keep what fits into the new layout
+	const pp_int32 copyRows = rows < pattern.rows ? rows : pattern.rows;
+	const pp_int32 copyChannels = channum < pattern.channum ? channum : pattern.channum;
+	const pp_int32 copyBytes = slotSize < srcSlotSize ? slotSize : srcSlotSize;
+	
+	for (pp_int32 i = 0; i < copyRows; i++)
+		for (pp_int32 j = 0; j < copyChannels; j++)
+			memcpy(patternData + (i*channum + j)*slotSize, 
+				   pattern.patternData + (i*pattern.channum + j)*srcSlotSize, copyBytes);
+	
+	delete[] pattern.patternData;
+	pattern.patternData = patternData;
+	pattern.rows = rows;
+	pattern.channum = channum;
+	pattern.effnum = effnum;
+}
+
+bool PatternUndoStackEntry::Diff::apply(TXMPattern& pattern, bool undo) const
+{
+	if (pattern.patternData == NULL)
+		return false;
+
+	if (layoutChanged)
+		return decompressPattern(pattern, undo ? beforePattern : afterPattern);
+	
+	// the pattern has been resized without undo or by a step which is 
+	// not on the same stack, the cells only make sense in the old layout
+	if (pattern.rows != rows ||
+		pattern.channum != channum ||
+		pattern.effnum != effnum)
+		resizePattern(pattern, rows, channum, effnum);
+
+	const pp_int32 slotSize = pattern.effnum*2 + 2;
+	const pp_int32 rowSize = slotSize * pattern.channum;
+	
+	// only the bytes this step has changed, the rectangle may cover cells
+	// which have been edited by a later step on another stack
+	const mp_ubyte* src = undo ? beforeData : afterData;
+	const mp_ubyte* other = undo ? afterData : beforeData;
+	for (pp_int32 i = startRow; i < startRow + numRows; i++)
+	{
+		for (pp_int32 j = startChannel; j < startChannel + numChannels; j++)
+		{
+			mp_ubyte* dst = pattern.patternData + i*rowSize + j*slotSize + startByte;
+			for (pp_int32 k = 0; k < numBytes; k++)
+				if (src[k] != other[k])
+					dst[k] = src[k];
+			src+=numBytes;
+			other+=numBytes;
+		}
 	}
-	else
-		memset(&this->pattern, 0, sizeof(pattern));
+	
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// Pre     : 
+// Post    : 
+// Globals : 
+// I/O     : 
+// Task    : Create new stack entry, diffs are added with addDiff()
+//---------------------------------------------------------------------------
+PatternUndoStackEntry::PatternUndoStackEntry(const CursorPosition& cursorBefore,
+											 const CursorPosition& cursorAfter,
+											 const UserData* userDataBefore/* = NULL*/,
+											 const UserData* userDataAfter/* = NULL*/) :
+	UndoStackEntry(userDataBefore),
+	cursorBefore(cursorBefore),
+	cursorAfter(cursorAfter),
+	sequence(0),
+	diffs(NULL),
+	numDiffs(0)
+{
+	if (userDataAfter)
+		this->userDataAfter = *userDataAfter;
 }
 
 //---------------------------------------------------------------------------
@@ -72,19 +329,15 @@ PatternUndoStackEntry::PatternUndoStackEntry(const TXMPattern& pattern,
 // Task    : Copy constructor
 //---------------------------------------------------------------------------
 PatternUndoStackEntry::PatternUndoStackEntry(const PatternUndoStackEntry& source) :
-	UndoStackEntry(&source.getUserData())
+	UndoStackEntry(&source.getUserData()),
+	cursorBefore(source.cursorBefore),
+	cursorAfter(source.cursorAfter),
+	userDataAfter(source.userDataAfter),
+	sequence(source.sequence),
+	diffs(NULL),
+	numDiffs(0)
 {
-	cursorPositionChannel = source.cursorPositionChannel;
-	cursorPositionRow = source.cursorPositionRow;
-	cursorPositionInner = source.cursorPositionInner;
-
-	pattern.len = source.pattern.len;
-	pattern.rows = source.pattern.rows;
-	pattern.channum = source.pattern.channum;
-	pattern.effnum = source.pattern.effnum;
-	
-	pattern.patternData = new mp_ubyte[pattern.len];
-	memcpy(pattern.patternData, source.pattern.patternData, pattern.len);
+	copyDiffs(source);
 }
 
 //---------------------------------------------------------------------------
@@ -96,7 +349,7 @@ PatternUndoStackEntry::PatternUndoStackEntry(const PatternUndoStackEntry& source
 //---------------------------------------------------------------------------
 PatternUndoStackEntry::~PatternUndoStackEntry()
 {
-	delete[] pattern.patternData;
+	freeDiffs();
 }
 
 //---------------------------------------------------------------------------
@@ -113,54 +366,57 @@ PatternUndoStackEntry& PatternUndoStackEntry::operator=(const PatternUndoStackEn
 	{
 		copyBasePart(source);
 	
-		cursorPositionChannel = source.cursorPositionChannel;
-		cursorPositionRow = source.cursorPositionRow;
-		cursorPositionInner = source.cursorPositionInner;	
+		cursorBefore = source.cursorBefore;
+		cursorAfter = source.cursorAfter;
+		userDataAfter = source.userDataAfter;
+		sequence = source.sequence;
 		
-		if (pattern.patternData)
-			delete[] pattern.patternData;
-	
-		pattern.len = source.pattern.len;
-		pattern.rows = source.pattern.rows;
-		pattern.channum = source.pattern.channum;
-		pattern.effnum = source.pattern.effnum;
-		
-		pattern.patternData = new mp_ubyte[pattern.len];
-		memcpy(pattern.patternData, source.pattern.patternData, pattern.len);
+		freeDiffs();
+		copyDiffs(source);
 	}
 
 	return *this;
 }
 
-//---------------------------------------------------------------------------
-// Pre     : 
-// Post    : 
-// Globals : 
-// I/O     : 
-// Task    : comparison operators
-//---------------------------------------------------------------------------
-bool PatternUndoStackEntry::operator==(const PatternUndoStackEntry& source)
+void PatternUndoStackEntry::addDiff(pp_int32 patternIndex, const TXMPattern& before, const TXMPattern& after)
 {
-	ASSERT(source.pattern.patternData);
-	ASSERT(pattern.patternData);
+	Diff* diff = new Diff(patternIndex, before, after);
+	if (diff->isEmpty())
+	{
+		delete diff;
+		return;
+	}
+	
+	Diff** newDiffs = new Diff*[numDiffs+1];
+	for (pp_int32 i = 0; i < numDiffs; i++)
+		newDiffs[i] = diffs[i];
+	newDiffs[numDiffs++] = diff;
+	
+	delete[] diffs;
+	diffs = newDiffs;
+}
 
-	if (pattern.len == source.pattern.len &&
-		pattern.rows == source.pattern.rows &&
-		pattern.channum == source.pattern.channum &&
-		pattern.effnum == source.pattern.effnum)
+void PatternUndoStackEntry::copyDiffs(const PatternUndoStackEntry& source)
+{
+	numDiffs = source.numDiffs;
+	diffs = NULL;
+	
+	if (numDiffs)
 	{
-		if (memcmp(pattern.patternData, source.pattern.patternData, pattern.len) == 0)
-			return true;
-		else
-			return false;
+		diffs = new Diff*[numDiffs];
+		for (pp_int32 i = 0; i < numDiffs; i++)
+			diffs[i] = new Diff(*source.diffs[i]);
 	}
-	else
-		return false;
 }
 
-bool PatternUndoStackEntry::operator!=(const PatternUndoStackEntry& source)
+void PatternUndoStackEntry::freeDiffs()
 {
-	return !(*this==source);
+	for (pp_int32 i = 0; i < numDiffs; i++)
+		delete diffs[i];
+	
+	delete[] diffs;
+	diffs = NULL;
+	numDiffs = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -229,21 +485,32 @@ void EnvelopeUndoStackEntry::GetEnvelope(TEnvelope& env) const
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //														samples
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void SampleUndoStackEntry::calcCheckSum()
+void SampleUndoStackEntry::copyChunks(const SampleUndoStackEntry& src)
 {
-	checkSum = 0;
-	if (!buffer)
-		return;
-	mp_uint32 size = (flags & 16) ? samplen*2 : samplen;
-	if (size)
+	chunks = NULL;
+	numChunks = src.numChunks;
+	
+	if (numChunks)
 	{
-		mp_ubyte* mem = TXMSample::getPadStartAddr(buffer);
-		mp_uint32 realSize = TXMSample::getPaddedSize(size);
-		for (pp_uint32 i = 0; i < realSize; i++)
-			checkSum+=(pp_uint32)mem[i];		
+		chunks = new SampleUndoStore::Chunk*[numChunks];
+		for (pp_uint32 i = 0; i < numChunks; i++)
+		{
+			chunks[i] = src.chunks[i];
+			SampleUndoStore::retain(chunks[i]);
+		}
 	}
 }
 
+void SampleUndoStackEntry::releaseChunks()
+{
+	for (pp_uint32 i = 0; i < numChunks; i++)
+		SampleUndoStore::release(chunks[i]);
+	
+	delete[] chunks;
+	chunks = NULL;
+	numChunks = 0;
+}
+
 SampleUndoStackEntry::SampleUndoStackEntry(const TXMSample& sample, 
 										   pp_int32 selectionStart, pp_int32 selectionEnd, 
 										   const UserData* userData/* = NULL*/) :
@@ -258,26 +525,24 @@ SampleUndoStackEntry::SampleUndoStackEntry(const TXMSample& sample,
 	this->selectionStart = selectionStart;
 	this->selectionEnd = selectionEnd;
 	
-	buffer = NULL;
-
-	checkSum = 0;
+	chunks = NULL;
+	numChunks = 0;
 	
 	if (sample.samplen && sample.sample)
 	{
-		// 16 bit sample
-		if (flags & 16)
-		{
-			buffer = TXMSample::allocPaddedMem(samplen*2);
-			if (buffer)
-				TXMSample::copyPaddedMem(buffer, sample.sample, samplen*2);				
-		}
-		else
+		// save the padding too, it holds the loop area backup
+		const mp_uint32 size = TXMSample::getPaddedSize((flags & 16) ? samplen*2 : samplen);
+		const pp_uint8* mem = TXMSample::getPadStartAddr((mp_ubyte*)sample.sample);
+
+		numChunks = (size + SampleUndoStore::CHUNKSIZE - 1) / SampleUndoStore::CHUNKSIZE;
+		chunks = new SampleUndoStore::Chunk*[numChunks];
+		
+		for (pp_uint32 i = 0; i < numChunks; i++)
 		{
-			buffer = TXMSample::allocPaddedMem(samplen);
-			if (buffer)
-				TXMSample::copyPaddedMem(buffer, sample.sample, samplen);
+			const pp_uint32 offset = i * SampleUndoStore::CHUNKSIZE;
+			const pp_uint32 chunkSize = (size - offset) < SampleUndoStore::CHUNKSIZE ? (size - offset) : SampleUndoStore::CHUNKSIZE;
+			chunks[i] = SampleUndoStore::store(mem + offset, chunkSize);
 		}
-		calcCheckSum();
 	}
 }
 
@@ -290,32 +555,15 @@ SampleUndoStackEntry::SampleUndoStackEntry(const SampleUndoStackEntry& src)	:
 	relnote = src.relnote;
 	finetune = src.finetune;
 	flags = src.flags;
-	checkSum = src.checkSum;
 	this->selectionStart = src.selectionStart;
 	this->selectionEnd = src.selectionEnd;
 	
-	buffer = NULL;
-	if (src.buffer && samplen)
-	{	
-		// 16 bit sample
-		if (flags & 16)
-		{			
-			buffer = TXMSample::allocPaddedMem(samplen*2);
-			if (buffer)
-				TXMSample::copyPaddedMem(buffer, src.buffer, samplen*2);
-		}
-		else
-		{
-			buffer = TXMSample::allocPaddedMem(samplen);
-			if (buffer)
-				TXMSample::copyPaddedMem(buffer, src.buffer, samplen);
-		}	
-	}
+	copyChunks(src);
 }
 
 SampleUndoStackEntry::~SampleUndoStackEntry()
 {
-	TXMSample::freePaddedMem(buffer);
+	releaseChunks();
 }
 
 // assignment operator
@@ -331,30 +579,9 @@ SampleUndoStackEntry& SampleUndoStackEntry::operator=(const SampleUndoStackEntry
 		relnote = src.relnote;
 		finetune = src.finetune;
 		flags = src.flags;
-		checkSum = src.checkSum;
 		
-		if (buffer)
-		{
-			TXMSample::freePaddedMem(buffer);
-			buffer = NULL;
-		}
-		
-		if (src.buffer && samplen)
-		{	
-			// 16 bit sample
-			if (flags & 16)
-			{
-				buffer = TXMSample::allocPaddedMem(samplen*2);
-				if (buffer)
-					TXMSample::copyPaddedMem(buffer, src.buffer, samplen*2);
-			}
-			else
-			{
-				buffer = TXMSample::allocPaddedMem(samplen);
-				if (buffer)
-					TXMSample::copyPaddedMem(buffer, src.buffer, samplen);
-			}	
-		}
+		releaseChunks();
+		copyChunks(src);
 	}
 
 	return (*this);
@@ -366,9 +593,6 @@ bool SampleUndoStackEntry::operator==(const SampleUndoStackEntry& src)
 	if (samplen != src.samplen)
 		return false;
 		
-	if (checkSum != src.checkSum)
-		return false;
-
 	if (loopstart != src.loopstart)
 		return false;
 		
@@ -384,25 +608,13 @@ bool SampleUndoStackEntry::operator==(const SampleUndoStackEntry& src)
 	if (flags != src.flags)
 		return false;
 	
-	if (buffer == NULL && src.buffer != NULL)
-		return false;
-
-	if (buffer != NULL && src.buffer == NULL)
+	if (numChunks != src.numChunks)
 		return false;
 	
-	mp_uint32 size = (flags & 16) ? samplen*2 : samplen;
-	if (size)
-	{
-		mp_ubyte* _src = src.buffer;
-		mp_ubyte* _dst = buffer;
-
-		mp_ubyte* srcmem = TXMSample::getPadStartAddr(_src);
-		mp_ubyte* dstmem = TXMSample::getPadStartAddr(_dst);
-		mp_uint32 realSize = TXMSample::getPaddedSize(size);
-		for (pp_uint32 i = 0; i < realSize; i++)
-			if (srcmem[i] != dstmem[i])
-				return false;
-	}
+	// identical chunks are only stored once
+	for (pp_uint32 i = 0; i < numChunks; i++)
+		if (chunks[i] != src.chunks[i])
+			return false;
 
 	return true;
 }
@@ -411,3 +623,20 @@ bool SampleUndoStackEntry::operator!=(const SampleUndoStackEntry& source)
 {
 	return !(*this==source);
 }
+
+bool SampleUndoStackEntry::restoreBuffer(mp_sbyte* sample) const
+{
+	pp_uint8* mem = TXMSample::getPadStartAddr((mp_ubyte*)sample);
+	// the saved padding might come from a bigger buffer, keep our size
+	const mp_uint32 size = TXMSample::getSampleSizeInBytes((mp_ubyte*)sample);
+	
+	for (pp_uint32 i = 0; i < numChunks; i++)
+	{
+		if (!SampleUndoStore::load(chunks[i], mem))
+			return false;
+		mem+=SampleUndoStore::getSize(chunks[i]);
+	}
+	
+	TXMSample::setSampleSizeInBytes((mp_ubyte*)sample, size);
+	return true;
+}
@@ -25,6 +25,7 @@
 
 #include "BasicTypes.h"
 #include "UndoStack.h"
+#include "SampleUndoStore.h"
 #include "XModule.h"
 
 #define UNDODEPTH_ENVELOPEEDITOR		32
@@ -122,43 +123,106 @@ public:
 	
 };
 
-// Undo information from pattern editor
+// Undo information from pattern editor, keeps only what an operation 
+// has changed, an operation on the whole song keeps a diff per pattern
 class PatternUndoStackEntry : public UndoStackEntry
 {
 public:
-	// Construction (new element)
-	PatternUndoStackEntry(const TXMPattern& pattern, 
-						  const pp_int32 cursorPositionChannel, 
-						  const pp_int32 cursorPositionRow, 
-						  const pp_int32 cursorPositionInner,
-						  const UserData* userData = NULL);
+	struct CursorPosition
+	{
+		pp_int32 channel;
+		pp_int32 row;
+		pp_int32 inner;
+	};
+
+	class Diff
+	{
+	private:
+		// index of the pattern in the module, -1 for the edited pattern
+		pp_int32 patternIndex;
+		
+		// same layout before and after: the layout of the pattern and the
+		// bounding box of the changed rows x channels x bytes within a slot
+		pp_int32 rows, channum, effnum;
+		pp_int32 startRow, numRows;
+		pp_int32 startChannel, numChannels;
+		pp_int32 startByte, numBytes;
+		mp_ubyte* beforeData;
+		mp_ubyte* afterData;
+		
+		// layout has changed (resize, expand...): both patterns compressed
+		bool layoutChanged;
+		TXMPattern beforePattern;
+		TXMPattern afterPattern;
+
+		void copyFrom(const Diff& src);
+		
+		static void compressPattern(TXMPattern& dst, const TXMPattern& src);
+		static void copyCompressedPattern(TXMPattern& dst, const TXMPattern& src);
+		static bool decompressPattern(TXMPattern& dst, const TXMPattern& src);
+		static void resizePattern(TXMPattern& pattern, pp_int32 rows, pp_int32 channum, pp_int32 effnum);
+		
+	public:
+		Diff(pp_int32 patternIndex, const TXMPattern& before, const TXMPattern& after);
+		Diff(const Diff& src);
+		~Diff();
+		
+		Diff& operator=(const Diff& src);
+		
+		bool isEmpty() const { return !layoutChanged && numBytes == 0; }
+		
+		pp_int32 getPatternIndex() const { return patternIndex; }
+		bool getLayoutChanged() const { return layoutChanged; }
+		pp_int32 getStartRow() const { return startRow; }
+		pp_int32 getNumRows() const { return numRows; }
+		pp_int32 getStartChannel() const { return startChannel; }
+		pp_int32 getNumChannels() const { return numChannels; }
+		
+		// write the state before (undo) or after (redo) into the pattern,
+		// a pattern which has been resized since is brought back to the
+		// layout the diff has been made with
+		bool apply(TXMPattern& pattern, bool undo) const;
+	};
+
+	PatternUndoStackEntry(const CursorPosition& cursorBefore,
+						  const CursorPosition& cursorAfter,
+						  const UserData* userDataBefore = NULL,
+						  const UserData* userDataAfter = NULL);
 	// Copy ctor
 	PatternUndoStackEntry(const PatternUndoStackEntry& source);
 
 	// dtor
 	virtual ~PatternUndoStackEntry();
 
-	// get your pattern
-	const TXMPattern& GetPattern() const { return pattern; }
-
-	pp_int32 getCursorPositionChannel() const { return cursorPositionChannel; }
-	pp_int32 getCursorPositionRow() const { return cursorPositionRow; }
-	pp_int32 getCursorPositionInner() const { return cursorPositionInner; }
-
 	// assignment operator
 	PatternUndoStackEntry& operator=(const PatternUndoStackEntry& source);
+
+	// diff is only kept if something has changed
+	void addDiff(pp_int32 patternIndex, const TXMPattern& before, const TXMPattern& after);
+
+	bool isEmpty() const { return numDiffs == 0; }
 	
-	// comparison is necessary too
-	bool operator==(const PatternUndoStackEntry& source);
-	bool operator!=(const PatternUndoStackEntry& source);
+	// tells the order of entries on different stacks
+	void setSequence(pp_uint32 sequence) { this->sequence = sequence; }
+	pp_uint32 getSequence() const { return sequence; }
+	pp_int32 getNumDiffs() const { return numDiffs; }
+	const Diff& getDiff(pp_int32 index) const { return *diffs[index]; }
 
+	const CursorPosition& getCursorPosition(bool undo) const { return undo ? cursorBefore : cursorAfter; }
+	using UndoStackEntry::getUserData;
+	const UserData& getUserData(bool undo) const { return undo ? getUserData() : userDataAfter; }
 
 private:	
-	TXMPattern pattern;
+	CursorPosition cursorBefore;
+	CursorPosition cursorAfter;
+	UserData userDataAfter;
+	pp_uint32 sequence;
+
+	Diff** diffs;
+	pp_int32 numDiffs;
 	
-	pp_int32 cursorPositionChannel;
-	pp_int32 cursorPositionRow;
-	pp_int32 cursorPositionInner;
+	void copyDiffs(const PatternUndoStackEntry& source);
+	void freeDiffs();
 };
 
 // Less memory consumption than TEnvelope because XMs can only handle 12 envelope points
@@ -228,7 +292,9 @@ class SampleUndoStackEntry : public UndoStackEntry
 {
 public:
 	SampleUndoStackEntry() : 
-		UndoStackEntry(NULL)
+		UndoStackEntry(NULL),
+		chunks(NULL),
+		numChunks(0)
 	{
 	}
 
@@ -255,7 +321,10 @@ public:
 	mp_sbyte getRelNote() const { return relnote; }
 	mp_sbyte getFineTune() const { return finetune; }
 	
-	const pp_uint8* getBuffer() const { return buffer; }
+	bool hasBuffer() const { return numChunks != 0; }
+	// copy the saved sample data into sample memory allocated 
+	// with TXMSample::allocPaddedMem(), including the padding
+	bool restoreBuffer(mp_sbyte* sample) const;
 	
 	pp_int32 getSelectionStart() const { return selectionStart; }
 	pp_int32 getSelectionEnd() const { return selectionEnd; }
@@ -264,34 +333,36 @@ private:
 	// from sample
 	pp_uint32 samplen, loopstart, looplen;
 	mp_sbyte relnote, finetune;
-	pp_uint8* buffer;
 	pp_uint8 flags;
 
+	// padded sample memory, shared with other entries chunk by chunk
+	SampleUndoStore::Chunk** chunks;
+	pp_uint32 numChunks;
+
 	// from sample editor
 	pp_int32 selectionStart;
 	pp_int32 selectionEnd;
 
-	pp_int32 checkSum;
-	
-	void calcCheckSum();
+	void copyChunks(const SampleUndoStackEntry& src);
+	void releaseChunks();
 };
 
 // undo history maintainance
-template<class Key, class Type>
+template<class Key, class Stack>
 struct HistoryEntry
 {
 	Key* key;
-	PPUndoStack<Type>* undoStack;	
+	Stack* undoStack;	
 };
 
-template<class Key, class Type>
+template<class Key, class Type, class Stack = PPUndoStack<Type> >
 class UndoHistory
 {
 private:
 	// undo/redo information
-	PPUndoStack<Type>* currentUndoStack;	
+	Stack* currentUndoStack;	
 
-	HistoryEntry<Key, Type>* patternHistory;
+	HistoryEntry<Key, Stack>* patternHistory;
 	pp_int32 patternHistoryNumEntries;
 
 	pp_int32 size;
@@ -302,7 +373,7 @@ public:
 		patternHistoryNumEntries(0),
 		size(defaultSize)
 	{
-		patternHistory = new HistoryEntry<Key, Type>[size];
+		patternHistory = new HistoryEntry<Key, Stack>[size];
 		for (pp_int32 i = 0; i < size; i++)
 		{
 			patternHistory[i].key = NULL;
@@ -319,7 +390,7 @@ public:
 		delete[] patternHistory;
 	}
 	
-	PPUndoStack<Type>* getUndoStack(Key* newKey, Key* oldKey, PPUndoStack<Type>* oldUndoStack)
+	Stack* getUndoStack(Key* newKey, Key* oldKey, Stack* oldUndoStack)
 	{
 		if (oldUndoStack)
 		{